@@ -0,0 +1,274 @@
+/**
+ * leafOS - 主机端基准测试框架实现
+ *
+ * 每组配置(参数, 线程数)先用少量迭代试跑，按耗时外推迭代次数，直到一次运行不少于最短时间。
+ * 多线程时各线程迭代次数相同，在屏障后同时开始；耗时取最早开始到最晚结束的墙钟时间
+ */
+
+#include "hostbench.hpp"
+
+#include <page_alloc.hpp>
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+namespace hostbench {
+
+namespace {
+
+struct Options {
+    const char* filter   = nullptr;
+    double      min_time = 0.2;
+    bool        csv      = false;
+};
+
+std::vector<Benchmark*>& registry()
+{
+    static std::vector<Benchmark*> list;
+    return list;
+}
+
+uint64_t now_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// 进程允许使用的CPU，线程依次绑定，不够时循环使用
+std::vector<int> usable_cpus()
+{
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int i = 0; i < CPU_SETSIZE; i++) {
+            if (CPU_ISSET(i, &set)) {
+                cpus.push_back(i);
+            }
+        }
+    }
+    if (cpus.empty()) {
+        cpus.push_back(0);
+    }
+    return cpus;
+}
+
+struct Run {
+    Function          fn;
+    int64_t           arg;
+    int               threads;
+    uint64_t          iterations;
+    pthread_barrier_t barrier;
+    uint64_t          start_ns;     // 各线程中最早的开始时刻
+    uint64_t          end_ns;       // 各线程中最晚的结束时刻
+    uint64_t          bytes;
+};
+
+struct Worker {
+    Run*      run;
+    int       index;
+    int       cpu;
+    pthread_t thread;
+};
+
+void* worker_main(void* p)
+{
+    Worker* w = static_cast<Worker*>(p);
+    Run* run = w->run;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(w->cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+    State state(run->iterations, run->arg, w->index, run->threads);
+    pthread_barrier_wait(&run->barrier);
+    uint64_t t0 = now_ns();
+    run->fn(state);
+    uint64_t t1 = now_ns();
+
+    uint64_t cur = __atomic_load_n(&run->start_ns, __ATOMIC_RELAXED);
+    while (t0 < cur && !__atomic_compare_exchange_n(&run->start_ns, &cur, t0, false,
+                                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    cur = __atomic_load_n(&run->end_ns, __ATOMIC_RELAXED);
+    while (t1 > cur && !__atomic_compare_exchange_n(&run->end_ns, &cur, t1, false,
+                                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    if (w->index == 0) {
+        run->bytes = state.bytes_per_iteration();
+    }
+    return nullptr;
+}
+
+// 以给定迭代次数运行一次，返回墙钟耗时(纳秒)
+uint64_t run_once(Run& run, const std::vector<int>& cpus)
+{
+    std::vector<Worker> workers((size_t)run.threads);
+    run.start_ns = ~0ull;
+    run.end_ns = 0;
+    pthread_barrier_init(&run.barrier, nullptr, (unsigned)run.threads);
+    for (int i = 0; i < run.threads; i++) {
+        Worker& w = workers[(size_t)i];
+        w.run = &run;
+        w.index = i;
+        w.cpu = cpus[(size_t)i % cpus.size()];
+        if (pthread_create(&w.thread, nullptr, worker_main, &w) != 0) {
+            fprintf(stderr, "hostbench: 无法创建线程\n");
+            exit(1);
+        }
+    }
+    for (Worker& w : workers) {
+        pthread_join(w.thread, nullptr);
+    }
+    pthread_barrier_destroy(&run.barrier);
+    return run.end_ns - run.start_ns;
+}
+
+void report(const Options& opt, const char* name, const Run& run, uint64_t elapsed)
+{
+    double ns_per_op = (double)elapsed / (double)run.iterations;
+    double ops_per_s = (double)run.iterations * run.threads * 1e9 / (double)elapsed;
+    double mib_per_s = (double)run.bytes * run.iterations * run.threads * 1e9
+                     / (double)elapsed / (1024.0 * 1024.0);
+    if (opt.csv) {
+        printf("%s,%d,%llu,%.2f,%.0f,%.1f\n", name, run.threads,
+               (unsigned long long)run.iterations, ns_per_op, ops_per_s, mib_per_s);
+        return;
+    }
+    printf("%-40s %12llu %12.2f %14.0f", name, (unsigned long long)run.iterations,
+           ns_per_op, ops_per_s);
+    if (run.bytes) {
+        printf(" %12.1f MiB/s", mib_per_s);
+    }
+    printf("\n");
+}
+
+void run_benchmark(const Options& opt, const Benchmark& b, int64_t arg, bool has_arg,
+                   int threads, const std::vector<int>& cpus)
+{
+    char name[128];
+    int len = snprintf(name, sizeof(name), "%s", b.name());
+    if (has_arg) {
+        len += snprintf(name + len, sizeof(name) - (size_t)len, "/%lld", (long long)arg);
+    }
+    snprintf(name + len, sizeof(name) - (size_t)len, "/threads:%d", threads);
+    if (opt.filter && !strstr(name, opt.filter)) {
+        return;
+    }
+
+    Run run;
+    run.fn = b.function();
+    run.arg = arg;
+    run.threads = threads;
+    run.iterations = 1;
+    run.bytes = 0;
+
+    // 第一次运行含有基准自身的准备工作(映射内存、生成输入)，只用来外推，不作为结果
+    const uint64_t min_ns = (uint64_t)(opt.min_time * 1e9);
+    for (bool warm = false;; warm = true) {
+        uint64_t elapsed = run_once(run, cpus);
+        if (warm && (elapsed >= min_ns || run.iterations >= 1000000000ull)) {
+            report(opt, name, run, elapsed);
+            return;
+        }
+        // 按比例外推并多留余量，每轮最多放大100倍，以免试跑时间太短导致估计失真
+        double scale = elapsed ? (double)min_ns * 1.4 / (double)elapsed : 100.0;
+        scale = scale > 100.0 ? 100.0 : (scale < 1.0 ? 1.0 : scale);
+        run.iterations = (uint64_t)((double)run.iterations * scale);
+    }
+}
+
+void usage(const char* prog)
+{
+    fprintf(stderr,
+            "用法: %s [--filter=<子串>] [--min-time=<秒>] [--csv]\n"
+            "  --filter    只运行名字中含有该子串的基准\n"
+            "  --min-time  每组配置单次运行的最短时间，默认0.2秒\n"
+            "  --csv       以CSV格式输出\n", prog);
+}
+
+} // namespace
+
+Benchmark* add(const char* name, Function fn)
+{
+    Benchmark* b = new Benchmark(name, fn);
+    registry().push_back(b);
+    return b;
+}
+
+void init_page_alloc(size_t bytes)
+{
+    static bool done;
+    if (done) {
+        return;
+    }
+    done = true;
+
+    // 多映射一个最大块的大小，把起点对齐到最大块，让伙伴系统能拼出最高order
+    const size_t align = (size_t)mm::PAGE_SIZE << mm::MAX_ORDER;
+    void* p = mmap(nullptr, bytes + align, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (p == MAP_FAILED) {
+        fprintf(stderr, "hostbench: 无法映射 %zu 字节\n", bytes + align);
+        exit(1);
+    }
+    uintptr_t base = ((uintptr_t)p + align - 1) & ~(uintptr_t)(align - 1);
+    mm::MemRange range = { base, bytes >> mm::PAGE_SHIFT };
+    mm::page_alloc_init(&range, 1);
+}
+
+} // namespace hostbench
+
+int main(int argc, char** argv)
+{
+    hostbench::Options opt;
+    for (int i = 1; i < argc; i++) {
+        if (!strncmp(argv[i], "--filter=", 9)) {
+            opt.filter = argv[i] + 9;
+        } else if (!strncmp(argv[i], "--min-time=", 11)) {
+            opt.min_time = atof(argv[i] + 11);
+        } else if (!strcmp(argv[i], "--csv")) {
+            opt.csv = true;
+        } else {
+            hostbench::usage(argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<int> cpus = hostbench::usable_cpus();
+    if (opt.csv) {
+        printf("name,threads,iterations,ns_per_op,ops_per_s,mib_per_s\n");
+    } else {
+        printf("%d CPU(s) available, min time %.2f s\n", (int)cpus.size(), opt.min_time);
+        printf("%-40s %12s %12s %14s\n", "Benchmark", "Iterations", "ns/op", "ops/s");
+        for (int i = 0; i < 80; i++) {
+            putchar('-');
+        }
+        putchar('\n');
+    }
+
+    for (const hostbench::Benchmark* b : hostbench::registry()) {
+        std::vector<int64_t> args = b->args();
+        bool has_arg = !args.empty();
+        if (!has_arg) {
+            args.push_back(0);
+        }
+        std::vector<int> threads = b->thread_counts();
+        if (threads.empty()) {
+            threads.push_back(1);
+        }
+        for (int64_t a : args) {
+            for (int t : threads) {
+                hostbench::run_benchmark(opt, *b, a, has_arg, t, cpus);
+            }
+        }
+    }
+    return 0;
+}
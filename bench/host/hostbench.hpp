@@ -0,0 +1,108 @@
+/**
+ * leafOS - 主机端基准测试框架
+ *
+ * 内核中与硬件无关的算法(页分配器、内核堆、LZ4解码)另外编成Linux用户态静态库(make hostlib)，
+ * 在这里直接测量，不必启动QEMU。用法仿Google Benchmark:
+ *
+ *     void bm_alloc(hostbench::State& s)
+ *     {
+ *         while (s.keep_running()) {
+ *             ...
+ *         }
+ *     }
+ *     HOSTBENCH(bm_alloc)->arg(0)->threads(1)->threads(4);
+ *
+ * 每个线程绑定到各自的CPU上。迭代次数自动增加到单次运行不少于--min-time秒
+ */
+
+#pragma once
+#ifndef __LEAFOS_HOSTBENCH_H__
+#define __LEAFOS_HOSTBENCH_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+namespace hostbench {
+
+class State {
+public:
+    State(uint64_t iterations, int64_t arg, int thread_index, int threads)
+        : left_(iterations), iterations_(iterations), arg_(arg),
+          thread_index_(thread_index), threads_(threads) {}
+
+    // 还需要再执行一次时返回true
+    bool keep_running()
+    {
+        if (left_ == 0) {
+            return false;
+        }
+        left_--;
+        return true;
+    }
+
+    uint64_t iterations() const { return iterations_; }
+    int64_t  arg() const { return arg_; }
+    int      thread_index() const { return thread_index_; }
+    int      threads() const { return threads_; }
+
+    // 每次迭代处理的字节数，设置后额外报告吞吐量
+    void set_bytes_per_iteration(uint64_t bytes) { bytes_ = bytes; }
+    uint64_t bytes_per_iteration() const { return bytes_; }
+
+private:
+    uint64_t left_;
+    uint64_t iterations_;
+    int64_t  arg_;
+    int      thread_index_;
+    int      threads_;
+    uint64_t bytes_ = 0;
+};
+
+typedef void (*Function)(State&);
+
+class Benchmark {
+public:
+    Benchmark(const char* name, Function fn) : name_(name), fn_(fn) {}
+
+    // 依次以每个参数运行；不调用时只运行一次，参数为0
+    Benchmark* arg(int64_t a)
+    {
+        args_.push_back(a);
+        return this;
+    }
+
+    // 依次以每个线程数运行；不调用时单线程
+    Benchmark* threads(int n)
+    {
+        threads_.push_back(n);
+        return this;
+    }
+
+    const char*                 name() const { return name_; }
+    Function                    function() const { return fn_; }
+    const std::vector<int64_t>& args() const { return args_; }
+    const std::vector<int>&     thread_counts() const { return threads_; }
+
+private:
+    const char*          name_;
+    Function             fn_;
+    std::vector<int64_t> args_;
+    std::vector<int>     threads_;
+};
+
+// 登记一个基准，返回值用于链式设置参数
+Benchmark* add(const char* name, Function fn);
+
+// 向页分配器交出一段匿名内存，供页分配器和内核堆的基准共用；只有第一次调用生效
+void init_page_alloc(size_t bytes);
+
+} // namespace hostbench
+
+#define HOSTBENCH_CONCAT2(a, b) a##b
+#define HOSTBENCH_CONCAT(a, b) HOSTBENCH_CONCAT2(a, b)
+#define HOSTBENCH(fn) \
+    static hostbench::Benchmark* HOSTBENCH_CONCAT(hostbench_, __LINE__) \
+        __attribute__((unused)) = hostbench::add(#fn, fn)
+
+#endif // __LEAFOS_HOSTBENCH_H__
@@ -0,0 +1,61 @@
+/**
+ * leafOS - 内核堆基准
+ */
+
+#include "hostbench.hpp"
+
+#include <kheap.hpp>
+
+namespace {
+
+constexpr size_t ARENA_BYTES = 256ull << 20;
+constexpr int    LIVE        = 64;
+
+// 大小级别内的分配与释放；8192字节走整页分配
+void bm_kmalloc_kfree(hostbench::State& s)
+{
+    hostbench::init_page_alloc(ARENA_BYTES);
+    size_t size = (size_t)s.arg();
+    while (s.keep_running()) {
+        void* p = kmalloc(size);
+        kfree(p);
+    }
+}
+HOSTBENCH(bm_kmalloc_kfree)->arg(16)->arg(256)->arg(2000)->arg(8192)->threads(1)->threads(4);
+
+// 保持一批对象存活并轮换其中一个，空闲链表不会退化成只有一个对象
+void bm_kmalloc_churn(hostbench::State& s)
+{
+    hostbench::init_page_alloc(ARENA_BYTES);
+    size_t size = (size_t)s.arg();
+    void* live[LIVE];
+    for (int i = 0; i < LIVE; i++) {
+        live[i] = kmalloc(size);
+    }
+    unsigned i = 0;
+    while (s.keep_running()) {
+        kfree(live[i]);
+        live[i] = kmalloc(size);
+        i = (i + 1) % LIVE;
+    }
+    for (int k = 0; k < LIVE; k++) {
+        kfree(live[k]);
+    }
+}
+HOSTBENCH(bm_kmalloc_churn)->arg(64)->arg(1024)->threads(1)->threads(4);
+
+// 从16字节逐次翻倍增长到4 KiB
+void bm_krealloc_grow(hostbench::State& s)
+{
+    hostbench::init_page_alloc(ARENA_BYTES);
+    while (s.keep_running()) {
+        void* p = nullptr;
+        for (size_t size = 16; size <= 4096; size *= 2) {
+            p = krealloc(p, size);
+        }
+        kfree(p);
+    }
+}
+HOSTBENCH(bm_krealloc_grow)->threads(1);
+
+} // namespace
@@ -0,0 +1,149 @@
+/**
+ * leafOS - LZ4解码基准
+ *
+ * 内核只有解码器，输入块由这里一个简单的贪心编码器生成(单一散列表，不做延迟匹配)，
+ * 压缩率与lz4默认级别相近，足以反映解码器在文本类数据上的表现
+ */
+
+#include "hostbench.hpp"
+
+#include <lz4.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+constexpr size_t INPUT_BYTES = 256 * 1024;
+constexpr size_t LAST_LITERALS = 5;     // 块的最后5字节必须是字面量
+constexpr size_t MF_LIMIT = 12;         // 最后一个匹配必须在距结尾12字节之前开始
+
+struct Corpus {
+    uint8_t* plain;
+    uint8_t* packed;
+    size_t   packed_len;
+};
+
+uint32_t load32(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+uint8_t* put_length(uint8_t* op, size_t len)
+{
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+uint8_t* put_sequence(uint8_t* op, const uint8_t* lit, size_t lit_len, size_t offset, size_t match_len)
+{
+    uint8_t* token = op++;
+    *token = (uint8_t)((lit_len >= 15 ? 15 : lit_len) << 4);
+    if (lit_len >= 15) {
+        op = put_length(op, lit_len - 15);
+    }
+    memcpy(op, lit, lit_len);
+    op += lit_len;
+    if (!match_len) {
+        return op;
+    }
+    *op++ = (uint8_t)offset;
+    *op++ = (uint8_t)(offset >> 8);
+    size_t ml = match_len - 4;
+    *token |= (uint8_t)(ml >= 15 ? 15 : ml);
+    if (ml >= 15) {
+        op = put_length(op, ml - 15);
+    }
+    return op;
+}
+
+size_t compress(const uint8_t* src, size_t n, uint8_t* dst)
+{
+    static uint32_t table[1 << 14];
+    memset(table, 0, sizeof(table));
+    uint8_t* op = dst;
+    size_t anchor = 0;
+    size_t ip = 0;
+    while (n > MF_LIMIT && ip < n - MF_LIMIT) {
+        uint32_t seq = load32(src + ip);
+        uint32_t h = (seq * 2654435761u) >> 18;
+        size_t ref = table[h];
+        table[h] = (uint32_t)ip + 1;
+        if (!ref || ip - (ref - 1) > 65535 || load32(src + ref - 1) != seq) {
+            ip++;
+            continue;
+        }
+        ref--;
+        size_t len = 4;
+        while (ip + len < n - LAST_LITERALS && src[ref + len] == src[ip + len]) {
+            len++;
+        }
+        op = put_sequence(op, src + anchor, ip - anchor, ip - ref, len);
+        ip += len;
+        anchor = ip;
+    }
+    return (size_t)(put_sequence(op, src + anchor, n - anchor, 0, 0) - dst);
+}
+
+// 由少量单词随机拼成的类文本数据
+void fill_text(uint8_t* p, size_t n)
+{
+    static const char* const words[] = {
+        "leafOS ", "kernel ", "page ", "alloc ", "buddy ", "order ", "free ", "list ",
+        "initcall ", "ring ", "submit ", "complete ", "0x1000 ", "\n", "{ ", "} ",
+        "return ", "nullptr; ", "uint64_t ", "spinlock ", "the ", "of ", "a ", "and ",
+    };
+    uint32_t x = 12345;
+    size_t pos = 0;
+    while (pos < n) {
+        x = x * 1103515245u + 12345u;
+        const char* w = words[(x >> 16) % (sizeof(words) / sizeof(words[0]))];
+        for (; *w && pos < n; w++) {
+            p[pos++] = (uint8_t)*w;
+        }
+    }
+}
+
+const Corpus& corpus()
+{
+    static Corpus c = [] {
+        Corpus k;
+        k.plain = static_cast<uint8_t*>(malloc(INPUT_BYTES));
+        k.packed = static_cast<uint8_t*>(malloc(INPUT_BYTES + INPUT_BYTES / 255 + 16));
+        fill_text(k.plain, INPUT_BYTES);
+        k.packed_len = compress(k.plain, INPUT_BYTES, k.packed);
+
+        // 先确认解码结果正确，否则测出的速度没有意义
+        uint8_t* out = static_cast<uint8_t*>(malloc(INPUT_BYTES));
+        int64_t n = lz4_decompress_block(k.packed, k.packed_len, out, INPUT_BYTES, 0);
+        if (n != (int64_t)INPUT_BYTES || memcmp(out, k.plain, INPUT_BYTES) != 0) {
+            fprintf(stderr, "lz4_bench: 解码结果与原文不符 (%lld)\n", (long long)n);
+            exit(1);
+        }
+        free(out);
+        return k;
+    }();
+    return c;
+}
+
+void bm_lz4_decompress_block(hostbench::State& s)
+{
+    const Corpus& c = corpus();
+    uint8_t* out = static_cast<uint8_t*>(malloc(INPUT_BYTES));
+    s.set_bytes_per_iteration(INPUT_BYTES);
+    while (s.keep_running()) {
+        lz4_decompress_block(c.packed, c.packed_len, out, INPUT_BYTES, 0);
+        __asm__ __volatile__("" : : "r"(out) : "memory");
+    }
+    free(out);
+}
+HOSTBENCH(bm_lz4_decompress_block)->threads(1)->threads(4);
+
+} // namespace
@@ -0,0 +1,42 @@
+/**
+ * leafOS - 页分配器基准
+ */
+
+#include "hostbench.hpp"
+
+#include <page_alloc.hpp>
+
+namespace {
+
+constexpr size_t ARENA_BYTES = 256ull << 20;
+constexpr int    BATCH       = 256;
+
+// 分配后立即释放: 走空闲链表头的快路径，order>0时还包括拆分与合并
+void bm_alloc_free(hostbench::State& s)
+{
+    hostbench::init_page_alloc(ARENA_BYTES);
+    unsigned order = (unsigned)s.arg();
+    while (s.keep_running()) {
+        void* p = mm::alloc_pages(order);
+        mm::free_pages(p, order);
+    }
+}
+HOSTBENCH(bm_alloc_free)->arg(0)->arg(4)->arg(9)->threads(1)->threads(2)->threads(4);
+
+// 连续分配一批单页再逆序释放，释放时逐级与伙伴合并
+void bm_alloc_batch(hostbench::State& s)
+{
+    hostbench::init_page_alloc(ARENA_BYTES);
+    void* pages[BATCH];
+    while (s.keep_running()) {
+        for (int i = 0; i < BATCH; i++) {
+            pages[i] = mm::alloc_pages(0);
+        }
+        for (int i = BATCH - 1; i >= 0; i--) {
+            mm::free_pages(pages[i], 0);
+        }
+    }
+}
+HOSTBENCH(bm_alloc_batch)->threads(1)->threads(4);
+
+} // namespace
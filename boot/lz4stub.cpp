@@ -0,0 +1,62 @@
+/**
+ * leafOS - LZ4内核解压启动器
+ *
+ * 开启压缩时由它代替内核作为bootx64.efi被固件加载: 把ESP上LZ4压缩的内核映像
+ * 边读边解压到内存，再交给固件的LoadImage/StartImage从内存启动。
+ * 内核本身没有所在设备，之后经父映像(即本启动器)找到同一个ESP读取initrd
+ */
+
+#include <efi_loader.hpp>
+#include <clock.hpp>
+#include "../kernel/uefi.hpp"
+
+#define KERNEL_PATH u"\\EFI\\leafos\\leafOS.efi.lz4"
+
+// StreamSink的虚函数表会引用它；启动器不链接内核的C++运行时
+extern "C" void __cxa_pure_virtual()
+{
+    for (;;) {
+    }
+}
+
+// Makefile构建沿用内核的boot.S，它在进入C++代码前调用_init执行全局构造函数；
+// gnu-efi的crt0不调用它，弱符号也不与其运行时冲突
+typedef void (*ctor_fn)();
+extern "C" ctor_fn __init_array_start[] __attribute__((weak));
+extern "C" ctor_fn __init_array_end[] __attribute__((weak));
+
+extern "C" __attribute__((weak)) void _init()
+{
+    for (ctor_fn* p = __init_array_start; p < __init_array_end; p++) {
+        (*p)();
+    }
+}
+
+extern "C"
+EFI_STATUS EFIAPI efi_main(EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE* SystemTable)
+{
+    efi::init(ImageHandle, SystemTable);
+    clock_init();
+
+    void* image;
+    uint64_t size;
+    efi::LoadStats stats;
+    if (efi::load_lz4_file(KERNEL_PATH, &image, &size, &stats)) {
+        SystemTable->ConOut->OutputString(SystemTable->ConOut,
+                                          const_cast<CHAR16*>(u"leafOS: cannot load " KERNEL_PATH u"\r\n"));
+        return EFI_LOAD_ERROR;
+    }
+    efi::report(u"leafOS.efi.lz4", stats, size);
+
+    // LoadImage会把各节拷到自己分配的位置并完成重定位，解压缓冲随后即可释放
+    EFI_BOOT_SERVICES* bs = SystemTable->BootServices;
+    EFI_HANDLE kernel = nullptr;
+    EFI_STATUS s = bs->LoadImage(0, ImageHandle, nullptr, image, size, &kernel);
+    efi::free_pages(image, (size + efi::PAGE_SIZE - 1) / efi::PAGE_SIZE);
+    if (EFI_ERROR(s)) {
+        return s;
+    }
+
+    // 内核退出启动服务后不再返回；返回说明启动失败
+    return bs->StartImage(kernel, nullptr, nullptr);
+}
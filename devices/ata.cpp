@@ -0,0 +1,196 @@
+/**
+ * leafOS - ATA(IDE) PIO磁盘驱动实现
+ * 使用LBA48命令，一条命令最多传输256个扇区，减少命令往返次数
+ */
+
+#if defined(__x86_64__)
+
+#include <ata.hpp>
+#include <arch/io.hpp>
+#include <kheap.hpp>
+#include <kerrno.hpp>
+#include <init.hpp>
+#include <trace.hpp>
+
+// 每条发给驱动器的命令
+#define TRACE_ATA_ISSUE(F) F(uint16_t, io) F(bool, slave) F(uint8_t, cmd) F(uint16_t, count) F(uint64_t, lba)
+
+TRACE_EVENT(ata_issue, TRACE_ATA_ISSUE)
+DEFINE_TRACE_EVENT(ata_issue, TRACE_ATA_ISSUE);
+
+namespace {
+
+// 通道寄存器偏移 (相对io_base)
+constexpr uint16_t REG_DATA     = 0;
+constexpr uint16_t REG_SECCOUNT = 2;
+constexpr uint16_t REG_LBA0     = 3;
+constexpr uint16_t REG_LBA1     = 4;
+constexpr uint16_t REG_LBA2     = 5;
+constexpr uint16_t REG_DRIVE    = 6;
+constexpr uint16_t REG_STATUS   = 7;
+constexpr uint16_t REG_COMMAND  = 7;
+
+constexpr uint8_t ST_ERR  = 0x01;
+constexpr uint8_t ST_DRQ  = 0x08;
+constexpr uint8_t ST_DF   = 0x20;
+constexpr uint8_t ST_BSY  = 0x80;
+
+constexpr uint8_t CMD_READ_EXT   = 0x24;
+constexpr uint8_t CMD_WRITE_EXT  = 0x34;
+constexpr uint8_t CMD_FLUSH_EXT  = 0xEA;
+constexpr uint8_t CMD_IDENTIFY   = 0xEC;
+
+constexpr uint32_t MAX_SECTORS_PER_CMD = 256;
+constexpr uint32_t SPIN_LIMIT = 10000000;
+
+} // namespace
+
+AtaDisk::AtaDisk(uint16_t io_base, uint16_t ctrl_base, bool slave, uint64_t sectors)
+    : BlockDevice(512, sectors), io_(io_base), ctrl_(ctrl_base), slave_(slave)
+{
+}
+
+AtaDisk* __init AtaDisk::probe(uint16_t io_base, uint16_t ctrl_base, bool slave)
+{
+    // 关闭设备中断 (nIEN)，驱动使用轮询
+    outb(ctrl_base, 0x02);
+
+    outb(io_base + REG_DRIVE, slave ? 0xB0 : 0xA0);
+    outb(io_base + REG_SECCOUNT, 0);
+    outb(io_base + REG_LBA0, 0);
+    outb(io_base + REG_LBA1, 0);
+    outb(io_base + REG_LBA2, 0);
+    outb(io_base + REG_COMMAND, CMD_IDENTIFY);
+
+    uint8_t st = inb(io_base + REG_STATUS);
+    if (st == 0 || st == 0xFF) {
+        return nullptr;     // 通道上没有设备
+    }
+
+    uint32_t spins = 0;
+    while ((st = inb(io_base + REG_STATUS)) & ST_BSY) {
+        if (++spins > SPIN_LIMIT) {
+            return nullptr;
+        }
+    }
+    // ATAPI/SATA设备会在LBA1/LBA2中留下签名，不是ATA磁盘
+    if (inb(io_base + REG_LBA1) || inb(io_base + REG_LBA2)) {
+        return nullptr;
+    }
+    while (!((st = inb(io_base + REG_STATUS)) & (ST_DRQ | ST_ERR))) {
+        if (++spins > SPIN_LIMIT) {
+            return nullptr;
+        }
+    }
+    if (st & ST_ERR) {
+        return nullptr;
+    }
+
+    uint16_t id[256];
+    insw(io_base + REG_DATA, id, 256);
+
+    // 字83第10位: 支持LBA48；扇区数在字100-103
+    uint64_t sectors;
+    if (id[83] & (1 << 10)) {
+        sectors = (uint64_t)id[100] | ((uint64_t)id[101] << 16) |
+                  ((uint64_t)id[102] << 32) | ((uint64_t)id[103] << 48);
+    } else {
+        sectors = (uint64_t)id[60] | ((uint64_t)id[61] << 16);
+    }
+    if (!sectors) {
+        return nullptr;
+    }
+
+    return knew<AtaDisk>(io_base, ctrl_base, slave, sectors);
+}
+
+int AtaDisk::wait_ready(bool need_drq)
+{
+    // 先读4次备用状态寄存器，等待约400ns让状态稳定
+    for (int i = 0; i < 4; i++) {
+        inb(ctrl_);
+    }
+
+    for (uint32_t spins = 0; spins < SPIN_LIMIT; spins++) {
+        uint8_t st = inb(io_ + REG_STATUS);
+        if (st & ST_BSY) {
+            continue;
+        }
+        if (st & (ST_ERR | ST_DF)) {
+            return -EIO;
+        }
+        if (!need_drq || (st & ST_DRQ)) {
+            return 0;
+        }
+    }
+    return -EIO;
+}
+
+void AtaDisk::issue(uint64_t lba, uint16_t count, uint8_t cmd)
+{
+    trace_ata_issue(io_, slave_, cmd, count, lba);
+    outb(io_ + REG_DRIVE, slave_ ? 0x50 : 0x40);    // LBA模式
+
+    // LBA48: 先写高字节再写低字节
+    outb(io_ + REG_SECCOUNT, (uint8_t)(count >> 8));
+    outb(io_ + REG_LBA0, (uint8_t)(lba >> 24));
+    outb(io_ + REG_LBA1, (uint8_t)(lba >> 32));
+    outb(io_ + REG_LBA2, (uint8_t)(lba >> 40));
+    outb(io_ + REG_SECCOUNT, (uint8_t)count);
+    outb(io_ + REG_LBA0, (uint8_t)lba);
+    outb(io_ + REG_LBA1, (uint8_t)(lba >> 8));
+    outb(io_ + REG_LBA2, (uint8_t)(lba >> 16));
+    outb(io_ + REG_COMMAND, cmd);
+}
+
+int AtaDisk::read(uint64_t lba, uint32_t count, void* buf)
+{
+    if (lba + count > sector_count_) {
+        return -EIO;
+    }
+
+    uint8_t* out = static_cast<uint8_t*>(buf);
+    while (count) {
+        uint32_t n = count < MAX_SECTORS_PER_CMD ? count : MAX_SECTORS_PER_CMD;
+        issue(lba, (uint16_t)n, CMD_READ_EXT);
+        for (uint32_t i = 0; i < n; i++) {
+            int err = wait_ready(true);
+            if (err) {
+                return err;
+            }
+            insw(io_ + REG_DATA, out, 256);
+            out += 512;
+        }
+        lba += n;
+        count -= n;
+    }
+    return 0;
+}
+
+int AtaDisk::write(uint64_t lba, uint32_t count, const void* buf)
+{
+    if (lba + count > sector_count_) {
+        return -EIO;
+    }
+
+    const uint8_t* in = static_cast<const uint8_t*>(buf);
+    while (count) {
+        uint32_t n = count < MAX_SECTORS_PER_CMD ? count : MAX_SECTORS_PER_CMD;
+        issue(lba, (uint16_t)n, CMD_WRITE_EXT);
+        for (uint32_t i = 0; i < n; i++) {
+            int err = wait_ready(true);
+            if (err) {
+                return err;
+            }
+            outsw(io_ + REG_DATA, in, 256);
+            in += 512;
+        }
+        lba += n;
+        count -= n;
+    }
+
+    outb(io_ + REG_COMMAND, CMD_FLUSH_EXT);
+    return wait_ready(false);
+}
+
+#endif // __x86_64__
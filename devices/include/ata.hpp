@@ -0,0 +1,37 @@
+/**
+ * leafOS - ATA(IDE) PIO磁盘驱动
+ * QEMU的pc机型把 -drive 默认接在主IDE通道上，UEFI启动盘即在此处
+ */
+
+#pragma once
+#ifndef __LEAFOS_ATA_H__
+#define __LEAFOS_ATA_H__
+
+#include <block.hpp>
+
+class AtaDisk : public BlockDevice {
+public:
+    // 探测指定通道上的磁盘，不存在时返回nullptr。只在启动期间可用(__init)
+    static AtaDisk* probe(uint16_t io_base, uint16_t ctrl_base, bool slave);
+
+    AtaDisk(uint16_t io_base, uint16_t ctrl_base, bool slave, uint64_t sectors);
+
+    int read(uint64_t lba, uint32_t count, void* buf) override;
+    int write(uint64_t lba, uint32_t count, const void* buf) override;
+
+private:
+    int wait_ready(bool need_drq);
+    void issue(uint64_t lba, uint16_t count, uint8_t cmd);
+
+    uint16_t io_;
+    uint16_t ctrl_;
+    bool     slave_;
+};
+
+// 标准主/从IDE通道端口
+constexpr uint16_t ATA_PRIMARY_IO     = 0x1F0;
+constexpr uint16_t ATA_PRIMARY_CTRL   = 0x3F6;
+constexpr uint16_t ATA_SECONDARY_IO   = 0x170;
+constexpr uint16_t ATA_SECONDARY_CTRL = 0x376;
+
+#endif // __LEAFOS_ATA_H__
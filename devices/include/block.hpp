@@ -0,0 +1,60 @@
+/**
+ * leafOS - 块设备接口
+ * 文件系统驱动通过它按扇区读写磁盘，具体设备(ATA等)实现这个接口
+ */
+
+#pragma once
+#ifndef __LEAFOS_BLOCK_H__
+#define __LEAFOS_BLOCK_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kerrno.hpp>
+
+class BlockDevice {
+public:
+    // 读取 count 个扇区到 buf，成功返回0，失败返回负错误码
+    virtual int read(uint64_t lba, uint32_t count, void* buf) = 0;
+    virtual int write(uint64_t lba, uint32_t count, const void* buf) = 0;
+
+    uint32_t sector_size() const { return sector_size_; }
+    uint64_t sector_count() const { return sector_count_; }
+
+protected:
+    BlockDevice(uint32_t sector_size, uint64_t sector_count)
+        : sector_size_(sector_size), sector_count_(sector_count) {}
+    ~BlockDevice() = default;
+
+    uint32_t sector_size_;
+    uint64_t sector_count_;
+};
+
+// 设备上从某个起始扇区开始的一段区域 (分区)
+class BlockPartition : public BlockDevice {
+public:
+    BlockPartition(BlockDevice* parent, uint64_t first_lba, uint64_t sectors)
+        : BlockDevice(parent->sector_size(), sectors),
+          parent_(parent), first_lba_(first_lba) {}
+
+    int read(uint64_t lba, uint32_t count, void* buf) override
+    {
+        if (lba + count > sector_count_) {
+            return -EIO;
+        }
+        return parent_->read(first_lba_ + lba, count, buf);
+    }
+
+    int write(uint64_t lba, uint32_t count, const void* buf) override
+    {
+        if (lba + count > sector_count_) {
+            return -EIO;
+        }
+        return parent_->write(first_lba_ + lba, count, buf);
+    }
+
+private:
+    BlockDevice* parent_;
+    uint64_t     first_lba_;
+};
+
+#endif // __LEAFOS_BLOCK_H__
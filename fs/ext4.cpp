@@ -0,0 +1,1240 @@
+/**
+ * leafOS - ext2/ext3/ext4文件系统驱动实现 (只读)
+ */
+
+#include <ext4.hpp>
+#include <page_alloc.hpp>
+#include <kheap.hpp>
+#include <kstring.hpp>
+
+namespace fs {
+
+namespace {
+
+// ============================================
+// 磁盘结构
+// ============================================
+
+struct __attribute__((packed)) Ext4SuperBlock {
+    uint32_t inodes_count;
+    uint32_t blocks_count_lo;
+    uint32_t r_blocks_count_lo;
+    uint32_t free_blocks_count_lo;
+    uint32_t free_inodes_count;
+    uint32_t first_data_block;
+    uint32_t log_block_size;        // 块大小 = 1024 << log_block_size
+    uint32_t log_cluster_size;
+    uint32_t blocks_per_group;
+    uint32_t clusters_per_group;
+    uint32_t inodes_per_group;
+    uint32_t mtime;
+    uint32_t wtime;
+    uint16_t mnt_count;
+    uint16_t max_mnt_count;
+    uint16_t magic;                 // 0xEF53
+    uint16_t state;
+    uint16_t errors;
+    uint16_t minor_rev_level;
+    uint32_t lastcheck;
+    uint32_t checkinterval;
+    uint32_t creator_os;
+    uint32_t rev_level;
+    uint16_t def_resuid;
+    uint16_t def_resgid;
+    uint32_t first_ino;
+    uint16_t inode_size;
+    uint16_t block_group_nr;
+    uint32_t feature_compat;
+    uint32_t feature_incompat;
+    uint32_t feature_ro_compat;
+    uint8_t  uuid[16];
+    char     volume_name[16];
+    char     last_mounted[64];
+    uint32_t algorithm_usage_bitmap;
+    uint8_t  prealloc_blocks;
+    uint8_t  prealloc_dir_blocks;
+    uint16_t reserved_gdt_blocks;
+    uint8_t  journal_uuid[16];
+    uint32_t journal_inum;
+    uint32_t journal_dev;
+    uint32_t last_orphan;
+    uint32_t hash_seed[4];          // htree目录哈希的种子
+    uint8_t  def_hash_version;
+    uint8_t  jnl_backup_type;
+    uint16_t desc_size;             // 64bit特性下块组描述符的大小
+    uint32_t default_mount_opts;
+    uint32_t first_meta_bg;
+    uint32_t mkfs_time;
+    uint32_t jnl_blocks[17];
+    uint32_t blocks_count_hi;
+    uint32_t r_blocks_count_hi;
+    uint32_t free_blocks_count_hi;
+    uint16_t min_extra_isize;
+    uint16_t want_extra_isize;
+    uint32_t flags;
+    uint16_t raid_stride;
+    uint16_t mmp_interval;
+    uint64_t mmp_block;
+    uint32_t raid_stripe_width;
+    uint8_t  log_groups_per_flex;
+};
+
+struct __attribute__((packed)) Ext4GroupDesc {
+    uint32_t block_bitmap_lo;
+    uint32_t inode_bitmap_lo;
+    uint32_t inode_table_lo;
+    uint16_t free_blocks_count_lo;
+    uint16_t free_inodes_count_lo;
+    uint16_t used_dirs_count_lo;
+    uint16_t flags;
+    uint32_t exclude_bitmap_lo;
+    uint16_t block_bitmap_csum_lo;
+    uint16_t inode_bitmap_csum_lo;
+    uint16_t itable_unused_lo;      // 组内末尾从未使用过的inode数
+    uint16_t checksum;
+    // 以下字段只在desc_size >= 64时存在
+    uint32_t block_bitmap_hi;
+    uint32_t inode_bitmap_hi;
+    uint32_t inode_table_hi;
+    uint16_t free_blocks_count_hi;
+    uint16_t free_inodes_count_hi;
+    uint16_t used_dirs_count_hi;
+    uint16_t itable_unused_hi;
+    uint32_t exclude_bitmap_hi;
+    uint16_t block_bitmap_csum_hi;
+    uint16_t inode_bitmap_csum_hi;
+    uint32_t reserved;
+};
+
+struct __attribute__((packed)) Ext4RawInode {
+    uint16_t mode;
+    uint16_t uid;
+    uint32_t size_lo;
+    uint32_t atime;
+    uint32_t ctime;
+    uint32_t mtime;
+    uint32_t dtime;
+    uint16_t gid;
+    uint16_t links_count;
+    uint32_t blocks_lo;
+    uint32_t flags;
+    uint32_t osd1;
+    uint8_t  block[60];
+    uint32_t generation;
+    uint32_t file_acl_lo;
+    uint32_t size_high;
+    uint32_t obso_faddr;
+    uint8_t  osd2[12];
+};
+
+struct __attribute__((packed)) Ext4ExtentHeader {
+    uint16_t magic;                 // 0xF30A
+    uint16_t entries;
+    uint16_t max;
+    uint16_t depth;                 // 0表示叶子
+    uint32_t generation;
+};
+
+struct __attribute__((packed)) Ext4ExtentLeaf {
+    uint32_t block;
+    uint16_t len;                   // 大于32768表示未初始化区段
+    uint16_t start_hi;
+    uint32_t start_lo;
+};
+
+struct __attribute__((packed)) Ext4ExtentIndex {
+    uint32_t block;
+    uint32_t leaf_lo;
+    uint16_t leaf_hi;
+    uint16_t unused;
+};
+
+struct __attribute__((packed)) Ext4DirEntry {
+    uint32_t inode;
+    uint16_t rec_len;
+    uint8_t  name_len;
+    uint8_t  file_type;
+};
+
+static_assert(sizeof(Ext4SuperBlock) == 0x175, "ext4超级块布局错误");
+static_assert(sizeof(Ext4GroupDesc) == 64, "ext4块组描述符布局错误");
+static_assert(sizeof(Ext4RawInode) == 128, "ext4 inode布局错误");
+static_assert(sizeof(Ext4ExtentLeaf) == 12 && sizeof(Ext4ExtentIndex) == 12, "ext4区段布局错误");
+
+constexpr uint64_t SUPERBLOCK_OFFSET = 1024;
+constexpr uint16_t EXT4_MAGIC        = 0xEF53;
+constexpr uint16_t EXTENT_MAGIC      = 0xF30A;
+constexpr uint32_t ROOT_INO          = 2;
+
+constexpr uint32_t INCOMPAT_FILETYPE    = 0x0002;
+constexpr uint32_t INCOMPAT_RECOVER     = 0x0004;
+constexpr uint32_t INCOMPAT_EXTENTS     = 0x0040;
+constexpr uint32_t INCOMPAT_64BIT       = 0x0080;
+constexpr uint32_t INCOMPAT_MMP         = 0x0100;
+constexpr uint32_t INCOMPAT_FLEX_BG     = 0x0200;
+constexpr uint32_t INCOMPAT_EA_INODE    = 0x0400;
+constexpr uint32_t INCOMPAT_CSUM_SEED   = 0x2000;
+constexpr uint32_t INCOMPAT_LARGEDIR    = 0x4000;
+constexpr uint32_t INCOMPAT_INLINE_DATA = 0x8000;
+
+// 只读挂载能正确处理的特性；其余(meta_bg、压缩、加密、大小写折叠等)会改变磁盘布局或名字的语义
+constexpr uint32_t INCOMPAT_SUPPORTED =
+    INCOMPAT_FILETYPE | INCOMPAT_RECOVER | INCOMPAT_EXTENTS | INCOMPAT_64BIT |
+    INCOMPAT_MMP | INCOMPAT_FLEX_BG | INCOMPAT_EA_INODE | INCOMPAT_CSUM_SEED |
+    INCOMPAT_LARGEDIR | INCOMPAT_INLINE_DATA;
+
+constexpr uint32_t RO_COMPAT_GDT_CSUM      = 0x0010;
+constexpr uint32_t RO_COMPAT_METADATA_CSUM = 0x0400;
+
+constexpr uint16_t BG_INODE_UNINIT = 0x0001;
+
+constexpr uint32_t FLAG_UNSIGNED_HASH = 0x0002;
+
+constexpr uint32_t INODE_INDEX_FL       = 0x00001000;
+constexpr uint32_t INODE_EXTENTS_FL     = 0x00080000;
+constexpr uint32_t INODE_INLINE_DATA_FL = 0x10000000;
+
+constexpr uint32_t EXTENT_INIT_MAX = 32768;
+constexpr unsigned EXTENT_MAX_DEPTH = 5;
+
+constexpr uint8_t FT_REG_FILE = 1;
+constexpr uint8_t FT_DIR      = 2;
+constexpr uint8_t FT_SYMLINK  = 7;
+
+// inode表预取: 单次读取的上限，以及允许顺带读过的未使用inode的最大字节数
+constexpr uint64_t PREFETCH_MAX = mm::PAGE_SIZE << mm::MAX_ORDER;
+constexpr uint64_t PREFETCH_GAP = 256 * 1024;
+
+// Linux文件系统数据分区的GUID (磁盘上的字节序)
+const uint8_t GUID_LINUX_DATA[16] = {
+    0xAF, 0x3D, 0xC6, 0x0F, 0x83, 0x84, 0x72, 0x47,
+    0x8E, 0x79, 0x3D, 0x69, 0xD8, 0x47, 0x7D, 0xE4,
+};
+
+struct __attribute__((packed)) MbrPartition {
+    uint8_t  status;
+    uint8_t  chs_first[3];
+    uint8_t  type;
+    uint8_t  chs_last[3];
+    uint32_t lba_first;
+    uint32_t sectors;
+};
+
+struct __attribute__((packed)) GptHeader {
+    char     signature[8];          // "EFI PART"
+    uint32_t revision;
+    uint32_t header_size;
+    uint32_t header_crc;
+    uint32_t reserved;
+    uint64_t current_lba;
+    uint64_t backup_lba;
+    uint64_t first_usable;
+    uint64_t last_usable;
+    uint8_t  disk_guid[16];
+    uint64_t entries_lba;
+    uint32_t num_entries;
+    uint32_t entry_size;
+    uint32_t entries_crc;
+};
+
+struct __attribute__((packed)) GptEntry {
+    uint8_t  type_guid[16];
+    uint8_t  unique_guid[16];
+    uint64_t first_lba;
+    uint64_t last_lba;
+    uint64_t attributes;
+    uint16_t name[36];
+};
+
+inline uint16_t get16(const uint8_t* p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+inline uint32_t get32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+NodeType mode_to_type(uint16_t mode)
+{
+    switch (mode & 0170000) {
+    case 0040000: return NodeType::Directory;
+    case 0100000: return NodeType::File;
+    case 0120000: return NodeType::Symlink;
+    default:      return NodeType::Other;
+    }
+}
+
+NodeType dirent_type(uint8_t ft)
+{
+    switch (ft) {
+    case FT_REG_FILE: return NodeType::File;
+    case FT_DIR:      return NodeType::Directory;
+    case FT_SYMLINK:  return NodeType::Symlink;
+    default:          return NodeType::Other;
+    }
+}
+
+// 检查块内offset处的目录项是否完整落在块内
+const Ext4DirEntry* dirent_at(const uint8_t* blk, uint32_t bs, uint32_t off)
+{
+    if (off + sizeof(Ext4DirEntry) > bs) {
+        return nullptr;
+    }
+    const Ext4DirEntry* d = reinterpret_cast<const Ext4DirEntry*>(blk + off);
+    if (d->rec_len < sizeof(Ext4DirEntry) || (d->rec_len & 3) || off + d->rec_len > bs ||
+        sizeof(Ext4DirEntry) + d->name_len > d->rec_len) {
+        return nullptr;
+    }
+    return d;
+}
+
+// 在一个目录块中查找名字，返回inode号，0表示不在此块
+uint32_t find_in_block(const uint8_t* blk, uint32_t bs, const char* name, size_t len)
+{
+    uint32_t off = 0;
+    while (off < bs) {
+        const Ext4DirEntry* d = dirent_at(blk, bs, off);
+        if (!d) {
+            return 0;
+        }
+        if (d->inode && d->name_len == len &&
+            memcmp(blk + off + sizeof(Ext4DirEntry), name, len) == 0) {
+            return d->inode;
+        }
+        off += d->rec_len;
+    }
+    return 0;
+}
+
+// ============================================
+// htree目录哈希 (与Linux fs/ext4/hash.c一致)
+// ============================================
+
+constexpr unsigned HASH_LEGACY            = 0;
+constexpr unsigned HASH_HALF_MD4          = 1;
+constexpr unsigned HASH_TEA               = 2;
+constexpr unsigned HASH_UNSIGNED_DELTA    = 3;  // 0-2加3是对应的无符号字符版本
+
+inline uint32_t rol32(uint32_t v, unsigned s)
+{
+    return (v << s) | (v >> (32 - s));
+}
+
+uint32_t dx_hack_hash(const char* name, size_t len, bool is_signed)
+{
+    uint32_t hash0 = 0x12a3fe2d, hash1 = 0x37abe8f9;
+    for (size_t i = 0; i < len; i++) {
+        int c = is_signed ? (int)(signed char)name[i] : (int)(unsigned char)name[i];
+        uint32_t hash = hash1 + (hash0 ^ (uint32_t)(c * 7152373));
+        if (hash & 0x80000000) {
+            hash -= 0x7fffffff;
+        }
+        hash1 = hash0;
+        hash0 = hash;
+    }
+    return hash0 << 1;
+}
+
+// 把名字按4字节一组打包成num个字，不足的部分用长度填充
+void str2hashbuf(const char* msg, size_t len, uint32_t* buf, int num, bool is_signed)
+{
+    uint32_t pad = (uint32_t)len | ((uint32_t)len << 8);
+    pad |= pad << 16;
+
+    uint32_t val = pad;
+    if (len > (size_t)num * 4) {
+        len = num * 4;
+    }
+    for (size_t i = 0; i < len; i++) {
+        int c = is_signed ? (int)(signed char)msg[i] : (int)(unsigned char)msg[i];
+        val = (uint32_t)c + (val << 8);
+        if ((i % 4) == 3) {
+            *buf++ = val;
+            val = pad;
+            num--;
+        }
+    }
+    if (--num >= 0) {
+        *buf++ = val;
+    }
+    while (--num >= 0) {
+        *buf++ = pad;
+    }
+}
+
+void half_md4_transform(uint32_t buf[4], const uint32_t in[8])
+{
+    uint32_t a = buf[0], b = buf[1], c = buf[2], d = buf[3];
+
+#define F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define G(x, y, z) (((x) & (y)) + (((x) ^ (y)) & (z)))
+#define H(x, y, z) ((x) ^ (y) ^ (z))
+#define ROUND(f, a, b, c, d, x, s) (a += f(b, c, d) + (x), a = rol32(a, s))
+    const uint32_t K2 = 0x5A827999, K3 = 0x6ED9EBA1;
+
+    ROUND(F, a, b, c, d, in[0], 3);
+    ROUND(F, d, a, b, c, in[1], 7);
+    ROUND(F, c, d, a, b, in[2], 11);
+    ROUND(F, b, c, d, a, in[3], 19);
+    ROUND(F, a, b, c, d, in[4], 3);
+    ROUND(F, d, a, b, c, in[5], 7);
+    ROUND(F, c, d, a, b, in[6], 11);
+    ROUND(F, b, c, d, a, in[7], 19);
+
+    ROUND(G, a, b, c, d, in[1] + K2, 3);
+    ROUND(G, d, a, b, c, in[3] + K2, 5);
+    ROUND(G, c, d, a, b, in[5] + K2, 9);
+    ROUND(G, b, c, d, a, in[7] + K2, 13);
+    ROUND(G, a, b, c, d, in[0] + K2, 3);
+    ROUND(G, d, a, b, c, in[2] + K2, 5);
+    ROUND(G, c, d, a, b, in[4] + K2, 9);
+    ROUND(G, b, c, d, a, in[6] + K2, 13);
+
+    ROUND(H, a, b, c, d, in[3] + K3, 3);
+    ROUND(H, d, a, b, c, in[7] + K3, 9);
+    ROUND(H, c, d, a, b, in[2] + K3, 11);
+    ROUND(H, b, c, d, a, in[6] + K3, 15);
+    ROUND(H, a, b, c, d, in[1] + K3, 3);
+    ROUND(H, d, a, b, c, in[5] + K3, 9);
+    ROUND(H, c, d, a, b, in[0] + K3, 11);
+    ROUND(H, b, c, d, a, in[4] + K3, 15);
+#undef F
+#undef G
+#undef H
+#undef ROUND
+
+    buf[0] += a;
+    buf[1] += b;
+    buf[2] += c;
+    buf[3] += d;
+}
+
+void tea_transform(uint32_t buf[4], const uint32_t in[4])
+{
+    uint32_t sum = 0;
+    uint32_t b0 = buf[0], b1 = buf[1];
+    uint32_t a = in[0], b = in[1], c = in[2], d = in[3];
+
+    for (int n = 0; n < 16; n++) {
+        sum += 0x9E3779B9;
+        b0 += ((b1 << 4) + a) ^ (b1 + sum) ^ ((b1 >> 5) + b);
+        b1 += ((b0 << 4) + c) ^ (b0 + sum) ^ ((b0 >> 5) + d);
+    }
+    buf[0] += b0;
+    buf[1] += b1;
+}
+
+} // namespace
+
+uint32_t Ext4FileSystem::dir_hash(const char* name, size_t len, unsigned version) const
+{
+    uint32_t buf[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+    if (hash_seed_[0] | hash_seed_[1] | hash_seed_[2] | hash_seed_[3]) {
+        memcpy(buf, hash_seed_, sizeof(buf));
+    }
+
+    bool is_signed = version < HASH_UNSIGNED_DELTA;
+    uint32_t hash;
+    uint32_t in[8];
+
+    switch (version % HASH_UNSIGNED_DELTA) {
+    case HASH_LEGACY:
+        hash = dx_hack_hash(name, len, is_signed);
+        break;
+    case HASH_HALF_MD4:
+        for (size_t off = 0; off < len; off += 32) {
+            str2hashbuf(name + off, len - off, in, 8, is_signed);
+            half_md4_transform(buf, in);
+        }
+        hash = buf[1];
+        break;
+    default:
+        for (size_t off = 0; off < len; off += 16) {
+            str2hashbuf(name + off, len - off, in, 4, is_signed);
+            tea_transform(buf, in);
+        }
+        hash = buf[0];
+        break;
+    }
+
+    // 最低位在索引中用作冲突标记；0xFFFFFFFE保留给目录末尾
+    hash &= ~1u;
+    if (hash == (0x7fffffffu << 1)) {
+        hash = (0x7fffffffu - 1) << 1;
+    }
+    return hash;
+}
+
+// ============================================
+// Ext4Inode
+// ============================================
+
+Ext4Inode::Ext4Inode(Ext4FileSystem* fs, uint32_t ino, const uint8_t* raw)
+    : fs_(fs)
+{
+    const Ext4RawInode* r = reinterpret_cast<const Ext4RawInode*>(raw);
+    this->ino = ino;
+    size = r->size_lo | ((uint64_t)r->size_high << 32);
+    type = mode_to_type(r->mode);
+    mode = r->mode & 07777;
+    flags_ = r->flags;
+    memcpy(i_block_, r->block, sizeof(i_block_));
+}
+
+bool Ext4Inode::add_extent(uint32_t file_block, uint64_t disk_block, uint32_t count)
+{
+    // 与上一段在文件内和磁盘上都相邻时直接合并
+    if (!extents_.empty()) {
+        Ext4Extent& last = extents_.back();
+        if (last.file_block + last.count == file_block &&
+            ((last.disk_block && last.disk_block + last.count == disk_block) ||
+             (!last.disk_block && !disk_block))) {
+            last.count += count;
+            return true;
+        }
+    }
+    Ext4Extent e = { file_block, count, disk_block };
+    return extents_.push_back(e);
+}
+
+int Ext4Inode::map_extent_node(const uint8_t* node, size_t bytes, unsigned depth)
+{
+    const Ext4ExtentHeader* h = reinterpret_cast<const Ext4ExtentHeader*>(node);
+    if (h->magic != EXTENT_MAGIC || h->depth > EXTENT_MAX_DEPTH ||
+        sizeof(*h) + (size_t)h->entries * sizeof(Ext4ExtentLeaf) > bytes) {
+        return -EIO;
+    }
+    // 子节点的深度必须恰好比父节点少一
+    if (depth != ~0u && h->depth != depth) {
+        return -EIO;
+    }
+
+    if (h->depth == 0) {
+        const Ext4ExtentLeaf* leaf = reinterpret_cast<const Ext4ExtentLeaf*>(h + 1);
+        for (uint16_t i = 0; i < h->entries; i++) {
+            uint32_t len = leaf[i].len;
+            uint64_t start = leaf[i].start_lo | ((uint64_t)leaf[i].start_hi << 32);
+            if (len > EXTENT_INIT_MAX) {
+                len -= EXTENT_INIT_MAX;
+                start = 0;      // 已分配但未写入，读出为0
+            }
+            if (len && !add_extent(leaf[i].block, start, len)) {
+                return -ENOMEM;
+            }
+        }
+        return 0;
+    }
+
+    uint32_t bs = fs_->block_size_;
+    uint8_t* child = static_cast<uint8_t*>(kmalloc(bs));
+    if (!child) {
+        return -ENOMEM;
+    }
+
+    const Ext4ExtentIndex* idx = reinterpret_cast<const Ext4ExtentIndex*>(h + 1);
+    int err = 0;
+    for (uint16_t i = 0; i < h->entries && !err; i++) {
+        uint64_t blk = idx[i].leaf_lo | ((uint64_t)idx[i].leaf_hi << 32);
+        err = fs_->read_blocks(blk, 1, child);
+        if (!err) {
+            err = map_extent_node(child, bs, h->depth - 1u);
+        }
+    }
+    kfree(child);
+    return err;
+}
+
+int Ext4Inode::map_indirect(uint64_t block, unsigned level, uint32_t* file_block, uint32_t end)
+{
+    uint32_t bs = fs_->block_size_;
+    uint32_t per_block = bs / 4;
+    uint64_t span = 1;
+    for (unsigned i = 0; i < level; i++) {
+        span *= per_block;
+    }
+
+    if (!block) {
+        *file_block += (uint32_t)(span * per_block < end - *file_block ?
+                                  span * per_block : end - *file_block);
+        return 0;
+    }
+
+    uint32_t* ptrs = static_cast<uint32_t*>(kmalloc(bs));
+    if (!ptrs) {
+        return -ENOMEM;
+    }
+    int err = fs_->read_blocks(block, 1, ptrs);
+
+    for (uint32_t i = 0; i < per_block && !err && *file_block < end; i++) {
+        if (level == 0) {
+            if (ptrs[i] && !add_extent(*file_block, ptrs[i], 1)) {
+                err = -ENOMEM;
+            }
+            (*file_block)++;
+        } else {
+            err = map_indirect(ptrs[i], level - 1, file_block, end);
+        }
+    }
+    kfree(ptrs);
+    return err;
+}
+
+int Ext4Inode::ensure_extents()
+{
+    if (__atomic_load_n(&extents_ready_, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+
+    SpinGuard guard(fs_->build_lock_);
+    if (extents_ready_) {
+        return 0;
+    }
+
+    int err = 0;
+    if (flags_ & INODE_EXTENTS_FL) {
+        err = map_extent_node(i_block_, sizeof(i_block_), ~0u);
+    } else {
+        // ext2/ext3的块映射: 12个直接块，然后是一、二、三级间接块
+        uint32_t end = (uint32_t)((size + fs_->block_size_ - 1) >> fs_->block_shift_);
+        uint32_t fb = 0;
+        for (unsigned i = 0; i < 12 && fb < end && !err; i++, fb++) {
+            uint32_t b = get32(i_block_ + i * 4);
+            if (b && !add_extent(fb, b, 1)) {
+                err = -ENOMEM;
+            }
+        }
+        for (unsigned level = 0; level < 3 && fb < end && !err; level++) {
+            err = map_indirect(get32(i_block_ + (12 + level) * 4), level, &fb, end);
+        }
+    }
+    if (err) {
+        extents_.clear();
+        return err;
+    }
+
+    __atomic_store_n(&extents_ready_, true, __ATOMIC_RELEASE);
+    return 0;
+}
+
+const Ext4Extent* Ext4Inode::find_extent(uint32_t file_block)
+{
+    size_t n = extents_.size();
+    if (!n) {
+        return nullptr;
+    }
+
+    size_t h = __atomic_load_n(&hint_, __ATOMIC_RELAXED);
+    if (h < n && file_block >= extents_[h].file_block &&
+        file_block - extents_[h].file_block < extents_[h].count) {
+        return &extents_[h];
+    }
+
+    // 找到最后一个 file_block <= 目标 的区段
+    size_t lo = 0, hi = n;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (extents_[mid].file_block <= file_block) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    const Ext4Extent& e = extents_[lo];
+    if (file_block < e.file_block) {
+        return &e;      // 在第一个区段之前的空洞
+    }
+    if (file_block - e.file_block >= e.count) {
+        // 落在空洞里: 返回下一个区段，调用者据此计算空洞长度
+        return lo + 1 < n ? &extents_[lo + 1] : nullptr;
+    }
+    __atomic_store_n(&hint_, lo, __ATOMIC_RELAXED);
+    return &e;
+}
+
+int64_t Ext4Inode::read(uint64_t off, void* buf, size_t len)
+{
+    if (off >= size) {
+        return 0;
+    }
+    if (len > size - off) {
+        len = size - off;
+    }
+
+    uint8_t* out = static_cast<uint8_t*>(buf);
+
+    // 快速符号链接和内联数据直接保存在inode的i_block中
+    bool fast_symlink = type == NodeType::Symlink && size < sizeof(i_block_) &&
+                        !(flags_ & INODE_EXTENTS_FL);
+    if (fast_symlink || (flags_ & INODE_INLINE_DATA_FL)) {
+        if (off + len > sizeof(i_block_)) {
+            return -EIO;    // 放在扩展属性中的内联数据不支持
+        }
+        memcpy(out, i_block_ + off, len);
+        return (int64_t)len;
+    }
+
+    int err = ensure_extents();
+    if (err) {
+        return err;
+    }
+
+    uint32_t bs = fs_->block_size_;
+    unsigned shift = fs_->block_shift_;
+    size_t done = 0;
+
+    while (done < len) {
+        uint64_t pos = off + done;
+        uint32_t fb = (uint32_t)(pos >> shift);
+        uint32_t in = (uint32_t)(pos & (bs - 1));
+
+        const Ext4Extent* e = find_extent(fb);
+        size_t n;
+        if (!e || fb < e->file_block) {
+            // 空洞: 一直到下一个区段(或文件末尾)都读出为0
+            uint64_t hole_end = e ? (uint64_t)e->file_block << shift : off + len;
+            n = hole_end - pos < len - done ? (size_t)(hole_end - pos) : len - done;
+            memset(out + done, 0, n);
+            done += n;
+            continue;
+        }
+
+        // 本区段内从当前位置起物理连续的字节数
+        uint32_t skip = fb - e->file_block;
+        uint64_t avail = ((uint64_t)(e->count - skip) << shift) - in;
+        n = len - done < avail ? len - done : (size_t)avail;
+
+        if (!e->disk_block) {
+            memset(out + done, 0, n);
+        } else {
+            err = fs_->read_bytes(((e->disk_block + skip) << shift) + in, out + done, n);
+            if (err) {
+                return done ? (int64_t)done : err;
+            }
+        }
+        done += n;
+    }
+    return (int64_t)done;
+}
+
+uint32_t Ext4Inode::lookup_linear(const char* name, size_t len)
+{
+    uint32_t bs = fs_->block_size_;
+    uint8_t* blk = static_cast<uint8_t*>(kmalloc(bs));
+    if (!blk) {
+        return 0;
+    }
+
+    uint32_t found = 0;
+    for (uint64_t off = 0; off < size && !found; off += bs) {
+        if (read(off, blk, bs) != (int64_t)bs) {
+            break;
+        }
+        found = find_in_block(blk, bs, name, len);
+    }
+    kfree(blk);
+    return found;
+}
+
+int Ext4Inode::lookup_htree(const char* name, size_t len, uint32_t* ino_out)
+{
+    uint32_t bs = fs_->block_size_;
+    uint8_t* index = static_cast<uint8_t*>(kmalloc(bs));
+    uint8_t* leaf = static_cast<uint8_t*>(kmalloc(bs));
+    int err = -EIO;
+    if (!index || !leaf) {
+        err = -ENOMEM;
+        goto out;
+    }
+    if (read(0, index, bs) != (int64_t)bs) {
+        goto out;
+    }
+
+    {
+        // dx_root: "."(12字节)、".."(覆盖块的剩余部分)之后是索引信息，
+        // 对不认识htree的驱动来说整个块就是两个普通目录项
+        const uint8_t* info = index + 24;
+        uint8_t version = info[4];
+        uint8_t info_len = info[5];
+        uint8_t levels = info[6];
+        if (get32(info) != 0 || info_len != 8 || levels > 2 || version > HASH_TEA) {
+            goto out;
+        }
+        if (fs_->unsigned_hash_) {
+            version += HASH_UNSIGNED_DELTA;
+        }
+        uint32_t hash = fs_->dir_hash(name, len, version);
+
+        const uint8_t* entries = info + info_len;
+        for (unsigned level = 0;; level++) {
+            // 每个索引块以 limit/count 开头，第0项的哈希隐含为0
+            uint16_t limit = get16(entries);
+            uint16_t count = get16(entries + 2);
+            if (!count || count > limit || entries + (size_t)count * 8 > index + bs) {
+                goto out;
+            }
+
+            uint16_t lo = 1, hi = count;
+            while (lo < hi) {
+                uint16_t mid = (uint16_t)((lo + hi) / 2);
+                if (get32(entries + mid * 8) <= hash) {
+                    lo = (uint16_t)(mid + 1);
+                } else {
+                    hi = mid;
+                }
+            }
+            uint16_t p = (uint16_t)(lo - 1);
+            uint32_t blk = get32(entries + p * 8 + 4) & 0x0FFFFFFF;
+
+            if (level < levels) {
+                if (read((uint64_t)blk * bs, index, bs) != (int64_t)bs) {
+                    goto out;
+                }
+                entries = index + 8;    // dx_node前面是一个覆盖整块的空目录项
+                continue;
+            }
+
+            // 叶子块；哈希冲突的名字可能延续到后续块，由下一项哈希的最低位标记
+            for (;;) {
+                if (read((uint64_t)blk * bs, leaf, bs) != (int64_t)bs) {
+                    goto out;
+                }
+                *ino_out = find_in_block(leaf, bs, name, len);
+                if (*ino_out || ++p >= count) {
+                    break;
+                }
+                uint32_t next = get32(entries + p * 8);
+                if (!(next & 1) || (next & ~1u) != hash) {
+                    break;
+                }
+                blk = get32(entries + p * 8 + 4) & 0x0FFFFFFF;
+            }
+            err = 0;
+            break;
+        }
+    }
+
+out:
+    kfree(index);
+    kfree(leaf);
+    return err;
+}
+
+Inode* Ext4Inode::lookup(const char* name, size_t len)
+{
+    if (!is_dir() || len == 0 || len > NAME_MAX) {
+        return nullptr;
+    }
+
+    uint32_t ino = 0;
+    if (!(flags_ & INODE_INDEX_FL) || lookup_htree(name, len, &ino) != 0) {
+        ino = lookup_linear(name, len);
+    }
+    return ino ? fs_->get_inode(ino) : nullptr;
+}
+
+int Ext4Inode::readdir(uint64_t* cookie, DirEntry* out)
+{
+    if (!is_dir()) {
+        return -ENOTDIR;
+    }
+
+    // cookie是目录内的字节偏移；最近读过的目录块缓存在dir_buf_中
+    uint32_t bs = fs_->block_size_;
+    SpinGuard guard(dir_lock_);
+    if (!dir_buf_) {
+        dir_buf_ = static_cast<uint8_t*>(kmalloc(bs));
+        if (!dir_buf_) {
+            return -ENOMEM;
+        }
+    }
+
+    while (*cookie < size) {
+        uint64_t blk = *cookie >> fs_->block_shift_;
+        uint32_t off = (uint32_t)(*cookie & (bs - 1));
+        if (blk != dir_buf_block_) {
+            dir_buf_block_ = ~0ULL;
+            if (read(blk << fs_->block_shift_, dir_buf_, bs) != (int64_t)bs) {
+                return -EIO;
+            }
+            dir_buf_block_ = blk;
+        }
+
+        const Ext4DirEntry* d = dirent_at(dir_buf_, bs, off);
+        if (!d) {
+            return -EIO;
+        }
+        *cookie += d->rec_len;
+
+        const char* name = reinterpret_cast<const char*>(d + 1);
+        if (!d->inode || d->name_len == 0 ||
+            (name[0] == '.' && (d->name_len == 1 || (d->name_len == 2 && name[1] == '.')))) {
+            continue;   // 空闲项、htree索引块、校验和尾部以及"."/".."
+        }
+
+        memcpy(out->name, name, d->name_len);
+        out->name[d->name_len] = '\0';
+        out->ino = d->inode;
+        if (fs_->has_filetype_) {
+            out->type = dirent_type(d->file_type);
+        } else {
+            // 老的ext2目录项没有类型字段，只能读inode
+            Ext4Inode* n = fs_->get_inode(d->inode);
+            out->type = n ? n->type : NodeType::Other;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+// ============================================
+// Ext4FileSystem
+// ============================================
+
+int Ext4FileSystem::read_blocks(uint64_t block, uint32_t count, void* buf)
+{
+    uint32_t spb = block_size_ / sector_size_;
+    return dev_->read(block * spb, count * spb, buf);
+}
+
+int Ext4FileSystem::read_bytes(uint64_t disk_off, void* buf, size_t len)
+{
+    uint8_t* out = static_cast<uint8_t*>(buf);
+    uint64_t lba = disk_off / sector_size_;
+    uint32_t in = (uint32_t)(disk_off % sector_size_);
+    int err;
+
+    // 开头不足一个扇区
+    if (in || len < sector_size_) {
+        size_t n = sector_size_ - in < len ? sector_size_ - in : len;
+        SpinGuard guard(lock_);
+        if ((err = dev_->read(lba, 1, bounce_))) {
+            return err;
+        }
+        memcpy(out, bounce_ + in, n);
+        out += n;
+        len -= n;
+        lba++;
+    }
+
+    // 中间整扇区部分直接读入调用者缓冲
+    uint64_t whole = len / sector_size_;
+    if (whole) {
+        if ((err = dev_->read(lba, (uint32_t)whole, out))) {
+            return err;
+        }
+        out += whole * sector_size_;
+        len -= whole * sector_size_;
+        lba += whole;
+    }
+
+    // 结尾不足一个扇区
+    if (len) {
+        SpinGuard guard(lock_);
+        if ((err = dev_->read(lba, 1, bounce_))) {
+            return err;
+        }
+        memcpy(out, bounce_, len);
+    }
+    return 0;
+}
+
+void Ext4FileSystem::prefetch_itables(uint32_t group)
+{
+    if (groups_[group].fetched) {
+        return;
+    }
+
+    // flex_bg把一组块组的inode表连续放在一起: 把其中物理相邻的表合并成一次读，
+    // 每张表只读到已使用的部分，组间未使用的空隙不超过PREFETCH_GAP时顺带读过
+    uint64_t table_bytes = (uint64_t)inodes_per_group_ * inode_size_;
+    uint64_t table_blocks = (table_bytes + block_size_ - 1) >> block_shift_;
+    uint32_t first = group - group % groups_per_flex_;
+    uint32_t last = first + groups_per_flex_ < group_count_ ? first + groups_per_flex_ : group_count_;
+
+    uint32_t g = first;
+    while (g < last) {
+        Ext4Group& start = groups_[g];
+        uint64_t bytes = (uint64_t)start.used_inodes * inode_size_;
+        if (start.fetched || !bytes || bytes > PREFETCH_MAX) {
+            start.fetched = true;
+            g++;
+            continue;
+        }
+
+        uint32_t end = g + 1;
+        while (end < last) {
+            const Ext4Group& prev = groups_[end - 1];
+            const Ext4Group& next = groups_[end];
+            uint64_t next_bytes = (next.inode_table - start.inode_table) * block_size_ +
+                                  (uint64_t)next.used_inodes * inode_size_;
+            if (next.fetched || !next.used_inodes ||
+                next.inode_table != prev.inode_table + table_blocks ||
+                table_bytes - (uint64_t)prev.used_inodes * inode_size_ > PREFETCH_GAP ||
+                next_bytes > PREFETCH_MAX) {
+                break;
+            }
+            bytes = next_bytes;
+            end++;
+        }
+
+        uint32_t blocks = (uint32_t)((bytes + block_size_ - 1) >> block_shift_);
+        uint8_t* buf = static_cast<uint8_t*>(mm::alloc_pages(
+            mm::size_to_order((uint64_t)blocks << block_shift_)));
+        if (buf && read_blocks(start.inode_table, blocks, buf) != 0) {
+            mm::free_pages(buf, mm::size_to_order((uint64_t)blocks << block_shift_));
+            buf = nullptr;
+        }
+
+        // 失败时这些组退回到逐个读inode
+        for (uint32_t i = g; i < end; i++) {
+            groups_[i].fetched = true;
+            if (buf) {
+                groups_[i].itable = buf + ((groups_[i].inode_table - start.inode_table) << block_shift_);
+            }
+        }
+        g = end;
+    }
+}
+
+int Ext4FileSystem::read_raw_inode(uint32_t ino, uint8_t* out)
+{
+    uint32_t group = (ino - 1) / inodes_per_group_;
+    uint32_t index = (ino - 1) % inodes_per_group_;
+    if (group >= group_count_) {
+        return -EINVAL;
+    }
+
+    prefetch_itables(group);
+    const Ext4Group& g = groups_[group];
+    if (g.itable && index < g.used_inodes) {
+        memcpy(out, g.itable + (uint64_t)index * inode_size_, sizeof(Ext4RawInode));
+        return 0;
+    }
+    return read_bytes((g.inode_table << block_shift_) + (uint64_t)index * inode_size_,
+                      out, sizeof(Ext4RawInode));
+}
+
+bool Ext4FileSystem::grow_table()
+{
+    uint32_t count = table_ ? (table_mask_ + 1) * 2 : 256;
+    Ext4Inode** table = static_cast<Ext4Inode**>(kzalloc(count * sizeof(Ext4Inode*)));
+    if (!table) {
+        return false;
+    }
+
+    if (table_) {
+        for (uint32_t b = 0; b <= table_mask_; b++) {
+            Ext4Inode* n = table_[b];
+            while (n) {
+                Ext4Inode* next = n->hash_next_;
+                uint32_t nb = (uint32_t)n->ino & (count - 1);
+                n->hash_next_ = table[nb];
+                table[nb] = n;
+                n = next;
+            }
+        }
+        kfree(table_);
+    }
+    table_ = table;
+    table_mask_ = count - 1;
+    return true;
+}
+
+Ext4Inode* Ext4FileSystem::get_inode(uint32_t ino)
+{
+    if (ino == 0 || ino > inodes_count_) {
+        return nullptr;
+    }
+
+    SpinGuard guard(cache_lock_);
+    if (table_) {
+        for (Ext4Inode* n = table_[ino & table_mask_]; n; n = n->hash_next_) {
+            if (n->ino == ino) {
+                return n;
+            }
+        }
+    }
+    if (cached_count_ >= table_mask_ && !grow_table()) {
+        return nullptr;
+    }
+
+    uint8_t raw[sizeof(Ext4RawInode)];
+    if (read_raw_inode(ino, raw) != 0) {
+        return nullptr;
+    }
+    Ext4Inode* n = knew<Ext4Inode>(this, ino, static_cast<const uint8_t*>(raw));
+    if (!n) {
+        return nullptr;
+    }
+    n->hash_next_ = table_[ino & table_mask_];
+    table_[ino & table_mask_] = n;
+    cached_count_++;
+    return n;
+}
+
+Ext4FileSystem* Ext4FileSystem::mount(BlockDevice* dev)
+{
+    uint32_t ss = dev->sector_size();
+    uint8_t* sector = static_cast<uint8_t*>(kmalloc(ss));
+    Ext4SuperBlock* sb = static_cast<Ext4SuperBlock*>(kmalloc(sizeof(Ext4SuperBlock)));
+    Ext4FileSystem* fs = knew<Ext4FileSystem>();
+    if (!sector || !sb || !fs) {
+        kfree(sector);
+        kfree(sb);
+        kdelete(fs);
+        return nullptr;
+    }
+
+    fs->dev_ = dev;
+    fs->bounce_ = sector;
+    fs->sector_size_ = ss;
+
+    bool ok = fs->read_bytes(SUPERBLOCK_OFFSET, sb, sizeof(*sb)) == 0 &&
+              sb->magic == EXT4_MAGIC && sb->log_block_size <= 6 &&
+              sb->inodes_per_group && sb->blocks_per_group &&
+              !(sb->feature_incompat & ~INCOMPAT_SUPPORTED);
+    uint32_t bs = 1024u << (ok ? sb->log_block_size : 0);
+    uint32_t isz = sb->rev_level == 0 ? 128 : sb->inode_size;
+    ok = ok && bs % ss == 0 && isz >= sizeof(Ext4RawInode) && isz <= bs && !(isz & (isz - 1));
+    if (!ok) {
+        kfree(sb);
+        return nullptr;
+    }
+
+    uint64_t blocks = sb->blocks_count_lo;
+    uint32_t desc_size = 32;
+    if (sb->feature_incompat & INCOMPAT_64BIT) {
+        blocks |= (uint64_t)sb->blocks_count_hi << 32;
+        desc_size = sb->desc_size;
+        if (desc_size < 32 || desc_size > sizeof(Ext4GroupDesc) || (desc_size & (desc_size - 1))) {
+            kfree(sb);
+            return nullptr;
+        }
+    }
+
+    fs->block_size_ = bs;
+    fs->block_shift_ = 10 + sb->log_block_size;
+    fs->inode_size_ = isz;
+    fs->inodes_per_group_ = sb->inodes_per_group;
+    fs->inodes_count_ = sb->inodes_count;
+    fs->group_count_ = (uint32_t)((blocks - sb->first_data_block + sb->blocks_per_group - 1) /
+                                  sb->blocks_per_group);
+    if ((sb->feature_incompat & INCOMPAT_FLEX_BG) && sb->log_groups_per_flex < 16) {
+        fs->groups_per_flex_ = 1u << sb->log_groups_per_flex;
+    }
+    memcpy(fs->hash_seed_, sb->hash_seed, sizeof(fs->hash_seed_));
+    fs->unsigned_hash_ = (sb->flags & FLAG_UNSIGNED_HASH) != 0;
+    fs->has_filetype_ = (sb->feature_incompat & INCOMPAT_FILETYPE) != 0;
+
+    bool csum = (sb->feature_ro_compat & (RO_COMPAT_GDT_CSUM | RO_COMPAT_METADATA_CSUM)) != 0;
+    uint64_t gdt_block = sb->first_data_block + 1;
+    kfree(sb);
+
+    // 块组描述符表: 一次读入，只保留驱动用到的字段
+    fs->groups_ = static_cast<Ext4Group*>(kzalloc((size_t)fs->group_count_ * sizeof(Ext4Group)));
+    uint64_t gdt_bytes = (uint64_t)fs->group_count_ * desc_size;
+    uint8_t* gdt = static_cast<uint8_t*>(kmalloc((gdt_bytes + bs - 1) & ~(uint64_t)(bs - 1)));
+    if (!fs->groups_ || !gdt) {
+        kfree(gdt);
+        return nullptr;
+    }
+
+    if (fs->read_blocks(gdt_block, (uint32_t)((gdt_bytes + bs - 1) >> fs->block_shift_), gdt)) {
+        kfree(gdt);
+        return nullptr;
+    }
+
+    for (uint32_t i = 0; i < fs->group_count_; i++) {
+        Ext4GroupDesc d;
+        memset(&d, 0, sizeof(d));
+        memcpy(&d, gdt + (uint64_t)i * desc_size, desc_size);
+
+        Ext4Group& g = fs->groups_[i];
+        g.inode_table = d.inode_table_lo | ((uint64_t)d.inode_table_hi << 32);
+        uint32_t used = fs->inodes_per_group_;
+        if (csum) {
+            // 带校验和的组描述符可信: 未初始化的组没有inode，末尾的itable_unused个也从未使用
+            uint32_t unused = d.itable_unused_lo | ((uint32_t)d.itable_unused_hi << 16);
+            used = (d.flags & BG_INODE_UNINIT) ? 0 : used - (unused < used ? unused : used);
+        }
+        g.used_inodes = used;
+    }
+    kfree(gdt);
+
+    fs->root_ = fs->get_inode(ROOT_INO);
+    return fs->root_ && fs->root_->is_dir() ? fs : nullptr;
+}
+
+namespace {
+
+// 在分区上挂载，失败时释放分区对象
+Ext4FileSystem* mount_partition(BlockDevice* disk, uint64_t first_lba, uint64_t sectors)
+{
+    BlockPartition* p = knew<BlockPartition>(disk, first_lba, sectors);
+    if (!p) {
+        return nullptr;
+    }
+    Ext4FileSystem* fs = Ext4FileSystem::mount(p);
+    if (!fs) {
+        kdelete(p);
+    }
+    return fs;
+}
+
+} // namespace
+
+Ext4FileSystem* Ext4FileSystem::probe(BlockDevice* disk)
+{
+    uint32_t ss = disk->sector_size();
+    uint8_t* sector = static_cast<uint8_t*>(kmalloc(ss));
+    if (!sector || disk->read(0, 1, sector)) {
+        kfree(sector);
+        return nullptr;
+    }
+
+    // 整盘格式化: mount自己检查超级块
+    Ext4FileSystem* fs = nullptr;
+    if (sector[510] != 0x55 || sector[511] != 0xAA) {
+        kfree(sector);
+        return mount(disk);
+    }
+
+    MbrPartition parts[4];
+    memcpy(parts, sector + 446, sizeof(parts));
+
+    for (int i = 0; i < 4 && !fs; i++) {
+        uint8_t t = parts[i].type;
+        if (t == 0x83) {
+            fs = mount_partition(disk, parts[i].lba_first, parts[i].sectors);
+        } else if (t == 0xEE && !disk->read(1, 1, sector)) {
+            GptHeader hdr;
+            memcpy(&hdr, sector, sizeof(hdr));
+            // 表项大小是不小于128的2的幂(UEFI规范)，这里还要求不跨扇区
+            if (memcmp(hdr.signature, "EFI PART", 8) != 0 || hdr.entry_size < sizeof(GptEntry) ||
+                hdr.entry_size > ss || (hdr.entry_size & (hdr.entry_size - 1))) {
+                break;
+            }
+            uint32_t per_sector = ss / hdr.entry_size;
+            for (uint32_t e = 0; e < hdr.num_entries && !fs; e++) {
+                if (e % per_sector == 0 &&
+                    disk->read(hdr.entries_lba + e / per_sector, 1, sector)) {
+                    break;
+                }
+                GptEntry ent;
+                memcpy(&ent, sector + (e % per_sector) * hdr.entry_size, sizeof(ent));
+                if (memcmp(ent.type_guid, GUID_LINUX_DATA, 16) != 0) {
+                    continue;
+                }
+                fs = mount_partition(disk, ent.first_lba, ent.last_lba - ent.first_lba + 1);
+            }
+        }
+    }
+
+    kfree(sector);
+    return fs;
+}
+
+} // namespace fs
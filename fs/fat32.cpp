@@ -0,0 +1,880 @@
+/**
+ * leafOS - FAT32文件系统驱动实现 (只读)
+ */
+
+#include <fat32.hpp>
+#include <page_alloc.hpp>
+#include <kheap.hpp>
+#include <kstring.hpp>
+
+namespace fs {
+
+namespace {
+
+// ============================================
+// 磁盘结构
+// ============================================
+
+struct __attribute__((packed)) FatBootSector {
+    uint8_t  jump[3];
+    char     oem[8];
+    uint16_t bytes_per_sector;
+    uint8_t  sectors_per_cluster;
+    uint16_t reserved_sectors;
+    uint8_t  num_fats;
+    uint16_t root_entries;          // FAT32中为0
+    uint16_t total_sectors_16;
+    uint8_t  media;
+    uint16_t fat_size_16;           // FAT32中为0
+    uint16_t sectors_per_track;
+    uint16_t num_heads;
+    uint32_t hidden_sectors;
+    uint32_t total_sectors_32;
+    uint32_t fat_size_32;
+    uint16_t ext_flags;             // 第7位置位时只有bits 0-3指定的FAT有效
+    uint16_t fs_version;
+    uint32_t root_cluster;
+    uint16_t fs_info;
+    uint16_t backup_boot;
+    uint8_t  reserved[12];
+    uint8_t  drive_number;
+    uint8_t  reserved1;
+    uint8_t  boot_signature;
+    uint32_t volume_id;
+    char     volume_label[11];
+    char     fs_type[8];
+};
+
+struct __attribute__((packed)) FatRawDirent {
+    char     name[11];
+    uint8_t  attr;
+    uint8_t  nt_reserved;           // 0x08: 主名小写, 0x10: 扩展名小写
+    uint8_t  create_time_tenth;
+    uint16_t create_time;
+    uint16_t create_date;
+    uint16_t access_date;
+    uint16_t cluster_hi;
+    uint16_t write_time;
+    uint16_t write_date;
+    uint16_t cluster_lo;
+    uint32_t size;
+};
+
+struct __attribute__((packed)) FatLfnDirent {
+    uint8_t  order;
+    uint16_t name1[5];
+    uint8_t  attr;
+    uint8_t  type;
+    uint8_t  checksum;
+    uint16_t name2[6];
+    uint16_t cluster;
+    uint16_t name3[2];
+};
+
+struct __attribute__((packed)) MbrPartition {
+    uint8_t  status;
+    uint8_t  chs_first[3];
+    uint8_t  type;
+    uint8_t  chs_last[3];
+    uint32_t lba_first;
+    uint32_t sectors;
+};
+
+struct __attribute__((packed)) GptHeader {
+    char     signature[8];          // "EFI PART"
+    uint32_t revision;
+    uint32_t header_size;
+    uint32_t header_crc;
+    uint32_t reserved;
+    uint64_t current_lba;
+    uint64_t backup_lba;
+    uint64_t first_usable;
+    uint64_t last_usable;
+    uint8_t  disk_guid[16];
+    uint64_t entries_lba;
+    uint32_t num_entries;
+    uint32_t entry_size;
+    uint32_t entries_crc;
+};
+
+struct __attribute__((packed)) GptEntry {
+    uint8_t  type_guid[16];
+    uint8_t  unique_guid[16];
+    uint64_t first_lba;
+    uint64_t last_lba;
+    uint64_t attributes;
+    uint16_t name[36];
+};
+
+static_assert(sizeof(FatBootSector) == 90, "FAT引导扇区布局错误");
+static_assert(sizeof(FatRawDirent) == 32, "FAT目录项布局错误");
+static_assert(sizeof(FatLfnDirent) == 32, "FAT长文件名项布局错误");
+
+constexpr uint8_t ATTR_READ_ONLY = 0x01;
+constexpr uint8_t ATTR_HIDDEN    = 0x02;
+constexpr uint8_t ATTR_SYSTEM    = 0x04;
+constexpr uint8_t ATTR_VOLUME_ID = 0x08;
+constexpr uint8_t ATTR_DIRECTORY = 0x10;
+constexpr uint8_t ATTR_LFN       = ATTR_READ_ONLY | ATTR_HIDDEN | ATTR_SYSTEM | ATTR_VOLUME_ID;
+
+constexpr uint32_t FAT_ENTRY_MASK = 0x0FFFFFFF;
+constexpr uint32_t FAT_EOC_MIN    = 0x0FFFFFF8;
+
+constexpr unsigned FAT_CHUNK_ORDER   = mm::MAX_ORDER;
+constexpr uint32_t FAT_CHUNK_ENTRIES = (uint32_t)((mm::PAGE_SIZE << FAT_CHUNK_ORDER) / 4);
+
+constexpr uint32_t NO_INDEX = 0xFFFFFFFF;
+
+// EFI系统分区和Microsoft基本数据分区的GUID (磁盘上的字节序)
+const uint8_t GUID_ESP[16] = {
+    0x28, 0x73, 0x2A, 0xC1, 0x1F, 0xF8, 0xD2, 0x11,
+    0xBA, 0x4B, 0x00, 0xA0, 0xC9, 0x3E, 0xC9, 0x3B,
+};
+const uint8_t GUID_BASIC_DATA[16] = {
+    0xA2, 0xA0, 0xD0, 0xEB, 0xE5, 0xB9, 0x33, 0x44,
+    0x87, 0xC0, 0x68, 0xB6, 0xB7, 0x26, 0x99, 0xC7,
+};
+
+inline char ascii_lower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+// FAT文件名不区分大小写: 哈希和比较都按ASCII小写进行
+uint32_t name_hash(const char* s, size_t len)
+{
+    uint32_t h = 2166136261u;   // FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)ascii_lower(s[i]);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+bool name_equal(const char* a, const char* b, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (ascii_lower(a[i]) != ascii_lower(b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint8_t short_name_checksum(const char* name)
+{
+    uint8_t sum = 0;
+    for (int i = 0; i < 11; i++) {
+        sum = (uint8_t)(((sum & 1) << 7) + (sum >> 1) + (uint8_t)name[i]);
+    }
+    return sum;
+}
+
+// UCS-2/UTF-16 -> UTF-8，返回写入的字节数
+size_t utf16_to_utf8(const uint16_t* in, size_t count, char* out, size_t cap)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t cp = in[i];
+        if (cp >= 0xD800 && cp < 0xDC00 && i + 1 < count &&
+            in[i + 1] >= 0xDC00 && in[i + 1] < 0xE000) {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (in[i + 1] - 0xDC00);
+            i++;
+        }
+
+        char tmp[4];
+        size_t len;
+        if (cp < 0x80) {
+            tmp[0] = (char)cp;
+            len = 1;
+        } else if (cp < 0x800) {
+            tmp[0] = (char)(0xC0 | (cp >> 6));
+            tmp[1] = (char)(0x80 | (cp & 0x3F));
+            len = 2;
+        } else if (cp < 0x10000) {
+            tmp[0] = (char)(0xE0 | (cp >> 12));
+            tmp[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+            tmp[2] = (char)(0x80 | (cp & 0x3F));
+            len = 3;
+        } else {
+            tmp[0] = (char)(0xF0 | (cp >> 18));
+            tmp[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+            tmp[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+            tmp[3] = (char)(0x80 | (cp & 0x3F));
+            len = 4;
+        }
+        if (n + len > cap) {
+            break;
+        }
+        memcpy(out + n, tmp, len);
+        n += len;
+    }
+    return n;
+}
+
+// 8.3短文件名 -> "NAME.EXT"，按NT保留字节中的标志转成小写
+size_t short_name_to_str(const FatRawDirent* d, char* out)
+{
+    size_t n = 0;
+    bool lower_base = d->nt_reserved & 0x08;
+    bool lower_ext = d->nt_reserved & 0x10;
+
+    for (int i = 0; i < 8 && d->name[i] != ' '; i++) {
+        char c = (i == 0 && d->name[0] == 0x05) ? (char)0xE5 : d->name[i];
+        out[n++] = lower_base ? ascii_lower(c) : c;
+    }
+    if (d->name[8] != ' ') {
+        out[n++] = '.';
+        for (int i = 8; i < 11 && d->name[i] != ' '; i++) {
+            out[n++] = lower_ext ? ascii_lower(d->name[i]) : d->name[i];
+        }
+    }
+    return n;
+}
+
+bool looks_like_fat32(const uint8_t* sector)
+{
+    const FatBootSector* bs = reinterpret_cast<const FatBootSector*>(sector);
+    if (sector[510] != 0x55 || sector[511] != 0xAA) {
+        return false;
+    }
+    if (sector[0] != 0xEB && sector[0] != 0xE9) {
+        return false;
+    }
+    uint16_t bps = bs->bytes_per_sector;
+    uint8_t spc = bs->sectors_per_cluster;
+    return bps >= 512 && bps <= 4096 && (bps & (bps - 1)) == 0 &&
+           spc && (spc & (spc - 1)) == 0 &&
+           bs->fat_size_16 == 0 && bs->fat_size_32 && bs->root_entries == 0;
+}
+
+} // namespace
+
+// ============================================
+// 目录缓存
+// ============================================
+
+// 目录中的一个条目
+struct FatDirRecord {
+    uint32_t  name_off;         // 显示名(长文件名优先)在names中的偏移
+    uint16_t  name_len;
+    uint8_t   attr;
+    uint32_t  first_cluster;
+    uint32_t  size;
+    FatInode* inode;            // 第一次查找到时创建
+};
+
+// 哈希链节点: 长文件名和8.3短名各占一个，指向同一条目
+struct FatHashNode {
+    uint32_t hash;
+    uint32_t record;
+    uint32_t name_off;
+    uint16_t name_len;
+    uint32_t next;
+};
+
+struct FatDirCache {
+    kstd::Vector<char>         names;
+    kstd::Vector<FatDirRecord> records;
+    kstd::Vector<FatHashNode>  nodes;
+    uint32_t*                  buckets = nullptr;
+    uint32_t                   bucket_mask = 0;
+
+    bool add_name(uint32_t record, const char* name, size_t len, uint32_t* off_out)
+    {
+        uint32_t off = (uint32_t)names.size();
+        if (!names.resize(off + len)) {
+            return false;
+        }
+        memcpy(names.data() + off, name, len);
+        if (off_out) {
+            *off_out = off;
+        }
+        FatHashNode node = { name_hash(name, len), record, off, (uint16_t)len, NO_INDEX };
+        return nodes.push_back(node);
+    }
+
+    bool build_index()
+    {
+        uint32_t count = 16;
+        while (count < nodes.size() * 2) {
+            count <<= 1;
+        }
+        buckets = static_cast<uint32_t*>(kmalloc(count * sizeof(uint32_t)));
+        if (!buckets) {
+            return false;
+        }
+        memset(buckets, 0xFF, count * sizeof(uint32_t));
+        bucket_mask = count - 1;
+
+        for (uint32_t i = 0; i < nodes.size(); i++) {
+            uint32_t b = nodes[i].hash & bucket_mask;
+            nodes[i].next = buckets[b];
+            buckets[b] = i;
+        }
+        return true;
+    }
+
+    FatDirRecord* find(const char* name, size_t len)
+    {
+        uint32_t h = name_hash(name, len);
+        for (uint32_t i = buckets[h & bucket_mask]; i != NO_INDEX; i = nodes[i].next) {
+            const FatHashNode& n = nodes[i];
+            if (n.hash == h && n.name_len == len &&
+                name_equal(names.data() + n.name_off, name, len)) {
+                return &records[n.record];
+            }
+        }
+        return nullptr;
+    }
+};
+
+// ============================================
+// FatInode
+// ============================================
+
+FatInode::FatInode(Fat32FileSystem* fs, uint32_t first_cluster, uint32_t size, bool dir)
+    : fs_(fs), first_cluster_(first_cluster)
+{
+    ino = fs->next_ino();
+    this->size = size;
+    type = dir ? NodeType::Directory : NodeType::File;
+    mode = dir ? 0555 : 0444;
+}
+
+int FatInode::ensure_extents()
+{
+    if (__atomic_load_n(&extents_ready_, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+
+    SpinGuard guard(fs_->build_lock_);
+    if (extents_ready_) {
+        return 0;
+    }
+
+    // 沿内存中的FAT走一遍簇链，把相邻簇合并成区段
+    uint32_t cluster = first_cluster_;
+    uint32_t file_cluster = 0;
+    while (fs_->valid_cluster(cluster)) {
+        if (file_cluster > fs_->cluster_count_) {
+            return -EIO;    // 簇链成环
+        }
+        if (!extents_.empty()) {
+            FatExtent& last = extents_.back();
+            if (last.disk_cluster + last.count == cluster) {
+                last.count++;
+                file_cluster++;
+                cluster = fs_->next_cluster(cluster);
+                continue;
+            }
+        }
+        FatExtent ext = { file_cluster, cluster, 1 };
+        if (!extents_.push_back(ext)) {
+            extents_.clear();
+            return -ENOMEM;
+        }
+        file_cluster++;
+        cluster = fs_->next_cluster(cluster);
+    }
+
+    // FAT目录项中目录的大小为0，以簇链长度为准
+    uint64_t chain_bytes = (uint64_t)file_cluster * fs_->cluster_bytes_;
+    if (is_dir()) {
+        size = chain_bytes;
+    } else if (size > chain_bytes) {
+        size = chain_bytes;     // 簇链比目录项记录的短，只读到簇链末尾
+    }
+
+    __atomic_store_n(&extents_ready_, true, __ATOMIC_RELEASE);
+    return 0;
+}
+
+const FatExtent* FatInode::find_extent(uint32_t file_cluster)
+{
+    size_t n = extents_.size();
+    if (!n) {
+        return nullptr;
+    }
+
+    size_t h = __atomic_load_n(&hint_, __ATOMIC_RELAXED);
+    if (h < n && file_cluster >= extents_[h].file_cluster &&
+        file_cluster < extents_[h].file_cluster + extents_[h].count) {
+        return &extents_[h];
+    }
+
+    // 找到最后一个 file_cluster <= 目标 的区段
+    size_t lo = 0, hi = n;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (extents_[mid].file_cluster <= file_cluster) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    const FatExtent& e = extents_[lo];
+    if (file_cluster < e.file_cluster || file_cluster >= e.file_cluster + e.count) {
+        return nullptr;
+    }
+    __atomic_store_n(&hint_, lo, __ATOMIC_RELAXED);
+    return &e;
+}
+
+int64_t FatInode::read(uint64_t off, void* buf, size_t len)
+{
+    int err = ensure_extents();
+    if (err) {
+        return err;
+    }
+    if (off >= size) {
+        return 0;
+    }
+    if (len > size - off) {
+        len = size - off;
+    }
+
+    uint8_t* out = static_cast<uint8_t*>(buf);
+    uint32_t cb = fs_->cluster_bytes_;
+    size_t done = 0;
+
+    while (done < len) {
+        uint64_t pos = off + done;
+        uint32_t fc = (uint32_t)(pos / cb);
+        uint32_t in = (uint32_t)(pos % cb);
+
+        const FatExtent* e = find_extent(fc);
+        if (!e) {
+            return done ? (int64_t)done : -EIO;
+        }
+
+        // 本区段内从当前位置起物理连续的字节数
+        uint32_t skip = fc - e->file_cluster;
+        uint64_t avail = (uint64_t)(e->count - skip) * cb - in;
+        size_t n = len - done < avail ? len - done : (size_t)avail;
+
+        uint64_t disk_off = fs_->cluster_lba(e->disk_cluster + skip) * fs_->sector_size_ + in;
+        err = fs_->read_bytes(disk_off, out + done, n);
+        if (err) {
+            return done ? (int64_t)done : err;
+        }
+        done += n;
+    }
+    return (int64_t)done;
+}
+
+int FatInode::ensure_dir_cache()
+{
+    if (__atomic_load_n(&dir_, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+    if (!is_dir()) {
+        return -ENOTDIR;
+    }
+
+    int err = ensure_extents();
+    if (err) {
+        return err;
+    }
+
+    SpinGuard guard(fs_->build_lock_);
+    if (dir_) {
+        return 0;
+    }
+
+    uint8_t* raw = static_cast<uint8_t*>(kmalloc(size));
+    if (!raw) {
+        return -ENOMEM;
+    }
+    int64_t got = read(0, raw, size);
+    if (got < 0) {
+        kfree(raw);
+        return (int)got;
+    }
+
+    FatDirCache* cache = knew<FatDirCache>();
+    if (!cache) {
+        kfree(raw);
+        return -ENOMEM;
+    }
+
+    uint16_t lfn[20 * 13];          // 长文件名最多20项，每项13个字符
+    int      lfn_next = 0;          // 期待的下一个序号，0表示没有进行中的长文件名
+    uint8_t  lfn_sum = 0;
+    size_t   lfn_len = 0;
+    bool     ok = true;
+
+    for (int64_t pos = 0; ok && pos + 32 <= got; pos += 32) {
+        const FatRawDirent* d = reinterpret_cast<const FatRawDirent*>(raw + pos);
+        uint8_t first = (uint8_t)d->name[0];
+
+        if (first == 0x00) {
+            break;              // 目录结束
+        }
+        if (first == 0xE5) {
+            lfn_next = 0;       // 已删除
+            continue;
+        }
+
+        if ((d->attr & 0x3F) == ATTR_LFN) {
+            const FatLfnDirent* l = reinterpret_cast<const FatLfnDirent*>(d);
+            int seq = l->order & 0x1F;
+            if (l->order & 0x40) {
+                // 长文件名的最后一段最先出现
+                if (seq < 1 || seq > 20) {
+                    lfn_next = 0;
+                    continue;
+                }
+                lfn_next = seq;
+                lfn_sum = l->checksum;
+                lfn_len = (size_t)seq * 13;
+            } else if (seq != lfn_next || l->checksum != lfn_sum) {
+                lfn_next = 0;
+                continue;
+            }
+
+            uint16_t* dst = lfn + (seq - 1) * 13;
+            memcpy(dst, l->name1, sizeof(l->name1));
+            memcpy(dst + 5, l->name2, sizeof(l->name2));
+            memcpy(dst + 11, l->name3, sizeof(l->name3));
+            lfn_next = seq - 1;
+            continue;
+        }
+
+        bool have_lfn = lfn_next == 0 && lfn_len &&
+                        short_name_checksum(d->name) == lfn_sum;
+        size_t lfn_count = lfn_len;
+        lfn_next = 0;
+        lfn_len = 0;
+
+        if (d->attr & ATTR_VOLUME_ID) {
+            continue;
+        }
+
+        char short_name[13];
+        size_t short_len = short_name_to_str(d, short_name);
+        if ((short_len == 1 && short_name[0] == '.') ||
+            (short_len == 2 && short_name[0] == '.' && short_name[1] == '.')) {
+            continue;
+        }
+
+        FatDirRecord rec;
+        rec.attr = d->attr;
+        rec.first_cluster = ((uint32_t)d->cluster_hi << 16) | d->cluster_lo;
+        rec.size = d->size;
+        rec.inode = nullptr;
+        uint32_t index = (uint32_t)cache->records.size();
+
+        if (have_lfn) {
+            // 长文件名以0结尾，其后用0xFFFF填充
+            size_t chars = 0;
+            while (chars < lfn_count && lfn[chars] != 0x0000 && lfn[chars] != 0xFFFF) {
+                chars++;
+            }
+            char utf8[NAME_MAX];
+            size_t n = utf16_to_utf8(lfn, chars, utf8, sizeof(utf8));
+            ok = cache->add_name(index, utf8, n, &rec.name_off);
+            rec.name_len = (uint16_t)n;
+            // 8.3短名作为别名，同样可以查到
+            ok = ok && cache->add_name(index, short_name, short_len, nullptr);
+        } else {
+            ok = cache->add_name(index, short_name, short_len, &rec.name_off);
+            rec.name_len = (uint16_t)short_len;
+        }
+        ok = ok && cache->records.push_back(rec);
+    }
+    kfree(raw);
+
+    if (!ok || !cache->build_index()) {
+        kfree(cache->buckets);
+        kdelete(cache);
+        return -ENOMEM;
+    }
+
+    __atomic_store_n(&dir_, cache, __ATOMIC_RELEASE);
+    return 0;
+}
+
+Inode* FatInode::lookup(const char* name, size_t len)
+{
+    if (ensure_dir_cache()) {
+        return nullptr;
+    }
+
+    FatDirRecord* rec = dir_->find(name, len);
+    if (!rec) {
+        return nullptr;
+    }
+
+    FatInode* node = __atomic_load_n(&rec->inode, __ATOMIC_ACQUIRE);
+    if (node) {
+        return node;
+    }
+
+    SpinGuard guard(fs_->build_lock_);
+    if (!rec->inode) {
+        uint32_t cluster = rec->first_cluster;
+        // ".."等指向根目录的项簇号为0
+        if (cluster == 0 && (rec->attr & ATTR_DIRECTORY)) {
+            return fs_->root_;
+        }
+        node = knew<FatInode>(fs_, cluster, rec->size, (rec->attr & ATTR_DIRECTORY) != 0);
+        __atomic_store_n(&rec->inode, node, __ATOMIC_RELEASE);
+    }
+    return rec->inode;
+}
+
+int FatInode::readdir(uint64_t* cookie, DirEntry* out)
+{
+    int err = ensure_dir_cache();
+    if (err) {
+        return err;
+    }
+    if (*cookie >= dir_->records.size()) {
+        return 0;
+    }
+
+    const FatDirRecord& rec = dir_->records[*cookie];
+    memcpy(out->name, dir_->names.data() + rec.name_off, rec.name_len);
+    out->name[rec.name_len] = '\0';
+    out->type = (rec.attr & ATTR_DIRECTORY) ? NodeType::Directory : NodeType::File;
+    out->ino = rec.inode ? rec.inode->ino : 0;
+    (*cookie)++;
+    return 1;
+}
+
+// ============================================
+// Fat32FileSystem
+// ============================================
+
+uint32_t Fat32FileSystem::next_cluster(uint32_t cluster) const
+{
+    uint32_t v = fat_chunks_[cluster / FAT_CHUNK_ENTRIES][cluster % FAT_CHUNK_ENTRIES];
+    v &= FAT_ENTRY_MASK;
+    return v >= FAT_EOC_MIN ? 0 : v;
+}
+
+int Fat32FileSystem::load_fat(uint64_t fat_lba)
+{
+    uint32_t entries = cluster_count_ + 2;
+    fat_chunk_count_ = (entries + FAT_CHUNK_ENTRIES - 1) / FAT_CHUNK_ENTRIES;
+    fat_chunks_ = static_cast<uint32_t**>(kzalloc(fat_chunk_count_ * sizeof(uint32_t*)));
+    if (!fat_chunks_) {
+        return -ENOMEM;
+    }
+
+    uint32_t entries_per_sector = sector_size_ / 4;
+    for (uint32_t i = 0; i < fat_chunk_count_; i++) {
+        uint32_t first = i * FAT_CHUNK_ENTRIES;
+        uint32_t n = entries - first < FAT_CHUNK_ENTRIES ? entries - first : FAT_CHUNK_ENTRIES;
+        uint32_t sectors = (n + entries_per_sector - 1) / entries_per_sector;
+
+        fat_chunks_[i] = static_cast<uint32_t*>(
+            mm::alloc_pages(mm::size_to_order((uint64_t)sectors * sector_size_)));
+        if (!fat_chunks_[i]) {
+            return -ENOMEM;
+        }
+        // 每块FAT用一次多扇区读取装入
+        int err = dev_->read(fat_lba + first / entries_per_sector, sectors, fat_chunks_[i]);
+        if (err) {
+            return err;
+        }
+    }
+    return 0;
+}
+
+int Fat32FileSystem::read_bytes(uint64_t disk_off, void* buf, size_t len)
+{
+    uint8_t* out = static_cast<uint8_t*>(buf);
+    uint64_t lba = disk_off / sector_size_;
+    uint32_t in = (uint32_t)(disk_off % sector_size_);
+    int err;
+
+    // 开头不足一个扇区
+    if (in || len < sector_size_) {
+        size_t n = sector_size_ - in < len ? sector_size_ - in : len;
+        SpinGuard guard(lock_);
+        if ((err = dev_->read(lba, 1, bounce_))) {
+            return err;
+        }
+        memcpy(out, bounce_ + in, n);
+        out += n;
+        len -= n;
+        lba++;
+    }
+
+    // 中间整扇区部分直接读入调用者缓冲
+    uint64_t whole = len / sector_size_;
+    if (whole) {
+        if ((err = dev_->read(lba, (uint32_t)whole, out))) {
+            return err;
+        }
+        out += whole * sector_size_;
+        len -= whole * sector_size_;
+        lba += whole;
+    }
+
+    // 结尾不足一个扇区
+    if (len) {
+        SpinGuard guard(lock_);
+        if ((err = dev_->read(lba, 1, bounce_))) {
+            return err;
+        }
+        memcpy(out, bounce_, len);
+    }
+    return 0;
+}
+
+Fat32FileSystem* Fat32FileSystem::mount(BlockDevice* dev)
+{
+    uint8_t* sector = static_cast<uint8_t*>(kmalloc(dev->sector_size()));
+    if (!sector) {
+        return nullptr;
+    }
+    if (dev->read(0, 1, sector) || !looks_like_fat32(sector)) {
+        kfree(sector);
+        return nullptr;
+    }
+
+    FatBootSector bs;
+    memcpy(&bs, sector, sizeof(bs));
+    if (bs.bytes_per_sector != dev->sector_size() || bs.num_fats == 0) {
+        kfree(sector);
+        return nullptr;
+    }
+
+    Fat32FileSystem* fs = knew<Fat32FileSystem>();
+    if (!fs) {
+        kfree(sector);
+        return nullptr;
+    }
+    fs->bounce_ = sector;
+
+    uint64_t total = bs.total_sectors_16 ? bs.total_sectors_16 : bs.total_sectors_32;
+    uint64_t fat_lba = bs.reserved_sectors;
+    if (bs.ext_flags & 0x80) {
+        // 未启用镜像时只有活动FAT是最新的
+        fat_lba += (uint64_t)(bs.ext_flags & 0x0F) * bs.fat_size_32;
+    }
+
+    fs->dev_ = dev;
+    fs->sector_size_ = bs.bytes_per_sector;
+    fs->sectors_per_cluster_ = bs.sectors_per_cluster;
+    fs->cluster_bytes_ = bs.bytes_per_sector * bs.sectors_per_cluster;
+    fs->data_lba_ = bs.reserved_sectors + (uint64_t)bs.num_fats * bs.fat_size_32;
+    if (total <= fs->data_lba_) {
+        fs->destroy();
+        return nullptr;
+    }
+    fs->cluster_count_ = (uint32_t)((total - fs->data_lba_) / bs.sectors_per_cluster);
+
+    uint32_t root_cluster = bs.root_cluster;
+    if (fs->load_fat(fat_lba) != 0 || !fs->valid_cluster(root_cluster)) {
+        fs->destroy();
+        return nullptr;
+    }
+
+    fs->root_ = knew<FatInode>(fs, root_cluster, 0u, true);
+    if (!fs->root_) {
+        fs->destroy();
+        return nullptr;
+    }
+    return fs;
+}
+
+// 挂载失败时释放已分配的FAT缓存、中转缓冲和对象本身，设备由调用者处理
+void Fat32FileSystem::destroy()
+{
+    if (fat_chunks_) {
+        uint32_t entries = cluster_count_ + 2;
+        for (uint32_t i = 0; i < fat_chunk_count_ && fat_chunks_[i]; i++) {
+            uint32_t first = i * FAT_CHUNK_ENTRIES;
+            uint32_t n = entries - first < FAT_CHUNK_ENTRIES ? entries - first : FAT_CHUNK_ENTRIES;
+            uint32_t sectors = (n + sector_size_ / 4 - 1) / (sector_size_ / 4);
+            mm::free_pages(fat_chunks_[i], mm::size_to_order((uint64_t)sectors * sector_size_));
+        }
+        kfree(fat_chunks_);
+    }
+    kfree(bounce_);
+    kdelete(this);
+}
+
+namespace {
+
+// 在分区上挂载，失败时连同分区对象一起释放
+Fat32FileSystem* mount_partition(BlockDevice* disk, uint64_t first_lba, uint64_t sectors)
+{
+    BlockPartition* p = knew<BlockPartition>(disk, first_lba, sectors);
+    if (!p) {
+        return nullptr;
+    }
+    Fat32FileSystem* fs = Fat32FileSystem::mount(p);
+    if (!fs) {
+        kdelete(p);
+    }
+    return fs;
+}
+
+} // namespace
+
+Fat32FileSystem* Fat32FileSystem::probe(BlockDevice* disk)
+{
+    uint32_t ss = disk->sector_size();
+    uint8_t* sector = static_cast<uint8_t*>(kmalloc(ss));
+    if (!sector || disk->read(0, 1, sector)) {
+        kfree(sector);
+        return nullptr;
+    }
+
+    // 整盘格式化 (make uefi-disk 生成的镜像就是这种)
+    if (looks_like_fat32(sector)) {
+        kfree(sector);
+        return mount(disk);
+    }
+    if (sector[510] != 0x55 || sector[511] != 0xAA) {
+        kfree(sector);
+        return nullptr;
+    }
+
+    MbrPartition parts[4];
+    memcpy(parts, sector + 446, sizeof(parts));
+    Fat32FileSystem* fs = nullptr;
+
+    for (int i = 0; i < 4 && !fs; i++) {
+        uint8_t t = parts[i].type;
+        if (t == 0x0B || t == 0x0C || t == 0xEF) {
+            fs = mount_partition(disk, parts[i].lba_first, parts[i].sectors);
+        } else if (t == 0xEE && !disk->read(1, 1, sector)) {
+            // GPT保护性MBR: 在分区表中找ESP，其次是基本数据分区
+            GptHeader hdr;
+            memcpy(&hdr, sector, sizeof(hdr));
+            // 表项大小是不小于128的2的幂(UEFI规范)，这里还要求不跨扇区
+            if (memcmp(hdr.signature, "EFI PART", 8) != 0 || hdr.entry_size < sizeof(GptEntry) ||
+                hdr.entry_size > ss || (hdr.entry_size & (hdr.entry_size - 1))) {
+                break;
+            }
+            uint32_t per_sector = ss / hdr.entry_size;
+            for (int pass = 0; pass < 2 && !fs; pass++) {
+                const uint8_t* want = pass == 0 ? GUID_ESP : GUID_BASIC_DATA;
+                for (uint32_t e = 0; e < hdr.num_entries && !fs; e++) {
+                    if (e % per_sector == 0 &&
+                        disk->read(hdr.entries_lba + e / per_sector, 1, sector)) {
+                        break;
+                    }
+                    GptEntry ent;
+                    memcpy(&ent, sector + (e % per_sector) * hdr.entry_size, sizeof(ent));
+                    if (memcmp(ent.type_guid, want, 16) != 0) {
+                        continue;
+                    }
+                    fs = mount_partition(disk, ent.first_lba, ent.last_lba - ent.first_lba + 1);
+                }
+            }
+        }
+    }
+
+    kfree(sector);
+    return fs;
+}
+
+} // namespace fs
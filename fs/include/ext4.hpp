@@ -0,0 +1,134 @@
+/**
+ * leafOS - ext2/ext3/ext4文件系统驱动 (只读)
+ *
+ * - 支持区段树(extents)和旧式间接块映射；每个文件第一次访问时把映射展开成
+ *   按文件块号排序的区段表并常驻内存，之后定位任意偏移只需二分查找
+ * - 按块组预取inode表: 第一次访问某个组的inode时，把它所在flex_bg中
+ *   物理相邻的各组inode表(只读已使用的部分)合并成一次大的顺序读
+ * - htree索引目录按名字哈希直接定位叶子块，不必扫描整个目录
+ */
+
+#pragma once
+#ifndef __LEAFOS_EXT4_H__
+#define __LEAFOS_EXT4_H__
+
+#include <vfs.hpp>
+#include <block.hpp>
+#include <kvector.hpp>
+#include <spinlock.hpp>
+
+namespace fs {
+
+class Ext4FileSystem;
+
+// 文件中一段物理连续的块
+struct Ext4Extent {
+    uint32_t file_block;    // 区段在文件内的起始块号
+    uint32_t count;         // 连续块数
+    uint64_t disk_block;    // 对应的磁盘块号，0表示未初始化(读出为0)
+};
+
+class Ext4Inode : public Inode {
+public:
+    Ext4Inode(Ext4FileSystem* fs, uint32_t ino, const uint8_t* raw);
+
+    int64_t read(uint64_t off, void* buf, size_t len) override;
+    Inode*  lookup(const char* name, size_t len) override;
+    int     readdir(uint64_t* cookie, DirEntry* out) override;
+
+private:
+    friend class Ext4FileSystem;
+
+    int ensure_extents();
+    int map_extent_node(const uint8_t* node, size_t bytes, unsigned depth);
+    int map_indirect(uint64_t block, unsigned level, uint32_t* file_block, uint32_t end);
+    bool add_extent(uint32_t file_block, uint64_t disk_block, uint32_t count);
+    const Ext4Extent* find_extent(uint32_t file_block);
+
+    // 在目录中按名字查找，返回inode号，0表示不存在
+    uint32_t lookup_linear(const char* name, size_t len);
+    int      lookup_htree(const char* name, size_t len, uint32_t* ino_out);
+
+    Ext4FileSystem*          fs_;
+    uint32_t                 flags_;
+    uint8_t                  i_block_[60];      // 区段树根/块映射/快速符号链接/内联数据
+    bool                     extents_ready_ = false;
+    kstd::Vector<Ext4Extent> extents_;
+    size_t                   hint_ = 0;         // 上次命中的区段，顺序读时免去二分
+
+    Spinlock                 dir_lock_;         // 保护readdir的块缓存
+    uint8_t*                 dir_buf_ = nullptr;
+    uint64_t                 dir_buf_block_ = ~0ULL;
+
+    Ext4Inode*               hash_next_ = nullptr;
+};
+
+// 块组描述符中驱动用到的部分
+struct Ext4Group {
+    uint64_t inode_table;   // inode表起始块
+    uint32_t used_inodes;   // inode表中已使用(需要读取)的inode数
+    bool     fetched;       // 已经尝试过预取
+    uint8_t* itable;        // 预取到内存中的inode表，nullptr表示逐个从磁盘读
+};
+
+class Ext4FileSystem : public FileSystem {
+public:
+    // 在整块磁盘上查找ext卷: 无分区表的整盘格式化、MBR的Linux分区或GPT的Linux数据分区
+    static Ext4FileSystem* probe(BlockDevice* disk);
+
+    // 挂载dev起始处的ext2/3/4卷，失败或含有不支持的特性时返回nullptr
+    static Ext4FileSystem* mount(BlockDevice* dev);
+
+    Ext4FileSystem() = default;
+
+    Inode* root() override { return root_; }
+    const char* name() const override { return "ext4"; }
+
+    uint32_t block_size() const { return block_size_; }
+    uint32_t group_count() const { return group_count_; }
+
+private:
+    friend class Ext4Inode;
+
+    Ext4Inode* get_inode(uint32_t ino);
+    int        read_raw_inode(uint32_t ino, uint8_t* out);
+    void       prefetch_itables(uint32_t group);
+    bool       grow_table();
+
+    int read_blocks(uint64_t block, uint32_t count, void* buf);
+    // 从磁盘字节偏移处读取，对齐部分直接读入buf，首尾不足一扇区的经中转缓冲
+    int read_bytes(uint64_t disk_off, void* buf, size_t len);
+
+    uint32_t dir_hash(const char* name, size_t len, unsigned version) const;
+
+    BlockDevice* dev_ = nullptr;
+    uint32_t     sector_size_ = 0;
+    uint32_t     block_size_ = 0;
+    uint32_t     block_shift_ = 0;
+    uint32_t     inode_size_ = 0;
+    uint32_t     inodes_per_group_ = 0;
+    uint32_t     inodes_count_ = 0;
+    uint32_t     groups_per_flex_ = 1;
+    uint32_t     group_count_ = 0;
+    Ext4Group*   groups_ = nullptr;
+
+    uint32_t     hash_seed_[4] = {};
+    bool         unsigned_hash_ = false;
+    bool         has_filetype_ = false;
+
+    Spinlock     lock_;                 // 保护中转缓冲
+    Spinlock     build_lock_;           // 保护区段表的延迟构建
+    Spinlock     cache_lock_;           // 保护inode缓存和inode表预取
+    uint8_t*     bounce_ = nullptr;     // 一个扇区的中转缓冲
+
+    // inode号 -> 已创建的Ext4Inode
+    Ext4Inode**  table_ = nullptr;
+    uint32_t     table_mask_ = 0;
+    uint32_t     cached_count_ = 0;
+
+    Ext4Inode*   root_ = nullptr;
+};
+
+} // namespace fs
+
+#endif // __LEAFOS_EXT4_H__
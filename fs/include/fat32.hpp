@@ -0,0 +1,111 @@
+/**
+ * leafOS - FAT32文件系统驱动 (只读)
+ *
+ * - 挂载时把整张FAT读入内存，之后查簇链不再访问磁盘
+ * - 每个文件第一次访问时把簇链合并成按文件簇号排序的区段表(extent)，
+ *   定位任意偏移只需二分查找，连续簇合并成一次多扇区读
+ * - 目录第一次查找时整体解析(含长文件名)，建立哈希索引
+ */
+
+#pragma once
+#ifndef __LEAFOS_FAT32_H__
+#define __LEAFOS_FAT32_H__
+
+#include <vfs.hpp>
+#include <block.hpp>
+#include <kvector.hpp>
+#include <spinlock.hpp>
+
+namespace fs {
+
+class Fat32FileSystem;
+struct FatDirCache;
+
+// 文件中一段物理连续的簇
+struct FatExtent {
+    uint32_t file_cluster;  // 区段在文件内的起始簇号
+    uint32_t disk_cluster;  // 对应的磁盘簇号
+    uint32_t count;         // 连续簇数
+};
+
+class FatInode : public Inode {
+public:
+    FatInode(Fat32FileSystem* fs, uint32_t first_cluster, uint32_t size, bool dir);
+
+    int64_t read(uint64_t off, void* buf, size_t len) override;
+    Inode*  lookup(const char* name, size_t len) override;
+    int     readdir(uint64_t* cookie, DirEntry* out) override;
+
+    uint32_t first_cluster() const { return first_cluster_; }
+
+private:
+    int ensure_extents();
+    int ensure_dir_cache();
+    const FatExtent* find_extent(uint32_t file_cluster);
+
+    Fat32FileSystem*         fs_;
+    uint32_t                 first_cluster_;
+    bool                     extents_ready_ = false;
+    kstd::Vector<FatExtent>  extents_;
+    size_t                   hint_ = 0;     // 上次命中的区段，顺序读时免去二分
+    FatDirCache*             dir_ = nullptr;
+};
+
+class Fat32FileSystem : public FileSystem {
+public:
+    // 在整块磁盘上查找FAT32卷: 无分区表的整盘格式化、MBR或GPT的ESP/数据分区
+    static Fat32FileSystem* probe(BlockDevice* disk);
+
+    // 挂载dev起始处的FAT32卷，失败返回nullptr
+    static Fat32FileSystem* mount(BlockDevice* dev);
+
+    Fat32FileSystem() = default;
+
+    Inode* root() override { return root_; }
+    const char* name() const override { return "fat32"; }
+
+    uint32_t cluster_bytes() const { return cluster_bytes_; }
+    uint32_t cluster_count() const { return cluster_count_; }
+
+private:
+    friend class FatInode;
+
+    int  load_fat(uint64_t fat_lba);
+    void destroy();
+
+    uint32_t next_cluster(uint32_t cluster) const;
+    bool     valid_cluster(uint32_t cluster) const
+    {
+        return cluster >= 2 && cluster < cluster_count_ + 2;
+    }
+    uint64_t cluster_lba(uint32_t cluster) const
+    {
+        return data_lba_ + (uint64_t)(cluster - 2) * sectors_per_cluster_;
+    }
+
+    // 从磁盘字节偏移处读取，对齐部分直接读入buf，首尾不足一扇区的经中转缓冲
+    int read_bytes(uint64_t disk_off, void* buf, size_t len);
+
+    uint64_t next_ino() { return ++ino_counter_; }
+
+    BlockDevice* dev_ = nullptr;
+    uint32_t     sector_size_ = 0;
+    uint32_t     sectors_per_cluster_ = 0;
+    uint32_t     cluster_bytes_ = 0;
+    uint32_t     cluster_count_ = 0;
+    uint64_t     data_lba_ = 0;
+
+    // FAT缓存按4 MiB块分配，避免需要一整段连续物理内存
+    uint32_t**   fat_chunks_ = nullptr;
+    uint32_t     fat_chunk_count_ = 0;
+
+    Spinlock     lock_;                 // 保护中转缓冲
+    Spinlock     build_lock_;           // 保护区段表/目录缓存的延迟构建
+    uint8_t*     bounce_ = nullptr;     // 一个扇区的中转缓冲
+    FatInode*    root_ = nullptr;
+    uint64_t     ino_counter_ = 0;
+};
+
+} // namespace fs
+
+#endif // __LEAFOS_FAT32_H__
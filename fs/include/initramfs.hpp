@@ -0,0 +1,76 @@
+/**
+ * leafOS - 内存映射的initramfs (cpio newc / ustar)
+ *
+ * 启动阶段把initrd整体读入EfiLoaderData页，挂载时只遍历一次归档建立索引。
+ * 文件名和文件内容都直接指向归档内存，不做任何拷贝；
+ * 数据按页对齐的文件(tools/mkinitrd.py生成的归档)可以把归档页直接映射进地址空间。
+ */
+
+#pragma once
+#ifndef __LEAFOS_INITRAMFS_H__
+#define __LEAFOS_INITRAMFS_H__
+
+#include <vfs.hpp>
+
+namespace fs {
+
+class InitramFileSystem;
+
+class InitrdInode : public Inode {
+public:
+    int64_t     read(uint64_t off, void* buf, size_t len) override;
+    Inode*      lookup(const char* name, size_t len) override;
+    int         readdir(uint64_t* cookie, DirEntry* out) override;
+    const void* direct(uint64_t off, size_t len) override;
+    uint64_t    map_page(uint64_t pgoff, bool write, unsigned* order) override;
+
+private:
+    friend class InitramFileSystem;
+
+    InitramFileSystem* fs_ = nullptr;
+    const char*        name_ = nullptr;     // 指向归档内的路径分量，不以0结尾
+    uint16_t           name_len_ = 0;
+    const uint8_t*     data_ = nullptr;     // 指向归档内的文件内容
+    InitrdInode*       parent_ = nullptr;
+    InitrdInode*       first_child_ = nullptr;
+    InitrdInode*       next_sibling_ = nullptr;
+    InitrdInode*       hash_next_ = nullptr;
+    InitrdInode*       all_next_ = nullptr;
+};
+
+class InitramFileSystem : public FileSystem {
+public:
+    // 索引位于 [base, base+size) 的归档，自动识别cpio newc和ustar格式
+    static InitramFileSystem* mount(const void* base, uint64_t size);
+
+    Inode* root() override { return &root_; }
+    const char* name() const override { return "initramfs"; }
+
+    uint64_t file_count() const { return count_; }
+
+private:
+    friend class InitrdInode;
+
+    bool index_cpio();
+    bool index_tar();
+
+    // 按完整路径插入一个节点，缺失的中间目录隐式创建
+    InitrdInode* insert_path(const char* path, size_t len, NodeType type);
+    InitrdInode* find_child(const InitrdInode* dir, const char* name, size_t len);
+    InitrdInode* add_child(InitrdInode* dir, const char* name, size_t len, NodeType type);
+    bool grow_table();
+
+    const uint8_t* base_ = nullptr;
+    uint64_t       size_ = 0;
+    InitrdInode    root_;
+    InitrdInode*   all_ = nullptr;
+
+    // (父目录, 名字) -> 节点 的哈希表，所有目录共用
+    InitrdInode**  table_ = nullptr;
+    uint32_t       table_mask_ = 0;
+    uint64_t       count_ = 0;
+};
+
+} // namespace fs
+
+#endif // __LEAFOS_INITRAMFS_H__
@@ -0,0 +1,96 @@
+/**
+ * leafOS - tmpfs 内存文件系统
+ *
+ * 文件内容是一棵以页号为键的稀疏基数树(每个节点一页，512个槽)，
+ * 数据页直接取自页分配器，未写过的空洞读出为0且不占内存。
+ * 大文件按2 MiB对齐的区间整块分配大页，挂在基数树倒数第二层，
+ * 映射进地址空间时可以用一条大页表项覆盖。
+ */
+
+#pragma once
+#ifndef __LEAFOS_TMPFS_H__
+#define __LEAFOS_TMPFS_H__
+
+#include <vfs.hpp>
+#include <spinlock.hpp>
+
+namespace fs {
+
+class TmpFileSystem;
+
+class TmpInode : public Inode {
+public:
+    int64_t  read(uint64_t off, void* buf, size_t len) override;
+    int64_t  write(uint64_t off, const void* buf, size_t len) override;
+    Inode*   lookup(const char* name, size_t len) override;
+    int      readdir(uint64_t* cookie, DirEntry* out) override;
+    int      create(const char* name, size_t len, NodeType type, Inode** out) override;
+    int      unlink(const char* name, size_t len) override;
+    int      truncate(uint64_t size) override;
+    uint64_t map_page(uint64_t pgoff, bool write, unsigned* order) override;
+    void     mmap_ref(int delta) override;
+
+private:
+    friend class TmpFileSystem;
+
+    // 取得第idx页的地址；create为真时填补空洞，huge_ok为真时优先整块分配大页
+    uint8_t* get_page(uint64_t idx, bool create, bool huge_ok, unsigned* order);
+    void     free_pages_from(uint64_t first_idx);
+    void     destroy();
+
+    TmpFileSystem* fs_ = nullptr;
+    Spinlock       lock_;
+
+    // 文件内容: 基数树，高度h时覆盖 512^h 页
+    void**         radix_ = nullptr;
+    unsigned       height_ = 0;
+
+    // 目录结构
+    char*          name_ = nullptr;
+    uint16_t       name_len_ = 0;
+    TmpInode*      parent_ = nullptr;
+    TmpInode*      first_child_ = nullptr;
+    TmpInode*      next_sibling_ = nullptr;
+    TmpInode*      prev_sibling_ = nullptr;
+    TmpInode*      hash_next_ = nullptr;
+
+    int            map_refs_ = 0;       // 被映射的次数
+    bool           orphan_ = false;     // 已删除但仍被映射，最后一次解除映射时释放
+};
+
+class TmpFileSystem : public FileSystem {
+public:
+    // max_pages为0表示不限制容量；文件大小达到huge_threshold字节后使用大页
+    static TmpFileSystem* create(uint64_t max_pages, uint64_t huge_threshold);
+
+    Inode* root() override { return &root_; }
+    const char* name() const override { return "tmpfs"; }
+
+    uint64_t used_pages() const { return __atomic_load_n(&used_pages_, __ATOMIC_RELAXED); }
+
+private:
+    friend class TmpInode;
+
+    void* alloc_data(unsigned order);
+    void  free_data(void* p, unsigned order);
+
+    TmpInode* find_child(const TmpInode* dir, const char* name, size_t len);
+    void      hash_insert(TmpInode* node);
+    void      hash_remove(TmpInode* node);
+    bool      grow_table();
+
+    TmpInode   root_;
+    Spinlock   ns_lock_;                // 保护目录结构和哈希表
+    TmpInode** table_ = nullptr;
+    uint32_t   table_mask_ = 0;
+    uint64_t   node_count_ = 0;
+    uint64_t   next_ino_ = 1;
+
+    uint64_t   max_pages_ = 0;
+    uint64_t   used_pages_ = 0;
+    uint64_t   huge_threshold_ = 0;
+};
+
+} // namespace fs
+
+#endif // __LEAFOS_TMPFS_H__
@@ -0,0 +1,98 @@
+/**
+ * leafOS - 虚拟文件系统层
+ * 各文件系统驱动实现 FileSystem/Inode 接口，通过挂载表按路径访问
+ *
+ * Inode由所属文件系统管理生命周期，VFS只持有指针，不负责释放
+ */
+
+#pragma once
+#ifndef __LEAFOS_VFS_H__
+#define __LEAFOS_VFS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kerrno.hpp>
+
+namespace mm {
+class AddressSpace;
+}
+
+namespace fs {
+
+constexpr size_t NAME_MAX = 255;
+
+enum class NodeType : uint8_t {
+    File,
+    Directory,
+    Symlink,
+    Other,
+};
+
+struct DirEntry {
+    char     name[NAME_MAX + 1];
+    NodeType type;
+    uint64_t ino;
+};
+
+class Inode {
+public:
+    uint64_t ino  = 0;
+    uint64_t size = 0;
+    NodeType type = NodeType::File;
+    uint32_t mode = 0;
+
+    // 读写文件内容，返回实际传输的字节数或负错误码
+    virtual int64_t read(uint64_t off, void* buf, size_t len) = 0;
+    virtual int64_t write(uint64_t, const void*, size_t) { return -EROFS; }
+
+    // 在目录中查找名字(不要求以0结尾)，不存在时返回nullptr
+    virtual Inode* lookup(const char*, size_t) { return nullptr; }
+
+    // 逐项读取目录；cookie从0开始，返回1表示取到一项，0表示结束
+    virtual int readdir(uint64_t*, DirEntry*) { return -ENOTDIR; }
+
+    // 在目录中创建文件或子目录，成功时通过out返回新节点
+    virtual int create(const char*, size_t, NodeType, Inode** out) { *out = nullptr; return -EROFS; }
+    virtual int unlink(const char*, size_t) { return -EROFS; }
+    virtual int truncate(uint64_t) { return -EROFS; }
+
+    // 内容常驻内存的文件可以不经拷贝直接访问:
+    // direct() 返回 [off, off+len) 所在的连续内存，不支持时返回nullptr；
+    // map_page() 返回文件第pgoff页所在的物理页，可直接映射进地址空间，不支持时返回0。
+    // order返回该页所在物理连续块的大小(2^order页)，用于决定能否使用大页映射
+    virtual const void* direct(uint64_t, size_t) { return nullptr; }
+    virtual uint64_t    map_page(uint64_t, bool, unsigned*) { return 0; }
+
+    // 文件被映射/解除映射时调用，映射期间文件内容不能被释放
+    virtual void mmap_ref(int) {}
+
+    bool is_dir() const { return type == NodeType::Directory; }
+
+protected:
+    ~Inode() = default;
+};
+
+class FileSystem {
+public:
+    virtual Inode* root() = 0;
+    virtual const char* name() const = 0;
+
+protected:
+    ~FileSystem() = default;
+};
+
+// 把文件系统挂载到绝对路径 (例如 "/" 或 "/boot")
+int mount(const char* path, FileSystem* fs);
+
+// 解析绝对路径，找不到时返回nullptr
+Inode* resolve(const char* path);
+
+// 把文件从off起len字节直接映射到地址空间的va处(均需页对齐)，不拷贝文件内容；
+// 文件由物理连续的2 MiB块支撑且va对齐时使用大页映射
+int mmap_file(mm::AddressSpace* as, uint64_t va, Inode* node, uint64_t off, uint64_t len,
+              uint32_t flags);
+int munmap_file(mm::AddressSpace* as, uint64_t va, uint64_t len, Inode* node);
+
+} // namespace fs
+
+#endif // __LEAFOS_VFS_H__
@@ -0,0 +1,415 @@
+/**
+ * leafOS - 内存映射的initramfs实现
+ */
+
+#include <initramfs.hpp>
+#include <page_alloc.hpp>
+#include <kheap.hpp>
+#include <kstring.hpp>
+
+namespace fs {
+
+namespace {
+
+constexpr size_t CPIO_HEADER_SIZE = 110;
+constexpr size_t TAR_BLOCK = 512;
+
+// cpio newc头部中 8 位十六进制字段
+uint32_t parse_hex8(const uint8_t* p, bool* ok)
+{
+    uint32_t v = 0;
+    for (int i = 0; i < 8; i++) {
+        uint8_t c = p[i];
+        v <<= 4;
+        if (c >= '0' && c <= '9') {
+            v |= c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            v |= c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            v |= c - 'A' + 10;
+        } else {
+            *ok = false;
+        }
+    }
+    return v;
+}
+
+// tar头部中的八进制数字段 (以空格或0结尾)
+uint64_t parse_octal(const uint8_t* p, size_t len)
+{
+    uint64_t v = 0;
+    for (size_t i = 0; i < len && p[i] >= '0' && p[i] <= '7'; i++) {
+        v = (v << 3) | (p[i] - '0');
+    }
+    return v;
+}
+
+size_t bounded_len(const uint8_t* s, size_t max)
+{
+    size_t n = 0;
+    while (n < max && s[n]) {
+        n++;
+    }
+    return n;
+}
+
+inline uint64_t align_up(uint64_t v, uint64_t a)
+{
+    return (v + a - 1) & ~(a - 1);
+}
+
+uint32_t node_hash(const void* parent, const char* name, size_t len)
+{
+    uint32_t h = 2166136261u ^ (uint32_t)((uintptr_t)parent >> 4);
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)name[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+NodeType mode_to_type(uint32_t mode)
+{
+    switch (mode & 0170000) {
+    case 0040000: return NodeType::Directory;
+    case 0100000: return NodeType::File;
+    case 0120000: return NodeType::Symlink;
+    default:      return NodeType::Other;
+    }
+}
+
+} // namespace
+
+// ============================================
+// 索引
+// ============================================
+
+bool InitramFileSystem::grow_table()
+{
+    uint32_t count = table_ ? (table_mask_ + 1) * 2 : 64;
+    InitrdInode** table = static_cast<InitrdInode**>(kzalloc(count * sizeof(InitrdInode*)));
+    if (!table) {
+        return false;
+    }
+
+    kfree(table_);
+    table_ = table;
+    table_mask_ = count - 1;
+    for (InitrdInode* n = all_; n; n = n->all_next_) {
+        uint32_t b = node_hash(n->parent_, n->name_, n->name_len_) & table_mask_;
+        n->hash_next_ = table_[b];
+        table_[b] = n;
+    }
+    return true;
+}
+
+InitrdInode* InitramFileSystem::find_child(const InitrdInode* dir, const char* name, size_t len)
+{
+    if (!table_) {
+        return nullptr;
+    }
+    uint32_t b = node_hash(dir, name, len) & table_mask_;
+    for (InitrdInode* n = table_[b]; n; n = n->hash_next_) {
+        if (n->parent_ == dir && n->name_len_ == len && memcmp(n->name_, name, len) == 0) {
+            return n;
+        }
+    }
+    return nullptr;
+}
+
+InitrdInode* InitramFileSystem::add_child(InitrdInode* dir, const char* name, size_t len,
+                                          NodeType type)
+{
+    if (len > NAME_MAX) {
+        return nullptr;
+    }
+    if ((!table_ || count_ >= table_mask_) && !grow_table()) {
+        return nullptr;
+    }
+
+    InitrdInode* n = knew<InitrdInode>();
+    if (!n) {
+        return nullptr;
+    }
+    n->fs_ = this;
+    n->ino = ++count_;
+    n->type = type;
+    n->mode = type == NodeType::Directory ? 0555 : 0444;
+    n->name_ = name;
+    n->name_len_ = (uint16_t)len;
+    n->parent_ = dir;
+    n->next_sibling_ = dir->first_child_;
+    dir->first_child_ = n;
+    n->all_next_ = all_;
+    all_ = n;
+
+    uint32_t b = node_hash(dir, name, len) & table_mask_;
+    n->hash_next_ = table_[b];
+    table_[b] = n;
+    return n;
+}
+
+InitrdInode* InitramFileSystem::insert_path(const char* path, size_t len, NodeType type)
+{
+    InitrdInode* dir = &root_;
+    size_t pos = 0;
+
+    for (;;) {
+        while (pos < len && path[pos] == '/') {
+            pos++;
+        }
+        size_t start = pos;
+        while (pos < len && path[pos] != '/') {
+            pos++;
+        }
+        size_t n = pos - start;
+        if (n == 0) {
+            return dir;     // "./" 或 "/" 本身
+        }
+
+        // 剩下的全是'/'说明这是最后一个分量
+        size_t rest = pos;
+        while (rest < len && path[rest] == '/') {
+            rest++;
+        }
+        bool last = rest == len;
+
+        const char* name = path + start;
+        if (n == 1 && name[0] == '.') {
+            if (last) {
+                return dir;
+            }
+            continue;
+        }
+
+        InitrdInode* child = find_child(dir, name, n);
+        if (!child) {
+            child = add_child(dir, name, n, last ? type : NodeType::Directory);
+            if (!child) {
+                return nullptr;
+            }
+        } else if (last) {
+            child->type = type;     // 隐式创建的目录稍后在归档中出现
+        }
+        if (last) {
+            return child;
+        }
+        dir = child;
+    }
+}
+
+bool InitramFileSystem::index_cpio()
+{
+    uint64_t off = 0;
+
+    while (off + CPIO_HEADER_SIZE <= size_) {
+        const uint8_t* h = base_ + off;
+        if (memcmp(h, "070701", 6) != 0 && memcmp(h, "070702", 6) != 0) {
+            return false;
+        }
+
+        bool ok = true;
+        uint32_t mode     = parse_hex8(h + 14, &ok);
+        uint32_t filesize = parse_hex8(h + 54, &ok);
+        uint32_t namesize = parse_hex8(h + 94, &ok);
+        if (!ok || namesize == 0) {
+            return false;
+        }
+
+        uint64_t name_off = off + CPIO_HEADER_SIZE;
+        uint64_t data_off = align_up(name_off + namesize, 4);
+        if (data_off + filesize > size_) {
+            return false;
+        }
+
+        // namesize包含结尾的0；名字后面可能用额外的0填充以对齐数据
+        const char* name = reinterpret_cast<const char*>(base_ + name_off);
+        size_t name_len = bounded_len(base_ + name_off, namesize);
+        if (name_len == 10 && memcmp(name, "TRAILER!!!", 10) == 0) {
+            return true;
+        }
+
+        NodeType type = mode_to_type(mode);
+        InitrdInode* n = insert_path(name, name_len, type);
+        if (!n) {
+            return false;
+        }
+        if (n != &root_) {
+            n->mode = mode & 07777;
+            if (type != NodeType::Directory) {
+                n->data_ = base_ + data_off;
+                n->size = filesize;
+            }
+        }
+
+        off = align_up(data_off + filesize, 4);
+    }
+    return true;
+}
+
+bool InitramFileSystem::index_tar()
+{
+    uint64_t off = 0;
+    const uint8_t* long_name = nullptr;    // GNU 'L' 扩展头给出的长文件名
+    size_t long_len = 0;
+
+    while (off + TAR_BLOCK <= size_) {
+        const uint8_t* h = base_ + off;
+        if (h[0] == 0) {
+            return true;    // 全零块表示归档结束
+        }
+        if (memcmp(h + 257, "ustar", 5) != 0) {
+            return false;
+        }
+
+        uint64_t filesize = parse_octal(h + 124, 12);
+        uint32_t mode = (uint32_t)parse_octal(h + 100, 8);
+        uint8_t  flag = h[156];
+        uint64_t data_off = off + TAR_BLOCK;
+        if (data_off + filesize > size_) {
+            return false;
+        }
+        off = data_off + align_up(filesize, TAR_BLOCK);
+
+        if (flag == 'L') {
+            long_name = base_ + data_off;
+            long_len = bounded_len(long_name, filesize);
+            continue;
+        }
+
+        NodeType type;
+        switch (flag) {
+        case '0': case '\0': case '7': type = NodeType::File; break;
+        case '5':                      type = NodeType::Directory; break;
+        case '2':                      type = NodeType::Symlink; break;
+        default:                       type = NodeType::Other; break;
+        }
+
+        InitrdInode* n;
+        if (long_name) {
+            n = insert_path(reinterpret_cast<const char*>(long_name), long_len, type);
+            long_name = nullptr;
+        } else if (h[345]) {
+            // 带prefix的ustar名字不连续，只能拼接后再插入；
+            // 分量名仍需指向常驻内存，所以拼接结果留在堆上
+            size_t plen = bounded_len(h + 345, 155);
+            size_t nlen = bounded_len(h, 100);
+            char* full = static_cast<char*>(kmalloc(plen + 1 + nlen));
+            if (!full) {
+                return false;
+            }
+            memcpy(full, h + 345, plen);
+            full[plen] = '/';
+            memcpy(full + plen + 1, h, nlen);
+            n = insert_path(full, plen + 1 + nlen, type);
+        } else {
+            n = insert_path(reinterpret_cast<const char*>(h), bounded_len(h, 100), type);
+        }
+        if (!n) {
+            return false;
+        }
+
+        if (n != &root_) {
+            n->mode = mode & 07777;
+            if (type == NodeType::Symlink) {
+                n->data_ = h + 157;
+                n->size = bounded_len(h + 157, 100);
+            } else if (type != NodeType::Directory) {
+                n->data_ = base_ + data_off;
+                n->size = filesize;
+            }
+        }
+    }
+    return true;
+}
+
+InitramFileSystem* InitramFileSystem::mount(const void* base, uint64_t size)
+{
+    if (!base || size < CPIO_HEADER_SIZE) {
+        return nullptr;
+    }
+
+    InitramFileSystem* fs = knew<InitramFileSystem>();
+    if (!fs) {
+        return nullptr;
+    }
+    fs->base_ = static_cast<const uint8_t*>(base);
+    fs->size_ = size;
+    fs->root_.fs_ = fs;
+    fs->root_.type = NodeType::Directory;
+    fs->root_.mode = 0555;
+
+    bool ok = memcmp(base, "0707", 4) == 0 ? fs->index_cpio() : fs->index_tar();
+    return ok ? fs : nullptr;
+}
+
+// ============================================
+// InitrdInode
+// ============================================
+
+int64_t InitrdInode::read(uint64_t off, void* buf, size_t len)
+{
+    if (is_dir()) {
+        return -EISDIR;
+    }
+    if (off >= size) {
+        return 0;
+    }
+    if (len > size - off) {
+        len = size - off;
+    }
+    memcpy(buf, data_ + off, len);
+    return (int64_t)len;
+}
+
+Inode* InitrdInode::lookup(const char* name, size_t len)
+{
+    if (len == 2 && name[0] == '.' && name[1] == '.') {
+        return parent_ ? parent_ : this;
+    }
+    return fs_->find_child(this, name, len);
+}
+
+int InitrdInode::readdir(uint64_t* cookie, DirEntry* out)
+{
+    if (!is_dir()) {
+        return -ENOTDIR;
+    }
+
+    // cookie直接保存下一个节点的地址，~0表示结束
+    InitrdInode* n = *cookie == 0 ? first_child_ : reinterpret_cast<InitrdInode*>(*cookie);
+    if (*cookie == ~0ULL || !n) {
+        return 0;
+    }
+
+    memcpy(out->name, n->name_, n->name_len_);
+    out->name[n->name_len_] = '\0';
+    out->type = n->type;
+    out->ino = n->ino;
+    *cookie = n->next_sibling_ ? reinterpret_cast<uintptr_t>(n->next_sibling_) : ~0ULL;
+    return 1;
+}
+
+const void* InitrdInode::direct(uint64_t off, size_t len)
+{
+    if (is_dir() || off > size || len > size - off) {
+        return nullptr;
+    }
+    return data_ + off;
+}
+
+uint64_t InitrdInode::map_page(uint64_t pgoff, bool write, unsigned* order)
+{
+    // 只有落在页边界上的完整页才能直接映射：
+    // 末尾不足一页的部分后面紧跟着归档里的其他内容，必须由调用者拷贝并补零。
+    // 归档是只读的，不允许可写映射
+    uint64_t off = pgoff << mm::PAGE_SHIFT;
+    if (write || is_dir() || ((uintptr_t)data_ & (mm::PAGE_SIZE - 1)) ||
+        off + mm::PAGE_SIZE > size) {
+        return 0;
+    }
+    *order = 0;
+    return reinterpret_cast<uintptr_t>(data_ + off);
+}
+
+} // namespace fs
@@ -0,0 +1,571 @@
+/**
+ * leafOS - tmpfs 内存文件系统实现
+ */
+
+#include <tmpfs.hpp>
+#include <vmm.hpp>
+#include <initcall.hpp>
+#include <page_alloc.hpp>
+#include <kheap.hpp>
+#include <kstring.hpp>
+
+namespace fs {
+
+namespace {
+
+constexpr unsigned RADIX_SHIFT = 9;
+constexpr uint64_t RADIX_SLOTS = 1ULL << RADIX_SHIFT;
+constexpr uint64_t RADIX_MASK  = RADIX_SLOTS - 1;
+constexpr unsigned MAX_HEIGHT  = 6;     // 512^6页，远超任何物理内存
+
+// 倒数第二层的槽位最低位置1表示这里是一整个2 MiB大页，而不是下一级节点
+constexpr uintptr_t HUGE_TAG = 1;
+
+inline bool is_huge(void* e)
+{
+    return reinterpret_cast<uintptr_t>(e) & HUGE_TAG;
+}
+
+inline uint8_t* untag(void* e)
+{
+    return reinterpret_cast<uint8_t*>(reinterpret_cast<uintptr_t>(e) & ~HUGE_TAG);
+}
+
+inline void* tag_huge(void* p)
+{
+    return reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(p) | HUGE_TAG);
+}
+
+// 高度h的树能容纳的页数
+inline uint64_t capacity(unsigned height)
+{
+    return height >= MAX_HEIGHT ? ~0ULL : 1ULL << (RADIX_SHIFT * height);
+}
+
+uint32_t node_hash(const void* parent, const char* name, size_t len)
+{
+    uint32_t h = 2166136261u ^ (uint32_t)((uintptr_t)parent >> 4);
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)name[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+} // namespace
+
+// ============================================
+// TmpFileSystem
+// ============================================
+
+TmpFileSystem* TmpFileSystem::create(uint64_t max_pages, uint64_t huge_threshold)
+{
+    TmpFileSystem* fs = knew<TmpFileSystem>();
+    if (!fs) {
+        return nullptr;
+    }
+    fs->max_pages_ = max_pages;
+    fs->huge_threshold_ = huge_threshold;
+    fs->root_.fs_ = fs;
+    fs->root_.ino = fs->next_ino_++;
+    fs->root_.type = NodeType::Directory;
+    fs->root_.mode = 0777;
+    return fs;
+}
+
+void* TmpFileSystem::alloc_data(unsigned order)
+{
+    uint64_t pages = 1ULL << order;
+    uint64_t used = __atomic_add_fetch(&used_pages_, pages, __ATOMIC_RELAXED);
+    if (max_pages_ && used > max_pages_) {
+        __atomic_sub_fetch(&used_pages_, pages, __ATOMIC_RELAXED);
+        return nullptr;
+    }
+
+    void* p = mm::alloc_pages_zeroed(order);
+    if (!p) {
+        __atomic_sub_fetch(&used_pages_, pages, __ATOMIC_RELAXED);
+    }
+    return p;
+}
+
+void TmpFileSystem::free_data(void* p, unsigned order)
+{
+    mm::free_pages(p, order);
+    __atomic_sub_fetch(&used_pages_, 1ULL << order, __ATOMIC_RELAXED);
+}
+
+bool TmpFileSystem::grow_table()
+{
+    uint32_t count = table_ ? (table_mask_ + 1) * 2 : 64;
+    TmpInode** table = static_cast<TmpInode**>(kzalloc(count * sizeof(TmpInode*)));
+    if (!table) {
+        return false;
+    }
+
+    // 旧表中的节点逐个迁移到新表
+    if (table_) {
+        for (uint32_t b = 0; b <= table_mask_; b++) {
+            TmpInode* n = table_[b];
+            while (n) {
+                TmpInode* next = n->hash_next_;
+                uint32_t nb = node_hash(n->parent_, n->name_, n->name_len_) & (count - 1);
+                n->hash_next_ = table[nb];
+                table[nb] = n;
+                n = next;
+            }
+        }
+        kfree(table_);
+    }
+    table_ = table;
+    table_mask_ = count - 1;
+    return true;
+}
+
+TmpInode* TmpFileSystem::find_child(const TmpInode* dir, const char* name, size_t len)
+{
+    if (!table_) {
+        return nullptr;
+    }
+    uint32_t b = node_hash(dir, name, len) & table_mask_;
+    for (TmpInode* n = table_[b]; n; n = n->hash_next_) {
+        if (n->parent_ == dir && n->name_len_ == len && memcmp(n->name_, name, len) == 0) {
+            return n;
+        }
+    }
+    return nullptr;
+}
+
+void TmpFileSystem::hash_insert(TmpInode* node)
+{
+    uint32_t b = node_hash(node->parent_, node->name_, node->name_len_) & table_mask_;
+    node->hash_next_ = table_[b];
+    table_[b] = node;
+    node_count_++;
+}
+
+void TmpFileSystem::hash_remove(TmpInode* node)
+{
+    uint32_t b = node_hash(node->parent_, node->name_, node->name_len_) & table_mask_;
+    for (TmpInode** p = &table_[b]; *p; p = &(*p)->hash_next_) {
+        if (*p == node) {
+            *p = node->hash_next_;
+            node_count_--;
+            return;
+        }
+    }
+}
+
+// ============================================
+// 文件内容
+// ============================================
+
+uint8_t* TmpInode::get_page(uint64_t idx, bool create, bool huge_ok, unsigned* order)
+{
+    // 大页挂在倒数第二层，树至少要两层
+    unsigned need = huge_ok ? 2 : 1;
+    while (capacity(need) <= idx) {
+        need++;
+    }
+
+    if (height_ < need) {
+        if (!create) {
+            if (!radix_ || capacity(height_) <= idx) {
+                return nullptr;
+            }
+        } else if (!radix_) {
+            radix_ = static_cast<void**>(fs_->alloc_data(0));
+            if (!radix_) {
+                return nullptr;
+            }
+            height_ = need;
+        } else {
+            // 树长高: 新根的第0槽指向旧根
+            while (height_ < need) {
+                void** root = static_cast<void**>(fs_->alloc_data(0));
+                if (!root) {
+                    return nullptr;
+                }
+                root[0] = radix_;
+                radix_ = root;
+                height_++;
+            }
+        }
+    }
+
+    void** node = radix_;
+    for (unsigned level = height_ - 1; level >= 1; level--) {
+        uint64_t slot = (idx >> (RADIX_SHIFT * level)) & RADIX_MASK;
+        void* e = node[slot];
+
+        if (level == 1 && e && is_huge(e)) {
+            *order = mm::HUGE_PAGE_ORDER;
+            return untag(e) + ((idx & RADIX_MASK) << mm::PAGE_SHIFT);
+        }
+        if (!e) {
+            if (!create) {
+                return nullptr;
+            }
+            if (level == 1 && huge_ok) {
+                void* huge = fs_->alloc_data(mm::HUGE_PAGE_ORDER);
+                if (huge) {
+                    node[slot] = tag_huge(huge);
+                    *order = mm::HUGE_PAGE_ORDER;
+                    return static_cast<uint8_t*>(huge) + ((idx & RADIX_MASK) << mm::PAGE_SHIFT);
+                }
+                // 没有连续的2 MiB，退回4K页
+            }
+            e = fs_->alloc_data(0);
+            if (!e) {
+                return nullptr;
+            }
+            node[slot] = e;
+        }
+        node = static_cast<void**>(e);
+    }
+
+    void*& leaf = node[idx & RADIX_MASK];
+    if (!leaf) {
+        if (!create) {
+            return nullptr;
+        }
+        leaf = fs_->alloc_data(0);
+        if (!leaf) {
+            return nullptr;
+        }
+    }
+    *order = 0;
+    return static_cast<uint8_t*>(leaf);
+}
+
+namespace {
+
+// 释放节点(覆盖从base开始的页)中页号 >= first 的所有数据页，level为节点所在层
+void free_subtree(TmpFileSystem* fs, void** node, unsigned level, uint64_t base, uint64_t first,
+                  void (TmpFileSystem::*free_fn)(void*, unsigned))
+{
+    uint64_t span = 1ULL << (RADIX_SHIFT * level);
+
+    for (uint64_t slot = 0; slot < RADIX_SLOTS; slot++) {
+        uint64_t child_base = base + slot * span;
+        void* e = node[slot];
+        if (!e || child_base + span <= first) {
+            continue;
+        }
+
+        if (level == 0) {
+            (fs->*free_fn)(e, 0);
+            node[slot] = nullptr;
+            continue;
+        }
+        if (level == 1 && is_huge(e)) {
+            if (child_base >= first) {
+                (fs->*free_fn)(untag(e), mm::HUGE_PAGE_ORDER);
+                node[slot] = nullptr;
+            } else {
+                // 大页只被截掉一部分: 保留大页，把截掉的部分清零
+                uint64_t keep = first - child_base;
+                memset(untag(e) + (keep << mm::PAGE_SHIFT), 0,
+                       (span - keep) << mm::PAGE_SHIFT);
+            }
+            continue;
+        }
+
+        free_subtree(fs, static_cast<void**>(e), level - 1, child_base, first, free_fn);
+        if (child_base >= first) {
+            (fs->*free_fn)(e, 0);
+            node[slot] = nullptr;
+        }
+    }
+}
+
+} // namespace
+
+void TmpInode::free_pages_from(uint64_t first_idx)
+{
+    if (!radix_) {
+        return;
+    }
+    free_subtree(fs_, radix_, height_ - 1, 0, first_idx, &TmpFileSystem::free_data);
+    if (first_idx == 0) {
+        fs_->free_data(radix_, 0);
+        radix_ = nullptr;
+        height_ = 0;
+    }
+}
+
+int64_t TmpInode::read(uint64_t off, void* buf, size_t len)
+{
+    if (is_dir()) {
+        return -EISDIR;
+    }
+
+    SpinGuard guard(lock_);
+    if (off >= size) {
+        return 0;
+    }
+    if (len > size - off) {
+        len = size - off;
+    }
+
+    uint8_t* out = static_cast<uint8_t*>(buf);
+    size_t done = 0;
+    while (done < len) {
+        uint64_t pos = off + done;
+        size_t in = pos & (mm::PAGE_SIZE - 1);
+        size_t n = mm::PAGE_SIZE - in < len - done ? mm::PAGE_SIZE - in : len - done;
+
+        unsigned order;
+        uint8_t* page = get_page(pos >> mm::PAGE_SHIFT, false, false, &order);
+        if (page) {
+            memcpy(out + done, page + in, n);
+        } else {
+            memset(out + done, 0, n);   // 空洞
+        }
+        done += n;
+    }
+    return (int64_t)done;
+}
+
+int64_t TmpInode::write(uint64_t off, const void* buf, size_t len)
+{
+    if (is_dir()) {
+        return -EISDIR;
+    }
+
+    SpinGuard guard(lock_);
+    uint64_t end = off + len;
+    bool huge_ok = fs_->huge_threshold_ && (end > size ? end : size) >= fs_->huge_threshold_;
+
+    const uint8_t* in_buf = static_cast<const uint8_t*>(buf);
+    size_t done = 0;
+    while (done < len) {
+        uint64_t pos = off + done;
+        size_t in = pos & (mm::PAGE_SIZE - 1);
+        size_t n = mm::PAGE_SIZE - in < len - done ? mm::PAGE_SIZE - in : len - done;
+
+        unsigned order;
+        uint8_t* page = get_page(pos >> mm::PAGE_SHIFT, true, huge_ok, &order);
+        if (!page) {
+            break;
+        }
+        memcpy(page + in, in_buf + done, n);
+        done += n;
+    }
+
+    if (off + done > size) {
+        size = off + done;
+    }
+    return done ? (int64_t)done : -ENOSPC;
+}
+
+int TmpInode::truncate(uint64_t new_size)
+{
+    if (is_dir()) {
+        return -EISDIR;
+    }
+
+    SpinGuard guard(lock_);
+    if (new_size < size) {
+        if (map_refs_) {
+            return -EBUSY;  // 映射中的页不能释放
+        }
+        uint64_t first = (new_size + mm::PAGE_SIZE - 1) >> mm::PAGE_SHIFT;
+        free_pages_from(first);
+
+        // 保留下来的最后一页中超出新长度的部分清零，之后再扩展时读出0
+        size_t in = new_size & (mm::PAGE_SIZE - 1);
+        unsigned order;
+        uint8_t* page = in ? get_page(new_size >> mm::PAGE_SHIFT, false, false, &order) : nullptr;
+        if (page) {
+            memset(page + in, 0, mm::PAGE_SIZE - in);
+        }
+    }
+    size = new_size;
+    return 0;
+}
+
+uint64_t TmpInode::map_page(uint64_t pgoff, bool, unsigned* order)
+{
+    if (is_dir()) {
+        return 0;
+    }
+
+    SpinGuard guard(lock_);
+    if (pgoff >= (size + mm::PAGE_SIZE - 1) >> mm::PAGE_SHIFT) {
+        return 0;
+    }
+    // 映射时填补空洞，之后进程和内核看到的是同一组物理页
+    bool huge_ok = fs_->huge_threshold_ && size >= fs_->huge_threshold_;
+    uint8_t* page = get_page(pgoff, true, huge_ok, order);
+    return reinterpret_cast<uintptr_t>(page);
+}
+
+void TmpInode::mmap_ref(int delta)
+{
+    lock_.lock();
+    map_refs_ += delta;
+    bool release = map_refs_ == 0 && orphan_;
+    lock_.unlock();
+
+    if (release) {
+        destroy();
+    }
+}
+
+void TmpInode::destroy()
+{
+    free_pages_from(0);
+    kfree(name_);
+    kdelete(this);
+}
+
+// ============================================
+// 目录
+// ============================================
+
+Inode* TmpInode::lookup(const char* name, size_t len)
+{
+    if (!is_dir()) {
+        return nullptr;
+    }
+    if (len == 2 && name[0] == '.' && name[1] == '.') {
+        return parent_ ? parent_ : this;
+    }
+
+    SpinGuard guard(fs_->ns_lock_);
+    return fs_->find_child(this, name, len);
+}
+
+int TmpInode::readdir(uint64_t* cookie, DirEntry* out)
+{
+    if (!is_dir()) {
+        return -ENOTDIR;
+    }
+
+    // cookie是序号而不是指针: 两次调用之间子节点可能被删除
+    SpinGuard guard(fs_->ns_lock_);
+    TmpInode* n = first_child_;
+    for (uint64_t i = 0; n && i < *cookie; i++) {
+        n = n->next_sibling_;
+    }
+    if (!n) {
+        return 0;
+    }
+
+    memcpy(out->name, n->name_, n->name_len_);
+    out->name[n->name_len_] = '\0';
+    out->type = n->type;
+    out->ino = n->ino;
+    (*cookie)++;
+    return 1;
+}
+
+int TmpInode::create(const char* name, size_t len, NodeType type, Inode** out)
+{
+    *out = nullptr;
+    if (!is_dir()) {
+        return -ENOTDIR;
+    }
+    if (len == 0 || (len <= 2 && name[0] == '.' && name[len - 1] == '.')) {
+        return -EINVAL;
+    }
+    if (len > NAME_MAX) {
+        return -ENAMETOOLONG;
+    }
+
+    char* copy = static_cast<char*>(kmalloc(len));
+    TmpInode* node = knew<TmpInode>();
+    if (!copy || !node) {
+        kfree(copy);
+        kdelete(node);
+        return -ENOMEM;
+    }
+    memcpy(copy, name, len);
+
+    SpinGuard guard(fs_->ns_lock_);
+    if (fs_->find_child(this, name, len)) {
+        kfree(copy);
+        kdelete(node);
+        return -EEXIST;
+    }
+    if (fs_->node_count_ >= fs_->table_mask_ && !fs_->grow_table()) {
+        kfree(copy);
+        kdelete(node);
+        return -ENOMEM;
+    }
+
+    node->fs_ = fs_;
+    node->ino = fs_->next_ino_++;
+    node->type = type;
+    node->mode = type == NodeType::Directory ? 0777 : 0666;
+    node->name_ = copy;
+    node->name_len_ = (uint16_t)len;
+    node->parent_ = this;
+    node->next_sibling_ = first_child_;
+    if (first_child_) {
+        first_child_->prev_sibling_ = node;
+    }
+    first_child_ = node;
+    fs_->hash_insert(node);
+
+    *out = node;
+    return 0;
+}
+
+int TmpInode::unlink(const char* name, size_t len)
+{
+    if (!is_dir()) {
+        return -ENOTDIR;
+    }
+
+    TmpInode* node;
+    {
+        SpinGuard guard(fs_->ns_lock_);
+        node = fs_->find_child(this, name, len);
+        if (!node) {
+            return -ENOENT;
+        }
+        if (node->is_dir() && node->first_child_) {
+            return -ENOTEMPTY;
+        }
+
+        fs_->hash_remove(node);
+        if (node->prev_sibling_) {
+            node->prev_sibling_->next_sibling_ = node->next_sibling_;
+        } else {
+            first_child_ = node->next_sibling_;
+        }
+        if (node->next_sibling_) {
+            node->next_sibling_->prev_sibling_ = node->prev_sibling_;
+        }
+    }
+
+    // 仍被映射的文件延迟到最后一次解除映射时释放
+    node->lock_.lock();
+    bool mapped = node->map_refs_ > 0;
+    node->orphan_ = mapped;
+    node->lock_.unlock();
+
+    if (!mapped) {
+        node->destroy();
+    }
+    return 0;
+}
+
+namespace {
+
+// /tmp 最多占用四分之一的物理内存，超过2 MiB的文件使用大页
+int __init mount_tmp()
+{
+    TmpFileSystem* tmp = TmpFileSystem::create(mm::total_page_count() / 4, mm::HUGE_PAGE_SIZE);
+    if (!tmp) {
+        return -ENOMEM;
+    }
+    return mount("/tmp", tmp);
+}
+DEFINE_INITCALL_AFTER(INIT_LEVEL_LATE, mount_tmp, "mount_root");
+
+} // namespace
+
+} // namespace fs
@@ -0,0 +1,199 @@
+/**
+ * leafOS - 虚拟文件系统层实现
+ */
+
+#include <vfs.hpp>
+#include <vmm.hpp>
+#include <kstring.hpp>
+#include <spinlock.hpp>
+
+namespace fs {
+
+namespace {
+
+constexpr size_t MAX_MOUNTS = 16;
+constexpr size_t MOUNT_PATH_MAX = 64;
+
+struct Mount {
+    char        path[MOUNT_PATH_MAX];
+    size_t      len;
+    FileSystem* fs;
+};
+
+Spinlock g_mount_lock;
+Mount    g_mounts[MAX_MOUNTS];
+size_t   g_mount_count;
+
+// 去掉末尾的'/'(根目录除外)后的长度
+size_t trimmed_len(const char* path)
+{
+    size_t len = strlen(path);
+    while (len > 1 && path[len - 1] == '/') {
+        len--;
+    }
+    return len;
+}
+
+// 找到覆盖path的最长挂载点，返回剩余部分
+const Mount* find_mount(const char* path, const char** rest)
+{
+    const Mount* best = nullptr;
+
+    for (size_t i = 0; i < g_mount_count; i++) {
+        const Mount& m = g_mounts[i];
+        if (strncmp(path, m.path, m.len) != 0) {
+            continue;
+        }
+        // 必须在路径分量边界上匹配: "/boot" 不匹配 "/bootx"
+        char next = path[m.len];
+        if (m.len > 1 && next != '\0' && next != '/') {
+            continue;
+        }
+        if (!best || m.len > best->len) {
+            best = &m;
+        }
+    }
+    if (best) {
+        *rest = path + best->len;
+    }
+    return best;
+}
+
+} // namespace
+
+int mount(const char* path, FileSystem* fs)
+{
+    if (!path || path[0] != '/' || !fs) {
+        return -EINVAL;
+    }
+
+    size_t len = trimmed_len(path);
+    if (len >= MOUNT_PATH_MAX) {
+        return -ENAMETOOLONG;
+    }
+
+    SpinGuard guard(g_mount_lock);
+    for (size_t i = 0; i < g_mount_count; i++) {
+        if (g_mounts[i].len == len && strncmp(g_mounts[i].path, path, len) == 0) {
+            return -EBUSY;
+        }
+    }
+    if (g_mount_count == MAX_MOUNTS) {
+        return -ENOSPC;
+    }
+
+    Mount& m = g_mounts[g_mount_count++];
+    memcpy(m.path, path, len);
+    m.path[len] = '\0';
+    m.len = len;
+    m.fs = fs;
+    return 0;
+}
+
+Inode* resolve(const char* path)
+{
+    if (!path || path[0] != '/') {
+        return nullptr;
+    }
+
+    const char* rest = nullptr;
+    const Mount* m;
+    {
+        SpinGuard guard(g_mount_lock);
+        m = find_mount(path, &rest);
+    }
+    if (!m) {
+        return nullptr;
+    }
+
+    Inode* node = m->fs->root();
+    while (node && *rest) {
+        while (*rest == '/') {
+            rest++;
+        }
+        const char* end = rest;
+        while (*end && *end != '/') {
+            end++;
+        }
+        size_t len = end - rest;
+        if (len == 0) {
+            break;
+        }
+        if (!(len == 1 && rest[0] == '.')) {
+            if (!node->is_dir()) {
+                return nullptr;
+            }
+            node = node->lookup(rest, len);
+        }
+        rest = end;
+    }
+    return node;
+}
+
+int mmap_file(mm::AddressSpace* as, uint64_t va, Inode* node, uint64_t off, uint64_t len,
+              uint32_t flags)
+{
+    if (((va | off) & (mm::PAGE_SIZE - 1)) || !len || node->is_dir()) {
+        return -EINVAL;
+    }
+
+    uint64_t pages = (len + mm::PAGE_SIZE - 1) >> mm::PAGE_SHIFT;
+    uint64_t pgoff = off >> mm::PAGE_SHIFT;
+    bool write = flags & mm::VM_WRITE;
+    int err = 0;
+
+    uint64_t i = 0;
+    while (i < pages) {
+        unsigned order = 0;
+        uint64_t pa = node->map_page(pgoff + i, write, &order);
+        if (!pa) {
+            err = -ENOSYS;
+            break;
+        }
+
+        uint64_t addr = va + (i << mm::PAGE_SHIFT);
+        uint64_t huge_pages = 1ULL << mm::HUGE_PAGE_ORDER;
+        uint64_t step = 1;
+        if (order >= mm::HUGE_PAGE_ORDER && pages - i >= huge_pages &&
+            !(addr & (mm::HUGE_PAGE_SIZE - 1)) && !(pa & (mm::HUGE_PAGE_SIZE - 1))) {
+            err = as->map_huge(addr, pa, flags);
+            step = huge_pages;
+        } else {
+            err = as->map(addr, pa, flags);
+        }
+        if (err) {
+            break;
+        }
+        i += step;
+    }
+
+    if (err) {
+        // 撤销本次已建立的映射
+        uint64_t done = 0;
+        while (done < (i << mm::PAGE_SHIFT)) {
+            uint64_t n = as->unmap(va + done);
+            done += n ? n : mm::PAGE_SIZE;
+        }
+        return err;
+    }
+
+    node->mmap_ref(1);
+    return 0;
+}
+
+int munmap_file(mm::AddressSpace* as, uint64_t va, uint64_t len, Inode* node)
+{
+    if (va & (mm::PAGE_SIZE - 1)) {
+        return -EINVAL;
+    }
+
+    uint64_t done = 0;
+    while (done < len) {
+        uint64_t n = as->unmap(va + done);
+        done += n ? n : mm::PAGE_SIZE;
+    }
+    node->mmap_ref(-1);
+    return 0;
+}
+
+} // namespace fs
@@ -0,0 +1,131 @@
+/**
+ * leafOS - ELF64格式
+ * 只包含加载可重定位模块(ET_REL)用到的结构和常量，命名与ELF规范一致
+ */
+
+#pragma once
+#ifndef __LEAFOS_ELF_H__
+#define __LEAFOS_ELF_H__
+
+#include <stdint.h>
+
+struct Elf64_Ehdr {
+    uint8_t  e_ident[16];
+    uint16_t e_type;
+    uint16_t e_machine;
+    uint32_t e_version;
+    uint64_t e_entry;
+    uint64_t e_phoff;
+    uint64_t e_shoff;
+    uint32_t e_flags;
+    uint16_t e_ehsize;
+    uint16_t e_phentsize;
+    uint16_t e_phnum;
+    uint16_t e_shentsize;
+    uint16_t e_shnum;
+    uint16_t e_shstrndx;
+};
+
+struct Elf64_Shdr {
+    uint32_t sh_name;
+    uint32_t sh_type;
+    uint64_t sh_flags;
+    uint64_t sh_addr;
+    uint64_t sh_offset;
+    uint64_t sh_size;
+    uint32_t sh_link;
+    uint32_t sh_info;
+    uint64_t sh_addralign;
+    uint64_t sh_entsize;
+};
+
+struct Elf64_Sym {
+    uint32_t st_name;
+    uint8_t  st_info;
+    uint8_t  st_other;
+    uint16_t st_shndx;
+    uint64_t st_value;
+    uint64_t st_size;
+};
+
+struct Elf64_Rela {
+    uint64_t r_offset;
+    uint64_t r_info;
+    int64_t  r_addend;
+};
+
+constexpr uint8_t  ELFCLASS64  = 2;
+constexpr uint8_t  ELFDATA2LSB = 1;
+constexpr uint16_t ET_REL      = 1;
+constexpr uint16_t EM_X86_64   = 62;
+constexpr uint16_t EM_AARCH64  = 183;
+
+constexpr uint32_t SHT_PROGBITS   = 1;
+constexpr uint32_t SHT_SYMTAB     = 2;
+constexpr uint32_t SHT_RELA       = 4;
+constexpr uint32_t SHT_NOBITS     = 8;
+constexpr uint32_t SHT_REL        = 9;
+constexpr uint32_t SHT_INIT_ARRAY = 14;
+
+constexpr uint64_t SHF_WRITE     = 0x1;
+constexpr uint64_t SHF_ALLOC     = 0x2;
+constexpr uint64_t SHF_EXECINSTR = 0x4;
+
+constexpr uint16_t SHN_UNDEF     = 0;
+constexpr uint16_t SHN_LORESERVE = 0xFF00;
+constexpr uint16_t SHN_ABS       = 0xFFF1;
+constexpr uint16_t SHN_COMMON    = 0xFFF2;
+
+constexpr uint8_t STB_LOCAL  = 0;
+constexpr uint8_t STB_GLOBAL = 1;
+constexpr uint8_t STB_WEAK   = 2;
+
+static inline uint8_t elf64_st_bind(uint8_t info)
+{
+    return info >> 4;
+}
+
+static inline uint32_t elf64_r_sym(uint64_t info)
+{
+    return (uint32_t)(info >> 32);
+}
+
+static inline uint32_t elf64_r_type(uint64_t info)
+{
+    return (uint32_t)info;
+}
+
+// x86_64重定位类型
+constexpr uint32_t R_X86_64_NONE          = 0;
+constexpr uint32_t R_X86_64_64            = 1;
+constexpr uint32_t R_X86_64_PC32          = 2;
+constexpr uint32_t R_X86_64_PLT32         = 4;
+constexpr uint32_t R_X86_64_GOTPCREL      = 9;
+constexpr uint32_t R_X86_64_32            = 10;
+constexpr uint32_t R_X86_64_32S           = 11;
+constexpr uint32_t R_X86_64_PC64          = 24;
+constexpr uint32_t R_X86_64_GOTPCRELX     = 41;
+constexpr uint32_t R_X86_64_REX_GOTPCRELX = 42;
+
+// aarch64重定位类型
+constexpr uint32_t R_AARCH64_NONE                = 0;
+constexpr uint32_t R_AARCH64_ABS64               = 257;
+constexpr uint32_t R_AARCH64_ABS32               = 258;
+constexpr uint32_t R_AARCH64_PREL64              = 260;
+constexpr uint32_t R_AARCH64_PREL32              = 261;
+constexpr uint32_t R_AARCH64_ADR_PREL_PG_HI21    = 275;
+constexpr uint32_t R_AARCH64_ADR_PREL_PG_HI21_NC = 276;
+constexpr uint32_t R_AARCH64_ADD_ABS_LO12_NC     = 277;
+constexpr uint32_t R_AARCH64_LDST8_ABS_LO12_NC   = 278;
+constexpr uint32_t R_AARCH64_TSTBR14             = 279;
+constexpr uint32_t R_AARCH64_CONDBR19            = 280;
+constexpr uint32_t R_AARCH64_JUMP26              = 282;
+constexpr uint32_t R_AARCH64_CALL26              = 283;
+constexpr uint32_t R_AARCH64_LDST16_ABS_LO12_NC  = 284;
+constexpr uint32_t R_AARCH64_LDST32_ABS_LO12_NC  = 285;
+constexpr uint32_t R_AARCH64_LDST64_ABS_LO12_NC  = 286;
+constexpr uint32_t R_AARCH64_LDST128_ABS_LO12_NC = 299;
+constexpr uint32_t R_AARCH64_ADR_GOT_PAGE        = 311;
+constexpr uint32_t R_AARCH64_LD64_GOT_LO12_NC    = 312;
+
+#endif // __LEAFOS_ELF_H__
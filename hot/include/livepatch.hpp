@@ -0,0 +1,40 @@
+/**
+ * leafOS - 实时补丁
+ *
+ * 不重启地替换内核函数: 替换函数放在可加载模块(module.hpp)中，模块的module_init
+ * 以一组(旧函数名, 新函数)调用livepatch_enable，旧函数的入口被改写为跳到新函数的跳转
+ * (x86 jmp rel32，aarch64 b)。以FTRACE=1构建时入口是函数跟踪的跟踪点，被补丁占用期间
+ * 不能开启跟踪；否则改写入口处原有的指令，保存下来供livepatch_disable恢复。
+ *
+ * 改写在stop_machine中进行，其间检查当前的调用栈: 任何一个旧函数正在执行(栈上有
+ * 返回到它里面的地址)时不改写，返回-EBUSY，调用期间新旧版本不会混用。
+ * 每次开启和关闭在串口报告系统因此停顿的时间。
+ *
+ * 只能替换内核符号表(ksyms.hpp)中的函数；被内联到调用者中的副本不受影响。
+ * 新函数要在旧函数入口的跳转范围内(x86 ±2 GiB，aarch64 ±128 MiB)，否则返回-ERANGE；
+ * 入口的跳转要能一次对齐的存储写入(text_patch.hpp)，x86上跨8字节边界的入口返回-EINVAL
+ */
+
+#pragma once
+#ifndef __LEAFOS_LIVEPATCH_H__
+#define __LEAFOS_LIVEPATCH_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct LivepatchFunc {
+    const char* old_name;   // 符号表中的名字(去掉参数表)，重载的函数改用导出表中修饰后的名字
+    const void* new_func;
+};
+
+#define LIVEPATCH_FUNC(old_name, new_func) { old_name, reinterpret_cast<const void*>(&new_func) }
+
+// 以name登记一组替换并全部开启，任何一个不能替换时都不改写，返回负错误码。
+// name已登记时返回-EEXIST；同一个函数同时只能被一个补丁替换，冲突时返回-EBUSY
+int livepatch_enable(const char* name, const LivepatchFunc* funcs, size_t count);
+
+// 恢复name替换的全部函数并删去登记；新函数所在的模块仍留在内存中，
+// 正在新函数中执行的调用照常返回
+int livepatch_disable(const char* name);
+
+#endif // __LEAFOS_LIVEPATCH_H__
@@ -0,0 +1,86 @@
+/**
+ * leafOS - 可加载内核模块
+ *
+ * 模块是普通的可重定位ELF目标文件(gcc -c或ld -r的输出，见 make MODULES=...)。
+ * 加载时所有可分配的节按代码在前、数据在后排成一个映像，放在专用的2 MiB对齐区域里，
+ * 多个模块在区域中依次存放。只有代码所在的页可执行，数据页不可执行，
+ * 内核恒等映射中覆盖区域的大页因此被拆成4K页。
+ *
+ * 未定义符号在导出表中查找。导出表是开放寻址的散列表，内核用EXPORT_SYMBOL登记的符号
+ * 和已加载模块导出的符号都在其中，查找不随符号数增长。重定位在符号全部解析之后一遍完成；
+ * 超出指令寻址范围的调用和经GOT的访问使用映像中为每个外部符号预留的跳板。
+ * 模块以-fPIC编译，对外部数据的访问都经GOT，区域离内核多远都能重定位。
+ *
+ * 模块中定义的 extern "C" int module_init() 在加载完成后调用，返回负错误码时加载失败。
+ * 模块目前不能卸载
+ */
+
+#pragma once
+#ifndef __LEAFOS_MODULE_H__
+#define __LEAFOS_MODULE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <init.hpp>
+
+constexpr size_t MODULE_NAME_LEN = 32;
+
+// 导出表项，由EXPORT_SYMBOL生成在kexports段中
+struct KernelExport {
+    uintptr_t   addr;
+    const char* name;   // 链接器看到的符号名，C++函数是修饰后的名字
+};
+
+struct Module {
+    Module*             next;
+    char                name[MODULE_NAME_LEN];
+    uintptr_t           base;           // 映像起始，代码和跳板在前
+    size_t              text_size;
+    size_t              size;
+    const KernelExport* exports;
+    size_t              export_count;
+};
+
+// 导出符号，供模块引用。sym在当前文件中必须是本地绑定的:
+// 在本文件中定义，或者(-fpie构建中)声明时带hidden可见性，见hot/exports.cpp。
+// 符号名由汇编器按实际的符号写出，C++函数导出修饰后的名字
+#if defined(__aarch64__)
+#define KEXPORT_SYM_ "S"
+#else
+#define KEXPORT_SYM_ "i"
+#endif
+
+#define KEXPORT_CAT_(a, b)  a##b
+#define KEXPORT_FN_(n)      KEXPORT_CAT_(kexport_, n)
+
+#define EXPORT_SYMBOL(sym)                                                          \
+    static void __init __attribute__((used)) KEXPORT_FN_(__COUNTER__)()             \
+    {                                                                               \
+        __asm__ __volatile__(".pushsection kexports, \"aw\"\n"                      \
+                             ".balign 8\n"                                          \
+                             ".quad %c0, 1f\n"                                      \
+                             ".popsection\n"                                        \
+                             ".pushsection .rodata.kexport_names, \"a\"\n"          \
+                             "1: .asciz \"%c0\"\n"                                  \
+                             ".popsection" :: KEXPORT_SYM_(&sym));                  \
+    }
+
+// 按符号名查找内核和已加载模块导出的符号，找不到时返回0
+uintptr_t kexport_lookup(const char* name);
+
+// 把[begin, end)加入导出表。任何一个名字已存在时返回-EEXIST，表不变
+int kexport_add(const KernelExport* begin, const KernelExport* end);
+
+// 从导出表中删去由kexport_add加入的[begin, end)
+void kexport_remove(const KernelExport* begin, const KernelExport* end);
+
+// 加载内存中的模块映像(加载后不再引用image)，成功时返回0并可由out带回模块
+int module_load(const char* name, const void* image, size_t size, Module** out = nullptr);
+
+// 从文件系统中读取并加载模块，模块名取文件名去掉扩展名
+int module_load_file(const char* path, Module** out = nullptr);
+
+// 按名字查找已加载的模块
+Module* module_find(const char* name);
+
+#endif // __LEAFOS_MODULE_H__
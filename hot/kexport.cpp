@@ -0,0 +1,195 @@
+/**
+ * leafOS - 导出表
+ *
+ * 开放寻址、线性探测的散列表，槽中存名字的散列值和表项指针，比较名字前先比较散列值。
+ * 装载率不超过1/2，删除时把后面同一探测链上的项前移，不留墓碑
+ */
+
+// 导出的符号都在内核映像中，声明为hidden后-fpie构建也能以本地符号引用它们(见EXPORT_SYMBOL)
+#pragma GCC visibility push(hidden)
+#include <kstring.hpp>
+#include <kheap.hpp>
+#include <page_alloc.hpp>
+#include <console.hpp>
+#include <clock.hpp>
+#include <module.hpp>
+#include <livepatch.hpp>
+#pragma GCC visibility pop
+
+#include <stdint.h>
+#include <stddef.h>
+#include <initcall.hpp>
+#include <kerrno.hpp>
+#include <spinlock.hpp>
+
+// 内核提供给模块的接口
+EXPORT_SYMBOL(memcpy)
+EXPORT_SYMBOL(memmove)
+EXPORT_SYMBOL(memset)
+EXPORT_SYMBOL(memcmp)
+EXPORT_SYMBOL(strlen)
+EXPORT_SYMBOL(strcmp)
+EXPORT_SYMBOL(strncmp)
+EXPORT_SYMBOL(kmalloc)
+EXPORT_SYMBOL(kzalloc)
+EXPORT_SYMBOL(krealloc)
+EXPORT_SYMBOL(kfree)
+EXPORT_SYMBOL(mm::alloc_pages)
+EXPORT_SYMBOL(mm::alloc_pages_zeroed)
+EXPORT_SYMBOL(mm::free_pages)
+EXPORT_SYMBOL(console::write)
+EXPORT_SYMBOL(clock_ns)
+EXPORT_SYMBOL(clock_cycles)
+EXPORT_SYMBOL(kexport_lookup)
+EXPORT_SYMBOL(module_find)
+EXPORT_SYMBOL(livepatch_enable)
+EXPORT_SYMBOL(livepatch_disable)
+
+// 由链接器生成的内核导出表边界
+extern "C" const KernelExport __start_kexports[] __attribute__((weak));
+extern "C" const KernelExport __stop_kexports[] __attribute__((weak));
+
+namespace {
+
+struct Slot {
+    uint32_t            hash;
+    const KernelExport* e;      // nullptr表示空槽
+};
+
+Spinlock g_lock;
+Slot*    g_slots;
+size_t   g_capacity;            // 2的幂
+size_t   g_count;
+
+// 32位FNV-1a
+uint32_t hash_name(const char* s)
+{
+    uint32_t h = 0x811c9dc5;
+    for (; *s; s++) {
+        h = (h ^ (uint8_t)*s) * 0x01000193;
+    }
+    return h;
+}
+
+Slot* find_slot(const char* name, uint32_t h)
+{
+    if (!g_slots) {
+        return nullptr;
+    }
+    size_t mask = g_capacity - 1;
+    for (size_t i = h & mask;; i = (i + 1) & mask) {
+        Slot& s = g_slots[i];
+        if (!s.e) {
+            return nullptr;
+        }
+        if (s.hash == h && !strcmp(s.e->name, name)) {
+            return &s;
+        }
+    }
+}
+
+void place(Slot* slots, size_t capacity, uint32_t h, const KernelExport* e)
+{
+    size_t mask = capacity - 1;
+    size_t i = h & mask;
+    while (slots[i].e) {
+        i = (i + 1) & mask;
+    }
+    slots[i].hash = h;
+    slots[i].e = e;
+}
+
+// 保证能再放下extra项而装载率不超过1/2
+int reserve(size_t extra)
+{
+    size_t need = (g_count + extra) * 2;
+    if (need <= g_capacity) {
+        return 0;
+    }
+    size_t capacity = g_capacity ? g_capacity : 64;
+    while (capacity < need) {
+        capacity *= 2;
+    }
+    Slot* slots = static_cast<Slot*>(kzalloc(capacity * sizeof(Slot)));
+    if (!slots) {
+        return -ENOMEM;
+    }
+    for (size_t i = 0; i < g_capacity; i++) {
+        if (g_slots[i].e) {
+            place(slots, capacity, g_slots[i].hash, g_slots[i].e);
+        }
+    }
+    kfree(g_slots);
+    g_slots = slots;
+    g_capacity = capacity;
+    return 0;
+}
+
+int __init kexport_init()
+{
+    int err = kexport_add(__start_kexports, __stop_kexports);
+    if (err) {
+        return err;
+    }
+    console::Line().str("kexport: ").num((int64_t)g_count).str(" kernel symbols exported").print();
+    return 0;
+}
+subsys_initcall(kexport_init);
+
+} // namespace
+
+uintptr_t kexport_lookup(const char* name)
+{
+    SpinGuard guard(g_lock);
+    Slot* s = find_slot(name, hash_name(name));
+    return s ? s->e->addr : 0;
+}
+
+int kexport_add(const KernelExport* begin, const KernelExport* end)
+{
+    SpinGuard guard(g_lock);
+    for (const KernelExport* e = begin; e < end; e++) {
+        if (find_slot(e->name, hash_name(e->name))) {
+            return -EEXIST;
+        }
+        // 同一批中的重名
+        for (const KernelExport* p = begin; p < e; p++) {
+            if (!strcmp(p->name, e->name)) {
+                return -EEXIST;
+            }
+        }
+    }
+    int err = reserve((size_t)(end - begin));
+    if (err) {
+        return err;
+    }
+    for (const KernelExport* e = begin; e < end; e++) {
+        place(g_slots, g_capacity, hash_name(e->name), e);
+        g_count++;
+    }
+    return 0;
+}
+
+void kexport_remove(const KernelExport* begin, const KernelExport* end)
+{
+    SpinGuard guard(g_lock);
+    size_t mask = g_capacity - 1;
+    for (const KernelExport* e = begin; e < end; e++) {
+        Slot* s = find_slot(e->name, hash_name(e->name));
+        if (!s || s->e != e) {
+            continue;
+        }
+        // 清空后，把探测链上原本应在空位之前的项移进来
+        size_t hole = (size_t)(s - g_slots);
+        g_slots[hole].e = nullptr;
+        g_count--;
+        for (size_t i = (hole + 1) & mask; g_slots[i].e; i = (i + 1) & mask) {
+            size_t home = g_slots[i].hash & mask;
+            if (((i - home) & mask) >= ((i - hole) & mask)) {
+                g_slots[hole] = g_slots[i];
+                g_slots[i].e = nullptr;
+                hole = i;
+            }
+        }
+    }
+}
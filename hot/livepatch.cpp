@@ -0,0 +1,320 @@
+/**
+ * leafOS - 实时补丁实现
+ *
+ * 开启分两步: 先在正常状态下查找全部旧函数、生成跳转指令、保存入口原有的字节并占用
+ * 跟踪点，再在stop_machine中检查调用栈并逐个改写。改写中途失败时把已改写的恢复原样
+ */
+
+#include <livepatch.hpp>
+#include <stdint.h>
+#include <stddef.h>
+#include <console.hpp>
+#include <ftrace.hpp>
+#include <kerrno.hpp>
+#include <kheap.hpp>
+#include <ksyms.hpp>
+#include <kstring.hpp>
+#include <module.hpp>
+#include <spinlock.hpp>
+#include <stacktrace.hpp>
+#include <stop_machine.hpp>
+#include <text_patch.hpp>
+
+// 链接脚本划分的init区，其中的函数启动完成后被释放
+extern "C" char __init_begin[] __attribute__((weak));
+extern "C" char __init_end[] __attribute__((weak));
+
+namespace {
+
+#if defined(__x86_64__)
+
+// jmp rel32。以FTRACE=1构建时与跟踪点的5字节NOP等长，一次对齐的存储完成改写
+constexpr size_t PATCH_SIZE = 5;
+
+int encode_jump(uintptr_t from, uintptr_t to, uint8_t* insn)
+{
+    int64_t rel = (int64_t)(to - (from + PATCH_SIZE));
+    if (rel < INT32_MIN || rel > INT32_MAX) {
+        return -ERANGE;
+    }
+    int32_t rel32 = (int32_t)rel;
+    insn[0] = 0xE9;
+    memcpy(insn + 1, &rel32, sizeof(rel32));
+    return 0;
+}
+
+#elif defined(__aarch64__)
+
+// b imm26，只改写入口的第一条指令
+constexpr size_t PATCH_SIZE = 4;
+
+int encode_jump(uintptr_t from, uintptr_t to, uint8_t* insn)
+{
+    int64_t rel = (int64_t)(to - from);
+    if (rel < -(1LL << 27) || rel >= (1LL << 27)) {
+        return -ERANGE;
+    }
+    uint32_t b = 0x14000000u | (uint32_t)((rel >> 2) & 0x03FFFFFF);
+    memcpy(insn, &b, sizeof(b));
+    return 0;
+}
+
+#endif
+
+struct PatchedFunc {
+    uintptr_t old_addr;
+    uint32_t  old_size;
+    uintptr_t new_addr;
+    uint8_t   jump[PATCH_SIZE];
+    uint8_t   saved[PATCH_SIZE];     // 入口原有的字节
+};
+
+struct Patch {
+    Patch*       next;
+    char         name[MODULE_NAME_LEN];
+    PatchedFunc* funcs;
+    size_t       count;
+};
+
+// 交给stop_machine的参数
+struct Switch {
+    Patch* patch;
+    bool   enable;
+    size_t active;          // 检查失败时，正在执行的旧函数的下标
+};
+
+Spinlock g_lock;            // 开启和关闭串行进行
+Patch*   g_patches;
+
+Patch* find_patch(const char* name)
+{
+    for (Patch* p = g_patches; p; p = p->next) {
+        if (!strcmp(p->name, name)) {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+bool is_patched(uintptr_t addr)
+{
+    for (Patch* p = g_patches; p; p = p->next) {
+        for (size_t i = 0; i < p->count; i++) {
+            if (p->funcs[i].old_addr == addr) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// 按名字找到旧函数: 先查符号表，找不到再查导出表中的符号名，最终都要是符号表中的函数入口
+int find_old(const char* name, Ksym* sym)
+{
+    uint32_t n = ksym_find(name, sym);
+    if (n > 1) {
+        console::Line().str("livepatch: ").str(name).str(" is ambiguous, ").num((int64_t)n)
+            .str(" functions have this name").print();
+        return -EINVAL;
+    }
+    if (!n) {
+        uintptr_t addr = kexport_lookup(name);
+        if (!addr || !ksym_lookup(addr, sym) || sym->addr != addr) {
+            console::Line().str("livepatch: no kernel function named ").str(name).print();
+            return -ENOENT;
+        }
+    }
+    uintptr_t init_begin = reinterpret_cast<uintptr_t>(__init_begin);
+    uintptr_t init_end = reinterpret_cast<uintptr_t>(__init_end);
+    if (sym->size < PATCH_SIZE || (sym->addr >= init_begin && sym->addr < init_end)) {
+        console::Line().str("livepatch: ").str(name).str(" cannot be patched").print();
+        return -EINVAL;
+    }
+    return 0;
+}
+
+// 当前调用栈上是否有返回到[addr, addr + size)中的地址。
+// 其他CPU停下时也要检查它们被打断处的调用栈，目前只有这一个CPU
+bool on_stack(uintptr_t addr, uint32_t size)
+{
+    uintptr_t frames[64];
+    uintptr_t fp = reinterpret_cast<uintptr_t>(__builtin_frame_address(0));
+    uint32_t n = stack_walk(fp, fp, frames, sizeof(frames) / sizeof(frames[0]));
+    for (uint32_t i = 0; i < n; i++) {
+        if (frames[i] - addr < size) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 在stop_machine中运行。开启前要求没有旧函数正在执行；
+// 关闭时旧函数的入口本就不会被执行到，正在新函数中的调用照常返回，不需要检查
+int switch_patch(void* arg)
+{
+    Switch* sw = static_cast<Switch*>(arg);
+    Patch* p = sw->patch;
+    if (sw->enable) {
+        for (size_t i = 0; i < p->count; i++) {
+            if (on_stack(p->funcs[i].old_addr, p->funcs[i].old_size)) {
+                sw->active = i;
+                return -EBUSY;
+            }
+        }
+    }
+
+    int err = 0;
+    size_t done = 0;
+    while (done < p->count) {
+        PatchedFunc& f = p->funcs[done];
+        err = text_poke(reinterpret_cast<void*>(f.old_addr), sw->enable ? f.jump : f.saved, PATCH_SIZE);
+        if (err) {
+            break;
+        }
+        done++;
+    }
+    // 第done个改写失败，之前的恢复原样
+    for (size_t i = 0; err && i < done; i++) {
+        PatchedFunc& f = p->funcs[i];
+        text_poke(reinterpret_cast<void*>(f.old_addr), sw->enable ? f.saved : f.jump, PATCH_SIZE);
+    }
+    return err;
+}
+
+void release_sites(Patch* p, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        ftrace_release(p->funcs[i].old_addr);
+    }
+}
+
+void free_patch(Patch* p)
+{
+    kfree(p->funcs);
+    kdelete(p);
+}
+
+// 查找并准备全部替换，占用对应的跟踪点
+int prepare(Patch* p, const LivepatchFunc* funcs)
+{
+    for (size_t i = 0; i < p->count; i++) {
+        Ksym sym;
+        PatchedFunc& f = p->funcs[i];
+        int err = find_old(funcs[i].old_name, &sym);
+        if (!err) {
+            f.old_addr = sym.addr;
+            f.old_size = sym.size;
+            f.new_addr = reinterpret_cast<uintptr_t>(funcs[i].new_func);
+            err = encode_jump(f.old_addr, f.new_addr, f.jump);
+            if (err) {
+                console::Line().str("livepatch: ").str(funcs[i].old_name)
+                    .str(" is out of jump range of its replacement").print();
+            } else if (!text_poke_atomic(f.old_addr, PATCH_SIZE)) {
+                // 跳转跨8字节边界时不能一次写入，改写中途执行到这里的CPU或NMI会看到半条指令
+                console::Line().str("livepatch: ").str(funcs[i].old_name)
+                    .str(" has an entry that cannot be patched atomically").print();
+                err = -EINVAL;
+            }
+        }
+        if (!err) {
+            bool dup = is_patched(f.old_addr);
+            for (size_t k = 0; k < i; k++) {
+                dup |= p->funcs[k].old_addr == f.old_addr;
+            }
+            if (dup) {
+                console::Line().str("livepatch: ").str(funcs[i].old_name).str(" is already replaced").print();
+                err = -EBUSY;
+            }
+        }
+        if (!err) {
+            err = ftrace_claim(f.old_addr);
+            if (err) {
+                console::Line().str("livepatch: ").str(funcs[i].old_name).str(" is being traced").print();
+            }
+        }
+        if (err) {
+            release_sites(p, i);
+            return err;
+        }
+        memcpy(f.saved, reinterpret_cast<const void*>(f.old_addr), PATCH_SIZE);
+    }
+    return 0;
+}
+
+} // namespace
+
+int livepatch_enable(const char* name, const LivepatchFunc* funcs, size_t count)
+{
+    if (!count || !*name) {
+        return -EINVAL;
+    }
+    SpinGuard guard(g_lock);
+    if (find_patch(name)) {
+        return -EEXIST;
+    }
+    Patch* p = knew<Patch>();
+    PatchedFunc* pf = static_cast<PatchedFunc*>(kzalloc(count * sizeof(PatchedFunc)));
+    if (!p || !pf) {
+        kdelete(p);
+        kfree(pf);
+        return -ENOMEM;
+    }
+    size_t len = strlen(name);
+    len = len < MODULE_NAME_LEN - 1 ? len : MODULE_NAME_LEN - 1;
+    memcpy(p->name, name, len);
+    p->name[len] = 0;
+    p->funcs = pf;
+    p->count = count;
+
+    int err = prepare(p, funcs);
+    if (err) {
+        free_patch(p);
+        return err;
+    }
+
+    Switch sw = { p, true, 0 };
+    uint64_t paused = 0;
+    err = stop_machine(switch_patch, &sw, &paused);
+    if (err) {
+        if (err == -EBUSY) {
+            console::Line().str("livepatch: ").str(p->name).str(": ").str(funcs[sw.active].old_name)
+                .str(" is running, not applied").print();
+        } else {
+            console::Line().str("livepatch: ").str(p->name).str(": patching failed (").num(err).str(")").print();
+        }
+        release_sites(p, count);
+        free_patch(p);
+        return err;
+    }
+    p->next = g_patches;
+    g_patches = p;
+    console::Line().str("livepatch: ").str(p->name).str(": ").num((int64_t)count)
+        .str(" functions replaced, system paused for ").num((int64_t)paused).str(" ns").print();
+    return 0;
+}
+
+int livepatch_disable(const char* name)
+{
+    SpinGuard guard(g_lock);
+    Patch* p = find_patch(name);
+    if (!p) {
+        return -ENOENT;
+    }
+    Switch sw = { p, false, 0 };
+    uint64_t paused = 0;
+    int err = stop_machine(switch_patch, &sw, &paused);
+    if (err) {
+        console::Line().str("livepatch: ").str(p->name).str(": restoring failed (").num(err).str(")").print();
+        return err;
+    }
+    Patch** pp = &g_patches;
+    while (*pp != p) {
+        pp = &(*pp)->next;
+    }
+    *pp = p->next;
+    release_sites(p, p->count);
+    console::Line().str("livepatch: ").str(p->name).str(": ").num((int64_t)p->count)
+        .str(" functions restored, system paused for ").num((int64_t)paused).str(" ns").print();
+    free_patch(p);
+    return 0;
+}
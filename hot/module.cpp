@@ -0,0 +1,805 @@
+/**
+ * leafOS - 模块加载实现
+ *
+ * 映像布局: 可执行的节，每个外部符号一个16字节的跳板，然后从下一页开始是其余可分配的节。
+ * 跳板是一条经后随8字节地址的间接跳转，这8字节同时充当该符号的GOT项，只在用到时填写。
+ * 映像不超过一个区域(最大4 MiB)，模块内部的引用总在指令的寻址范围内。
+ * 重定位完成后只有代码和跳板所在的页可执行
+ */
+
+#include <module.hpp>
+#include <elf.hpp>
+#include <stdint.h>
+#include <stddef.h>
+#include <arch/cpu.hpp>
+#include <clock.hpp>
+#include <console.hpp>
+#include <initcall.hpp>
+#include <kerrno.hpp>
+#include <kheap.hpp>
+#include <kstring.hpp>
+#include <page_alloc.hpp>
+#include <spinlock.hpp>
+#include <vfs.hpp>
+#include <vmm.hpp>
+
+namespace {
+
+#if defined(__x86_64__)
+constexpr uint16_t MACHINE = EM_X86_64;
+// jmp *2(%rip)，两字节int3填充
+const uint8_t STUB_CODE[8] = { 0xFF, 0x25, 0x02, 0x00, 0x00, 0x00, 0xCC, 0xCC };
+#elif defined(__aarch64__)
+constexpr uint16_t MACHINE = EM_AARCH64;
+// ldr x16, #8; br x16
+const uint8_t STUB_CODE[8] = { 0x50, 0x00, 0x00, 0x58, 0x00, 0x02, 0x1F, 0xD6 };
+#endif
+
+constexpr size_t   STUB_SIZE    = 16;
+constexpr size_t   STUB_SLOT    = 8;            // 目标地址在跳板中的偏移
+constexpr uint64_t NOT_LOADED   = ~0ULL;
+constexpr uint64_t REGION_SIZE  = mm::HUGE_PAGE_SIZE;
+
+// 存放模块映像的区域，按页依次分配出去
+struct Region {
+    Region*   next;
+    uintptr_t base;
+    uint64_t  size;
+    uint64_t  used;
+};
+
+Spinlock g_lock;
+Region*  g_regions;
+Module*  g_modules;
+
+inline uint64_t align_up(uint64_t v, uint64_t a)
+{
+    return (v + a - 1) & ~(a - 1);
+}
+
+// 新区域整块来自页分配器，伙伴块按自身大小对齐。可执行属性由各模块加载时按页设置
+Region* new_region(uint64_t size)
+{
+    unsigned order = size <= REGION_SIZE ? mm::HUGE_PAGE_ORDER : mm::size_to_order(size);
+    if (order > mm::MAX_ORDER) {
+        return nullptr;
+    }
+    void* mem = mm::alloc_pages(order);
+    if (!mem) {
+        return nullptr;
+    }
+    uintptr_t base = reinterpret_cast<uintptr_t>(mem);
+    uint64_t bytes = mm::PAGE_SIZE << order;
+
+    Region* r = knew<Region>();
+    if (!r) {
+        mm::free_pages(mem, order);
+        return nullptr;
+    }
+    r->base = base;
+    r->size = bytes;
+    r->used = 0;
+    r->next = g_regions;
+    g_regions = r;
+    return r;
+}
+
+uintptr_t region_alloc(uint64_t size)
+{
+    size = align_up(size, mm::PAGE_SIZE);
+    SpinGuard guard(g_lock);
+    Region* r = g_regions;
+    while (r && r->size - r->used < size) {
+        r = r->next;
+    }
+    if (!r) {
+        r = new_region(size);
+    }
+    if (!r) {
+        return 0;
+    }
+    uintptr_t p = r->base + r->used;
+    r->used += size;
+    return p;
+}
+
+// 只能退还区域中最后分配的一块，其余的留作空洞
+void region_free(uintptr_t p, uint64_t size)
+{
+    size = align_up(size, mm::PAGE_SIZE);
+    SpinGuard guard(g_lock);
+    for (Region* r = g_regions; r; r = r->next) {
+        if (p >= r->base && p < r->base + r->size) {
+            if (p + size == r->base + r->used) {
+                r->used -= size;
+            }
+            return;
+        }
+    }
+}
+
+inline uint32_t read32(uintptr_t p)
+{
+    uint32_t v;
+    memcpy(&v, reinterpret_cast<const void*>(p), 4);
+    return v;
+}
+
+inline void write32(uintptr_t p, uint32_t v)
+{
+    memcpy(reinterpret_cast<void*>(p), &v, 4);
+}
+
+inline void write64(uintptr_t p, uint64_t v)
+{
+    memcpy(reinterpret_cast<void*>(p), &v, 8);
+}
+
+inline bool fits_s32(int64_t v)
+{
+    return v >= INT32_MIN && v <= INT32_MAX;
+}
+
+class Loader {
+public:
+    Loader(const char* name, const void* image, size_t size)
+        : name_(name), image_(static_cast<const uint8_t*>(image)), size_(size) {}
+
+    ~Loader()
+    {
+        kfree(offset_);
+        kfree(value_);
+        kfree(stub_of_);
+    }
+
+    int load(Module** out);
+
+private:
+    int check();
+    int layout();
+    int resolve();
+    int relocate();
+    int protect();
+    int apply(uint32_t type, uintptr_t p, uint64_t room, uint32_t sym, int64_t addend);
+    uintptr_t stub(uint32_t sym);
+    void fail(const char* what, const char* detail = nullptr);
+
+    bool loaded(uint32_t sec) const { return offset_[sec] != NOT_LOADED; }
+    const char* sym_name(uint32_t i) const { return strtab_ + syms_[i].st_name; }
+
+    const char*       name_;
+    const uint8_t*    image_;
+    size_t            size_;
+
+    const Elf64_Ehdr* eh_ = nullptr;
+    const Elf64_Shdr* sh_ = nullptr;
+    const char*       shstr_ = nullptr;
+    uint32_t          symtab_ = 0;
+    const Elf64_Sym*  syms_ = nullptr;
+    uint32_t          nsyms_ = 0;
+    const char*       strtab_ = nullptr;
+
+    uint64_t*         offset_ = nullptr;    // 各节在映像中的偏移
+    uintptr_t*        value_ = nullptr;     // 各符号解析后的地址
+    uint32_t*         stub_of_ = nullptr;   // 各符号的跳板序号加1，0表示还没有
+    uint32_t          stub_count_ = 0;
+    uint32_t          stub_used_ = 0;
+
+    uintptr_t         base_ = 0;
+    uint64_t          stubs_ = 0;           // 跳板区在映像中的偏移
+    uint64_t          text_size_ = 0;
+    uint64_t          image_size_ = 0;
+    uint32_t          relocs_ = 0;
+    uintptr_t         init_ = 0;
+};
+
+void Loader::fail(const char* what, const char* detail)
+{
+    console::Line line;
+    line.str("module ").str(name_).str(": ").str(what);
+    if (detail) {
+        line.str(" ").str(detail);
+    }
+    line.print();
+}
+
+int Loader::check()
+{
+    eh_ = reinterpret_cast<const Elf64_Ehdr*>(image_);
+    if (size_ < sizeof(Elf64_Ehdr) || memcmp(eh_->e_ident, "\x7f" "ELF", 4) ||
+        eh_->e_ident[4] != ELFCLASS64 || eh_->e_ident[5] != ELFDATA2LSB ||
+        eh_->e_type != ET_REL || eh_->e_machine != MACHINE) {
+        fail("not a relocatable ELF object for this architecture");
+        return -ENOEXEC;
+    }
+    if (eh_->e_shentsize != sizeof(Elf64_Shdr) || eh_->e_shoff > size_ ||
+        (size_ - eh_->e_shoff) / sizeof(Elf64_Shdr) < eh_->e_shnum ||
+        eh_->e_shstrndx >= eh_->e_shnum) {
+        fail("bad section table");
+        return -ENOEXEC;
+    }
+    sh_ = reinterpret_cast<const Elf64_Shdr*>(image_ + eh_->e_shoff);
+
+    for (uint32_t i = 0; i < eh_->e_shnum; i++) {
+        const Elf64_Shdr& s = sh_[i];
+        if (s.sh_type != SHT_NOBITS && (s.sh_offset > size_ || s.sh_size > size_ - s.sh_offset)) {
+            fail("section out of bounds");
+            return -ENOEXEC;
+        }
+        if (s.sh_type == SHT_REL && (sh_[s.sh_info % eh_->e_shnum].sh_flags & SHF_ALLOC)) {
+            fail("REL relocations are not supported");
+            return -ENOEXEC;
+        }
+        if (s.sh_type == SHT_SYMTAB) {
+            if (symtab_ || s.sh_link >= eh_->e_shnum || s.sh_entsize != sizeof(Elf64_Sym)) {
+                fail("bad symbol table");
+                return -ENOEXEC;
+            }
+            symtab_ = i;
+        }
+    }
+    if (!symtab_) {
+        fail("no symbol table");
+        return -ENOEXEC;
+    }
+
+    // 字符串表必须以0结尾，之后按偏移取名字不会越界
+    const Elf64_Shdr& shstr = sh_[eh_->e_shstrndx];
+    const Elf64_Shdr& str = sh_[sh_[symtab_].sh_link];
+    if (!shstr.sh_size || image_[shstr.sh_offset + shstr.sh_size - 1] ||
+        !str.sh_size || image_[str.sh_offset + str.sh_size - 1]) {
+        fail("bad string table");
+        return -ENOEXEC;
+    }
+    shstr_ = reinterpret_cast<const char*>(image_ + shstr.sh_offset);
+    strtab_ = reinterpret_cast<const char*>(image_ + str.sh_offset);
+    syms_ = reinterpret_cast<const Elf64_Sym*>(image_ + sh_[symtab_].sh_offset);
+    nsyms_ = (uint32_t)(sh_[symtab_].sh_size / sizeof(Elf64_Sym));
+    for (uint32_t i = 0; i < nsyms_; i++) {
+        if (syms_[i].st_name >= str.sh_size) {
+            fail("bad symbol name");
+            return -ENOEXEC;
+        }
+    }
+    for (uint32_t i = 0; i < eh_->e_shnum; i++) {
+        if (sh_[i].sh_name >= shstr.sh_size) {
+            fail("bad section name");
+            return -ENOEXEC;
+        }
+    }
+    return 0;
+}
+
+// 代码节在前，其后是跳板，其余可分配的节从下一页开始。
+// 内核链接时丢弃的节(展开信息、FTRACE的跟踪点记录)这里同样不加载
+int Loader::layout()
+{
+    uint32_t n = eh_->e_shnum;
+    offset_ = static_cast<uint64_t*>(kmalloc(n * sizeof(uint64_t)));
+    value_ = static_cast<uintptr_t*>(kmalloc(nsyms_ * sizeof(uintptr_t)));
+    stub_of_ = static_cast<uint32_t*>(kzalloc(nsyms_ * sizeof(uint32_t)));
+    if (!offset_ || !value_ || !stub_of_) {
+        return -ENOMEM;
+    }
+
+    uint64_t end = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        bool exec = pass == 0;
+        for (uint32_t i = 0; i < n; i++) {
+            const Elf64_Shdr& s = sh_[i];
+            const char* sname = shstr_ + s.sh_name;
+            if (pass == 0) {
+                offset_[i] = NOT_LOADED;
+            }
+            if (!(s.sh_flags & SHF_ALLOC) || !!(s.sh_flags & SHF_EXECINSTR) != exec ||
+                !strcmp(sname, ".eh_frame") || !strcmp(sname, "__patchable_function_entries")) {
+                continue;
+            }
+            uint64_t align = s.sh_addralign ? s.sh_addralign : 1;
+            if ((align & (align - 1)) || align > mm::PAGE_SIZE) {
+                fail("unsupported section alignment in", sname);
+                return -ENOEXEC;
+            }
+            end = align_up(end, align);
+            offset_[i] = end;
+            end += s.sh_size;
+        }
+        if (exec) {
+            // 每个非本地符号预留一个跳板
+            for (uint32_t i = 1; i < nsyms_; i++) {
+                stub_count_ += elf64_st_bind(syms_[i].st_info) != STB_LOCAL;
+            }
+            stubs_ = align_up(end, STUB_SIZE);
+            text_size_ = stubs_ + (uint64_t)stub_count_ * STUB_SIZE;
+            end = align_up(text_size_, mm::PAGE_SIZE);
+        }
+    }
+    image_size_ = end;
+    if (image_size_ > (mm::PAGE_SIZE << mm::MAX_ORDER)) {
+        fail("image too large");
+        return -EFBIG;
+    }
+
+    base_ = region_alloc(image_size_);
+    if (!base_) {
+        fail("out of memory");
+        return -ENOMEM;
+    }
+    memset(reinterpret_cast<void*>(base_), 0, image_size_);
+    for (uint32_t i = 0; i < n; i++) {
+        if (loaded(i) && sh_[i].sh_type != SHT_NOBITS) {
+            memcpy(reinterpret_cast<void*>(base_ + offset_[i]), image_ + sh_[i].sh_offset, sh_[i].sh_size);
+        }
+    }
+    return 0;
+}
+
+// 先解析全部符号，重定位时只按下标取值
+int Loader::resolve()
+{
+    int err = 0;
+    value_[0] = 0;
+    for (uint32_t i = 1; i < nsyms_; i++) {
+        const Elf64_Sym& s = syms_[i];
+        uint8_t bind = elf64_st_bind(s.st_info);
+        uintptr_t v = 0;
+        if (s.st_shndx == SHN_UNDEF) {
+            if (!strcmp(sym_name(i), "_GLOBAL_OFFSET_TABLE_")) {
+                // 汇编器为GOT重定位引用的符号，模块的GOT项都在跳板区
+                v = base_ + stubs_;
+            } else if (*sym_name(i)) {
+                v = kexport_lookup(sym_name(i));
+                if (!v && bind != STB_WEAK) {
+                    fail("unresolved symbol", sym_name(i));
+                    err = -ENOENT;
+                }
+            }
+        } else if (s.st_shndx == SHN_ABS) {
+            v = s.st_value;
+        } else if (s.st_shndx >= eh_->e_shnum) {
+            fail("unsupported symbol section for", sym_name(i));
+            return -ENOEXEC;
+        } else if (loaded(s.st_shndx)) {
+            v = base_ + offset_[s.st_shndx] + s.st_value;
+            if (bind == STB_GLOBAL && !strcmp(sym_name(i), "module_init")) {
+                init_ = v;
+            }
+        }
+        value_[i] = v;
+    }
+    return err;
+}
+
+uintptr_t Loader::stub(uint32_t sym)
+{
+    if (!stub_of_[sym]) {
+        if (stub_used_ == stub_count_) {
+            return 0;
+        }
+        uintptr_t p = base_ + stubs_ + (uint64_t)stub_used_ * STUB_SIZE;
+        memcpy(reinterpret_cast<void*>(p), STUB_CODE, sizeof(STUB_CODE));
+        write64(p + STUB_SLOT, value_[sym]);
+        stub_of_[sym] = ++stub_used_;
+    }
+    return base_ + stubs_ + (uint64_t)(stub_of_[sym] - 1) * STUB_SIZE;
+}
+
+#if defined(__x86_64__)
+
+int Loader::apply(uint32_t type, uintptr_t p, uint64_t room, uint32_t sym, int64_t addend)
+{
+    uint64_t s = value_[sym];
+    uint64_t width = type == R_X86_64_64 || type == R_X86_64_PC64 ? 8 : 4;
+    if (type != R_X86_64_NONE && room < width) {
+        return -ENOEXEC;
+    }
+
+    switch (type) {
+    case R_X86_64_NONE:
+        return 0;
+    case R_X86_64_64:
+        write64(p, s + addend);
+        return 0;
+    case R_X86_64_PC64:
+        write64(p, s + addend - p);
+        return 0;
+    case R_X86_64_32:
+        if (s + addend > UINT32_MAX) {
+            return -ERANGE;
+        }
+        write32(p, (uint32_t)(s + addend));
+        return 0;
+    case R_X86_64_32S:
+        if (!fits_s32((int64_t)(s + addend))) {
+            return -ERANGE;
+        }
+        write32(p, (uint32_t)(s + addend));
+        return 0;
+    case R_X86_64_PC32:
+    case R_X86_64_PLT32: {
+        int64_t d = (int64_t)(s + addend - p);
+        if (!fits_s32(d) && type == R_X86_64_PLT32) {
+            uintptr_t t = stub(sym);
+            d = t ? (int64_t)(t + addend - p) : d;
+        }
+        if (!fits_s32(d)) {
+            return -ERANGE;
+        }
+        write32(p, (uint32_t)d);
+        return 0;
+    }
+    case R_X86_64_GOTPCREL:
+    case R_X86_64_GOTPCRELX:
+    case R_X86_64_REX_GOTPCRELX: {
+        uintptr_t t = stub(sym);
+        if (!t) {
+            return -ERANGE;
+        }
+        write32(p, (uint32_t)(t + STUB_SLOT + addend - p));
+        return 0;
+    }
+    default:
+        return -ENOEXEC;
+    }
+}
+
+#elif defined(__aarch64__)
+
+inline bool fits_signed(int64_t v, unsigned bits)
+{
+    return v >= -(1LL << (bits - 1)) && v < (1LL << (bits - 1));
+}
+
+inline int64_t page_delta(uint64_t target, uint64_t p)
+{
+    return (int64_t)((target & ~0xFFFULL) - (p & ~0xFFFULL));
+}
+
+// ADRP的21位页偏移分成immlo(位29-30)和immhi(位5-23)
+inline uint32_t set_adrp(uint32_t insn, int64_t pages)
+{
+    uint32_t imm = (uint32_t)pages & 0x1FFFFF;
+    return (insn & ~((3u << 29) | (0x7FFFFu << 5))) | ((imm & 3) << 29) | ((imm >> 2) << 5);
+}
+
+inline uint32_t set_imm12(uint32_t insn, uint64_t v)
+{
+    return (insn & ~(0xFFFu << 10)) | (uint32_t)((v & 0xFFF) << 10);
+}
+
+int Loader::apply(uint32_t type, uintptr_t p, uint64_t room, uint32_t sym, int64_t addend)
+{
+    uint64_t s = value_[sym];
+    uint64_t x = s + addend;
+    uint64_t width = type == R_AARCH64_ABS64 || type == R_AARCH64_PREL64 ? 8 : 4;
+    if (type != R_AARCH64_NONE && room < width) {
+        return -ENOEXEC;
+    }
+
+    switch (type) {
+    case R_AARCH64_NONE:
+        return 0;
+    case R_AARCH64_ABS64:
+        write64(p, x);
+        return 0;
+    case R_AARCH64_PREL64:
+        write64(p, x - p);
+        return 0;
+    case R_AARCH64_ABS32:
+        if ((int64_t)x < INT32_MIN || x > UINT32_MAX) {
+            return -ERANGE;
+        }
+        write32(p, (uint32_t)x);
+        return 0;
+    case R_AARCH64_PREL32:
+        if (!fits_s32((int64_t)(x - p))) {
+            return -ERANGE;
+        }
+        write32(p, (uint32_t)(x - p));
+        return 0;
+    case R_AARCH64_ADR_PREL_PG_HI21:
+    case R_AARCH64_ADR_PREL_PG_HI21_NC: {
+        int64_t pages = page_delta(x, p) >> 12;
+        if (type == R_AARCH64_ADR_PREL_PG_HI21 && !fits_signed(pages, 21)) {
+            return -ERANGE;
+        }
+        write32(p, set_adrp(read32(p), pages));
+        return 0;
+    }
+    case R_AARCH64_ADD_ABS_LO12_NC:
+    case R_AARCH64_LDST8_ABS_LO12_NC:
+        write32(p, set_imm12(read32(p), x));
+        return 0;
+    case R_AARCH64_LDST16_ABS_LO12_NC:
+        write32(p, set_imm12(read32(p), (x & 0xFFF) >> 1));
+        return 0;
+    case R_AARCH64_LDST32_ABS_LO12_NC:
+        write32(p, set_imm12(read32(p), (x & 0xFFF) >> 2));
+        return 0;
+    case R_AARCH64_LDST64_ABS_LO12_NC:
+        write32(p, set_imm12(read32(p), (x & 0xFFF) >> 3));
+        return 0;
+    case R_AARCH64_LDST128_ABS_LO12_NC:
+        write32(p, set_imm12(read32(p), (x & 0xFFF) >> 4));
+        return 0;
+    case R_AARCH64_JUMP26:
+    case R_AARCH64_CALL26: {
+        int64_t d = (int64_t)(x - p);
+        if (!fits_signed(d, 28) && addend == 0) {
+            uintptr_t t = stub(sym);
+            d = t ? (int64_t)(t - p) : d;
+        }
+        if (!fits_signed(d, 28)) {
+            return -ERANGE;
+        }
+        write32(p, (read32(p) & 0xFC000000) | (uint32_t)((d >> 2) & 0x3FFFFFF));
+        return 0;
+    }
+    case R_AARCH64_CONDBR19: {
+        int64_t d = (int64_t)(x - p);
+        if (!fits_signed(d, 21)) {
+            return -ERANGE;
+        }
+        write32(p, (read32(p) & ~(0x7FFFFu << 5)) | (uint32_t)(((d >> 2) & 0x7FFFF) << 5));
+        return 0;
+    }
+    case R_AARCH64_TSTBR14: {
+        int64_t d = (int64_t)(x - p);
+        if (!fits_signed(d, 16)) {
+            return -ERANGE;
+        }
+        write32(p, (read32(p) & ~(0x3FFFu << 5)) | (uint32_t)(((d >> 2) & 0x3FFF) << 5));
+        return 0;
+    }
+    case R_AARCH64_ADR_GOT_PAGE:
+    case R_AARCH64_LD64_GOT_LO12_NC: {
+        uintptr_t t = stub(sym);
+        if (!t) {
+            return -ERANGE;
+        }
+        uint64_t slot = t + STUB_SLOT;
+        uint32_t insn = read32(p);
+        write32(p, type == R_AARCH64_ADR_GOT_PAGE ? set_adrp(insn, page_delta(slot, p) >> 12)
+                                                  : set_imm12(insn, (slot & 0xFFF) >> 3));
+        return 0;
+    }
+    default:
+        return -ENOEXEC;
+    }
+}
+
+#endif
+
+// 全部重定位一遍完成，每一项只做一次下标取值和一次写入
+int Loader::relocate()
+{
+    for (uint32_t i = 0; i < eh_->e_shnum; i++) {
+        const Elf64_Shdr& rs = sh_[i];
+        if (rs.sh_type != SHT_RELA || rs.sh_info >= eh_->e_shnum || !loaded(rs.sh_info)) {
+            continue;
+        }
+        if (rs.sh_link != symtab_ || rs.sh_entsize != sizeof(Elf64_Rela)) {
+            fail("bad relocation section", shstr_ + rs.sh_name);
+            return -ENOEXEC;
+        }
+        const Elf64_Shdr& target = sh_[rs.sh_info];
+        uintptr_t sec = base_ + offset_[rs.sh_info];
+        const Elf64_Rela* r = reinterpret_cast<const Elf64_Rela*>(image_ + rs.sh_offset);
+        size_t count = rs.sh_size / sizeof(Elf64_Rela);
+        for (size_t k = 0; k < count; k++) {
+            uint32_t sym = elf64_r_sym(r[k].r_info);
+            uint32_t type = elf64_r_type(r[k].r_info);
+            if (sym >= nsyms_ || r[k].r_offset >= target.sh_size) {
+                fail("bad relocation in", shstr_ + rs.sh_name);
+                return -ENOEXEC;
+            }
+            int err = apply(type, sec + r[k].r_offset, target.sh_size - r[k].r_offset, sym, r[k].r_addend);
+            if (err) {
+                console::Line().str("module ").str(name_).str(": relocation type ").num((int64_t)type)
+                    .str(err == -ERANGE ? " out of range for " : " not supported for ")
+                    .str(*sym_name(sym) ? sym_name(sym) : "<section>").print();
+                return err;
+            }
+        }
+        relocs_ += (uint32_t)count;
+    }
+    return 0;
+}
+
+// 代码和跳板所在的页可执行，数据页不可执行(区域中的页可能曾属于加载失败的模块)。
+// 覆盖映像的大页映射在这里被拆成4K页
+int Loader::protect()
+{
+    mm::AddressSpace* as = mm::AddressSpace::kernel();
+    uint64_t text_end = align_up(text_size_, mm::PAGE_SIZE);
+    for (uint64_t off = 0; off < image_size_; off += mm::PAGE_SIZE) {
+        int err = as ? as->set_exec(base_ + off, off < text_end) : -ENOMEM;
+        if (err) {
+            fail("cannot set page permissions");
+            return err;
+        }
+    }
+    return 0;
+}
+
+int Loader::load(Module** out)
+{
+    uint64_t start = clock_ns();
+    int err = check();
+    if (!err) {
+        err = layout();
+    }
+    if (!err) {
+        err = resolve();
+    }
+    if (!err) {
+        err = relocate();
+    }
+    if (!err) {
+        err = protect();
+    }
+
+    Module* m = nullptr;
+    const KernelExport* exports = nullptr;
+    size_t export_count = 0;
+    if (!err) {
+        for (uint32_t i = 0; i < eh_->e_shnum; i++) {
+            if (loaded(i) && !strcmp(shstr_ + sh_[i].sh_name, "kexports")) {
+                exports = reinterpret_cast<const KernelExport*>(base_ + offset_[i]);
+                export_count = sh_[i].sh_size / sizeof(KernelExport);
+            }
+        }
+        m = knew<Module>();
+        err = m ? kexport_add(exports, exports + export_count) : -ENOMEM;
+        if (err == -EEXIST) {
+            fail("exports a symbol that already exists");
+        }
+    }
+    if (err) {
+        kdelete(m);
+        if (base_) {
+            region_free(base_, image_size_);
+        }
+        return err;
+    }
+    arch::sync_code(base_, base_, text_size_);
+    uint64_t elapsed = clock_ns() - start;
+
+    // C++全局构造函数，然后是模块的初始化函数
+    for (uint32_t i = 0; i < eh_->e_shnum && !err; i++) {
+        if (loaded(i) && sh_[i].sh_type == SHT_INIT_ARRAY) {
+            typedef void (*ctor_fn)();
+            const ctor_fn* fn = reinterpret_cast<const ctor_fn*>(base_ + offset_[i]);
+            for (size_t k = 0; k < sh_[i].sh_size / sizeof(ctor_fn); k++) {
+                fn[k]();
+            }
+        }
+    }
+    if (init_) {
+        err = reinterpret_cast<int (*)()>(init_)();
+    }
+    if (err) {
+        console::Line().str("module ").str(name_).str(": module_init failed (").num(err).str(")").print();
+        kexport_remove(exports, exports + export_count);
+        kdelete(m);
+        region_free(base_, image_size_);
+        return err;
+    }
+
+    size_t len = strlen(name_);
+    len = len < MODULE_NAME_LEN - 1 ? len : MODULE_NAME_LEN - 1;
+    memcpy(m->name, name_, len);
+    m->name[len] = 0;
+    m->base = base_;
+    m->text_size = text_size_;
+    m->size = image_size_;
+    m->exports = exports;
+    m->export_count = export_count;
+    {
+        SpinGuard guard(g_lock);
+        m->next = g_modules;
+        g_modules = m;
+    }
+
+    console::Line().str("module ").str(m->name).str(" at ").hex(base_).str(": ")
+        .num((int64_t)text_size_).str(" bytes text, ").num((int64_t)(image_size_ - align_up(text_size_, mm::PAGE_SIZE)))
+        .str(" bytes data, ").num((int64_t)relocs_).str(" relocations, ").num((int64_t)stub_used_)
+        .str(" stubs, ").num((int64_t)export_count).str(" exports, loaded in ").num((int64_t)(elapsed / 1000))
+        .str(" us").print();
+    if (out) {
+        *out = m;
+    }
+    return 0;
+}
+
+// 启动时加载根文件系统中 /lib/modules 下的全部 .ko
+int __init load_boot_modules()
+{
+    static const char dir_path[] = "/lib/modules";
+    fs::Inode* dir = fs::resolve(dir_path);
+    if (!dir || !dir->is_dir()) {
+        return 0;
+    }
+    uint64_t cookie = 0;
+    fs::DirEntry ent;
+    while (dir->readdir(&cookie, &ent) == 1) {
+        size_t len = strlen(ent.name);
+        if (ent.type != fs::NodeType::File || len < 4 || strcmp(ent.name + len - 3, ".ko")) {
+            continue;
+        }
+        char path[sizeof(dir_path) + fs::NAME_MAX + 1];
+        memcpy(path, dir_path, sizeof(dir_path) - 1);
+        path[sizeof(dir_path) - 1] = '/';
+        memcpy(path + sizeof(dir_path), ent.name, len + 1);
+        module_load_file(path);
+    }
+    return 0;
+}
+late_initcall(load_boot_modules);
+
+} // namespace
+
+int module_load(const char* name, const void* image, size_t size, Module** out)
+{
+    if (module_find(name)) {
+        return -EEXIST;
+    }
+    Loader loader(name, image, size);
+    return loader.load(out);
+}
+
+int module_load_file(const char* path, Module** out)
+{
+    fs::Inode* node = fs::resolve(path);
+    if (!node) {
+        return -ENOENT;
+    }
+    if (node->is_dir()) {
+        return -EISDIR;
+    }
+
+    // 模块名: 文件名去掉扩展名
+    const char* base = path;
+    for (const char* p = path; *p; p++) {
+        if (*p == '/') {
+            base = p + 1;
+        }
+    }
+    char name[MODULE_NAME_LEN];
+    size_t len = 0;
+    while (base[len] && base[len] != '.' && len < MODULE_NAME_LEN - 1) {
+        name[len] = base[len];
+        len++;
+    }
+    name[len] = 0;
+
+    // 常驻内存的文件(initrd)直接使用，否则读入临时缓冲区
+    const void* image = node->direct(0, node->size);
+    void* buf = nullptr;
+    if (!image) {
+        buf = kmalloc(node->size);
+        if (!buf) {
+            return -ENOMEM;
+        }
+        int64_t n = node->read(0, buf, node->size);
+        if (n != (int64_t)node->size) {
+            kfree(buf);
+            return n < 0 ? (int)n : -EIO;
+        }
+        image = buf;
+    }
+    int err = module_load(name, image, node->size, out);
+    kfree(buf);
+    return err;
+}
+
+Module* module_find(const char* name)
+{
+    SpinGuard guard(g_lock);
+    for (Module* m = g_modules; m; m = m->next) {
+        if (!strcmp(m->name, name)) {
+            return m;
+        }
+    }
+    return nullptr;
+}
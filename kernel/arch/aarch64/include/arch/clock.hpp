@@ -0,0 +1,46 @@
+/**
+ * leafOS - aarch64 时间计数器
+ * 以通用定时器的虚拟计数器CNTVCT_EL0为时间源，频率由固件写入CNTFRQ_EL0
+ */
+
+#pragma once
+#ifndef __LEAFOS_ARCH_CLOCK_H__
+#define __LEAFOS_ARCH_CLOCK_H__
+
+#include <stdint.h>
+
+namespace arch {
+
+static inline uint64_t read_counter()
+{
+    uint64_t v;
+    // isb保证计数器不会早于前面的指令被读取
+    __asm__ __volatile__("isb; mrs %0, cntvct_el0" : "=r"(v) :: "memory");
+    return v;
+}
+
+// 测量一段代码时的起止读数: 前后两个isb保证被测代码既不会提前到读数之前，
+// 也不会拖到读数之后才执行
+static inline uint64_t read_counter_serialized()
+{
+    uint64_t v;
+    __asm__ __volatile__("isb; mrs %0, cntvct_el0; isb" : "=r"(v) :: "memory");
+    return v;
+}
+
+static inline uint64_t counter_hz_hint()
+{
+    uint64_t v;
+    __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r"(v));
+    return v;
+}
+
+// CNTFRQ_EL0总是有效，不需要校准
+static inline uint64_t calibrate_counter()
+{
+    return counter_hz_hint();
+}
+
+} // namespace arch
+
+#endif // __LEAFOS_ARCH_CLOCK_H__
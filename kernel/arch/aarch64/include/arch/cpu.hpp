@@ -0,0 +1,87 @@
+/**
+ * leafOS - aarch64 CPU标识与每CPU数据
+ */
+
+#pragma once
+#ifndef __LEAFOS_ARCH_CPU_H__
+#define __LEAFOS_ARCH_CPU_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace arch {
+
+// 当前CPU的MPIDR_EL1亲和度0字段
+static inline uint32_t cpu_id()
+{
+    uint64_t v;
+    __asm__ __volatile__("mrs %0, mpidr_el1" : "=r"(v));
+    return (uint32_t)(v & 0xFF);
+}
+
+// 每CPU数据: TPIDR_EL1指向当前CPU的数据块。与x86一致，块的第一个字是块自己的地址。
+// 某个CPU调用set_cpu_local之前，它上面的cpu_local没有意义
+static inline void set_cpu_local(void* p)
+{
+    __asm__ __volatile__("msr tpidr_el1, %0" :: "r"(p) : "memory");
+}
+
+static inline void* cpu_local()
+{
+    void* p;
+    __asm__ __volatile__("mrs %0, tpidr_el1" : "=r"(p));
+    return p;
+}
+
+// 经别名alias改写了va处的len字节代码之后调用(别名必须仍然有效):
+// 经别名把数据缓存清理到统一点，再按原地址作废指令缓存
+static inline void sync_code(uintptr_t alias, uintptr_t va, size_t len)
+{
+    uint64_t ctr;
+    __asm__ __volatile__("mrs %0, ctr_el0" : "=r"(ctr));
+    uintptr_t dline = 4u << ((ctr >> 16) & 0xF);
+    uintptr_t iline = 4u << (ctr & 0xF);
+    for (uintptr_t p = alias & ~(dline - 1); p < alias + len; p += dline) {
+        __asm__ __volatile__("dc cvau, %0" :: "r"(p) : "memory");
+    }
+    __asm__ __volatile__("dsb ish" ::: "memory");
+    for (uintptr_t p = va & ~(iline - 1); p < va + len; p += iline) {
+        __asm__ __volatile__("ic ivau, %0" :: "r"(p) : "memory");
+    }
+    __asm__ __volatile__("dsb ish\n"
+                         "isb" ::: "memory");
+}
+
+// IRQ的开关。irq_save屏蔽IRQ并返回原来的DAIF，交给irq_restore恢复
+static inline void irq_enable()
+{
+    __asm__ __volatile__("msr daifclr, #2" ::: "memory");
+}
+
+static inline void irq_disable()
+{
+    __asm__ __volatile__("msr daifset, #2" ::: "memory");
+}
+
+static inline unsigned long irq_save()
+{
+    unsigned long flags;
+    __asm__ __volatile__("mrs %0, daif; msr daifset, #2" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void irq_restore(unsigned long flags)
+{
+    __asm__ __volatile__("msr daif, %0" :: "r"(flags) : "memory");
+}
+
+// 屏蔽IRQ时调用: 等到下一个中断并处理它，返回时仍屏蔽IRQ。
+// 屏蔽状态下挂起的中断同样能唤醒wfi，之后短暂解除屏蔽让它进入处理
+static inline void wait_for_interrupt()
+{
+    __asm__ __volatile__("wfi; msr daifclr, #2; isb; msr daifset, #2" ::: "memory");
+}
+
+} // namespace arch
+
+#endif // __LEAFOS_ARCH_CPU_H__
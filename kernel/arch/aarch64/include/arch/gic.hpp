@@ -0,0 +1,138 @@
+/**
+ * leafOS - aarch64 中断控制器
+ * QEMU virt机型的GIC，由固件完成初始化。GICv3(-M virt,gic-version=3)经系统寄存器
+ * 访问CPU接口，PPI在本CPU的重分发器中设置；GICv2(默认)全部通过MMIO。
+ * 这里只提供打开单个中断、应答和结束中断所需的最少操作
+ */
+
+#pragma once
+#ifndef __LEAFOS_ARCH_GIC_H__
+#define __LEAFOS_ARCH_GIC_H__
+
+#include <stdint.h>
+
+namespace arch {
+
+constexpr uintptr_t GICD_BASE = 0x08000000;
+constexpr uintptr_t GICC_BASE = 0x08010000;    // GICv2 CPU接口
+constexpr uintptr_t GICR_BASE = 0x080A0000;    // GICv3 第一个重分发器
+
+constexpr uint32_t GICD_IGROUPR    = 0x080;
+constexpr uint32_t GICD_ISENABLER  = 0x100;
+constexpr uint32_t GICD_ICENABLER  = 0x180;
+constexpr uint32_t GICD_IPRIORITYR = 0x400;
+
+constexpr uint32_t GICC_CTLR = 0x00;
+constexpr uint32_t GICC_PMR  = 0x04;
+constexpr uint32_t GICC_IAR  = 0x0C;
+constexpr uint32_t GICC_EOIR = 0x10;
+
+// 每个重分发器占两个64K帧，SGI/PPI的设置在第二帧，寄存器偏移与分发器相同
+constexpr uint32_t  GICR_TYPER  = 0x08;
+constexpr uintptr_t GICR_SGI    = 0x10000;
+constexpr uintptr_t GICR_STRIDE = 0x20000;
+constexpr uint64_t  GICR_TYPER_LAST = 1u << 4;
+
+constexpr uint32_t GIC_SPURIOUS = 1020;        // 大于等于它的中断号不需要结束
+
+static inline volatile uint32_t* gic_reg(uintptr_t base, uint32_t off)
+{
+    return reinterpret_cast<volatile uint32_t*>(base + off);
+}
+
+// CPU接口是否以系统寄存器方式工作(GICv3)
+static inline bool gic_v3()
+{
+    uint64_t pfr0;
+    __asm__ __volatile__("mrs %0, id_aa64pfr0_el1" : "=r"(pfr0));
+    if (!((pfr0 >> 24) & 0xF)) {
+        return false;
+    }
+    uint64_t sre;
+    __asm__ __volatile__("mrs %0, s3_0_c12_c12_5" : "=r"(sre));     // ICC_SRE_EL1
+    return sre & 1;
+}
+
+// 当前CPU的重分发器的SGI帧，按GICR_TYPER中的亲和度查找；找不到返回0
+static inline uintptr_t gic_redist()
+{
+    uint64_t mpidr;
+    __asm__ __volatile__("mrs %0, mpidr_el1" : "=r"(mpidr));
+    uint32_t aff = (uint32_t)(((mpidr >> 8) & 0xFF000000) | (mpidr & 0xFFFFFF));
+    for (uintptr_t rd = GICR_BASE;; rd += GICR_STRIDE) {
+        uint64_t typer = *reinterpret_cast<volatile uint64_t*>(rd + GICR_TYPER);
+        if ((uint32_t)(typer >> 32) == aff) {
+            return rd + GICR_SGI;
+        }
+        if (typer & GICR_TYPER_LAST) {
+            return 0;
+        }
+    }
+}
+
+// 打开当前CPU的CPU接口，并以给定优先级打开一个PPI(中断号16..31)
+static inline bool gic_enable_ppi(uint32_t intid, uint8_t prio)
+{
+    uint32_t bit = 1u << intid;
+    if (gic_v3()) {
+        uintptr_t sgi = gic_redist();
+        if (!sgi) {
+            return false;
+        }
+        // 单一安全状态下组1以IRQ送达，组0是FIQ
+        *gic_reg(sgi, GICD_IGROUPR) |= bit;
+        *reinterpret_cast<volatile uint8_t*>(sgi + GICD_IPRIORITYR + intid) = prio;
+        *gic_reg(sgi, GICD_ISENABLER) = bit;
+        __asm__ __volatile__("msr s3_0_c4_c6_0, %0\n"              // ICC_PMR_EL1
+                             "msr s3_0_c12_c12_7, %1\n"            // ICC_IGRPEN1_EL1
+                             "isb"
+                             :: "r"(0xFFull), "r"(1ull) : "memory");
+    } else {
+        *reinterpret_cast<volatile uint8_t*>(GICD_BASE + GICD_IPRIORITYR + intid) = prio;
+        *gic_reg(GICD_BASE, GICD_ISENABLER) = bit;
+        *gic_reg(GICC_BASE, GICC_PMR) = 0xFF;
+        *gic_reg(GICC_BASE, GICC_CTLR) |= 1;
+    }
+    return true;
+}
+
+static inline void gic_disable(uint32_t intid)
+{
+    uint32_t bit = 1u << (intid & 31);
+    if (intid < 32 && gic_v3()) {
+        uintptr_t sgi = gic_redist();
+        if (sgi) {
+            *gic_reg(sgi, GICD_ICENABLER) = bit;
+        }
+    } else {
+        *gic_reg(GICD_BASE, GICD_ICENABLER + (intid / 32) * 4) = bit;
+    }
+}
+
+// 应答当前最高优先级的中断，返回中断号
+static inline uint32_t gic_ack()
+{
+    if (gic_v3()) {
+        uint64_t v;
+        __asm__ __volatile__("mrs %0, s3_0_c12_c12_0" : "=r"(v));  // ICC_IAR1_EL1
+        return (uint32_t)v & 0xFFFFFF;
+    }
+    return *gic_reg(GICC_BASE, GICC_IAR) & 0x3FF;
+}
+
+static inline void gic_eoi(uint32_t intid)
+{
+    if (intid >= GIC_SPURIOUS) {
+        return;
+    }
+    if (gic_v3()) {
+        __asm__ __volatile__("msr s3_0_c12_c12_1, %0; isb"          // ICC_EOIR1_EL1
+                             :: "r"((uint64_t)intid) : "memory");
+    } else {
+        *gic_reg(GICC_BASE, GICC_EOIR) = intid;
+    }
+}
+
+} // namespace arch
+
+#endif // __LEAFOS_ARCH_GIC_H__
@@ -0,0 +1,172 @@
+/**
+ * leafOS - aarch64 页表格式
+ * 4K粒度的VMSAv8-64页表，内核中层级编号从叶子开始: 0=L3(4K) 1=L2(2M) 2=L1(1G) 3=L0
+ *
+ * 起始层级取决于固件设置的TCR_EL1.T0SZ，内存属性索引从MAIR_EL1中查找写回类型
+ */
+
+#pragma once
+#ifndef __LEAFOS_ARCH_PAGING_H__
+#define __LEAFOS_ARCH_PAGING_H__
+
+#include <stdint.h>
+
+namespace arch {
+
+typedef uint64_t pte_t;
+
+constexpr unsigned PT_ENTRIES = 512;
+
+constexpr pte_t PTE_VALID   = 1ULL << 0;
+constexpr pte_t PTE_TABLE   = 1ULL << 1;    // L0-L2: 指向下一级表；L3: 页描述符
+constexpr pte_t PTE_AP_EL0  = 1ULL << 6;    // AP[1]: EL0可访问
+constexpr pte_t PTE_AP_RO   = 1ULL << 7;    // AP[2]: 只读
+constexpr pte_t PTE_SH_INNER = 3ULL << 8;
+constexpr pte_t PTE_AF      = 1ULL << 10;
+constexpr pte_t PTE_NG      = 1ULL << 11;
+constexpr pte_t PTE_PXN     = 1ULL << 53;
+constexpr pte_t PTE_UXN     = 1ULL << 54;
+constexpr pte_t PTE_ADDR    = 0x0000FFFFFFFFF000ULL;
+
+static inline uint64_t read_tcr()
+{
+    uint64_t v;
+    __asm__ __volatile__("mrs %0, tcr_el1" : "=r"(v));
+    return v;
+}
+
+static inline uint64_t read_mair()
+{
+    uint64_t v;
+    __asm__ __volatile__("mrs %0, mair_el1" : "=r"(v));
+    return v;
+}
+
+// 顶层页表所在的层级: T0SZ 16-24 从L0开始，25-33 从L1开始，否则从L2开始
+static inline unsigned paging_top_level()
+{
+    unsigned t0sz = read_tcr() & 0x3F;
+    return t0sz <= 24 ? 3 : (t0sz <= 33 ? 2 : 1);
+}
+
+// 固件在MAIR_EL1中配置的普通写回内存(0xFF)的索引
+static inline unsigned normal_memory_attr_index()
+{
+    uint64_t mair = read_mair();
+    for (unsigned i = 0; i < 8; i++) {
+        if (((mair >> (i * 8)) & 0xFF) == 0xFF) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+// 与x86一致的接口: 不可执行位(UXN/PXN)总是有效，不需要设置
+static inline bool paging_init()
+{
+    return true;
+}
+
+static inline uint64_t current_root()
+{
+    uint64_t v;
+    __asm__ __volatile__("mrs %0, ttbr0_el1" : "=r"(v));
+    return v & PTE_ADDR;
+}
+
+static inline void set_root(uint64_t root)
+{
+    __asm__ __volatile__("dsb ishst\n"
+                         "msr ttbr0_el1, %0\n"
+                         "isb\n"
+                         "tlbi vmalle1is\n"
+                         "dsb ish\n"
+                         "isb" :: "r"(root) : "memory");
+}
+
+static inline void flush_tlb_page(uint64_t va)
+{
+    __asm__ __volatile__("dsb ishst\n"
+                         "tlbi vaae1is, %0\n"
+                         "dsb ish\n"
+                         "isb" :: "r"(va >> 12) : "memory");
+}
+
+static inline bool pte_present(pte_t e)
+{
+    return e & PTE_VALID;
+}
+
+static inline bool pte_is_table(pte_t e, unsigned level)
+{
+    return level > 0 && (e & PTE_VALID) && (e & PTE_TABLE);
+}
+
+// 叶子表项是否允许用户访问、是否可写
+static inline bool pte_user(pte_t e)
+{
+    return e & PTE_AP_EL0;
+}
+
+static inline bool pte_writable(pte_t e)
+{
+    return !(e & PTE_AP_RO);
+}
+
+static inline uint64_t pte_addr(pte_t e)
+{
+    return e & PTE_ADDR;
+}
+
+static inline pte_t make_table(uint64_t pa)
+{
+    return (pa & PTE_ADDR) | PTE_VALID | PTE_TABLE;
+}
+
+static inline pte_t make_leaf(uint64_t pa, unsigned level, bool write, bool user, bool exec)
+{
+    pte_t e = (pa & PTE_ADDR) | PTE_VALID | PTE_AF | PTE_SH_INNER |
+              ((pte_t)normal_memory_attr_index() << 2);
+    if (level == 0) {
+        e |= PTE_TABLE;     // L3页描述符的bit 1必须为1
+    }
+    if (!write) {
+        e |= PTE_AP_RO;
+    }
+    if (user) {
+        // 用户页: 内核不可执行，非全局(按ASID区分)
+        e |= PTE_AP_EL0 | PTE_PXN | PTE_NG;
+        if (!exec) {
+            e |= PTE_UXN;
+        }
+    } else {
+        e |= PTE_UXN;
+        if (!exec) {
+            e |= PTE_PXN;
+        }
+    }
+    return e;
+}
+
+// 允许内核执行叶子表项映射的内存，其余属性不变
+static inline pte_t pte_allow_exec(pte_t e)
+{
+    return e & ~PTE_PXN;
+}
+
+static inline pte_t pte_deny_exec(pte_t e)
+{
+    return e | PTE_PXN;
+}
+
+// level级的块表项e拆成下一级页表后，映射其中偏移off处的表项，属性不变。
+// 拆到L3时描述符的bit 1要置位
+static inline pte_t pte_split(pte_t e, unsigned level, uint64_t off)
+{
+    pte_t child = ((e & PTE_ADDR) + off) | (e & ~PTE_ADDR);
+    return level == 1 ? child | PTE_TABLE : child;
+}
+
+} // namespace arch
+
+#endif // __LEAFOS_ARCH_PAGING_H__
@@ -0,0 +1,74 @@
+/**
+ * leafOS - aarch64 性能计数器
+ * PMUv3的周期计数器PMCCNTR_EL0，按64位计数；溢出时产生PMU中断(PMI)，
+ * 在QEMU virt机型上是PPI 7，即中断号23
+ */
+
+#pragma once
+#ifndef __LEAFOS_ARCH_PMU_H__
+#define __LEAFOS_ARCH_PMU_H__
+
+#include <stdint.h>
+
+namespace arch {
+
+constexpr uint32_t PMU_IRQ = 23;
+
+constexpr uint64_t PMCR_E  = 1u << 0;      // 全部计数器使能
+constexpr uint64_t PMCR_D  = 1u << 3;      // 每64个周期计一次
+constexpr uint64_t PMCR_LC = 1u << 6;      // 周期计数器在64位上溢出
+constexpr uint64_t PM_CYCLES = 1ull << 31; // 各使能/溢出寄存器中周期计数器的位
+
+// ID_AA64DFR0_EL1.PMUVer: 0为没有PMU，0xF为非标准实现
+static inline bool pmu_probe()
+{
+    uint64_t dfr0;
+    __asm__ __volatile__("mrs %0, id_aa64dfr0_el1" : "=r"(dfr0));
+    uint32_t ver = (dfr0 >> 8) & 0xF;
+    return ver != 0 && ver != 0xF;
+}
+
+static inline void pmu_start(uint64_t period)
+{
+    uint64_t pmcr;
+    __asm__ __volatile__("mrs %0, pmcr_el0" : "=r"(pmcr));
+    pmcr = (pmcr | PMCR_E | PMCR_LC) & ~PMCR_D;
+    __asm__ __volatile__("msr pmcntenclr_el0, %0\n"
+                         "msr pmcr_el0, %1\n"
+                         "msr pmccfiltr_el0, xzr\n"            // EL0和EL1都计数
+                         "msr pmovsclr_el0, %0\n"
+                         "msr pmccntr_el0, %2\n"
+                         "msr pmintenset_el1, %0\n"
+                         "msr pmcntenset_el0, %0\n"
+                         "isb"
+                         :: "r"(PM_CYCLES), "r"(pmcr), "r"(0 - period) : "memory");
+}
+
+static inline void pmu_stop()
+{
+    __asm__ __volatile__("msr pmcntenclr_el0, %0\n"
+                         "msr pmintenclr_el1, %0\n"
+                         "msr pmovsclr_el0, %0\n"
+                         "isb"
+                         :: "r"(PM_CYCLES) : "memory");
+}
+
+// 在PMI中调用: 周期计数器没有溢出返回false；否则重新装入计数值并清除溢出标志。
+// PMI是电平触发的，必须在结束中断之前清除
+static inline bool pmu_ack(uint64_t period)
+{
+    uint64_t ovs;
+    __asm__ __volatile__("mrs %0, pmovsclr_el0" : "=r"(ovs));
+    if (!(ovs & PM_CYCLES)) {
+        return false;
+    }
+    __asm__ __volatile__("msr pmccntr_el0, %1\n"
+                         "msr pmovsclr_el0, %0\n"
+                         "isb"
+                         :: "r"(PM_CYCLES), "r"(0 - period) : "memory");
+    return true;
+}
+
+} // namespace arch
+
+#endif // __LEAFOS_ARCH_PMU_H__
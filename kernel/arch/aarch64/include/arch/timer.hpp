@@ -0,0 +1,53 @@
+/**
+ * leafOS - aarch64 单次定时器
+ * 通用定时器的虚拟定时器: 到期时刻直接以CNTVCT读数写入CNTV_CVAL_EL0，
+ * 到期中断是PPI 27。处理函数要调用timer_ack关掉它，否则电平中断会一直有效
+ */
+
+#pragma once
+#ifndef __LEAFOS_ARCH_TIMER_H__
+#define __LEAFOS_ARCH_TIMER_H__
+
+#include <stdint.h>
+
+namespace arch {
+
+constexpr uint32_t TIMER_IRQ = 27;
+
+constexpr uint64_t CNTV_CTL_ENABLE = 1u << 0;
+constexpr uint64_t CNTV_CTL_IMASK  = 1u << 1;
+
+struct Timer {
+    uint64_t counter_hz;
+};
+
+static inline bool timer_init(Timer* t, uint64_t counter_hz)
+{
+    t->counter_hz = counter_hz;
+    __asm__ __volatile__("msr cntv_ctl_el0, %0; isb" :: "r"(CNTV_CTL_IMASK) : "memory");
+    return true;
+}
+
+// 在计数器读数到达deadline时产生一次中断；已经过去的时刻立即到期
+static inline void timer_arm(const Timer&, uint64_t deadline)
+{
+    __asm__ __volatile__("msr cntv_cval_el0, %0\n"
+                         "msr cntv_ctl_el0, %1\n"
+                         "isb"
+                         :: "r"(deadline), "r"(CNTV_CTL_ENABLE) : "memory");
+}
+
+// 在中断处理中调用
+static inline void timer_ack()
+{
+    __asm__ __volatile__("msr cntv_ctl_el0, %0; isb" :: "r"(CNTV_CTL_IMASK) : "memory");
+}
+
+static inline void timer_stop(const Timer&)
+{
+    timer_ack();
+}
+
+} // namespace arch
+
+#endif // __LEAFOS_ARCH_TIMER_H__
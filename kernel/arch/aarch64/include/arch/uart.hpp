@@ -0,0 +1,47 @@
+/**
+ * leafOS - aarch64 串口
+ * QEMU virt机型的PL011，固件已完成初始化并保留恒等映射，只需轮询收发
+ */
+
+#pragma once
+#ifndef __LEAFOS_ARCH_UART_H__
+#define __LEAFOS_ARCH_UART_H__
+
+#include <stdint.h>
+
+namespace arch {
+
+constexpr uintptr_t PL011_BASE = 0x09000000;
+constexpr uint32_t  PL011_DR   = 0x00;
+constexpr uint32_t  PL011_FR   = 0x18;
+constexpr uint32_t  FR_RXFE    = 1u << 4;  // 接收FIFO空
+constexpr uint32_t  FR_TXFF    = 1u << 5;  // 发送FIFO满
+
+static inline volatile uint32_t* pl011_reg(uint32_t off)
+{
+    return reinterpret_cast<volatile uint32_t*>(PL011_BASE + off);
+}
+
+static inline void uart_init()
+{
+}
+
+static inline void uart_putc(char c)
+{
+    while (*pl011_reg(PL011_FR) & FR_TXFF) {
+    }
+    *pl011_reg(PL011_DR) = (uint8_t)c;
+}
+
+// 没有收到数据时返回-1
+static inline int uart_getc()
+{
+    if (*pl011_reg(PL011_FR) & FR_RXFE) {
+        return -1;
+    }
+    return *pl011_reg(PL011_DR) & 0xFF;
+}
+
+} // namespace arch
+
+#endif // __LEAFOS_ARCH_UART_H__
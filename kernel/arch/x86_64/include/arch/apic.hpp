@@ -0,0 +1,45 @@
+/**
+ * leafOS - x86_64 本地APIC
+ * 固件已启用APIC；xAPIC模式下寄存器在IA32_APIC_BASE给出的MMIO页(恒等映射)，
+ * x2APIC模式下是从0x800起的MSR，偏移除以16即为MSR号
+ */
+
+#pragma once
+#ifndef __LEAFOS_ARCH_APIC_H__
+#define __LEAFOS_ARCH_APIC_H__
+
+#include <stdint.h>
+#include <arch/cpu.hpp>
+
+namespace arch {
+
+constexpr uint32_t MSR_APIC_BASE    = 0x1B;
+constexpr uint64_t APIC_BASE_X2APIC = 1ull << 10;
+constexpr uint64_t APIC_BASE_ADDR   = 0xFFFFFF000ull;
+
+constexpr uint32_t APIC_LVT_PMI     = 0x340;     // 性能计数器LVT
+constexpr uint32_t APIC_DM_NMI      = 4u << 8;   // 以NMI方式送达
+constexpr uint32_t APIC_LVT_MASKED  = 1u << 16;
+
+static inline void apic_write(uint32_t reg, uint32_t v)
+{
+    uint64_t base = rdmsr(MSR_APIC_BASE);
+    if (base & APIC_BASE_X2APIC) {
+        wrmsr(0x800 + (reg >> 4), v);
+    } else {
+        *reinterpret_cast<volatile uint32_t*>((base & APIC_BASE_ADDR) + reg) = v;
+    }
+}
+
+static inline uint32_t apic_read(uint32_t reg)
+{
+    uint64_t base = rdmsr(MSR_APIC_BASE);
+    if (base & APIC_BASE_X2APIC) {
+        return (uint32_t)rdmsr(0x800 + (reg >> 4));
+    }
+    return *reinterpret_cast<volatile uint32_t*>((base & APIC_BASE_ADDR) + reg);
+}
+
+} // namespace arch
+
+#endif // __LEAFOS_ARCH_APIC_H__
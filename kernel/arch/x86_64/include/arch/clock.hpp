@@ -0,0 +1,84 @@
+/**
+ * leafOS - x86_64 时间计数器
+ * 以TSC为时间源；频率优先取CPUID 0x15/0x16，拿不到时用PIT通道2校准
+ */
+
+#pragma once
+#ifndef __LEAFOS_ARCH_CLOCK_H__
+#define __LEAFOS_ARCH_CLOCK_H__
+
+#include <stdint.h>
+#include <arch/io.hpp>
+
+namespace arch {
+
+static inline uint64_t read_counter()
+{
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+// 测量一段代码时的起止读数。rdtsc本身不等待前面的指令完成，前后各加lfence:
+// 前一个等之前的指令(开始时是调用方的准备工作，结束时是被测代码)全部执行完，
+// 后一个不让其后的指令提前开始。没有用rdtscp，QEMU默认的CPU型号不支持它
+static inline uint64_t read_counter_serialized()
+{
+    uint32_t lo, hi;
+    __asm__ __volatile__("lfence; rdtsc; lfence" : "=a"(lo), "=d"(hi) :: "memory");
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline void cpuid(uint32_t leaf, uint32_t sub, uint32_t* a, uint32_t* b, uint32_t* c, uint32_t* d)
+{
+    __asm__ __volatile__("cpuid" : "=a"(*a), "=b"(*b), "=c"(*c), "=d"(*d) : "a"(leaf), "c"(sub));
+}
+
+// 从CPUID读取TSC频率，不可用时返回0
+static inline uint64_t counter_hz_hint()
+{
+    uint32_t a, b, c, d;
+    cpuid(0, 0, &a, &b, &c, &d);
+    uint32_t max_leaf = a;
+
+    if (max_leaf >= 0x15) {
+        // TSC/晶振 = EBX/EAX，ECX为晶振频率
+        cpuid(0x15, 0, &a, &b, &c, &d);
+        if (a && b && c) {
+            return (uint64_t)c * b / a;
+        }
+    }
+    if (max_leaf >= 0x16) {
+        cpuid(0x16, 0, &a, &b, &c, &d);     // EAX: 基准频率(MHz)
+        if (a & 0xFFFF) {
+            return (uint64_t)(a & 0xFFFF) * 1000000;
+        }
+    }
+    return 0;
+}
+
+// 用PIT通道2倒数约10ms，测出这段时间内TSC走了多少
+static inline uint64_t calibrate_counter()
+{
+    constexpr uint32_t PIT_HZ = 1193182;
+    constexpr uint16_t count = PIT_HZ / 100;
+
+    uint8_t gate = inb(0x61);
+    outb(0x61, (uint8_t)((gate & ~0x02) & ~0x01));  // 关扬声器，先拉低门控
+    outb(0x43, 0xB0);                               // 通道2，低/高字节，模式0
+    outb(0x42, count & 0xFF);
+    outb(0x42, count >> 8);
+
+    outb(0x61, (uint8_t)((gate & ~0x02) | 0x01));   // 门控拉高开始计数
+    uint64_t t0 = read_counter();
+    while (!(inb(0x61) & 0x20)) {
+    }
+    uint64_t t1 = read_counter();
+    outb(0x61, gate);
+
+    return (t1 - t0) * PIT_HZ / count;
+}
+
+} // namespace arch
+
+#endif // __LEAFOS_ARCH_CLOCK_H__
@@ -0,0 +1,98 @@
+/**
+ * leafOS - x86_64 CPU标识、MSR访问与每CPU数据
+ */
+
+#pragma once
+#ifndef __LEAFOS_ARCH_CPU_H__
+#define __LEAFOS_ARCH_CPU_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <arch/clock.hpp>
+
+namespace arch {
+
+// 当前CPU的初始APIC ID (CPUID.1:EBX[31:24])
+static inline uint32_t cpu_id()
+{
+    uint32_t a, b, c, d;
+    cpuid(1, 0, &a, &b, &c, &d);
+    return b >> 24;
+}
+
+static inline uint64_t rdmsr(uint32_t msr)
+{
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline void wrmsr(uint32_t msr, uint64_t v)
+{
+    __asm__ __volatile__("wrmsr" :: "c"(msr), "a"((uint32_t)v), "d"((uint32_t)(v >> 32)) : "memory");
+}
+
+constexpr uint32_t MSR_GS_BASE = 0xC0000101;
+
+// 每CPU数据: GS基址指向当前CPU的数据块，块的第一个字必须是块自己的地址，
+// 一条mov %gs:0即可取到，不像cpu_id那样执行CPUID(虚拟机中会陷入)。
+// 固件不使用GS；某个CPU调用set_cpu_local之前，它上面的cpu_local没有意义
+static inline void set_cpu_local(void* p)
+{
+    wrmsr(MSR_GS_BASE, reinterpret_cast<uintptr_t>(p));
+}
+
+static inline void* cpu_local()
+{
+    void* p;
+    __asm__ __volatile__("mov %%gs:0, %0" : "=r"(p));
+    return p;
+}
+
+// 经别名alias改写了va处的len字节代码之后调用。x86的指令缓存与数据缓存保持一致，
+// 本CPU在下一次跳转之后就执行新指令，不需要额外操作
+static inline void sync_code(uintptr_t alias, uintptr_t va, size_t len)
+{
+    (void)alias;
+    (void)va;
+    (void)len;
+    __asm__ __volatile__("" ::: "memory");
+}
+
+// 可屏蔽中断的开关。irq_save关中断并返回原来的状态，交给irq_restore恢复
+static inline void irq_enable()
+{
+    __asm__ __volatile__("sti" ::: "memory");
+}
+
+static inline void irq_disable()
+{
+    __asm__ __volatile__("cli" ::: "memory");
+}
+
+static inline unsigned long irq_save()
+{
+    unsigned long flags;
+    __asm__ __volatile__("pushf; pop %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void irq_restore(unsigned long flags)
+{
+    if (flags & (1ul << 9)) {       // RFLAGS.IF
+        irq_enable();
+    } else {
+        irq_disable();
+    }
+}
+
+// 关中断时调用: 等到下一个中断并处理它，返回时仍是关中断状态。
+// sti之后的一条指令不响应中断，中断不会落在sti与hlt之间而错过唤醒
+static inline void wait_for_interrupt()
+{
+    __asm__ __volatile__("sti; hlt; cli" ::: "memory");
+}
+
+} // namespace arch
+
+#endif // __LEAFOS_ARCH_CPU_H__
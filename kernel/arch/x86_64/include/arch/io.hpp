@@ -0,0 +1,53 @@
+/**
+ * leafOS - x86_64 端口I/O
+ */
+
+#pragma once
+#ifndef __LEAFOS_ARCH_IO_H__
+#define __LEAFOS_ARCH_IO_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+static inline void outb(uint16_t port, uint8_t val)
+{
+    __asm__ __volatile__("outb %0, %1" :: "a"(val), "Nd"(port));
+}
+
+static inline uint8_t inb(uint16_t port)
+{
+    uint8_t val;
+    __asm__ __volatile__("inb %1, %0" : "=a"(val) : "Nd"(port));
+    return val;
+}
+
+static inline void outw(uint16_t port, uint16_t val)
+{
+    __asm__ __volatile__("outw %0, %1" :: "a"(val), "Nd"(port));
+}
+
+static inline uint16_t inw(uint16_t port)
+{
+    uint16_t val;
+    __asm__ __volatile__("inw %1, %0" : "=a"(val) : "Nd"(port));
+    return val;
+}
+
+// 从同一端口连续读取 count 个16位字 (rep insw)
+static inline void insw(uint16_t port, void* buf, size_t count)
+{
+    __asm__ __volatile__("rep insw"
+                         : "+D"(buf), "+c"(count)
+                         : "d"(port)
+                         : "memory");
+}
+
+static inline void outsw(uint16_t port, const void* buf, size_t count)
+{
+    __asm__ __volatile__("rep outsw"
+                         : "+S"(buf), "+c"(count)
+                         : "d"(port)
+                         : "memory");
+}
+
+#endif // __LEAFOS_ARCH_IO_H__
@@ -0,0 +1,154 @@
+/**
+ * leafOS - x86_64 页表格式
+ * 4级页表(PML4/PDPT/PD/PT)，内核中层级编号从叶子开始: 0=PT(4K) 1=PD(2M) 2=PDPT(1G) 3=PML4
+ */
+
+#pragma once
+#ifndef __LEAFOS_ARCH_PAGING_H__
+#define __LEAFOS_ARCH_PAGING_H__
+
+#include <stdint.h>
+
+namespace arch {
+
+typedef uint64_t pte_t;
+
+constexpr unsigned PT_ENTRIES = 512;
+
+constexpr pte_t PTE_PRESENT = 1ULL << 0;
+constexpr pte_t PTE_RW      = 1ULL << 1;
+constexpr pte_t PTE_USER    = 1ULL << 2;
+constexpr pte_t PTE_HUGE    = 1ULL << 7;    // PD/PDPT级的大页
+constexpr pte_t PTE_PAT     = 1ULL << 7;    // 4K页表项的PAT位与大页标志同位
+constexpr pte_t PTE_PAT_HUGE = 1ULL << 12;  // 大页表项的PAT位
+constexpr pte_t PTE_NX      = 1ULL << 63;   // EFER.NXE打开后才有效，否则是保留位
+constexpr pte_t PTE_ADDR    = 0x000FFFFFFFFFF000ULL;
+
+// 顶层页表所在的层级
+static inline unsigned paging_top_level()
+{
+    return 3;
+}
+
+constexpr uint32_t MSR_EFER = 0xC0000080;
+constexpr uint64_t EFER_NXE = 1ULL << 11;
+
+// 每个CPU在建立页表项之前调用一次: 打开EFER.NXE，不可执行的叶子表项才能使用PTE_NX。
+// 固件不一定打开它；CPU不支持NX(CPUID 0x80000001 EDX[20])时返回false
+static inline bool paging_init()
+{
+    uint32_t a, b, c, d;
+    __asm__ __volatile__("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "a"(0x80000000), "c"(0));
+    if (a < 0x80000001) {
+        return false;
+    }
+    __asm__ __volatile__("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "a"(0x80000001), "c"(0));
+    if (!(d & (1u << 20))) {
+        return false;
+    }
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdmsr" : "=a"(lo), "=d"(hi) : "c"(MSR_EFER));
+    if (!(lo & EFER_NXE)) {
+        __asm__ __volatile__("wrmsr" :: "c"(MSR_EFER), "a"(lo | (uint32_t)EFER_NXE), "d"(hi) : "memory");
+    }
+    return true;
+}
+
+static inline uint64_t current_root()
+{
+    uint64_t cr3;
+    __asm__ __volatile__("mov %%cr3, %0" : "=r"(cr3));
+    return cr3 & PTE_ADDR;
+}
+
+static inline void set_root(uint64_t root)
+{
+    __asm__ __volatile__("mov %0, %%cr3" :: "r"(root) : "memory");
+}
+
+static inline void flush_tlb_page(uint64_t va)
+{
+    __asm__ __volatile__("invlpg (%0)" :: "r"(va) : "memory");
+}
+
+static inline bool pte_present(pte_t e)
+{
+    return e & PTE_PRESENT;
+}
+
+// 非叶子层级上的表项是否指向下一级页表(而不是大页)
+static inline bool pte_is_table(pte_t e, unsigned level)
+{
+    return level > 0 && (e & PTE_PRESENT) && !(e & PTE_HUGE);
+}
+
+// 叶子表项是否允许用户访问、是否可写
+static inline bool pte_user(pte_t e)
+{
+    return e & PTE_USER;
+}
+
+static inline bool pte_writable(pte_t e)
+{
+    return e & PTE_RW;
+}
+
+static inline uint64_t pte_addr(pte_t e)
+{
+    return e & PTE_ADDR;
+}
+
+static inline pte_t make_table(uint64_t pa)
+{
+    // 中间层给足权限，实际权限由叶子表项决定
+    return (pa & PTE_ADDR) | PTE_PRESENT | PTE_RW | PTE_USER;
+}
+
+static inline pte_t make_leaf(uint64_t pa, unsigned level, bool write, bool user, bool exec)
+{
+    pte_t e = (pa & PTE_ADDR) | PTE_PRESENT;
+    if (level > 0) {
+        e |= PTE_HUGE;
+    }
+    if (write) {
+        e |= PTE_RW;
+    }
+    if (user) {
+        e |= PTE_USER;
+    }
+    if (!exec) {
+        e |= PTE_NX;
+    }
+    return e;
+}
+
+// 去掉叶子表项的不可执行位，其余属性不变
+static inline pte_t pte_allow_exec(pte_t e)
+{
+    return e & ~PTE_NX;
+}
+
+static inline pte_t pte_deny_exec(pte_t e)
+{
+    return e | PTE_NX;
+}
+
+// level级的大页表项e拆成下一级页表后，映射其中偏移off处的表项，属性不变。
+// 拆成4K页时去掉大页标志，PAT位从第12位移到第7位
+static inline pte_t pte_split(pte_t e, unsigned level, uint64_t off)
+{
+    uint64_t pa = (e & PTE_ADDR & ~PTE_PAT_HUGE) + off;
+    pte_t attrs = e & ~PTE_ADDR;
+    if (level > 1) {
+        return pa | attrs | (e & PTE_PAT_HUGE);
+    }
+    attrs &= ~PTE_HUGE;
+    if (e & PTE_PAT_HUGE) {
+        attrs |= PTE_PAT;
+    }
+    return pa | attrs;
+}
+
+} // namespace arch
+
+#endif // __LEAFOS_ARCH_PAGING_H__
@@ -0,0 +1,80 @@
+/**
+ * leafOS - x86_64 性能计数器
+ * 只使用Intel架构性能监控(CPUID 0xA)的0号通用计数器，计未停机核心周期；
+ * 溢出经本地APIC的性能计数器LVT以NMI送达
+ */
+
+#pragma once
+#ifndef __LEAFOS_ARCH_PMU_H__
+#define __LEAFOS_ARCH_PMU_H__
+
+#include <stdint.h>
+#include <arch/clock.hpp>
+#include <arch/apic.hpp>
+
+namespace arch {
+
+constexpr uint32_t MSR_PMC0                 = 0xC1;
+constexpr uint32_t MSR_PERFEVTSEL0          = 0x186;
+constexpr uint32_t MSR_PERF_GLOBAL_STATUS   = 0x38E;
+constexpr uint32_t MSR_PERF_GLOBAL_CTRL     = 0x38F;
+constexpr uint32_t MSR_PERF_GLOBAL_OVF_CTRL = 0x390;
+
+// 事件0x3C/掩码0x00: 未停机核心周期
+constexpr uint64_t EVTSEL_CORE_CYCLES = 0x3C;
+constexpr uint64_t EVTSEL_USR = 1ull << 16;
+constexpr uint64_t EVTSEL_OS  = 1ull << 17;
+constexpr uint64_t EVTSEL_INT = 1ull << 20;    // 溢出时产生PMI
+constexpr uint64_t EVTSEL_EN  = 1ull << 22;
+
+// 需要版本2以上(有全局控制和溢出状态寄存器)，并且周期事件可用。
+// AMD和没有开放vPMU的虚拟机(包括QEMU的TCG)都不满足
+static inline bool pmu_probe()
+{
+    uint32_t a, b, c, d;
+    cpuid(0, 0, &a, &b, &c, &d);
+    if (a < 0xA) {
+        return false;
+    }
+    cpuid(0xA, 0, &a, &b, &c, &d);
+    uint32_t version = a & 0xFF;
+    uint32_t counters = (a >> 8) & 0xFF;
+    uint32_t events = (a >> 24) & 0xFF;    // EBX中有效位的个数，置位表示对应事件不可用
+    return version >= 2 && counters >= 1 && events >= 1 && !(b & 1);
+}
+
+// 计数器写入时只取低32位并做符号扩展，period必须小于2^31
+static inline void pmu_start(uint64_t period)
+{
+    wrmsr(MSR_PERF_GLOBAL_CTRL, 0);
+    wrmsr(MSR_PERFEVTSEL0, 0);
+    wrmsr(MSR_PMC0, 0 - period);
+    wrmsr(MSR_PERF_GLOBAL_OVF_CTRL, 1);
+    apic_write(APIC_LVT_PMI, APIC_DM_NMI);
+    wrmsr(MSR_PERFEVTSEL0, EVTSEL_CORE_CYCLES | EVTSEL_USR | EVTSEL_OS | EVTSEL_INT | EVTSEL_EN);
+    wrmsr(MSR_PERF_GLOBAL_CTRL, 1);
+}
+
+static inline void pmu_stop()
+{
+    wrmsr(MSR_PERF_GLOBAL_CTRL, 0);
+    wrmsr(MSR_PERFEVTSEL0, 0);
+    apic_write(APIC_LVT_PMI, APIC_LVT_MASKED);
+}
+
+// 在NMI中调用: 不是计数器溢出引起的返回false；否则重新装入计数值并返回true。
+// PMI送达时CPU会自动屏蔽LVT，这里要重新打开
+static inline bool pmu_ack(uint64_t period)
+{
+    if (!(rdmsr(MSR_PERF_GLOBAL_STATUS) & 1)) {
+        return false;
+    }
+    wrmsr(MSR_PMC0, 0 - period);
+    wrmsr(MSR_PERF_GLOBAL_OVF_CTRL, 1);
+    apic_write(APIC_LVT_PMI, APIC_DM_NMI);
+    return true;
+}
+
+} // namespace arch
+
+#endif // __LEAFOS_ARCH_PMU_H__
@@ -0,0 +1,96 @@
+/**
+ * leafOS - x86_64 单次定时器
+ * 本地APIC定时器。CPU支持TSC-deadline模式时直接把到期时刻(TSC读数)写入IA32_TSC_DEADLINE；
+ * 否则用一次性模式，按启动时相对TSC校准出的频率把剩余时间换算为APIC计数。
+ * 到期中断以TIMER_IRQ送达，处理函数要调用timer_ack
+ */
+
+#pragma once
+#ifndef __LEAFOS_ARCH_TIMER_H__
+#define __LEAFOS_ARCH_TIMER_H__
+
+#include <stdint.h>
+#include <arch/apic.hpp>
+#include <arch/clock.hpp>
+#include <arch/cpu.hpp>
+
+namespace arch {
+
+constexpr uint32_t TIMER_IRQ = 0xF0;             // IDT向量
+
+constexpr uint32_t MSR_TSC_DEADLINE     = 0x6E0;
+constexpr uint32_t APIC_EOI             = 0x0B0;
+constexpr uint32_t APIC_LVT_TIMER       = 0x320;
+constexpr uint32_t APIC_TIMER_INIT      = 0x380;
+constexpr uint32_t APIC_TIMER_CURRENT   = 0x390;
+constexpr uint32_t APIC_TIMER_DIVIDE    = 0x3E0;
+constexpr uint32_t APIC_TIMER_DEADLINE  = 2u << 17;     // LVT定时器模式
+constexpr uint32_t APIC_DIVIDE_1        = 0xB;
+
+struct Timer {
+    uint64_t counter_hz;    // TSC频率
+    uint64_t apic_hz;       // 一次性模式下APIC定时器的频率；0表示TSC-deadline模式
+    uint64_t apic_mult;     // 每个TSC周期的APIC计数，32.32定点数，换算时不做除法
+};
+
+// 选择定时器模式，一次性模式还要用约10ms校准。返回后定时器未启动
+static inline bool timer_init(Timer* t, uint64_t counter_hz)
+{
+    t->counter_hz = counter_hz;
+    t->apic_hz = 0;
+    t->apic_mult = 0;
+
+    uint32_t a, b, c, d;
+    cpuid(1, 0, &a, &b, &c, &d);
+    if (c & (1u << 24)) {
+        apic_write(APIC_LVT_TIMER, APIC_LVT_MASKED | APIC_TIMER_DEADLINE | TIMER_IRQ);
+        return true;
+    }
+
+    apic_write(APIC_TIMER_DIVIDE, APIC_DIVIDE_1);
+    apic_write(APIC_LVT_TIMER, APIC_LVT_MASKED | TIMER_IRQ);
+    apic_write(APIC_TIMER_INIT, 0xFFFFFFFF);
+    uint64_t t0 = read_counter();
+    while (read_counter() - t0 < counter_hz / 100) {
+    }
+    uint32_t left = apic_read(APIC_TIMER_CURRENT);
+    apic_write(APIC_TIMER_INIT, 0);
+    t->apic_hz = (uint64_t)(0xFFFFFFFFu - left) * 100;
+    t->apic_mult = counter_hz ? (t->apic_hz << 32) / counter_hz : 0;
+    return t->apic_mult != 0;
+}
+
+// 在计数器读数到达deadline时产生一次中断；已经过去的时刻立即到期
+static inline void timer_arm(const Timer& t, uint64_t deadline)
+{
+    if (!t.apic_hz) {
+        apic_write(APIC_LVT_TIMER, APIC_TIMER_DEADLINE | TIMER_IRQ);
+        wrmsr(MSR_TSC_DEADLINE, deadline);
+        return;
+    }
+    uint64_t now = read_counter();
+    uint64_t count = deadline > now ? (uint64_t)(((unsigned __int128)(deadline - now) * t.apic_mult) >> 32) : 0;
+    count = count ? count : 1;
+    apic_write(APIC_LVT_TIMER, TIMER_IRQ);
+    apic_write(APIC_TIMER_INIT, count < 0xFFFFFFFFu ? (uint32_t)count : 0xFFFFFFFFu);
+}
+
+// 在中断处理中调用
+static inline void timer_ack()
+{
+    apic_write(APIC_EOI, 0);
+}
+
+static inline void timer_stop(const Timer& t)
+{
+    if (!t.apic_hz) {
+        wrmsr(MSR_TSC_DEADLINE, 0);
+    } else {
+        apic_write(APIC_TIMER_INIT, 0);
+    }
+    apic_write(APIC_LVT_TIMER, APIC_LVT_MASKED | TIMER_IRQ);
+}
+
+} // namespace arch
+
+#endif // __LEAFOS_ARCH_TIMER_H__
@@ -0,0 +1,46 @@
+/**
+ * leafOS - x86_64 串口
+ * COM1上的16550兼容UART，115200 8N1，轮询收发
+ */
+
+#pragma once
+#ifndef __LEAFOS_ARCH_UART_H__
+#define __LEAFOS_ARCH_UART_H__
+
+#include <stdint.h>
+#include <arch/io.hpp>
+
+namespace arch {
+
+constexpr uint16_t COM1 = 0x3F8;
+
+static inline void uart_init()
+{
+    outb(COM1 + 1, 0x00);   // 关中断
+    outb(COM1 + 3, 0x80);   // DLAB=1，设置波特率除数
+    outb(COM1 + 0, 0x01);   // 115200
+    outb(COM1 + 1, 0x00);
+    outb(COM1 + 3, 0x03);   // 8N1
+    outb(COM1 + 2, 0xC7);   // 启用并清空FIFO
+    outb(COM1 + 4, 0x03);   // DTR/RTS
+}
+
+static inline void uart_putc(char c)
+{
+    while (!(inb(COM1 + 5) & 0x20)) {     // 等待发送保持寄存器空
+    }
+    outb(COM1, (uint8_t)c);
+}
+
+// 没有收到数据时返回-1
+static inline int uart_getc()
+{
+    if (!(inb(COM1 + 5) & 0x01)) {         // 接收数据就绪
+        return -1;
+    }
+    return inb(COM1);
+}
+
+} // namespace arch
+
+#endif // __LEAFOS_ARCH_UART_H__
@@ -0,0 +1,100 @@
+/**
+ * leafOS - 内核基本操作的微基准
+ */
+
+#include <kbench.hpp>
+
+#if defined(LEAFOS_KBENCH)
+
+#include <clock.hpp>
+#include <kheap.hpp>
+#include <kstring.hpp>
+#include <page_alloc.hpp>
+#include <spinlock.hpp>
+
+namespace {
+
+Spinlock g_bench_lock;
+uint8_t  g_src[4096] __attribute__((aligned(64)));
+uint8_t  g_dst[4096] __attribute__((aligned(64)));
+
+void clock_read(uint32_t n)
+{
+    while (n--) {
+        kbench_keep(clock_ns());
+    }
+}
+DEFINE_KBENCH(clock_read, 64);
+
+// 无竞争时加锁、解锁一次
+void spin_lock_unlock(uint32_t n)
+{
+    while (n--) {
+        g_bench_lock.lock();
+        g_bench_lock.unlock();
+    }
+}
+DEFINE_KBENCH(spin_lock_unlock, 64);
+
+void kmalloc_kfree_64(uint32_t n)
+{
+    while (n--) {
+        void* p = kmalloc(64);
+        kbench_keep(p);
+        kfree(p);
+    }
+}
+DEFINE_KBENCH(kmalloc_kfree_64, 32);
+
+void kmalloc_kfree_1k(uint32_t n)
+{
+    while (n--) {
+        void* p = kmalloc(1024);
+        kbench_keep(p);
+        kfree(p);
+    }
+}
+DEFINE_KBENCH(kmalloc_kfree_1k, 32);
+
+void alloc_free_page(uint32_t n)
+{
+    while (n--) {
+        void* p = mm::alloc_pages(0);
+        kbench_keep(p);
+        mm::free_pages(p, 0);
+    }
+}
+DEFINE_KBENCH(alloc_free_page, 32);
+
+// order 4需要逐级拆分，释放时再逐级合并
+void alloc_free_order4(uint32_t n)
+{
+    while (n--) {
+        void* p = mm::alloc_pages(4);
+        kbench_keep(p);
+        mm::free_pages(p, 4);
+    }
+}
+DEFINE_KBENCH(alloc_free_order4, 32);
+
+void memcpy_4k(uint32_t n)
+{
+    while (n--) {
+        memcpy(g_dst, g_src, sizeof(g_dst));
+        kbench_keep(g_dst[0]);
+    }
+}
+DEFINE_KBENCH(memcpy_4k, 8);
+
+void memset_4k(uint32_t n)
+{
+    while (n--) {
+        memset(g_dst, (int)n, sizeof(g_dst));
+        kbench_keep(g_dst[0]);
+    }
+}
+DEFINE_KBENCH(memset_4k, 8);
+
+} // namespace
+
+#endif // LEAFOS_KBENCH
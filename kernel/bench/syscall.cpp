@@ -0,0 +1,260 @@
+/**
+ * leafOS - 系统调用与vDSO的微基准
+ *
+ * syscall_null: 用户态程序循环执行n次空的系统调用(SYS_getpid)后以SYS_exit返回，
+ * 结果是一次进出内核的往返，目标在100 ns以内。
+ * 其余几项在用户态循环调用同一个函数: vDSO中的clock_gettime、getcpu，或者只执行
+ * 对应系统调用的包装函数，两者相比即是vDSO省下的开销。
+ * 每个样本另有一次user_call的进出和两次地址空间切换，按batch分摊
+ */
+
+#include <kbench.hpp>
+
+#if defined(LEAFOS_KBENCH)
+
+#include <arch/cpu.hpp>
+#include <clock.hpp>
+#include <kstring.hpp>
+#include <page_alloc.hpp>
+#include <syscall.hpp>
+#include <vdso.hpp>
+#include <vmm.hpp>
+
+// 用户态程序只以相对的方式访问自身，复制到任意地址都能运行；调用号直接写在指令中
+static_assert(SYS_getpid == 0 && SYS_exit == 1 && SYS_clock_gettime == 2 && SYS_getcpu == 3,
+              "update the syscall numbers in the user programs");
+
+extern "C" const char user_progs[];
+extern "C" const char user_getpid_loop[];
+extern "C" const char user_fn_loop[];
+extern "C" const char user_fn_args[];
+extern "C" const char user_sys_clock_gettime[];
+extern "C" const char user_sys_getcpu[];
+extern "C" const char user_progs_end[];
+
+// user_getpid_loop(n): 执行n次SYS_getpid
+// user_fn_loop(n): 执行n次user_fn_args[2](user_fn_args[0], user_fn_args[1])
+// user_sys_*: 系统调用的包装函数
+#if defined(__x86_64__)
+
+__asm__(R"(
+    .pushsection .rodata
+    .balign 16
+    .globl user_progs
+    .hidden user_progs
+user_progs:
+
+    .globl user_getpid_loop
+    .hidden user_getpid_loop
+user_getpid_loop:
+1:
+    mov $0, %eax
+    syscall
+    dec %rdi
+    jnz 1b
+    mov $1, %eax
+    xor %edi, %edi
+    syscall
+
+    .globl user_fn_loop
+    .hidden user_fn_loop
+user_fn_loop:
+    mov %rdi, %rbx
+1:
+    mov user_fn_args(%rip), %rdi
+    mov user_fn_args+8(%rip), %rsi
+    call *user_fn_args+16(%rip)
+    dec %rbx
+    jnz 1b
+    mov $1, %eax
+    xor %edi, %edi
+    syscall
+
+    .globl user_sys_clock_gettime
+    .hidden user_sys_clock_gettime
+user_sys_clock_gettime:
+    mov $2, %eax
+    syscall
+    ret
+
+    .globl user_sys_getcpu
+    .hidden user_sys_getcpu
+user_sys_getcpu:
+    mov $3, %eax
+    syscall
+    ret
+
+    .balign 8
+    .globl user_fn_args
+    .hidden user_fn_args
+user_fn_args:
+    .quad 0, 0, 0
+    .globl user_progs_end
+    .hidden user_progs_end
+user_progs_end:
+    .popsection
+)");
+
+#elif defined(__aarch64__)
+
+__asm__(R"(
+    .pushsection .rodata
+    .balign 16
+    .globl user_progs
+    .hidden user_progs
+user_progs:
+
+    .globl user_getpid_loop
+    .hidden user_getpid_loop
+user_getpid_loop:
+    mov x19, x0
+1:
+    mov x8, #0
+    svc #0
+    subs x19, x19, #1
+    b.ne 1b
+    mov x8, #1
+    mov x0, #0
+    svc #0
+
+    .globl user_fn_loop
+    .hidden user_fn_loop
+user_fn_loop:
+    mov x19, x0
+1:
+    ldr x0, user_fn_args
+    ldr x1, user_fn_args + 8
+    ldr x9, user_fn_args + 16
+    blr x9
+    subs x19, x19, #1
+    b.ne 1b
+    mov x8, #1
+    mov x0, #0
+    svc #0
+
+    .globl user_sys_clock_gettime
+    .hidden user_sys_clock_gettime
+user_sys_clock_gettime:
+    mov x8, #2
+    svc #0
+    ret
+
+    .globl user_sys_getcpu
+    .hidden user_sys_getcpu
+user_sys_getcpu:
+    mov x8, #3
+    svc #0
+    ret
+
+    .balign 8
+    .globl user_fn_args
+    .hidden user_fn_args
+user_fn_args:
+    .quad 0, 0, 0
+    .globl user_progs_end
+    .hidden user_progs_end
+user_progs_end:
+    .popsection
+)");
+
+#endif
+
+namespace {
+
+constexpr uint64_t CODE_VA   = mm::USER_BASE;
+constexpr uint64_t STACK_TOP = mm::USER_BASE + 2 * mm::PAGE_SIZE;   // 栈占代码后的一页
+constexpr uint64_t BUF_VA    = STACK_TOP - mm::PAGE_SIZE;           // 栈页的底部放输出参数
+
+mm::AddressSpace* g_as;
+uint64_t*         g_args;   // 代码页中user_fn_args的内核地址
+
+// 用户程序在代码页中的地址
+uint64_t user_va(const char* sym)
+{
+    return CODE_VA + (uint64_t)(sym - user_progs);
+}
+
+// 新建地址空间(自带vDSO)，放入用户程序和栈，只尝试一次，失败时这些基准不做任何事
+bool setup()
+{
+    static bool tried;
+    if (tried) {
+        return false;
+    }
+    tried = true;
+    mm::AddressSpace* as = mm::AddressSpace::create();
+    uint8_t* code = static_cast<uint8_t*>(mm::alloc_pages_zeroed(0));
+    void* stack = mm::alloc_pages_zeroed(0);
+    if (!as || !code || !stack) {
+        return false;
+    }
+    size_t len = (size_t)(user_progs_end - user_progs);
+    memcpy(code, user_progs, len);
+    if (as->map(CODE_VA, reinterpret_cast<uintptr_t>(code), mm::VM_USER | mm::VM_EXEC) ||
+        as->map(STACK_TOP - mm::PAGE_SIZE, reinterpret_cast<uintptr_t>(stack), mm::VM_USER | mm::VM_WRITE)) {
+        return false;
+    }
+    as->activate();
+    arch::sync_code(reinterpret_cast<uintptr_t>(code), CODE_VA, len);
+    mm::AddressSpace::kernel()->activate();
+    g_args = reinterpret_cast<uint64_t*>(code + (user_fn_args - user_progs));
+    g_as = as;
+    return true;
+}
+
+int64_t run(const char* prog, uint32_t n)
+{
+    g_as->activate();
+    int64_t ret = user_call(user_va(prog), STACK_TOP, n);
+    mm::AddressSpace::kernel()->activate();
+    return ret;
+}
+
+// 在用户态执行n次fn(a0, a1)
+void run_fn(uint64_t fn, uint64_t a0, uint64_t a1, uint32_t n)
+{
+    if (!n || (!g_as && !setup()) || !fn) {
+        return;
+    }
+    g_args[0] = a0;
+    g_args[1] = a1;
+    g_args[2] = fn;
+    kbench_keep(run(user_fn_loop, n));
+}
+
+void syscall_null(uint32_t n)
+{
+    if (!n || (!g_as && !setup())) {
+        return;
+    }
+    kbench_keep(run(user_getpid_loop, n));
+}
+DEFINE_KBENCH(syscall_null, 256);
+
+void clock_gettime_syscall(uint32_t n)
+{
+    run_fn(user_va(user_sys_clock_gettime), CLOCK_MONOTONIC, BUF_VA, n);
+}
+DEFINE_KBENCH(clock_gettime_syscall, 256);
+
+void clock_gettime_vdso(uint32_t n)
+{
+    run_fn(vdso_lookup("clock_gettime"), CLOCK_MONOTONIC, BUF_VA, n);
+}
+DEFINE_KBENCH(clock_gettime_vdso, 256);
+
+void getcpu_syscall(uint32_t n)
+{
+    run_fn(user_va(user_sys_getcpu), BUF_VA, 0, n);
+}
+DEFINE_KBENCH(getcpu_syscall, 256);
+
+void getcpu_vdso(uint32_t n)
+{
+    run_fn(vdso_lookup("getcpu"), BUF_VA, 0, n);
+}
+DEFINE_KBENCH(getcpu_vdso, 256);
+
+} // namespace
+
+#endif // LEAFOS_KBENCH
@@ -0,0 +1,109 @@
+/**
+ * leafOS - 单调时钟实现
+ *
+ * 计数值的零点和换算系数在clock_init之后不再改变，内核读单调时钟时直接使用，
+ * 不经过seq；只有挂钟的基准会被修改
+ */
+
+#include <clock.hpp>
+#include <arch/clock.hpp>
+#include <arch/cpu.hpp>
+#include <init.hpp>
+#include <page_alloc.hpp>
+#include <spinlock.hpp>
+
+namespace {
+
+uint64_t g_hz;
+
+// 只读映射给用户态的一整页
+union {
+    ClockPage data;
+    uint8_t   bytes[mm::PAGE_SIZE];
+} g_page __attribute__((aligned(mm::PAGE_SIZE)));
+
+Spinlock g_write_lock;      // 写者之间互斥
+
+ClockPage& page()
+{
+    return g_page.data;
+}
+
+// 关中断写，本CPU上的读者不会插在更新中途而一直重读
+unsigned long write_begin()
+{
+    unsigned long flags = arch::irq_save();
+    g_write_lock.lock();
+    __atomic_store_n(&page().seq, page().seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return flags;
+}
+
+void write_end(unsigned long flags)
+{
+    __atomic_store_n(&page().seq, page().seq + 1, __ATOMIC_RELEASE);
+    g_write_lock.unlock();
+    arch::irq_restore(flags);
+}
+
+} // namespace
+
+void __init clock_init()
+{
+    // 启动服务阶段可能已为计时加载过程初始化过，保持同一个零点
+    if (g_hz) {
+        return;
+    }
+    g_hz = arch::counter_hz_hint();
+    if (!g_hz) {
+        g_hz = arch::calibrate_counter();
+    }
+    unsigned long flags = write_begin();
+    page().mult = (uint64_t)(((unsigned __int128)1000000000 << 32) / g_hz);
+    page().cycle_base = arch::read_counter();
+    write_end(flags);
+}
+
+uint64_t clock_hz()
+{
+    return g_hz;
+}
+
+uint64_t clock_cycles()
+{
+    return arch::read_counter();
+}
+
+uint64_t clock_cycles_to_ns(uint64_t cycles)
+{
+    return (uint64_t)(((unsigned __int128)cycles * page().mult) >> 32);
+}
+
+uint64_t clock_ns()
+{
+    return clock_cycles_to_ns(arch::read_counter() - page().cycle_base);
+}
+
+uint64_t clock_realtime_ns()
+{
+    uint32_t seq;
+    uint64_t base;
+    do {
+        seq = __atomic_load_n(&page().seq, __ATOMIC_ACQUIRE);
+        base = __atomic_load_n(&page().base_ns[CLOCK_REALTIME], __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || seq != __atomic_load_n(&page().seq, __ATOMIC_RELAXED));
+    return base + clock_ns();
+}
+
+void clock_set_realtime(uint64_t ns)
+{
+    unsigned long flags = write_begin();
+    __atomic_store_n(&page().base_ns[CLOCK_REALTIME], ns - clock_ns(), __ATOMIC_RELAXED);
+    write_end(flags);
+}
+
+const ClockPage* clock_page()
+{
+    return &page();
+}
@@ -0,0 +1,103 @@
+/**
+ * leafOS - 串口控制台实现
+ */
+
+#include <console.hpp>
+#include <arch/uart.hpp>
+#include <spinlock.hpp>
+
+namespace console {
+
+namespace {
+
+Spinlock g_lock;
+bool     g_ready;
+
+} // namespace
+
+void init()
+{
+    SpinGuard guard(g_lock);
+    if (!g_ready) {
+        arch::uart_init();
+        g_ready = true;
+    }
+}
+
+void write(const char* s, size_t len)
+{
+    SpinGuard guard(g_lock);
+    if (!g_ready) {
+        return;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] == '\n') {
+            arch::uart_putc('\r');
+        }
+        arch::uart_putc(s[i]);
+    }
+}
+
+int getc()
+{
+    SpinGuard guard(g_lock);
+    return g_ready ? arch::uart_getc() : -1;
+}
+
+Line& Line::str(const char* s)
+{
+    while (*s && len_ < CAP - 1) {
+        buf_[len_++] = *s++;
+    }
+    return *this;
+}
+
+Line& Line::num(int64_t v)
+{
+    return num(v, 0);
+}
+
+Line& Line::num(int64_t v, size_t width)
+{
+    char tmp[21];
+    size_t n = 0;
+    uint64_t u = v < 0 ? 0 - (uint64_t)v : (uint64_t)v;
+    do {
+        tmp[n++] = (char)('0' + u % 10);
+        u /= 10;
+    } while (u);
+    if (v < 0) {
+        tmp[n++] = '-';
+    }
+    while (width > n && len_ < CAP - 1) {
+        buf_[len_++] = ' ';
+        width--;
+    }
+    while (n && len_ < CAP - 1) {
+        buf_[len_++] = tmp[--n];
+    }
+    return *this;
+}
+
+Line& Line::hex(uint64_t v)
+{
+    static const char digits[] = "0123456789abcdef";
+    str("0x");
+    int shift = 60;
+    while (shift > 0 && !((v >> shift) & 0xF)) {
+        shift -= 4;
+    }
+    for (; shift >= 0 && len_ < CAP - 1; shift -= 4) {
+        buf_[len_++] = digits[(v >> shift) & 0xF];
+    }
+    return *this;
+}
+
+void Line::print()
+{
+    buf_[len_++] = '\n';
+    write(buf_, len_);
+    len_ = 0;
+}
+
+} // namespace console
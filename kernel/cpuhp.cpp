@@ -0,0 +1,186 @@
+/**
+ * leafOS - CPU热插拔实现
+ *
+ * 每个CPU的状态只由请求方和该CPU自己经原子操作交接: 请求方把ONLINE改为GOING_DOWN、
+ * 把OFFLINE改为COMING_UP，目标CPU完成步骤后写入结果状态，请求方等到结果为止
+ */
+
+#include <cpuhp.hpp>
+#include <arch/cpu.hpp>
+#include <console.hpp>
+#include <kerrno.hpp>
+#include <percpu.hpp>
+#include <spinlock.hpp>
+
+// 由链接器生成的登记表边界
+extern "C" const CpuhpStep __start_cpuhp_steps[] __attribute__((weak));
+extern "C" const CpuhpStep __stop_cpuhp_steps[] __attribute__((weak));
+
+namespace {
+
+enum : uint32_t {
+    CPU_ABSENT,         // 没有启动过
+    CPU_ONLINE,
+    CPU_GOING_DOWN,     // 已请求下线，等它在cpuhp_poll中清理
+    CPU_OFFLINE,        // 停在cpuhp_poll中
+    CPU_COMING_UP,      // 已请求上线，等它执行上线步骤
+};
+
+uint32_t g_state[MAX_CPUS];
+int      g_result[MAX_CPUS];    // 最近一次上线的结果，CPU_COMING_UP结束前写入
+uint32_t g_online;
+uint32_t g_boot_cpu;
+Spinlock g_lock;                // 同一时刻只处理一个请求
+
+// 倒序清理级别低于level的全部步骤，以及级别为level、在登记表中位于end之前的步骤
+void undo(uint32_t cpu, uint32_t level, const CpuhpStep* end)
+{
+    for (uint32_t l = level + 1; l-- > 0;) {
+        const CpuhpStep* last = l == level ? end : __stop_cpuhp_steps;
+        for (const CpuhpStep* s = last; s-- > __start_cpuhp_steps;) {
+            if (s->level == l && s->offline) {
+                s->offline(cpu);
+            }
+        }
+    }
+}
+
+int run_online(uint32_t cpu)
+{
+    for (uint32_t l = 0; l < CPUHP_LEVEL_COUNT; l++) {
+        for (const CpuhpStep* s = __start_cpuhp_steps; s < __stop_cpuhp_steps; s++) {
+            if (s->level != l || !s->online) {
+                continue;
+            }
+            int err = s->online(cpu);
+            if (err) {
+                console::Line().str("cpuhp: cpu ").num((int64_t)cpu).str(": ").str(s->name)
+                    .str(" failed (").num(err).str(")").print();
+                undo(cpu, l, s);
+                return err;
+            }
+        }
+    }
+    return 0;
+}
+
+void run_offline(uint32_t cpu)
+{
+    undo(cpu, CPUHP_LEVEL_COUNT - 1, __stop_cpuhp_steps);
+}
+
+// 停下的CPU在这里等待上线请求，上线失败时继续等待
+void park(uint32_t cpu)
+{
+    for (;;) {
+        while (__atomic_load_n(&g_state[cpu], __ATOMIC_ACQUIRE) != CPU_COMING_UP) {
+            cpu_relax();
+        }
+        int err = run_online(cpu);
+        g_result[cpu] = err;
+        if (!err) {
+            __atomic_add_fetch(&g_online, 1, __ATOMIC_RELAXED);
+            __atomic_store_n(&g_state[cpu], CPU_ONLINE, __ATOMIC_RELEASE);
+            return;
+        }
+        __atomic_store_n(&g_state[cpu], CPU_OFFLINE, __ATOMIC_RELEASE);
+    }
+}
+
+// 等到cpu离开from状态，返回新的状态
+uint32_t wait_leave(uint32_t cpu, uint32_t from)
+{
+    uint32_t s;
+    while ((s = __atomic_load_n(&g_state[cpu], __ATOMIC_ACQUIRE)) == from) {
+        cpu_relax();
+    }
+    return s;
+}
+
+} // namespace
+
+void cpuhp_init()
+{
+    g_boot_cpu = this_cpu()->cpu;
+    g_state[g_boot_cpu % MAX_CPUS] = CPU_ONLINE;
+    g_online = 1;
+}
+
+int cpuhp_online()
+{
+    uint32_t cpu = this_cpu()->cpu % MAX_CPUS;
+    if (__atomic_load_n(&g_state[cpu], __ATOMIC_ACQUIRE) != CPU_ABSENT) {
+        return -EINVAL;
+    }
+    unsigned long flags = arch::irq_save();
+    int err = run_online(cpu);
+    arch::irq_restore(flags);
+    if (!err) {
+        __atomic_add_fetch(&g_online, 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&g_state[cpu], CPU_ONLINE, __ATOMIC_RELEASE);
+    }
+    return err;
+}
+
+void cpuhp_poll()
+{
+    uint32_t cpu = this_cpu()->cpu % MAX_CPUS;
+    if (__atomic_load_n(&g_state[cpu], __ATOMIC_ACQUIRE) != CPU_GOING_DOWN) {
+        return;
+    }
+    unsigned long flags = arch::irq_save();
+    run_offline(cpu);
+    __atomic_sub_fetch(&g_online, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_state[cpu], CPU_OFFLINE, __ATOMIC_RELEASE);
+    park(cpu);
+    arch::irq_restore(flags);
+}
+
+int cpu_down(uint32_t cpu)
+{
+    if (cpu >= MAX_CPUS) {
+        return -EINVAL;
+    }
+    if (cpu == g_boot_cpu || cpu == this_cpu()->cpu) {
+        return -EBUSY;
+    }
+    SpinGuard guard(g_lock);
+    uint32_t expected = CPU_ONLINE;
+    if (!__atomic_compare_exchange_n(&g_state[cpu], &expected, CPU_GOING_DOWN, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        return -EINVAL;
+    }
+    wait_leave(cpu, CPU_GOING_DOWN);
+    console::Line().str("cpuhp: cpu ").num((int64_t)cpu).str(" offline, ")
+        .num((int64_t)num_online_cpus()).str(" online").print();
+    return 0;
+}
+
+int cpu_up(uint32_t cpu)
+{
+    if (cpu >= MAX_CPUS) {
+        return -EINVAL;
+    }
+    SpinGuard guard(g_lock);
+    uint32_t expected = CPU_OFFLINE;
+    if (!__atomic_compare_exchange_n(&g_state[cpu], &expected, CPU_COMING_UP, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        return -EINVAL;
+    }
+    if (wait_leave(cpu, CPU_COMING_UP) != CPU_ONLINE) {
+        return g_result[cpu];
+    }
+    console::Line().str("cpuhp: cpu ").num((int64_t)cpu).str(" online, ")
+        .num((int64_t)num_online_cpus()).str(" online").print();
+    return 0;
+}
+
+bool cpu_online(uint32_t cpu)
+{
+    return cpu < MAX_CPUS && __atomic_load_n(&g_state[cpu], __ATOMIC_ACQUIRE) == CPU_ONLINE;
+}
+
+uint32_t num_online_cpus()
+{
+    return __atomic_load_n(&g_online, __ATOMIC_RELAXED);
+}
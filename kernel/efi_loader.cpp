@@ -0,0 +1,648 @@
+/**
+ * leafOS - 启动服务阶段的文件加载实现
+ * 此时内核堆还没有建立，所有内存都直接向固件申请。
+ * 退出启动服务后这里的一切都不再可用，整个文件都放在init区
+ */
+
+#include <efi_loader.hpp>
+#include <init.hpp>
+#include <kerrno.hpp>
+#include <kstring.hpp>
+#include <clock.hpp>
+#include <lz4.hpp>
+#include "uefi.hpp"
+
+namespace efi {
+
+namespace {
+
+EFI_HANDLE         g_image __initdata;
+EFI_SYSTEM_TABLE*  g_st __initdata;
+EFI_BOOT_SERVICES* g_bs __initdata;
+
+int __init status_to_errno(EFI_STATUS s)
+{
+    switch (s) {
+    case EFI_SUCCESS:
+        return 0;
+    case EFI_NOT_FOUND:
+        return -ENOENT;
+    case EFI_OUT_OF_RESOURCES:
+        return -ENOMEM;
+    case EFI_INVALID_PARAMETER:
+    case EFI_BAD_BUFFER_SIZE:
+        return -EINVAL;
+    case EFI_UNSUPPORTED:
+        return -ENOSYS;
+    case EFI_NO_MEDIA:
+        return -ENXIO;
+    case EFI_ACCESS_DENIED:
+        return -EPERM;
+    default:
+        return -EIO;
+    }
+}
+
+uint64_t __init pages_for(uint64_t bytes)
+{
+    return (bytes + PAGE_SIZE - 1) / PAGE_SIZE;
+}
+
+// 打开内核映像所在卷上的文件并取得其长度
+int __init open_file(const char16_t* path, EFI_FILE_PROTOCOL** out, uint64_t* size)
+{
+    if (!g_bs) {
+        return -ENODEV;
+    }
+
+    EFI_GUID image_guid = EFI_LOADED_IMAGE_PROTOCOL_GUID;
+    EFI_GUID fs_guid = EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_GUID;
+    EFI_GUID info_guid = EFI_FILE_INFO_ID;
+
+    EFI_LOADED_IMAGE_PROTOCOL* image = nullptr;
+    EFI_STATUS s = g_bs->HandleProtocol(g_image, &image_guid, reinterpret_cast<VOID**>(&image));
+    if (EFI_ERROR(s)) {
+        return status_to_errno(s);
+    }
+
+    // 从内存缓冲区加载的映像(如经解压器启动的内核)没有所在设备，改用父映像的卷
+    EFI_HANDLE device = image->DeviceHandle;
+    if (!device && image->ParentHandle) {
+        EFI_LOADED_IMAGE_PROTOCOL* parent = nullptr;
+        s = g_bs->HandleProtocol(image->ParentHandle, &image_guid, reinterpret_cast<VOID**>(&parent));
+        if (!EFI_ERROR(s)) {
+            device = parent->DeviceHandle;
+        }
+    }
+
+    EFI_SIMPLE_FILE_SYSTEM_PROTOCOL* volume = nullptr;
+    s = g_bs->HandleProtocol(device, &fs_guid, reinterpret_cast<VOID**>(&volume));
+    if (EFI_ERROR(s)) {
+        return status_to_errno(s);
+    }
+
+    EFI_FILE_PROTOCOL* root = nullptr;
+    s = volume->OpenVolume(volume, &root);
+    if (EFI_ERROR(s)) {
+        return status_to_errno(s);
+    }
+
+    EFI_FILE_PROTOCOL* file = nullptr;
+    s = root->Open(root, &file, const_cast<CHAR16*>(path), EFI_FILE_MODE_READ, 0);
+    root->Close(root);
+    if (EFI_ERROR(s)) {
+        return status_to_errno(s);
+    }
+
+    // EFI_FILE_INFO末尾是变长的文件名，先用栈上的缓冲区试一次
+    alignas(8) UINT8 local[sizeof(EFI_FILE_INFO) + 128 * sizeof(CHAR16)];
+    VOID* buf = local;
+    UINTN len = sizeof(local);
+    s = file->GetInfo(file, &info_guid, &len, buf);
+    if (s == EFI_BUFFER_TOO_SMALL) {
+        s = g_bs->AllocatePool(EfiLoaderData, len, &buf);
+        if (!EFI_ERROR(s)) {
+            s = file->GetInfo(file, &info_guid, &len, buf);
+        } else {
+            buf = local;
+        }
+    }
+
+    int err = status_to_errno(s);
+    if (!err) {
+        const EFI_FILE_INFO* info = static_cast<const EFI_FILE_INFO*>(buf);
+        if (info->Attribute & EFI_FILE_DIRECTORY) {
+            err = -EISDIR;
+        }
+        *size = info->FileSize;
+    }
+    if (buf != local) {
+        g_bs->FreePool(buf);
+    }
+
+    if (err) {
+        file->Close(file);
+        return err;
+    }
+    *out = file;
+    return 0;
+}
+
+// 同步读满len字节(固件可能分几次返回)，返回读到的字节数，文件结束时可能不足len
+int64_t __init read_full(EFI_FILE_PROTOCOL* file, uint8_t* buf, uint64_t len, LoadStats* stats)
+{
+    uint64_t t0 = clock_cycles();
+    uint64_t done = 0;
+    while (done < len) {
+        UINTN n = len - done;
+        EFI_STATUS s = file->Read(file, &n, buf + done);
+        stats->reads++;
+        if (EFI_ERROR(s)) {
+            return status_to_errno(s);
+        }
+        if (!n) {
+            break;
+        }
+        done += n;
+    }
+    stats->read_ns += clock_cycles_to_ns(clock_cycles() - t0);
+    return done;
+}
+
+// 一次只有一个请求在途的读取器: issue发出读取后立即返回，complete等它结束。
+// 固件不支持ReadEx时issue只记下参数，complete里同步读取，调用方的流程不变
+class ChunkReader {
+public:
+    __init ChunkReader(EFI_FILE_PROTOCOL* file, LoadStats* stats)
+        : file_(file), stats_(stats)
+    {
+        if (file->Revision >= EFI_FILE_PROTOCOL_REVISION2 && file->ReadEx) {
+            async_ = !EFI_ERROR(g_bs->CreateEvent(0, 0, nullptr, nullptr, &event_));
+        }
+    }
+
+    __init ~ChunkReader()
+    {
+        if (event_) {
+            g_bs->CloseEvent(event_);
+        }
+    }
+
+    bool async() const { return async_; }
+
+    void __init issue(uint64_t off, uint8_t* buf, uint64_t len)
+    {
+        off_ = off;
+        buf_ = buf;
+        len_ = len;
+        error_ = 0;
+        in_flight_ = false;
+        if (!async_) {
+            return;
+        }
+
+        // 上一个请求已经完成，此时调整位置是安全的
+        EFI_STATUS s = file_->SetPosition(file_, off);
+        if (!EFI_ERROR(s)) {
+            token_.Event = event_;
+            token_.Status = EFI_SUCCESS;
+            token_.BufferSize = len;
+            token_.Buffer = buf;
+            s = file_->ReadEx(file_, &token_);
+            stats_->reads++;
+        }
+        if (s == EFI_UNSUPPORTED) {
+            // 声明了修订版2却没有实现异步读，退回同步方式
+            async_ = false;
+        } else if (EFI_ERROR(s)) {
+            error_ = status_to_errno(s);
+        } else {
+            in_flight_ = true;
+        }
+    }
+
+    // 返回读到的字节数或负错误码
+    int64_t __init complete()
+    {
+        if (error_) {
+            return error_;
+        }
+        if (!in_flight_) {
+            if (file_->SetPosition(file_, off_) != EFI_SUCCESS) {
+                return -EIO;
+            }
+            return read_full(file_, buf_, len_, stats_);
+        }
+
+        uint64_t t0 = clock_cycles();
+        UINTN index;
+        EFI_STATUS s = g_bs->WaitForEvent(1, &event_, &index);
+        in_flight_ = false;
+        stats_->read_ns += clock_cycles_to_ns(clock_cycles() - t0);
+        if (EFI_ERROR(s)) {
+            return status_to_errno(s);
+        }
+        if (EFI_ERROR(token_.Status)) {
+            return status_to_errno(token_.Status);
+        }
+        return token_.BufferSize;
+    }
+
+private:
+    EFI_FILE_PROTOCOL*  file_;
+    LoadStats*          stats_;
+    EFI_EVENT           event_ = nullptr;
+    EFI_FILE_IO_TOKEN   token_ = {};
+    bool                async_ = false;
+    bool                in_flight_ = false;
+
+    uint64_t            off_ = 0;
+    uint8_t*            buf_ = nullptr;
+    uint64_t            len_ = 0;
+    int                 error_ = 0;
+};
+
+// 边读边解压LZ4帧。压缩块常常跨越两次读取，不完整的块先拼到carry_中再解；
+// 所有块都解到同一片输出里，链接块引用的前文自然可用
+class Lz4Sink : public StreamSink {
+public:
+    __init ~Lz4Sink()
+    {
+        free_pages(carry_, carry_pages_);
+    }
+
+    int __init feed(const void* data, size_t len) override
+    {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        const uint8_t* end = p + len;
+        while (p < end) {
+            int err = step(p, end);
+            if (err) {
+                return err;
+            }
+        }
+        return 0;
+    }
+
+    int __init finish() override
+    {
+        return state_ == DONE && out_len_ == info_.content_size ? 0 : -EINVAL;
+    }
+
+    // 交出输出页，之后由调用方负责释放
+    void* __init take_output(uint64_t* size)
+    {
+        void* out = out_;
+        *size = out_len_;
+        out_ = nullptr;
+        return out;
+    }
+
+    void __init release_output()
+    {
+        free_pages(out_, out_pages_);
+        out_ = nullptr;
+    }
+
+private:
+    enum State { HEADER, BLOCK_SIZE, BLOCK, SKIP, DONE };
+
+    // 取得want字节连续的数据: 输入中已有完整的就直接返回指针，否则先攒到buf中，不够时返回nullptr
+    const uint8_t* __init gather(const uint8_t*& p, const uint8_t* end, uint8_t* buf, size_t want)
+    {
+        size_t avail = end - p;
+        if (!have_ && avail >= want) {
+            const uint8_t* r = p;
+            p += want;
+            return r;
+        }
+        size_t n = want - have_ < avail ? want - have_ : avail;
+        memcpy(buf + have_, p, n);
+        have_ += n;
+        p += n;
+        if (have_ < want) {
+            return nullptr;
+        }
+        have_ = 0;
+        return buf;
+    }
+
+    // 跳过n字节(校验和)后进入next状态；输入可能恰好在此结束，n为0时必须立即切换
+    void __init skip_then(size_t n, State next)
+    {
+        skip_ = n;
+        next_ = next;
+        state_ = n ? SKIP : next;
+    }
+
+    int __init step(const uint8_t*& p, const uint8_t* end)
+    {
+        switch (state_) {
+        case HEADER: {
+            const uint8_t* h = gather(p, end, small_, LZ4_FRAME_HEADER_SIZE);
+            if (!h) {
+                return 0;
+            }
+            if (lz4_frame_header(h, LZ4_FRAME_HEADER_SIZE, &info_) <= 0 || !info_.content_size) {
+                return -EINVAL;
+            }
+            out_pages_ = pages_for(info_.content_size);
+            out_ = static_cast<uint8_t*>(alloc_pages(out_pages_));
+            carry_pages_ = pages_for(info_.block_max);
+            carry_ = static_cast<uint8_t*>(alloc_pages(carry_pages_));
+            if (!out_ || !carry_) {
+                return -ENOMEM;
+            }
+            state_ = BLOCK_SIZE;
+            return 0;
+        }
+
+        case BLOCK_SIZE: {
+            const uint8_t* w = gather(p, end, small_, 4);
+            if (!w) {
+                return 0;
+            }
+            uint32_t word = w[0] | (w[1] << 8) | (w[2] << 16) | ((uint32_t)w[3] << 24);
+            if (!word) {
+                skip_then(info_.content_checksum ? 4 : 0, DONE);
+                return 0;
+            }
+            block_size_ = word & ~LZ4_BLOCK_UNCOMPRESSED;
+            block_raw_ = word & LZ4_BLOCK_UNCOMPRESSED;
+            if (block_size_ > info_.block_max) {
+                return -EINVAL;
+            }
+            state_ = BLOCK;
+            return 0;
+        }
+
+        case BLOCK: {
+            const uint8_t* b = gather(p, end, carry_, block_size_);
+            if (!b) {
+                return 0;
+            }
+            uint64_t room = info_.content_size - out_len_;
+            if (block_raw_) {
+                if (block_size_ > room) {
+                    return -EINVAL;
+                }
+                memcpy(out_ + out_len_, b, block_size_);
+                out_len_ += block_size_;
+            } else {
+                int64_t n = lz4_decompress_block(b, block_size_, out_ + out_len_, room, out_len_);
+                if (n < 0) {
+                    return static_cast<int>(n);
+                }
+                out_len_ += n;
+            }
+            skip_then(info_.block_checksum ? 4 : 0, BLOCK_SIZE);
+            return 0;
+        }
+
+        case SKIP: {
+            size_t n = skip_ < (size_t)(end - p) ? skip_ : end - p;
+            p += n;
+            skip_ -= n;
+            if (!skip_) {
+                state_ = next_;
+            }
+            return 0;
+        }
+
+        case DONE:
+            // 帧之后的数据忽略
+            p = end;
+            return 0;
+        }
+        return -EINVAL;
+    }
+
+    State        state_ = HEADER;
+    State        next_ = HEADER;
+    Lz4FrameInfo info_ = {};
+    uint8_t      small_[LZ4_FRAME_HEADER_SIZE];
+    size_t       have_ = 0;
+    size_t       skip_ = 0;
+    uint32_t     block_size_ = 0;
+    bool         block_raw_ = false;
+
+    uint8_t*     out_ = nullptr;
+    uint64_t     out_pages_ = 0;
+    uint64_t     out_len_ = 0;
+    uint8_t*     carry_ = nullptr;
+    uint64_t     carry_pages_ = 0;
+};
+
+// 拼一行控制台输出，超长部分丢弃
+class Line {
+public:
+    Line& __init str(const char16_t* s)
+    {
+        while (*s && len_ < CAP - 1) {
+            buf_[len_++] = *s++;
+        }
+        return *this;
+    }
+
+    Line& __init num(int64_t v)
+    {
+        if (v < 0) {
+            str(u"-");
+            v = -v;
+        }
+        char16_t tmp[21];
+        int n = 0;
+        do {
+            tmp[n++] = u'0' + (char16_t)(v % 10);
+            v /= 10;
+        } while (v);
+        while (n && len_ < CAP - 1) {
+            buf_[len_++] = tmp[--n];
+        }
+        return *this;
+    }
+
+    void __init print()
+    {
+        str(u"\r\n");
+        buf_[len_] = 0;
+        g_st->ConOut->OutputString(g_st->ConOut, buf_);
+    }
+
+private:
+    static constexpr size_t CAP = 192;
+    CHAR16 buf_[CAP];
+    size_t len_ = 0;
+};
+
+} // namespace
+
+void __init init(void* image_handle, void* system_table)
+{
+    g_image = image_handle;
+    g_st = static_cast<EFI_SYSTEM_TABLE*>(system_table);
+    g_bs = g_st->BootServices;
+}
+
+void* __init alloc_pages(uint64_t pages)
+{
+    EFI_PHYSICAL_ADDRESS addr = 0;
+    if (!g_bs || EFI_ERROR(g_bs->AllocatePages(AllocateAnyPages, EfiLoaderData, pages, &addr))) {
+        return nullptr;
+    }
+    return reinterpret_cast<void*>(addr);
+}
+
+void __init free_pages(void* p, uint64_t pages)
+{
+    if (p) {
+        g_bs->FreePages(reinterpret_cast<EFI_PHYSICAL_ADDRESS>(p), pages);
+    }
+}
+
+int __init load_file(const char16_t* path, void** data, uint64_t* size, LoadStats* stats)
+{
+    LoadStats local = {};
+    if (!stats) {
+        stats = &local;
+    }
+    *stats = LoadStats();
+    uint64_t t0 = clock_cycles();
+
+    EFI_FILE_PROTOCOL* file;
+    uint64_t len;
+    int err = open_file(path, &file, &len);
+    if (err) {
+        return err;
+    }
+    if (!len) {
+        file->Close(file);
+        return -EINVAL;
+    }
+
+    uint64_t pages = pages_for(len);
+    uint8_t* dst = static_cast<uint8_t*>(alloc_pages(pages));
+    if (!dst) {
+        file->Close(file);
+        return -ENOMEM;
+    }
+
+    // 每块的目标地址都是页对齐的，固件可以直接把扇区DMA到这里，不经过自己的缓冲
+    uint64_t off = 0;
+    while (off < len) {
+        uint64_t want = len - off < READ_CHUNK ? len - off : READ_CHUNK;
+        int64_t n = read_full(file, dst + off, want, stats);
+        if (n < 0) {
+            file->Close(file);
+            free_pages(dst, pages);
+            return static_cast<int>(n);
+        }
+        off += n;
+        if (static_cast<uint64_t>(n) < want) {
+            break;
+        }
+    }
+    file->Close(file);
+
+    stats->bytes = off;
+    stats->total_ns = clock_cycles_to_ns(clock_cycles() - t0);
+    *data = dst;
+    *size = off;
+    return 0;
+}
+
+int __init stream_file(const char16_t* path, StreamSink* sink, LoadStats* stats)
+{
+    LoadStats local = {};
+    if (!stats) {
+        stats = &local;
+    }
+    *stats = LoadStats();
+    uint64_t t0 = clock_cycles();
+
+    EFI_FILE_PROTOCOL* file;
+    uint64_t len;
+    int err = open_file(path, &file, &len);
+    if (err) {
+        return err;
+    }
+
+    // 两块交替使用的中转缓冲: 一块在被sink处理时，另一块正由固件填充
+    uint64_t chunk = pages_for(len < READ_CHUNK ? len : READ_CHUNK) * PAGE_SIZE;
+    if (!chunk) {
+        file->Close(file);
+        return sink->finish();
+    }
+    uint8_t* staging = static_cast<uint8_t*>(alloc_pages(2 * chunk / PAGE_SIZE));
+    if (!staging) {
+        file->Close(file);
+        return -ENOMEM;
+    }
+    uint8_t* bufs[2] = { staging, staging + chunk };
+
+    {
+        ChunkReader reader(file, stats);
+        uint64_t off = 0;
+        int cur = 0;
+        reader.issue(0, bufs[0], chunk);
+        for (;;) {
+            int64_t n = reader.complete();
+            if (n < 0) {
+                err = static_cast<int>(n);
+                break;
+            }
+            if (!n) {
+                break;
+            }
+            off += n;
+
+            bool more = off < len;
+            if (more) {
+                reader.issue(off, bufs[cur ^ 1], chunk);
+            }
+            uint64_t t1 = clock_cycles();
+            err = sink->feed(bufs[cur], n);
+            stats->sink_ns += clock_cycles_to_ns(clock_cycles() - t1);
+            if (err || !more) {
+                if (err && more) {
+                    // 释放缓冲前必须等在途的请求结束
+                    reader.complete();
+                }
+                break;
+            }
+            cur ^= 1;
+        }
+        stats->bytes = off;
+        stats->async = reader.async();
+    }
+
+    file->Close(file);
+    free_pages(staging, 2 * chunk / PAGE_SIZE);
+    if (!err) {
+        err = sink->finish();
+    }
+    stats->total_ns = clock_cycles_to_ns(clock_cycles() - t0);
+    return err;
+}
+
+int __init load_lz4_file(const char16_t* path, void** data, uint64_t* size, LoadStats* stats)
+{
+    Lz4Sink sink;
+    int err = stream_file(path, &sink, stats);
+    if (err) {
+        sink.release_output();
+        return err;
+    }
+    *data = sink.take_output(size);
+    return 0;
+}
+
+void __init report(const char16_t* name, const LoadStats& stats, uint64_t size)
+{
+    if (!g_st || !g_st->ConOut) {
+        return;
+    }
+
+    Line line;
+    line.str(name).str(u": ").num(stats.bytes / 1024).str(u" KiB");
+    if (size > stats.bytes && stats.bytes) {
+        line.str(u" -> ").num(size / 1024).str(u" KiB");
+    }
+    line.str(u", ").num(stats.reads).str(u" reads").str(stats.async ? u" (async)" : u"")
+        .str(u", total ").num(stats.total_ns / 1000).str(u" us");
+    line.print();
+
+    if (size > stats.bytes && stats.bytes) {
+        // 读取时间与字节数大致成正比；异步时read_ns只含等待的部分，估算偏保守
+        // 比例用16.16定点数，避免128位除法(独立环境下没有libgcc)
+        uint64_t ratio = ((size - stats.bytes) << 16) / stats.bytes;
+        uint64_t saved = (stats.read_ns * ratio) >> 16;
+        Line detail;
+        detail.str(u"  read ").num(stats.read_ns / 1000).str(u" us, decode ")
+            .num(stats.sink_ns / 1000).str(u" us, saved ~").num(saved / 1000)
+            .str(u" us of reading, net ").num(((int64_t)saved - (int64_t)stats.sink_ns) / 1000).str(u" us");
+        detail.print();
+    }
+}
+
+} // namespace efi
@@ -0,0 +1,559 @@
+/**
+ * leafOS - 函数入口跟踪实现
+ *
+ * 跟踪点在启动时按符号表查找: 入口处是编译器留下的NOP序列的函数就有跟踪点。
+ * 没有用编译器记录在__patchable_function_entries中的位置，GCC 12把同一个目标文件中
+ * 多个函数的记录放在一起，随其中被丢弃的inline函数副本一并丢弃，会漏掉函数。
+ * 本文件和在NMI/中断中运行的采样剖析(kprof.cpp)编译时不留跟踪点，见Makefile。
+ * 改写跟踪点时其他CPU尚未启动；不能以一次对齐写入改写的跟踪点(x86的5字节NOP跨8字节边界)
+ * 被跳过，这些函数不能跟踪
+ */
+
+#include <ftrace.hpp>
+
+#if defined(LEAFOS_FTRACE)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <arch/clock.hpp>
+#include <clock.hpp>
+#include <console.hpp>
+#include <cpuhp.hpp>
+#include <initcall.hpp>
+#include <kerrno.hpp>
+#include <kheap.hpp>
+#include <ksyms.hpp>
+#include <kstring.hpp>
+#include <page_alloc.hpp>
+#include <percpu.hpp>
+#include <text_patch.hpp>
+
+// 链接脚本划分的init区，其中的函数启动完成后被释放
+extern "C" char __init_begin[] __attribute__((weak));
+extern "C" char __init_end[] __attribute__((weak));
+
+// 开启的跟踪点调用的入口: 保存被跟踪函数的参数寄存器，以(入口地址, 返回到调用者的地址)
+// 调用ftrace_record，恢复后回到被跟踪函数
+extern "C" void ftrace_caller();
+
+struct FtraceEvent {
+    uint64_t  ts;           // arch::read_counter()
+    uintptr_t ip;           // 被跟踪函数的入口
+    uintptr_t parent;       // 返回到调用者中的地址
+};
+
+struct FtraceRing {
+    FtraceEvent* events;
+    uint64_t     head;      // 写入过的记录数，超过RING_SIZE后覆盖最旧的
+    uint32_t     busy;      // 正在记录；NMI打断记录时，NMI中嵌套的那一条丢弃
+    uint32_t     cpu;
+};
+
+namespace {
+
+constexpr unsigned RING_ORDER = 8;          // 每个CPU 1 MiB
+constexpr uint32_t RING_SIZE  = 1u << 15;
+static_assert(RING_SIZE * sizeof(FtraceEvent) <= (mm::PAGE_SIZE << RING_ORDER),
+              "ftrace ring does not fit");
+
+// 跟踪点的状态
+constexpr uint8_t SITE_OFF     = 0;
+constexpr uint8_t SITE_ON      = 1;
+constexpr uint8_t SITE_CLAIMED = 2;     // 由ftrace_claim交给了其他改写者
+
+uintptr_t*       g_sites;   // 有跟踪点的函数入口，按地址排序
+size_t           g_count;
+uint8_t*         g_state;
+FtraceRing       g_rings[MAX_CPUS];
+bool             g_paused;  // 输出和清空记录期间不记录，输出本身调用的函数不计入
+
+constexpr size_t CMD_LEN = 128;
+char   g_cmd[CMD_LEN];
+size_t g_cmd_len;
+bool   g_after_cr;          // 终端可能以"\r\n"结束一行，紧随\r的\n忽略
+bool   g_prompted;
+bool   g_exited;
+
+#if defined(__x86_64__)
+
+// 开启时改为call rel32，同样是5字节
+constexpr size_t SITE_SIZE = 5;
+const uint8_t NOP1[SITE_SIZE] = { 0x90, 0x90, 0x90, 0x90, 0x90 };
+const uint8_t NOP5[SITE_SIZE] = { 0x0F, 0x1F, 0x44, 0x00, 0x00 };     // nopl 0(%rax,%rax,1)
+
+// 入口是编译器留下的5个单字节NOP时，合并为一条指令，此后改写时执行到这里的CPU
+// 不会停在跟踪点中间。跨8字节边界的入口不能一次写入(text_patch.hpp)，不作为跟踪点
+bool __init prepare_site(uintptr_t site)
+{
+    if (!text_poke_atomic(site, SITE_SIZE) || memcmp(reinterpret_cast<const void*>(site), NOP1, SITE_SIZE)) {
+        return false;
+    }
+    return text_poke(reinterpret_cast<void*>(site), NOP5, SITE_SIZE) == 0;
+}
+
+int patch_site(uintptr_t site, bool on)
+{
+    uint8_t insn[SITE_SIZE];
+    if (on) {
+        int32_t rel = (int32_t)(reinterpret_cast<uintptr_t>(ftrace_caller) - (site + SITE_SIZE));
+        insn[0] = 0xE8;
+        memcpy(insn + 1, &rel, sizeof(rel));
+    } else {
+        memcpy(insn, NOP5, SITE_SIZE);
+    }
+    return text_poke(reinterpret_cast<void*>(site), insn, SITE_SIZE);
+}
+
+#elif defined(__aarch64__)
+
+// 开启时第一条NOP改为保存LR，第二条改为调用ftrace_caller
+constexpr size_t   SITE_SIZE      = 8;
+constexpr uint32_t INSN_NOP       = 0xD503201F;
+constexpr uint32_t INSN_MOV_X9_LR = 0xAA1E03E9;     // mov x9, x30
+
+uint32_t encode_bl(uintptr_t pc, uintptr_t target)
+{
+    return 0x94000000u | (uint32_t)(((target - pc) >> 2) & 0x03FFFFFF);
+}
+
+bool __init prepare_site(uintptr_t site)
+{
+    const uint32_t* insn = reinterpret_cast<const uint32_t*>(site);
+    return insn[0] == INSN_NOP && insn[1] == INSN_NOP;
+}
+
+// 每次只改一条对齐的指令: 开启时先保存LR再调用，关闭时倒过来，
+// 执行到这里的CPU看到的任何组合都是正确的
+int patch_site(uintptr_t site, bool on)
+{
+    uint32_t* insn = reinterpret_cast<uint32_t*>(site);
+    if (on) {
+        uint32_t bl = encode_bl(site + 4, reinterpret_cast<uintptr_t>(ftrace_caller));
+        int err = text_poke(insn, &INSN_MOV_X9_LR, sizeof(uint32_t));
+        return err ? err : text_poke(insn + 1, &bl, sizeof(uint32_t));
+    }
+    int err = text_poke(insn + 1, &INSN_NOP, sizeof(uint32_t));
+    return err ? err : text_poke(insn, &INSN_NOP, sizeof(uint32_t));
+}
+
+#endif
+
+} // namespace
+
+#if defined(__x86_64__)
+
+// 跟踪点调用ftrace_caller时，(%rsp)是被跟踪函数中跟踪点之后的地址，8(%rsp)是它返回到
+// 调用者的地址，栈按16字节对齐。被跟踪函数还没有执行任何指令，参数寄存器
+// (包括变参函数的%al和XMM0-7)都要保留
+__asm__(R"(
+    .pushsection .text
+    .balign 16
+    .globl ftrace_caller
+    .hidden ftrace_caller
+ftrace_caller:
+    push %rbp
+    mov %rsp, %rbp
+    push %rax
+    push %rcx
+    push %rdx
+    push %rsi
+    push %rdi
+    push %r8
+    push %r9
+    push %r10
+    push %r11
+    sub $128, %rsp
+    movdqu %xmm0, 0(%rsp)
+    movdqu %xmm1, 16(%rsp)
+    movdqu %xmm2, 32(%rsp)
+    movdqu %xmm3, 48(%rsp)
+    movdqu %xmm4, 64(%rsp)
+    movdqu %xmm5, 80(%rsp)
+    movdqu %xmm6, 96(%rsp)
+    movdqu %xmm7, 112(%rsp)
+    mov 8(%rbp), %rdi
+    sub $5, %rdi
+    mov 16(%rbp), %rsi
+    call ftrace_record
+    movdqu 0(%rsp), %xmm0
+    movdqu 16(%rsp), %xmm1
+    movdqu 32(%rsp), %xmm2
+    movdqu 48(%rsp), %xmm3
+    movdqu 64(%rsp), %xmm4
+    movdqu 80(%rsp), %xmm5
+    movdqu 96(%rsp), %xmm6
+    movdqu 112(%rsp), %xmm7
+    add $128, %rsp
+    pop %r11
+    pop %r10
+    pop %r9
+    pop %r8
+    pop %rdi
+    pop %rsi
+    pop %rdx
+    pop %rcx
+    pop %rax
+    pop %rbp
+    ret
+    .popsection
+)");
+
+#elif defined(__aarch64__)
+
+// 跟踪点调用ftrace_caller时，x30是被跟踪函数中跟踪点之后的地址，x9是被跟踪函数
+// 返回到调用者的地址。保留参数寄存器x0-x7和间接结果寄存器x8，
+// 最后把x30恢复为返回到调用者的地址，跳回被跟踪函数
+__asm__(R"(
+    .pushsection .text
+    .balign 16
+    .globl ftrace_caller
+    .hidden ftrace_caller
+ftrace_caller:
+    stp x29, x30, [sp, #-96]!
+    mov x29, sp
+    stp x0, x1, [sp, #16]
+    stp x2, x3, [sp, #32]
+    stp x4, x5, [sp, #48]
+    stp x6, x7, [sp, #64]
+    stp x8, x9, [sp, #80]
+    sub x0, x30, #8
+    mov x1, x9
+    bl ftrace_record
+    ldp x0, x1, [sp, #16]
+    ldp x2, x3, [sp, #32]
+    ldp x4, x5, [sp, #48]
+    ldp x6, x7, [sp, #64]
+    ldp x8, x9, [sp, #80]
+    ldp x29, x30, [sp], #96
+    mov x10, x30
+    mov x30, x9
+    ret x10
+    .popsection
+)");
+
+#endif
+
+extern "C" __attribute__((used)) void ftrace_record(uintptr_t ip, uintptr_t parent)
+{
+    FtraceRing* r = this_cpu()->ftrace;
+    if (!r || r->busy || __atomic_load_n(&g_paused, __ATOMIC_RELAXED)) {
+        return;
+    }
+    r->busy = 1;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    uint64_t seq = r->head;
+    FtraceEvent& e = r->events[seq & (RING_SIZE - 1)];
+    e.ts = arch::read_counter();
+    e.ip = ip;
+    e.parent = parent;
+    __atomic_store_n(&r->head, seq + 1, __ATOMIC_RELEASE);
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    r->busy = 0;
+}
+
+namespace {
+
+// 为当前CPU挂上记录环，重新上线的CPU沿用它原来的环
+int attach_ring()
+{
+    PerCpu* cpu = this_cpu();
+    FtraceRing& r = g_rings[cpu->cpu % MAX_CPUS];
+    if (!r.events) {
+        r.events = static_cast<FtraceEvent*>(mm::alloc_pages(RING_ORDER));
+        if (!r.events) {
+            return -ENOMEM;
+        }
+        r.cpu = cpu->cpu;
+    }
+    cpu->ftrace = &r;
+    return 0;
+}
+
+// 在符号表中查找跟踪点(x86同时合并NOP)；记录环先只为执行这项初始化的CPU分配，
+// 其他CPU上线时各自分配
+int __init ftrace_init()
+{
+    uint32_t n = ksym_count();
+    if (!n) {
+        return -ENODEV;
+    }
+    g_sites = static_cast<uintptr_t*>(kmalloc(n * sizeof(uintptr_t)));
+    g_state = static_cast<uint8_t*>(kzalloc(n));
+    if (!g_sites || !g_state || attach_ring()) {
+        kfree(g_sites);
+        kfree(g_state);
+        g_state = nullptr;
+        return -ENOMEM;
+    }
+
+    uintptr_t init_begin = reinterpret_cast<uintptr_t>(__init_begin);
+    uintptr_t init_end = reinterpret_cast<uintptr_t>(__init_end);
+    for (uint32_t i = 0; i < n; i++) {
+        Ksym sym;
+        if (ksym_at(i, &sym) && sym.size > SITE_SIZE &&
+            !(sym.addr >= init_begin && sym.addr < init_end) && prepare_site(sym.addr)) {
+            g_sites[g_count++] = sym.addr;
+        }
+    }
+
+    console::Line().str("ftrace: ").num((int64_t)g_count).str(" of ").num((int64_t)n)
+        .str(" functions traceable").print();
+    return 0;
+}
+early_initcall(ftrace_init);
+
+// 下线的CPU不再记录，记录环留着，其中的记录照常由show输出
+int ftrace_cpu_online(uint32_t)
+{
+    return g_state ? attach_ring() : 0;
+}
+
+void ftrace_cpu_offline(uint32_t)
+{
+    this_cpu()->ftrace = nullptr;
+}
+DEFINE_CPUHP_STEP(CPUHP_LEVEL_TRACE, ftrace, ftrace_cpu_online, ftrace_cpu_offline);
+
+// ip处跟踪点的下标，没有时返回g_count
+size_t find_site(uintptr_t ip)
+{
+    size_t lo = 0;
+    size_t hi = g_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (g_sites[mid] < ip) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo < g_count && g_sites[lo] == ip ? lo : g_count;
+}
+
+// 对名字与pat匹配的每个跟踪点调用fn(下标, 符号)，返回匹配的个数
+template <typename Fn>
+size_t for_each_match(const char* pat, Fn fn)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < g_count; i++) {
+        Ksym sym;
+        if (ksym_lookup(g_sites[i], &sym) && glob_match(pat, sym.name)) {
+            fn(i, sym);
+            n++;
+        }
+    }
+    return n;
+}
+
+void cmd_funcs(const char* pat)
+{
+    size_t n = for_each_match(pat, [](size_t i, const Ksym& sym) {
+        static const char* const mark[] = { "    ", "  * ", "  L " };
+        console::Line().str(mark[g_state[i]]).str(sym.name).print();
+    });
+    console::Line().str("ftrace: ").num((int64_t)n).str(" functions").print();
+}
+
+void cmd_set(const char* pat, bool on)
+{
+    size_t changed = 0;
+    int err = 0;
+    uint8_t want = on ? SITE_ON : SITE_OFF;
+    for_each_match(pat, [&](size_t i, const Ksym&) {
+        if (g_state[i] == want || g_state[i] == SITE_CLAIMED || err) {
+            return;
+        }
+        err = patch_site(g_sites[i], on);
+        if (!err) {
+            g_state[i] = want;
+            changed++;
+        }
+    });
+    console::Line().str("ftrace: ").str(on ? "enabled " : "disabled ").num((int64_t)changed)
+        .str(" functions").print();
+    if (err) {
+        console::Line().str("ftrace: patching failed (").num(err).str(")").print();
+    }
+}
+
+// 符号名+偏移；不在任何函数内时只输出地址
+void put_symbol(console::Line& line, uintptr_t addr, uintptr_t lookup)
+{
+    Ksym sym;
+    if (ksym_lookup(lookup, &sym)) {
+        line.str(sym.name);
+        if (addr != sym.addr) {
+            line.str("+").hex(addr - sym.addr);
+        }
+    } else {
+        line.hex(addr);
+    }
+}
+
+// 按CPU逐个输出，时间是自clock_init以来的秒数
+void cmd_show()
+{
+    __atomic_store_n(&g_paused, true, __ATOMIC_RELAXED);
+    uint64_t now_cycles = clock_cycles();
+    uint64_t now_ns = clock_ns();
+    uint64_t total = 0;
+    uint64_t lost = 0;
+    for (const FtraceRing& r : g_rings) {
+        if (!r.events) {
+            continue;
+        }
+        uint64_t head = __atomic_load_n(&r.head, __ATOMIC_ACQUIRE);
+        uint64_t first = head > RING_SIZE ? head - RING_SIZE : 0;
+        for (uint64_t seq = first; seq < head; seq++) {
+            const FtraceEvent& e = r.events[seq & (RING_SIZE - 1)];
+            uint64_t ns = now_ns - clock_cycles_to_ns(now_cycles - e.ts);
+            uint64_t us = ns / 1000 % 1000000;
+            char frac[8] = { '.' };
+            for (int d = 6; d >= 1; d--, us /= 10) {
+                frac[d] = (char)('0' + us % 10);
+            }
+            console::Line line;
+            line.str("  [").num(r.cpu, 3).str("] ").num((int64_t)(ns / 1000000000), 5).str(frac).str(": ");
+            put_symbol(line, e.ip, e.ip);
+            line.str(" <- ");
+            put_symbol(line, e.parent, e.parent - 1);
+            line.print();
+        }
+        total += head - first;
+        lost += first;
+    }
+    console::Line().str("ftrace: ").num((int64_t)total).str(" events, ").num((int64_t)lost)
+        .str(" overwritten").print();
+    __atomic_store_n(&g_paused, false, __ATOMIC_RELAXED);
+}
+
+void cmd_clear()
+{
+    __atomic_store_n(&g_paused, true, __ATOMIC_RELAXED);
+    for (FtraceRing& r : g_rings) {
+        __atomic_store_n(&r.head, 0, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&g_paused, false, __ATOMIC_RELAXED);
+}
+
+void cmd_help()
+{
+    console::Line().str("  funcs [pattern]   list traceable functions, * marks enabled ones,").print();
+    console::Line().str("                    L ones replaced by a live patch").print();
+    console::Line().str("  on <pattern>      trace functions matching pattern (* and ?)").print();
+    console::Line().str("  off <pattern>     stop tracing them").print();
+    console::Line().str("  show              print recorded calls").print();
+    console::Line().str("  clear             discard recorded calls").print();
+    console::Line().str("  exit              leave the command loop").print();
+}
+
+// 命令和参数之间以空格分隔，参数只有一个
+void run_command(char* cmd)
+{
+    while (*cmd == ' ') {
+        cmd++;
+    }
+    char* arg = cmd;
+    while (*arg && *arg != ' ') {
+        arg++;
+    }
+    if (*arg) {
+        *arg++ = '\0';
+        while (*arg == ' ') {
+            arg++;
+        }
+        char* end = arg + strlen(arg);
+        while (end > arg && end[-1] == ' ') {
+            *--end = '\0';
+        }
+    }
+
+    if (!*cmd) {
+        return;
+    } else if (!strcmp(cmd, "help")) {
+        cmd_help();
+    } else if (!strcmp(cmd, "funcs")) {
+        cmd_funcs(*arg ? arg : "*");
+    } else if (!strcmp(cmd, "on") && *arg) {
+        cmd_set(arg, true);
+    } else if (!strcmp(cmd, "off") && *arg) {
+        cmd_set(arg, false);
+    } else if (!strcmp(cmd, "show")) {
+        cmd_show();
+    } else if (!strcmp(cmd, "clear")) {
+        cmd_clear();
+    } else if (!strcmp(cmd, "exit")) {
+        g_exited = true;
+    } else {
+        console::Line().str("ftrace: unknown command, try help").print();
+    }
+}
+
+void prompt()
+{
+    console::write("ftrace> ", 8);
+}
+
+} // namespace
+
+bool ftrace_poll()
+{
+    if (!g_state || g_exited) {
+        return false;
+    }
+    if (!g_prompted) {
+        g_prompted = true;
+        console::Line().str("ftrace: command loop ready, type help").print();
+        prompt();
+    }
+    int c;
+    while (!g_exited && (c = console::getc()) >= 0) {
+        bool after_cr = g_after_cr;
+        g_after_cr = c == '\r';
+        if (c == '\n' && after_cr) {
+            continue;
+        }
+        if (c == '\r' || c == '\n') {
+            console::write("\n", 1);
+            g_cmd[g_cmd_len] = '\0';
+            g_cmd_len = 0;
+            run_command(g_cmd);
+            if (!g_exited) {
+                prompt();
+            }
+        } else if (c == 0x7F || c == '\b') {
+            if (g_cmd_len) {
+                g_cmd_len--;
+                console::write("\b \b", 3);
+            }
+        } else if (c >= ' ' && c < 0x7F && g_cmd_len < CMD_LEN - 1) {
+            char ch = (char)c;
+            g_cmd[g_cmd_len++] = ch;
+            console::write(&ch, 1);
+        }
+    }
+    return !g_exited;
+}
+
+int ftrace_claim(uintptr_t ip)
+{
+    size_t i = g_state ? find_site(ip) : g_count;
+    if (i == g_count) {
+        return 0;
+    }
+    if (g_state[i] != SITE_OFF) {
+        return -EBUSY;
+    }
+    g_state[i] = SITE_CLAIMED;
+    return 0;
+}
+
+void ftrace_release(uintptr_t ip)
+{
+    size_t i = g_state ? find_site(ip) : g_count;
+    if (i < g_count && g_state[i] == SITE_CLAIMED) {
+        g_state[i] = SITE_OFF;
+    }
+}
+
+#endif // LEAFOS_FTRACE
@@ -0,0 +1,52 @@
+/**
+ * leafOS - 单调时钟与挂钟
+ * 直接读取CPU的时间计数器(x86 TSC / aarch64 CNTVCT)，启动时确定一次频率。
+ *
+ * 换算参数放在单独的一页(ClockPage)中，vDSO(vdso.hpp)把它只读映射给用户态，
+ * 用户态与内核按同样的参数计算时间。写者把seq加到奇数、修改、再加到偶数；
+ * 读者在seq为奇数或读完后seq已变化时重读
+ */
+
+#pragma once
+#ifndef __LEAFOS_CLOCK_H__
+#define __LEAFOS_CLOCK_H__
+
+#include <stdint.h>
+
+#define CLOCK_REALTIME  0   // 1970-01-01 UTC以来
+#define CLOCK_MONOTONIC 1   // clock_init以来
+
+struct ClockPage {
+    uint32_t seq;
+    uint32_t reserved;
+    uint64_t cycle_base;    // clock_init时的计数值
+    uint64_t mult;          // 纳秒 = 计数 * mult >> 32
+    uint64_t base_ns[2];    // cycle_base时刻各时钟的纳秒数，下标为CLOCK_REALTIME/CLOCK_MONOTONIC
+};
+
+// 确定计数器频率并把当前时刻记为0，必须在使用其他函数之前调用；重复调用不产生影响。
+// 只在启动期间可用(__init)
+void clock_init();
+
+// 计数器频率 (Hz)
+uint64_t clock_hz();
+
+// 原始计数值
+uint64_t clock_cycles();
+
+// 自clock_init以来的纳秒数
+uint64_t clock_ns();
+
+// 计数差值换算为纳秒
+uint64_t clock_cycles_to_ns(uint64_t cycles);
+
+// 挂钟，1970-01-01 UTC以来的纳秒数；没有设置过时与clock_ns相同。不能在NMI中调用
+uint64_t clock_realtime_ns();
+
+// 把当前的挂钟时间设为ns，单调时钟不受影响
+void clock_set_realtime(uint64_t ns);
+
+// 时间页，按页对齐且整页不含其他数据
+const ClockPage* clock_page();
+
+#endif // __LEAFOS_CLOCK_H__
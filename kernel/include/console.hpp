@@ -0,0 +1,45 @@
+/**
+ * leafOS - 串口控制台
+ * 退出启动服务后内核唯一的输出途径。按行输出，多个CPU同时输出时行与行之间不会交错；
+ * 也可以轮询读取串口输入
+ */
+
+#pragma once
+#ifndef __LEAFOS_CONSOLE_H__
+#define __LEAFOS_CONSOLE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace console {
+
+// 初始化串口；重复调用不产生影响
+void init();
+
+// 原样输出，"\n"会被转换为"\r\n"
+void write(const char* s, size_t len);
+
+// 读取一个输入字符，没有输入时立即返回-1
+int getc();
+
+// 在栈上拼好一行再一次性输出
+class Line {
+public:
+    Line& str(const char* s);
+    Line& num(int64_t v);
+    Line& hex(uint64_t v);
+
+    // 右对齐到width个字符的十进制数
+    Line& num(int64_t v, size_t width);
+
+    void print();
+
+private:
+    static constexpr size_t CAP = 160;
+    char   buf_[CAP];
+    size_t len_ = 0;
+};
+
+} // namespace console
+
+#endif // __LEAFOS_CONSOLE_H__
@@ -0,0 +1,62 @@
+/**
+ * leafOS - CPU热插拔
+ *
+ * CPU按步骤上线、倒序下线。子系统用DEFINE_CPUHP_STEP登记每CPU的设置和清理
+ * (分配每CPU的缓冲区、在本CPU上打开或关掉中断源等)，登记项与initcalls一样由链接器
+ * 收集到cpuhp_steps段中。两个方向的步骤都在该CPU自己身上、关中断执行:
+ * 清理要停掉本CPU上的中断源和定时器，把每CPU缓冲区中的内容留给仍在线的CPU读取。
+ *
+ * 下线由其他CPU调用cpu_down请求，目标CPU在空闲循环的cpuhp_poll中看到请求后执行清理，
+ * 然后关中断停在cpuhp_poll中(没有处理器间中断，以cpu_relax自旋等待)，
+ * 直到cpu_up请求它回来，再依次执行上线步骤。
+ *
+ * 引导CPU的设置由各子系统的初始化函数完成，不经过这些步骤，也不能下线: 控制台命令和
+ * 空闲循环中的轮询都在它上面。目前还没有启动其他CPU的代码，其他CPU启动后在percpu_init和
+ * arch::paging_init之后调用cpuhp_online加入，空闲时反复调用cpuhp_poll
+ */
+
+#pragma once
+#ifndef __LEAFOS_CPUHP_H__
+#define __LEAFOS_CPUHP_H__
+
+#include <stdint.h>
+
+struct CpuhpStep {
+    int         (*online)(uint32_t cpu);    // 失败返回负错误码，之前完成的步骤倒序清理
+    void        (*offline)(uint32_t cpu);
+    const char* name;
+    uint32_t    level;
+};
+
+// 上线按级别从低到高，下线从高到低；同一级别内的先后不确定
+#define CPUHP_LEVEL_ARCH    0   // 本CPU上的中断源、性能计数器
+#define CPUHP_LEVEL_TRACE   1   // 每CPU的跟踪记录缓冲区
+#define CPUHP_LEVEL_LATE    2   // 其余一切
+#define CPUHP_LEVEL_COUNT   3
+
+#define DEFINE_CPUHP_STEP(level, name, online, offline)                     \
+    static const CpuhpStep __cpuhp_##name                                   \
+        __attribute__((used, section("cpuhp_steps"), aligned(8))) = { online, offline, #name, level }
+
+// 由引导CPU在percpu_init之后调用，把自己记为在线
+void cpuhp_init();
+
+// 由刚启动的CPU调用，执行全部上线步骤，成功后记为在线
+int cpuhp_online();
+
+// 由在线的CPU在空闲时调用: 有对本CPU的下线请求时执行清理并停在这里，
+// 直到被cpu_up唤回。返回时本CPU在线
+void cpuhp_poll();
+
+// 请求cpu下线并等待它完成清理。不能让引导CPU或调用者自己下线(-EBUSY)，
+// cpu不在线时返回-EINVAL
+int cpu_down(uint32_t cpu);
+
+// 请求由cpu_down停下的cpu重新上线，返回它执行上线步骤的结果。
+// cpu不是停下的状态时返回-EINVAL；从未启动的CPU要由启动代码带起来
+int cpu_up(uint32_t cpu);
+
+bool cpu_online(uint32_t cpu);
+uint32_t num_online_cpus();
+
+#endif // __LEAFOS_CPUHP_H__
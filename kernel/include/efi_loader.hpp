@@ -0,0 +1,69 @@
+/**
+ * leafOS - 启动服务阶段的文件加载
+ *
+ * 在ExitBootServices之前经EFI_SIMPLE_FILE_SYSTEM_PROTOCOL从ESP读取initrd、模块等附带文件。
+ * 固件的每次Read都有不小的固定开销，这里总是以READ_CHUNK大小、页对齐的块读取，
+ * load_file直接读进文件最终所在的页；stream_file把数据交给StreamSink(如解压器)，
+ * 固件支持ReadEx时下一块的读取与当前块的处理重叠进行。
+ * load_lz4_file在此基础上边读边解压LZ4帧，输出直接写进最终的页。
+ * 计时依赖clock_init，需在加载之前调用
+ *
+ * 本头文件不依赖UEFI类型，efi_main可以和gnu-efi的头文件一起使用
+ */
+
+#pragma once
+#ifndef __LEAFOS_EFI_LOADER_H__
+#define __LEAFOS_EFI_LOADER_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace efi {
+
+constexpr uint64_t PAGE_SIZE  = 4096;
+constexpr uint64_t READ_CHUNK = 4 * 1024 * 1024;
+
+// 读入数据的消费者。feed收到的数据在返回后即被覆盖，需要的部分必须自行拷走
+class StreamSink {
+public:
+    // 返回负错误码时中止加载
+    virtual int feed(const void* data, size_t len) = 0;
+    // 文件全部交付后调用一次
+    virtual int finish() = 0;
+
+protected:
+    ~StreamSink() = default;
+};
+
+struct LoadStats {
+    uint64_t bytes;         // 读到的字节数
+    uint32_t reads;         // 发给固件的Read/ReadEx次数
+    bool     async;         // 是否用ReadEx与处理重叠
+    uint64_t read_ns;       // 等待固件读取的时间
+    uint64_t sink_ns;       // 处理(解压)数据的时间
+    uint64_t total_ns;
+};
+
+// 记下固件接口，必须在其他函数之前、ExitBootServices之前调用
+void init(void* image_handle, void* system_table);
+
+// 分配EfiLoaderData页，退出启动服务后内容保留；失败返回nullptr
+void* alloc_pages(uint64_t pages);
+void  free_pages(void* p, uint64_t pages);
+
+// 把与内核映像同一个卷上的path整个读入新分配的页，成功时由*data/*size带回
+int load_file(const char16_t* path, void** data, uint64_t* size, LoadStats* stats = nullptr);
+
+// 把path的内容按顺序交给sink，返回0或负错误码
+int stream_file(const char16_t* path, StreamSink* sink, LoadStats* stats = nullptr);
+
+// 读取LZ4帧格式的path并解压到新分配的页，*size为解压后的长度
+int load_lz4_file(const char16_t* path, void** data, uint64_t* size, LoadStats* stats = nullptr);
+
+// 在固件控制台打印一行加载统计。size大于读到的字节数(即经过解压)时，
+// 按实测读取速率估算少读的时间，与解压耗时一起给出净收益
+void report(const char16_t* name, const LoadStats& stats, uint64_t size);
+
+} // namespace efi
+
+#endif // __LEAFOS_EFI_LOADER_H__
@@ -0,0 +1,51 @@
+/**
+ * leafOS - 函数入口跟踪
+ *
+ * 以 make FTRACE=1 构建时，编译器(-fpatchable-function-entry)在每个函数入口留出NOP作为
+ * 跟踪点，启动时按符号表找出它们: x86是5个单字节NOP，启动时合并为一条5字节NOP；
+ * aarch64是两条NOP。关闭跟踪的函数只多执行这一两条NOP。
+ *
+ * 开启某个函数的跟踪时把它的跟踪点改写为对ftrace_caller的调用(aarch64还要先把LR
+ * 存到x9)，记录入口地址、返回到的调用者和时间戳，写入当前CPU自己的记录环:
+ * 不加锁、不分配内存，环满后覆盖最旧的记录；NMI中嵌套的记录直接丢弃。
+ *
+ * 内核空闲时ftrace_poll在串口上接受命令(输入help查看)，按函数名开启、关闭跟踪并输出记录。
+ * 函数名来自内核符号表(ksyms.hpp)；init区的函数在启动完成后已被释放，不能跟踪。
+ * 跟踪点也是实时补丁(livepatch.hpp)改写的位置，被补丁占用的函数不能开启跟踪
+ */
+
+#pragma once
+#ifndef __LEAFOS_FTRACE_H__
+#define __LEAFOS_FTRACE_H__
+
+#include <stdint.h>
+
+#if defined(LEAFOS_FTRACE)
+
+// 处理串口上已经到达的命令，不等待输入；收到exit命令后返回false
+bool ftrace_poll();
+
+// 把入口ip处的跟踪点交给其他改写者，此后不能开启跟踪，直到ftrace_release。
+// 跟踪点正在跟踪或已被占用时返回-EBUSY；ip处没有跟踪点时不做任何事，返回0
+int ftrace_claim(uintptr_t ip);
+void ftrace_release(uintptr_t ip);
+
+#else
+
+static inline bool ftrace_poll()
+{
+    return false;
+}
+
+static inline int ftrace_claim(uintptr_t)
+{
+    return 0;
+}
+
+static inline void ftrace_release(uintptr_t)
+{
+}
+
+#endif
+
+#endif // __LEAFOS_FTRACE_H__
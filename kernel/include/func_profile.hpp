@@ -0,0 +1,27 @@
+/**
+ * leafOS - 函数调用顺序剖析
+ *
+ * 以 make FUNC_PROFILE=1 构建时，所有函数由-finstrument-functions插桩，
+ * 记录每个函数第一次被调用的先后和调用次数。func_profile_dump在串口上输出
+ * "fprof <相对映像基址的偏移> <次数>"，按首次调用排序；
+ * tools/mkorder.py据此生成函数排列顺序，再以 make TEXT_ORDER=<文件> 重新链接
+ */
+
+#pragma once
+#ifndef __LEAFOS_FUNC_PROFILE_H__
+#define __LEAFOS_FUNC_PROFILE_H__
+
+#if defined(LEAFOS_FUNC_PROFILE)
+
+// 停止记录并输出结果；只输出一次
+void func_profile_dump();
+
+#else
+
+static inline void func_profile_dump()
+{
+}
+
+#endif
+
+#endif // __LEAFOS_FUNC_PROFILE_H__
@@ -0,0 +1,27 @@
+/**
+ * leafOS - 剖析反馈优化(PGO)的计数收集
+ *
+ * 以 make PGO=gen 构建时，编译器在每条控制流弧上放一个计数器，计数器就在内核映像的数据段里。
+ * gcov_dump把它们按.gcda格式序列化，以十六进制在串口上输出
+ * "gcda begin <字节数> <文件名>"、"gcda <数据>"、"gcda end <校验和>"；
+ * tools/gcda.py从串口日志还原出.gcda文件，供 make PGO=use 构建使用
+ */
+
+#pragma once
+#ifndef __LEAFOS_GCOV_H__
+#define __LEAFOS_GCOV_H__
+
+#if defined(LEAFOS_PGO_GEN)
+
+// 输出全部编译单元的计数；只输出一次
+void gcov_dump();
+
+#else
+
+static inline void gcov_dump()
+{
+}
+
+#endif
+
+#endif // __LEAFOS_GCOV_H__
@@ -0,0 +1,28 @@
+/**
+ * leafOS - 启动期代码与数据
+ *
+ * 只在启动期间用到的函数标记为__init，数据标记为__initdata/__initconst。
+ * 链接脚本把它们连同初始化调用表一起放进页对齐的init区(__init_begin..__init_end)，
+ * 所有初始化结束后由free_initmem整页交还给页分配器。
+ * 被标记的代码和数据在那之后不能再被引用。
+ * 编入主机端库(见 make hostlib)时没有init区，标记不起作用
+ */
+
+#pragma once
+#ifndef __LEAFOS_INIT_H__
+#define __LEAFOS_INIT_H__
+
+#if __STDC_HOSTED__
+#define __init
+#define __initdata
+#define __initconst
+#else
+#define __init      __attribute__((section(".init.text")))
+#define __initdata  __attribute__((section(".init.data")))
+#define __initconst __attribute__((section(".init.rodata")))
+#endif
+
+// 释放init区并在控制台报告回收的大小。链接脚本没有划分init区时(如gnu-efi构建)什么也不做
+void free_initmem();
+
+#endif // __LEAFOS_INIT_H__
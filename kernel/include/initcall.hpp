@@ -0,0 +1,64 @@
+/**
+ * leafOS - 分级初始化调用
+ *
+ * 各子系统在自己的源文件里用core_initcall(fn)等宏登记初始化函数，
+ * 登记项由链接器收集到initcalls段中，不存在集中维护的调用列表。
+ * 段名是合法的C标识符，链接器会自动生成__start_initcalls/__stop_initcalls，
+ * 因此不依赖特定的链接脚本(gnu-efi的脚本同样可用)。初始化函数本身通常标记为__init。
+ *
+ * 全部登记项构成一张依赖图，由参与启动的所有CPU一起执行，没有依赖关系的
+ * 初始化(例如不同通道上的设备探测)可以同时进行:
+ *  - 用DEFINE_INITCALL_AFTER声明依赖的初始化只等待列出的那些
+ *  - 其余的依赖所有更低级别的初始化，即传统的逐级执行
+ * 级别同时决定就绪时的先后
+ */
+
+#pragma once
+#ifndef __LEAFOS_INITCALL_H__
+#define __LEAFOS_INITCALL_H__
+
+#include <stdint.h>
+#include <init.hpp>
+
+// 成功返回0，失败返回负错误码；失败不会阻止后续初始化
+typedef int (*initcall_fn)();
+
+struct Initcall {
+    initcall_fn fn;
+    const char* name;
+    const char* deps;   // 以空格分隔的前置初始化函数名；nullptr表示依赖所有更低级别
+    uint32_t    level;
+};
+
+#define INIT_LEVEL_EARLY    0   // 只依赖页分配器
+#define INIT_LEVEL_CORE     1   // 时钟等核心服务
+#define INIT_LEVEL_ARCH     2   // 体系结构相关设置
+#define INIT_LEVEL_SUBSYS   3   // 内核子系统
+#define INIT_LEVEL_FS       4   // 根文件系统
+#define INIT_LEVEL_DEVICE   5   // 设备探测与挂载
+#define INIT_LEVEL_LATE     6   // 其余一切
+#define INIT_LEVEL_COUNT    7
+
+#define DEFINE_INITCALL_AFTER(level, fn, deps)                              \
+    static const Initcall __initcall_##fn                                   \
+        __attribute__((used, section("initcalls"), aligned(8))) = { fn, #fn, deps, level }
+
+#define DEFINE_INITCALL(level, fn) DEFINE_INITCALL_AFTER(level, fn, nullptr)
+
+#define early_initcall(fn)  DEFINE_INITCALL(INIT_LEVEL_EARLY, fn)
+#define core_initcall(fn)   DEFINE_INITCALL(INIT_LEVEL_CORE, fn)
+#define arch_initcall(fn)   DEFINE_INITCALL(INIT_LEVEL_ARCH, fn)
+#define subsys_initcall(fn) DEFINE_INITCALL(INIT_LEVEL_SUBSYS, fn)
+#define fs_initcall(fn)     DEFINE_INITCALL(INIT_LEVEL_FS, fn)
+#define device_initcall(fn) DEFINE_INITCALL(INIT_LEVEL_DEVICE, fn)
+#define late_initcall(fn)   DEFINE_INITCALL(INIT_LEVEL_LATE, fn)
+
+// 由引导CPU调用: 执行所有登记的初始化，全部结束后在控制台输出启动耗时
+// (每项的用时、所在CPU，以及依赖图上的关键路径)，返回失败的个数。
+// 依赖成环的初始化不会执行，按失败计
+int run_initcalls();
+
+// 由其他CPU调用，加入正在进行的初始化，全部结束后返回
+void initcall_worker();
+
+#endif // __LEAFOS_INITCALL_H__
@@ -0,0 +1,227 @@
+/**
+ * leafOS - 异步I/O提交/完成环 (仿io_uring)
+ *
+ * 提交队列(SQ)和完成队列(CQ)放在同一块共享内存中，提交者只需填写SQE并推进sq_tail，
+ * 内核处理后把结果写入CQE并推进cq_tail，两边各自只写自己的下标，不需要锁。
+ * 支持文件读写、块设备读写和超时；带IOSQE_LINK标记的请求与下一项组成链，
+ * 前一项失败时后续项以-ECANCELED完成。
+ *
+ * 以IO_SETUP_SQPOLL创建的环由内核轮询处理，提交者完全不需要调用enter；
+ * 连续空闲一段时间后内核停止轮询并置位IO_SQ_NEED_WAKEUP，此时需要一次带IO_ENTER_SQ_WAKEUP的enter唤醒
+ */
+
+#pragma once
+#ifndef __LEAFOS_IO_RING_H__
+#define __LEAFOS_IO_RING_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kvector.hpp>
+#include <spinlock.hpp>
+
+// ============================================
+// 共享内存布局 (内核与提交者共用)
+// ============================================
+
+enum IoOpcode : uint8_t {
+    IO_OP_NOP,
+    IO_OP_READ,             // 从已注册文件fd的off处读len字节到addr
+    IO_OP_WRITE,
+    IO_OP_BLOCK_READ,       // 从已注册块设备fd的扇区off起读len个扇区到addr
+    IO_OP_BLOCK_WRITE,
+    IO_OP_TIMEOUT,          // off纳秒后以-ETIME完成
+};
+
+// IoSqe::flags
+constexpr uint8_t IOSQE_LINK = 1 << 0;      // 下一项在本项成功完成后才执行
+
+// IoSqe::op_flags (IO_OP_TIMEOUT)
+constexpr uint32_t IO_TIMEOUT_ABS          = 1 << 0;    // off是clock_ns()的绝对时刻
+constexpr uint32_t IO_TIMEOUT_ETIME_SUCCESS = 1 << 1;   // 到期不打断链接，可用于延时执行
+
+// IoRingShared::sq_flags
+constexpr uint32_t IO_SQ_NEED_WAKEUP = 1 << 0;
+
+// IoRing::create的setup_flags
+constexpr uint32_t IO_SETUP_SQPOLL = 1 << 0;
+
+// IoRing::enter的flags
+constexpr uint32_t IO_ENTER_GETEVENTS = 1 << 0;
+constexpr uint32_t IO_ENTER_SQ_WAKEUP = 1 << 1;
+
+struct IoSqe {
+    uint8_t  opcode;
+    uint8_t  flags;
+    uint16_t reserved;
+    int32_t  fd;            // 注册表中的下标
+    uint64_t off;
+    uint64_t addr;
+    uint32_t len;
+    uint32_t op_flags;
+    uint64_t user_data;     // 原样带回CQE
+    uint64_t pad[3];
+};
+
+struct IoCqe {
+    uint64_t user_data;
+    int32_t  res;           // 传输的字节/扇区数，或负错误码
+    uint32_t flags;
+};
+
+static_assert(sizeof(IoSqe) == 64, "SQE应占一个缓存行");
+static_assert(sizeof(IoCqe) == 16, "CQE布局错误");
+
+// 下标都是自由增长的32位计数，取模由mask完成；生产者和消费者的下标放在不同缓存行
+struct IoRingShared {
+    alignas(64) uint32_t sq_head;       // 内核写
+    uint32_t             sq_flags;      // 内核写
+    alignas(64) uint32_t sq_tail;       // 提交者写
+    uint32_t             sq_local_tail; // 提交者私用: 已取出还未提交的位置
+    alignas(64) uint32_t cq_tail;       // 内核写
+    uint32_t             cq_overflow;   // CQ满时丢弃的完成数
+    alignas(64) uint32_t cq_head;       // 消费者写
+
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    uint32_t sqes_off;                  // 相对于本结构起始处的偏移
+    uint32_t cqes_off;
+};
+
+// ---- 提交者/消费者一侧的辅助函数 (不依赖内核其他部分) ----
+
+inline IoSqe* io_sqes(IoRingShared* r)
+{
+    return reinterpret_cast<IoSqe*>(reinterpret_cast<uint8_t*>(r) + r->sqes_off);
+}
+
+inline IoCqe* io_cqes(IoRingShared* r)
+{
+    return reinterpret_cast<IoCqe*>(reinterpret_cast<uint8_t*>(r) + r->cqes_off);
+}
+
+// 取一个空闲SQE，SQ满时返回nullptr；填好后由io_submit_sqes一起发布
+inline IoSqe* io_get_sqe(IoRingShared* r)
+{
+    uint32_t head = __atomic_load_n(&r->sq_head, __ATOMIC_ACQUIRE);
+    uint32_t tail = r->sq_local_tail;
+    if (tail - head >= r->sq_entries) {
+        return nullptr;
+    }
+    r->sq_local_tail = tail + 1;
+    IoSqe* sqe = &io_sqes(r)[tail & (r->sq_entries - 1)];
+    *sqe = IoSqe();
+    return sqe;
+}
+
+// 发布所有已取出的SQE，返回本次发布的个数
+inline uint32_t io_submit_sqes(IoRingShared* r)
+{
+    uint32_t n = r->sq_local_tail - r->sq_tail;
+    __atomic_store_n(&r->sq_tail, r->sq_local_tail, __ATOMIC_RELEASE);
+    return n;
+}
+
+// 轮询模式下内核是否已停止轮询、需要enter唤醒
+inline bool io_sq_needs_wakeup(IoRingShared* r)
+{
+    return __atomic_load_n(&r->sq_flags, __ATOMIC_ACQUIRE) & IO_SQ_NEED_WAKEUP;
+}
+
+// 查看下一个完成项，没有时返回nullptr；处理完后调用io_cqe_seen
+inline IoCqe* io_peek_cqe(IoRingShared* r)
+{
+    uint32_t head = r->cq_head;
+    uint32_t tail = __atomic_load_n(&r->cq_tail, __ATOMIC_ACQUIRE);
+    return head != tail ? &io_cqes(r)[head & (r->cq_entries - 1)] : nullptr;
+}
+
+inline void io_cqe_seen(IoRingShared* r)
+{
+    __atomic_store_n(&r->cq_head, r->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+// ============================================
+// 内核一侧
+// ============================================
+
+class BlockDevice;
+
+namespace fs {
+class Inode;
+}
+
+namespace mm {
+class AddressSpace;
+}
+
+class IoRing {
+public:
+    // 条目数向上取整到2的幂；cq_entries为0时取sq_entries的两倍
+    static IoRing* create(uint32_t sq_entries, uint32_t cq_entries, uint32_t setup_flags);
+    void destroy();
+
+    IoRingShared* shared() { return shared_; }
+
+    // SQE中的fd是这里注册的下标
+    int register_files(fs::Inode* const* files, uint32_t count);
+    int register_blockdevs(BlockDevice* const* devs, uint32_t count);
+
+    // 把共享区映射到地址空间的va处，供用户代码直接访问，只能映射一次(否则-EBUSY)。
+    // 此后SQE中的addr是该地址空间中的用户地址: 必须在用户窗口内且已映射(读请求要求可写)，
+    // 否则以-EFAULT完成；块设备请求的addr还要按扇区对齐。未映射给用户的环中addr是内核指针。
+    // 共享区中的条目数和偏移可被用户改写，内核只用创建时记下的副本；destroy解除这个映射
+    int map_user(mm::AddressSpace* as, uint64_t va);
+
+    // 提交最多to_submit个SQE；带IO_ENTER_GETEVENTS时等到至少min_complete个CQE可取。
+    // 返回提交的SQE数或负错误码
+    int enter(uint32_t to_submit, uint32_t min_complete, uint32_t flags);
+
+    IoRing() = default;
+
+private:
+    friend bool io_ring_poll();
+
+    // 挂起等待超时的请求，以及超时后要继续执行的链
+    struct Timer {
+        uint64_t deadline;
+        uint64_t user_data;
+        uint32_t op_flags;
+        uint32_t rest_count;
+        IoSqe*   rest;
+    };
+
+    uint32_t submit(uint32_t max);
+    void     run_chain(const IoSqe* chain, uint32_t count);
+    void     cancel_chain(const IoSqe* chain, uint32_t count);
+    int32_t  execute(const IoSqe& sqe);
+    void     post(uint64_t user_data, int32_t res);
+    bool     run_timers();
+    bool     poll();
+
+    uint32_t cq_ready() const;
+    uint32_t cq_space() const;
+
+    IoRingShared*       shared_ = nullptr;
+    IoSqe*              sqes_ = nullptr;        // 以下是共享区布局的内核副本，不从共享区读回
+    IoCqe*              cqes_ = nullptr;
+    uint32_t            sq_entries_ = 0;
+    uint32_t            cq_entries_ = 0;
+    mm::AddressSpace*   user_as_ = nullptr;     // map_user的地址空间，SQE中的addr属于它
+    uint64_t            user_va_ = 0;
+    unsigned            order_ = 0;
+    uint32_t            setup_flags_ = 0;
+    Spinlock            lock_;
+
+    kstd::Vector<fs::Inode*>   files_;
+    kstd::Vector<BlockDevice*> blockdevs_;
+    kstd::Vector<Timer>        timers_;
+    kstd::Vector<IoSqe>        scratch_;        // 从共享区拷出的当前链，防止执行中被改写
+
+    uint64_t            idle_since_ = 0;
+    IoRing*             poll_next_ = nullptr;
+};
+
+// 处理所有SQPOLL环一遍；返回是否存在SQPOLL环 (由空闲循环反复调用)
+bool io_ring_poll();
+
+#endif // __LEAFOS_IO_RING_H__
@@ -0,0 +1,28 @@
+/**
+ * leafOS - 中断入口与分发
+ *
+ * 内核不接管全部中断，只为用到的中断源登记处理函数。x86复制固件的IDT，只替换登记过的
+ * 向量，其余沿用固件的处理函数；aarch64换上自己的向量表，IRQ经GIC应答后按中断号分发，
+ * 没有登记的中断源被关掉，其他异常输出现场和调用栈后停机。
+ *
+ * 处理函数在关中断的状态下运行，参数是被打断处的PC、帧指针和栈指针。
+ * 中断源本身的应答(性能计数器溢出、本地APIC的EOI等)由处理函数负责，
+ * GIC的应答和结束由分发代码完成
+ */
+
+#pragma once
+#ifndef __LEAFOS_IRQ_H__
+#define __LEAFOS_IRQ_H__
+
+#include <stdint.h>
+
+typedef void (*irq_handler)(uintptr_t pc, uintptr_t fp, uintptr_t sp);
+
+// 登记处理函数，并让当前CPU使用内核的中断入口。
+// x86上id是IDT向量: NMI(2)或32以上的外部中断，CPU异常不能登记；NMI在自己的栈上运行，
+// 要求调用的CPU已由syscall.cpp设置好TSS，否则返回false；
+// aarch64上是GIC中断号，目前只支持PPI(16..31)，同时在GIC中打开它。
+// 只对调用的CPU生效，其他CPU要各自调用一次；开中断由调用者决定
+bool irq_register(uint32_t id, irq_handler fn);
+
+#endif // __LEAFOS_IRQ_H__
@@ -0,0 +1,53 @@
+/**
+ * leafOS - 内核微基准
+ *
+ * 以 make KBENCH=1 构建时，用DEFINE_KBENCH登记的函数在启动完成后依次测量:
+ * 先预热，再采集大量样本，每个样本是连续执行batch次所用的计数器周期，
+ * 起止读数都经过串行化(x86 lfence+rdtsc，aarch64 isb+cntvct)。
+ * 结果减去空调用的开销后按每次操作在串口上输出最小值、中位数和p99，
+ * 行首为"kbench: "，其余部分是CSV；make bench 据此生成CSV文件。
+ *
+ * 与initcalls一样，登记项由链接器收集到kbench段。基准代码所在的源文件
+ * 整个放在 #if defined(LEAFOS_KBENCH) 中，普通构建里不占空间
+ */
+
+#pragma once
+#ifndef __LEAFOS_KBENCH_H__
+#define __LEAFOS_KBENCH_H__
+
+#include <stdint.h>
+
+// 把被测操作执行n次
+typedef void (*kbench_fn)(uint32_t n);
+
+struct KBench {
+    kbench_fn   fn;
+    const char* name;
+    uint32_t    batch;      // 每个样本连续执行的次数，操作越短越应取大
+};
+
+#define DEFINE_KBENCH(fn, batch)                                            \
+    static const KBench __kbench_##fn                                       \
+        __attribute__((used, section("kbench"), aligned(8))) = { fn, #fn, batch }
+
+// 让编译器认为v被使用了，被测的计算不会被优化掉
+template <typename T>
+static inline void kbench_keep(const T& v)
+{
+    __asm__ __volatile__("" : : "r"(v) : "memory");
+}
+
+#if defined(LEAFOS_KBENCH)
+
+// 依次运行所有登记的基准并输出结果，最后输出"kbench done"
+void run_kbenches();
+
+#else
+
+static inline void run_kbenches()
+{
+}
+
+#endif
+
+#endif // __LEAFOS_KBENCH_H__
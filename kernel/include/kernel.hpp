@@ -0,0 +1,35 @@
+/**
+ * leafOS - 内核入口
+ * efi_main 在退出启动服务后把启动信息交给 kernel_main，此后不再返回固件
+ */
+
+#pragma once
+#ifndef __LEAFOS_KERNEL_H__
+#define __LEAFOS_KERNEL_H__
+
+#include <page_alloc.hpp>
+
+// 启动阶段收集、交给内核的信息
+struct BootInfo {
+    const mm::MemRange* free_ranges;    // 可用物理内存
+    size_t              free_count;
+    const void*         initrd;         // 位于EfiLoaderData页中的initrd，没有时为nullptr
+    uint64_t            initrd_size;
+};
+
+[[noreturn]] void kernel_main(const BootInfo& boot);
+
+// kernel_main收到的启动信息，供各初始化调用使用
+const BootInfo& boot_info();
+
+// 停机，不再返回
+[[noreturn]] void halt_forever();
+
+// 输出错误信息和调用栈后停机
+[[noreturn]] void panic(const char* msg);
+
+// 从被打断的位置pc开始输出调用栈，fp/sp是那里的帧指针和栈指针，
+// 有符号表(ksyms.hpp)时每帧带函数名和偏移
+void print_backtrace(uintptr_t pc, uintptr_t fp, uintptr_t sp);
+
+#endif // __LEAFOS_KERNEL_H__
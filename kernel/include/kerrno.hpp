@@ -0,0 +1,37 @@
+/**
+ * leafOS - 内核错误码
+ * 内核内部函数返回负的错误码(-ENOENT等)，0或正数表示成功
+ */
+
+#pragma once
+#ifndef __LEAFOS_KERRNO_H__
+#define __LEAFOS_KERRNO_H__
+
+#define EPERM      1    // 操作不允许
+#define ENOENT     2    // 文件或目录不存在
+#define EIO        5    // I/O错误
+#define ENXIO      6    // 设备不存在
+#define E2BIG      7    // 参数过大
+#define ENOEXEC    8    // 可执行文件格式错误
+#define EBADF      9    // 无效的文件句柄
+#define EAGAIN     11   // 资源暂时不可用
+#define ENOMEM     12   // 内存不足
+#define EFAULT     14   // 地址错误
+#define EBUSY      16   // 设备忙
+#define EEXIST     17   // 已存在
+#define ENODEV     19   // 设备不存在
+#define ENOTDIR    20   // 不是目录
+#define EISDIR     21   // 是目录
+#define EINVAL     22   // 无效参数
+#define EFBIG      27   // 文件过大
+#define ENOSPC     28   // 空间不足
+#define EROFS      30   // 只读文件系统
+#define ERANGE     34   // 超出范围
+#define EDEADLK    35   // 会导致死锁
+#define ENAMETOOLONG 36 // 文件名过长
+#define ENOSYS     38   // 功能未实现
+#define ENOTEMPTY  39   // 目录非空
+#define ETIME      62   // 超时
+#define ECANCELED  125  // 操作已取消
+
+#endif // __LEAFOS_KERRNO_H__
@@ -0,0 +1,32 @@
+/**
+ * leafOS - 采样剖析
+ *
+ * 以 make KPROF=1 构建时，体系结构初始化阶段在执行该初始化的CPU上打开性能计数器，
+ * 每经过固定数目的核心周期溢出一次: x86经本地APIC以NMI送达，关中断的代码也能采到；
+ * aarch64是经GIC送达的PMU中断。处理时沿帧指针回溯调用栈(内核以
+ * -fno-omit-frame-pointer构建)，记入该CPU自己的缓冲区，不加锁也不分配内存。
+ *
+ * kprof_dump停止采样，合并相同的调用栈后在串口输出。内核带有符号表(ksyms.hpp)时
+ * 直接输出flamegraph.pl使用的折叠栈"kprof: 外层函数;...;被打断的函数 次数"；
+ * 否则输出"kprof <次数> <偏移>;<偏移>;..."，偏移相对映像基址、从最外层开始，
+ * 由tools/kprof.py借助nm转换
+ */
+
+#pragma once
+#ifndef __LEAFOS_KPROF_H__
+#define __LEAFOS_KPROF_H__
+
+#if defined(LEAFOS_KPROF)
+
+// 停止采样并输出结果；只输出一次
+void kprof_dump();
+
+#else
+
+static inline void kprof_dump()
+{
+}
+
+#endif
+
+#endif // __LEAFOS_KPROF_H__
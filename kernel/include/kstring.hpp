@@ -0,0 +1,39 @@
+/**
+ * leafOS - 内核字符串/内存函数
+ * 独立环境(freestanding)下没有libc，编译器生成的memcpy/memset调用也由这里提供。
+ * 编入主机端库时直接使用libc的实现
+ */
+
+#pragma once
+#ifndef __LEAFOS_KSTRING_H__
+#define __LEAFOS_KSTRING_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if __STDC_HOSTED__
+#include <string.h>
+#else
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void*  memcpy(void* dst, const void* src, size_t n);
+void*  memmove(void* dst, const void* src, size_t n);
+void*  memset(void* dst, int c, size_t n);
+int    memcmp(const void* a, const void* b, size_t n);
+size_t strlen(const char* s);
+int    strcmp(const char* a, const char* b);
+int    strncmp(const char* a, const char* b, size_t n);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // __STDC_HOSTED__
+
+// 通配符匹配，pat中*匹配任意串，?匹配任意一个字符
+bool glob_match(const char* pat, const char* s);
+
+#endif // __LEAFOS_KSTRING_H__
@@ -0,0 +1,40 @@
+/**
+ * leafOS - 内核符号表
+ *
+ * 链接时由tools/mksyms.py从第一遍链接的结果生成，作为只读数据再链接进内核
+ * (gnu-efi构建没有这一步，查找总是失败)。函数按地址排序，每16个一块:
+ * 块索引记录块首函数的偏移，块内地址差分、名字共享前缀，都按变长编码。
+ * 查找先在块索引上二分，再解码一个块，不加锁也不分配内存，任何上下文都可调用
+ */
+
+#pragma once
+#ifndef __LEAFOS_KSYMS_H__
+#define __LEAFOS_KSYMS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+constexpr size_t KSYM_NAME_LEN = 128;
+
+struct Ksym {
+    uintptr_t addr;                 // 函数起始地址
+    uint32_t  size;
+    char      name[KSYM_NAME_LEN];  // 去掉参数表的函数名
+};
+
+// 查找addr所在的函数，不在任何函数内返回false
+bool ksym_lookup(uintptr_t addr, Ksym* sym);
+
+// 内核中是否带有符号表
+bool ksym_available();
+
+// 按地址顺序遍历: 函数个数，以及第index个函数(0起)。
+// 每次调用要解码所在块的前一部分，遍历全部函数的代价与表长成正比
+uint32_t ksym_count();
+bool ksym_at(uint32_t index, Ksym* sym);
+
+// 按名字查找函数，返回同名函数的个数(重载的函数名字相同)，sym带回其中地址最低的一个。
+// 顺序解码整个表，只适合不频繁的调用
+uint32_t ksym_find(const char* name, Ksym* sym);
+
+#endif // __LEAFOS_KSYMS_H__
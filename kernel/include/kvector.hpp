@@ -0,0 +1,103 @@
+/**
+ * leafOS - 内核动态数组
+ * 只用于可平凡拷贝的类型，扩容时直接按字节搬移
+ */
+
+#pragma once
+#ifndef __LEAFOS_KVECTOR_H__
+#define __LEAFOS_KVECTOR_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <kheap.hpp>
+
+namespace kstd {
+
+template <typename T>
+class Vector {
+    static_assert(__is_trivially_copyable(T), "kstd::Vector只支持可平凡拷贝的类型");
+
+public:
+    Vector() = default;
+    ~Vector() { kfree(data_); }
+
+    Vector(const Vector&) = delete;
+    Vector& operator=(const Vector&) = delete;
+
+    Vector(Vector&& o) noexcept : data_(o.data_), size_(o.size_), cap_(o.cap_)
+    {
+        o.data_ = nullptr;
+        o.size_ = o.cap_ = 0;
+    }
+
+    Vector& operator=(Vector&& o) noexcept
+    {
+        if (this != &o) {
+            kfree(data_);
+            data_ = o.data_;
+            size_ = o.size_;
+            cap_ = o.cap_;
+            o.data_ = nullptr;
+            o.size_ = o.cap_ = 0;
+        }
+        return *this;
+    }
+
+    bool reserve(size_t n)
+    {
+        if (n <= cap_) {
+            return true;
+        }
+        T* p = static_cast<T*>(krealloc(data_, n * sizeof(T)));
+        if (!p) {
+            return false;
+        }
+        data_ = p;
+        cap_ = n;
+        return true;
+    }
+
+    bool push_back(const T& v)
+    {
+        if (size_ == cap_ && !reserve(cap_ ? cap_ * 2 : 8)) {
+            return false;
+        }
+        data_[size_++] = v;
+        return true;
+    }
+
+    void pop_back() { size_--; }
+    void clear() { size_ = 0; }
+
+    // 缩短长度或在预留空间内扩展 (新元素内容未定义)
+    bool resize(size_t n)
+    {
+        if (!reserve(n)) {
+            return false;
+        }
+        size_ = n;
+        return true;
+    }
+
+    T&       operator[](size_t i)       { return data_[i]; }
+    const T& operator[](size_t i) const { return data_[i]; }
+    T&       back()                     { return data_[size_ - 1]; }
+
+    T*       data()        { return data_; }
+    const T* data()  const { return data_; }
+    T*       begin()       { return data_; }
+    T*       end()         { return data_ + size_; }
+    const T* begin() const { return data_; }
+    const T* end()   const { return data_ + size_; }
+    size_t   size()  const { return size_; }
+    bool     empty() const { return size_ == 0; }
+
+private:
+    T*     data_ = nullptr;
+    size_t size_ = 0;
+    size_t cap_  = 0;
+};
+
+} // namespace kstd
+
+#endif // __LEAFOS_KVECTOR_H__
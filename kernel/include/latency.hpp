@@ -0,0 +1,32 @@
+/**
+ * leafOS - 中断与唤醒延迟测量 (仿cyclictest)
+ *
+ * 以 make LATENCY=<秒数> 构建时，启动完成后在引导CPU上测量这么长时间: 每个周期给单次定时器
+ * 设一个绝对到期时刻，然后停机等待，记录两种迟到时间:
+ *   irq     到期到中断处理函数开始执行
+ *   wakeup  到期到等待的代码重新开始运行(相当于cyclictest中高优先级线程被唤醒)
+ * 以 LATENCY_LOAD=1 构建时CPU在等待期间不停机，而是开着中断运行访存负载，每拷贝一页
+ * 检查一次是否到期，wakeup因此还包含负载让出CPU的粒度。
+ *
+ * 没有调度器，也就没有每CPU的测量线程: 每个调用run_latency的CPU测量自己，目前只有引导CPU。
+ * 结果以2的幂为桶宽的直方图输出到串口，行首为"latency: "，最后输出"latency done"
+ */
+
+#pragma once
+#ifndef __LEAFOS_LATENCY_H__
+#define __LEAFOS_LATENCY_H__
+
+#if defined(LEAFOS_LATENCY)
+
+// 在当前CPU上测量并输出结果
+void run_latency();
+
+#else
+
+static inline void run_latency()
+{
+}
+
+#endif
+
+#endif // __LEAFOS_LATENCY_H__
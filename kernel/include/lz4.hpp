@@ -0,0 +1,40 @@
+/**
+ * leafOS - LZ4解码
+ *
+ * 支持标准的LZ4帧格式(lz4命令行工具的默认输出)，要求帧头带有内容长度(--content-size)，
+ * 这样解码前就能一次分配好最终的输出页。块可以是独立的也可以是链接的(-BD)：
+ * 所有块都解到同一片连续输出中，前面已解出的数据就是后面块的字典。
+ * 校验和字段会被跳过，不做检查
+ */
+
+#pragma once
+#ifndef __LEAFOS_LZ4_H__
+#define __LEAFOS_LZ4_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+constexpr uint32_t LZ4_FRAME_MAGIC = 0x184D2204;
+constexpr size_t   LZ4_FRAME_HEADER_SIZE = 15;   // 魔数4 + FLG/BD 2 + 内容长度8 + HC 1 (不支持字典ID)
+
+struct Lz4FrameInfo {
+    uint64_t content_size;
+    uint32_t block_max;         // 单个块的最大字节数
+    bool     block_checksum;    // 每个块后有4字节校验和
+    bool     content_checksum;  // 结束标记后有4字节校验和
+};
+
+// 块大小字段的最高位表示该块未压缩，全0表示帧结束
+constexpr uint32_t LZ4_BLOCK_UNCOMPRESSED = 0x80000000;
+
+// 解析帧头。数据不足时返回0，格式错误或不支持时返回负错误码，成功返回帧头长度
+int lz4_frame_header(const void* src, size_t len, Lz4FrameInfo* info);
+
+// 把一个压缩块解到dst，最多写cap字节；dst之前的history字节是可被引用的已解出数据。
+// 返回解出的字节数或负错误码
+int64_t lz4_decompress_block(const void* src, size_t len, uint8_t* dst, size_t cap, size_t history);
+
+// 解码内存中一个完整的帧到dst，返回解出的字节数或负错误码
+int64_t lz4_decompress_frame(const void* src, size_t len, void* dst, size_t cap);
+
+#endif // __LEAFOS_LZ4_H__
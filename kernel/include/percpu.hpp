@@ -0,0 +1,40 @@
+/**
+ * leafOS - 每CPU数据
+ *
+ * 每个CPU有一个PerCpu块，由percpu_init在该CPU上登记到arch::set_cpu_local，
+ * 此后this_cpu()只需一次寄存器相对访问，不必经arch::cpu_id()查表，
+ * 适合在函数跟踪等频繁执行、可能处于NMI中的路径上使用。
+ * 引导CPU在kernel_main的最开始调用percpu_init，其他CPU要在加入初始化之前调用
+ */
+
+#pragma once
+#ifndef __LEAFOS_PERCPU_H__
+#define __LEAFOS_PERCPU_H__
+
+#include <stdint.h>
+#include <arch/cpu.hpp>
+
+constexpr uint32_t MAX_CPUS = 256;      // arch::cpu_id()是8位的
+
+struct FtraceRing;
+struct TraceBuffer;
+
+struct PerCpu {
+    PerCpu*      self;      // 必须是第一个成员，见arch::cpu_local
+    uint32_t     cpu;       // arch::cpu_id()
+    FtraceRing*  ftrace;    // 函数跟踪的记录环(ftrace.cpp)，没有时为nullptr
+    TraceBuffer* trace;     // 静态跟踪点的缓冲区(trace.cpp)，没有时为nullptr
+    uintptr_t    kernel_sp; // 进入用户态时的内核栈指针，系统调用在它之下执行(syscall.cpp)
+    uintptr_t    user_sp;   // x86: 系统调用入口暂存的用户栈指针
+    void*        tss;       // x86: 本CPU的TSS，没有时为nullptr
+};
+
+// 初始化当前CPU的PerCpu块；重复调用不产生影响
+void percpu_init();
+
+static inline PerCpu* this_cpu()
+{
+    return static_cast<PerCpu*>(arch::cpu_local());
+}
+
+#endif // __LEAFOS_PERCPU_H__
@@ -0,0 +1,61 @@
+/**
+ * leafOS - 自旋锁
+ * 基于GCC __atomic内建函数的test-and-test-and-set锁
+ */
+
+#pragma once
+#ifndef __LEAFOS_SPINLOCK_H__
+#define __LEAFOS_SPINLOCK_H__
+
+#include <stdint.h>
+
+// 忙等时提示CPU降低功耗/让出流水线
+static inline void cpu_relax()
+{
+#if defined(__x86_64__)
+    __asm__ __volatile__("pause" ::: "memory");
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield" ::: "memory");
+#endif
+}
+
+struct Spinlock {
+    volatile uint32_t locked = 0;
+
+    void lock()
+    {
+        for (;;) {
+            if (!__atomic_exchange_n(&locked, 1, __ATOMIC_ACQUIRE)) {
+                return;
+            }
+            while (__atomic_load_n(&locked, __ATOMIC_RELAXED)) {
+                cpu_relax();
+            }
+        }
+    }
+
+    bool try_lock()
+    {
+        return !__atomic_exchange_n(&locked, 1, __ATOMIC_ACQUIRE);
+    }
+
+    void unlock()
+    {
+        __atomic_store_n(&locked, 0, __ATOMIC_RELEASE);
+    }
+};
+
+// 作用域锁
+class SpinGuard {
+public:
+    explicit SpinGuard(Spinlock& l) : lock_(l) { lock_.lock(); }
+    ~SpinGuard() { lock_.unlock(); }
+
+    SpinGuard(const SpinGuard&) = delete;
+    SpinGuard& operator=(const SpinGuard&) = delete;
+
+private:
+    Spinlock& lock_;
+};
+
+#endif // __LEAFOS_SPINLOCK_H__
@@ -0,0 +1,36 @@
+/**
+ * leafOS - 调用栈回溯
+ *
+ * 内核以-fno-omit-frame-pointer构建，每个函数的帧记录中第0个字是上一层的帧指针，
+ * 第1个字是返回地址(x86 rbp，aarch64 x29)。回溯可能从被打断的任意位置开始，
+ * 帧指针只接受在栈指针之上STACK_WALK_SPAN以内、逐层增大的值，
+ * 链上出现垃圾值时就此停止，不会读到栈外
+ */
+
+#pragma once
+#ifndef __LEAFOS_STACKTRACE_H__
+#define __LEAFOS_STACKTRACE_H__
+
+#include <stdint.h>
+
+constexpr uintptr_t STACK_WALK_SPAN = 64 * 1024;   // 与启动栈大小相同
+
+// 从帧指针fp开始向外回溯，把返回地址依次存入out，最多max个，返回个数。
+// sp是回溯开始时的栈指针
+static inline uint32_t stack_walk(uintptr_t fp, uintptr_t sp, uintptr_t* out, uint32_t max)
+{
+    uint32_t n = 0;
+    uintptr_t lo = sp;
+    while (n < max && fp >= lo && fp < sp + STACK_WALK_SPAN && !(fp & 7)) {
+        const uintptr_t* frame = reinterpret_cast<const uintptr_t*>(fp);
+        if (!frame[1]) {
+            break;
+        }
+        out[n++] = frame[1];
+        lo = fp + 2 * sizeof(uintptr_t);
+        fp = frame[0];
+    }
+    return n;
+}
+
+#endif // __LEAFOS_STACKTRACE_H__
@@ -0,0 +1,20 @@
+/**
+ * leafOS - 停机执行
+ *
+ * stop_machine在其他CPU都不执行内核代码、本CPU关中断的状态下运行一个函数，
+ * 供改写正在使用的代码和数据(livepatch.hpp)。目前只有引导CPU在运行，
+ * 停下其他CPU这一步为空；启动其他CPU后，要先经处理器间中断让它们关中断自旋在集合点上。
+ * NMI不受影响，在NMI中运行的代码不能依赖fn改写的内容
+ */
+
+#pragma once
+#ifndef __LEAFOS_STOP_MACHINE_H__
+#define __LEAFOS_STOP_MACHINE_H__
+
+#include <stdint.h>
+
+// 停机执行fn(arg)并返回它的返回值。paused_ns不为空时带回停机的时长，
+// 即从关中断到恢复中断之间的纳秒数。同一时刻只有一个调用者，其余的等待
+int stop_machine(int (*fn)(void*), void* arg, uint64_t* paused_ns = nullptr);
+
+#endif // __LEAFOS_STOP_MACHINE_H__
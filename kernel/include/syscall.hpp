@@ -0,0 +1,64 @@
+/**
+ * leafOS - 系统调用
+ *
+ * x86_64经SYSCALL进入(MSR_LSTAR)，入口用SWAPGS换上内核的GS，由每CPU数据找到内核栈；
+ * aarch64经SVC进入VBAR_EL1向量表中来自EL0的同步异常项。入口只保存最小的现场:
+ * 返回地址、标志、用户栈指针和会被C代码改写的参数寄存器，然后按调用号查表调用处理函数。
+ *
+ * 调用约定与Linux相同:
+ *   x86_64  调用号rax，参数rdi rsi rdx r10 r8 r9，返回值rax；rcx和r11被改写。
+ *           内核代码可能使用SSE，XMM寄存器不保证保留
+ *   aarch64 调用号x8，参数x0-x5，返回值x0
+ * 其余通用寄存器保持不变。调用号不存在时返回-ENOSYS。
+ *
+ * 还没有进程: user_call在当前地址空间中同步运行一段用户态代码，直到它调用SYS_exit。
+ * 用户态在关中断的状态下运行，系统调用也在关中断下处理，期间不会被调度走
+ */
+
+#pragma once
+#ifndef __LEAFOS_SYSCALL_H__
+#define __LEAFOS_SYSCALL_H__
+
+#include <stdint.h>
+#include <vmm.hpp>
+
+// 全部系统调用，调用号按这里的顺序从0开始。增加一项要在某个源文件中定义sys_<名字>，
+// 调用号表由这个列表在编译期生成
+#define LEAFOS_SYSCALLS(X)  \
+    X(getpid)               \
+    X(exit)                 \
+    X(clock_gettime)        \
+    X(getcpu)
+
+enum : uint64_t {
+#define SYSCALL_NR(name) SYS_##name,
+    LEAFOS_SYSCALLS(SYSCALL_NR)
+#undef SYSCALL_NR
+    SYS_COUNT
+};
+
+typedef int64_t (*syscall_fn)(uint64_t a0, uint64_t a1, uint64_t a2, uint64_t a3, uint64_t a4, uint64_t a5);
+
+#define SYSCALL_DECL(name) \
+    int64_t sys_##name(uint64_t a0, uint64_t a1, uint64_t a2, uint64_t a3, uint64_t a4, uint64_t a5);
+LEAFOS_SYSCALLS(SYSCALL_DECL)
+#undef SYSCALL_DECL
+
+#if defined(__x86_64__)
+// 每个CPU的GDT中都有这个段，段界限是CPU的编号，用户态以LSL读取(vDSO的getcpu)
+constexpr uint16_t GDT_CPU_SELECTOR = 0x133;
+#endif
+
+// [addr, addr + len)是否在用户映射窗口中。只检查范围: 系统调用访问用户内存时
+// 不处理缺页，用户程序传入未映射的地址会使内核出错
+static inline bool access_ok(uint64_t addr, uint64_t len)
+{
+    return addr >= mm::USER_BASE && addr < mm::USER_END && len <= mm::USER_END - addr;
+}
+
+// 从用户态的pc开始执行，栈顶为sp，arg放在第一个参数寄存器中，返回它传给SYS_exit的值。
+// pc和sp要在用户映射窗口中(否则返回-EFAULT)，代码和栈由调用者映射到当前地址空间；
+// 本CPU没有完成系统调用的设置时返回-ENODEV
+int64_t user_call(uintptr_t pc, uintptr_t sp, uint64_t arg);
+
+#endif // __LEAFOS_SYSCALL_H__
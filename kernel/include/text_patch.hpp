@@ -0,0 +1,27 @@
+/**
+ * leafOS - 内核代码改写
+ *
+ * 内核代码所在的页可能被固件映射为只读，改写时把目标所在的物理页临时映射到
+ * 专用的可写窗口，经这个别名写入，再同步指令缓存。改写总是用一次对齐的8字节存储完成，
+ * 同时在执行这段代码的CPU(包括其中到来的NMI)看到的要么是旧指令、要么是新指令，
+ * 因此目标不能跨8字节边界
+ */
+
+#pragma once
+#ifndef __LEAFOS_TEXT_PATCH_H__
+#define __LEAFOS_TEXT_PATCH_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// [addr, addr + len)是否在同一个对齐的8字节字中，即能否由text_poke改写
+static inline bool text_poke_atomic(uintptr_t addr, size_t len)
+{
+    return len && (addr & 7) + len <= 8;
+}
+
+// 把src处的len字节写到内核代码addr处，成功返回0。目标跨8字节边界时返回-EINVAL，
+// addr没有映射返回-EFAULT，建立别名失败返回对应的错误码
+int text_poke(void* addr, const void* src, size_t len);
+
+#endif // __LEAFOS_TEXT_PATCH_H__
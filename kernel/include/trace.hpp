@@ -0,0 +1,176 @@
+/**
+ * leafOS - 静态跟踪点
+ *
+ * 跟踪点总是编入内核。每个事件有一个开关字节，关闭时调用处只有一次读取和一个预测为不跳转的
+ * 分支；开启时把定长的二进制记录(时间戳、事件号和各字段的原始值)追加到当前CPU自己的缓冲区，
+ * 不加锁。缓冲区写满后丢弃新记录并计数；NMI中嵌套的记录同样丢弃。
+ *
+ * 事件的字段用X宏列出，在头文件中声明、在恰好一个源文件中定义:
+ *
+ *     #define TRACE_IO_SUBMIT(F) F(uint8_t, opcode) F(int32_t, fd) F(uint64_t, user_data)
+ *     TRACE_EVENT(io_submit, TRACE_IO_SUBMIT)         // 头文件
+ *     DEFINE_TRACE_EVENT(io_submit, TRACE_IO_SUBMIT); // 一个源文件
+ *
+ *     trace_io_submit(sqe.opcode, sqe.fd, sqe.user_data);
+ *
+ * 字段可以是整数、bool、指针或定长char数组(记录字符串的前N-1个字符)。
+ * 名字以_begin/_end结尾的一对事件在tools/trace2json.py中还原为一段持续时间。
+ *
+ * 以 make TRACE_EVENTS=<通配符,...> 构建时，trace_init开启名字匹配的事件，
+ * 内核空闲时trace_dump把格式描述和各CPU的缓冲区以十六进制输出到串口，
+ * tools/trace2json.py把日志转换为Chrome跟踪格式(chrome://tracing、Perfetto)
+ */
+
+#pragma once
+#ifndef __LEAFOS_TRACE_H__
+#define __LEAFOS_TRACE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+enum TraceFieldType : uint8_t {
+    TRACE_UINT,
+    TRACE_INT,
+    TRACE_PTR,
+    TRACE_STR,      // 以0结尾，不足时补0
+};
+
+struct TraceField {
+    const char* name;
+    uint16_t    offset;
+    uint8_t     size;
+    uint8_t     type;   // TraceFieldType
+};
+
+// 登记项由链接器收集到trace_events段，事件号是它在段中的下标
+struct TraceEvent {
+    const char*       name;
+    bool*             enabled;
+    const TraceField* fields;
+    uint16_t          field_count;
+    uint16_t          size;         // 记录体的字节数
+};
+
+// 缓冲区中每条记录的头部，记录体紧随其后，整条记录按8字节对齐
+struct TraceHeader {
+    uint64_t ts;        // arch::read_counter()
+    uint16_t id;
+    uint16_t size;      // 记录体的字节数，不含对齐填充
+    uint32_t reserved;
+};
+
+static_assert(sizeof(TraceHeader) == 16, "TraceHeader布局错误");
+
+// ---- 字段类型 ----
+
+// 只为支持的类型特化，其他类型在编译时报错；arg是跟踪函数的参数类型
+template <typename T> struct TraceType;
+
+#define TRACE_TYPE_(T, kind)                                \
+    template <> struct TraceType<T> {                       \
+        static const uint8_t value = kind;                  \
+        typedef T arg;                                      \
+    }
+
+TRACE_TYPE_(bool, TRACE_UINT);
+TRACE_TYPE_(uint8_t, TRACE_UINT);
+TRACE_TYPE_(uint16_t, TRACE_UINT);
+TRACE_TYPE_(uint32_t, TRACE_UINT);
+TRACE_TYPE_(uint64_t, TRACE_UINT);
+TRACE_TYPE_(int8_t, TRACE_INT);
+TRACE_TYPE_(int16_t, TRACE_INT);
+TRACE_TYPE_(int32_t, TRACE_INT);
+TRACE_TYPE_(int64_t, TRACE_INT);
+
+#undef TRACE_TYPE_
+
+template <typename T> struct TraceType<T*> {
+    static const uint8_t value = TRACE_PTR;
+    typedef T* arg;
+};
+
+template <size_t N> struct TraceType<char[N]> {
+    static const uint8_t value = TRACE_STR;
+    typedef const char* arg;
+};
+
+template <typename T>
+using trace_arg_t = typename TraceType<T>::arg;
+
+// 让char[N]这样的类型也能写成"类型 名字"的形式
+template <typename T>
+using trace_member_t = T;
+
+template <typename T>
+static inline void trace_assign(T& dst, T src)
+{
+    dst = src;
+}
+
+template <size_t N>
+static inline void trace_assign(char (&dst)[N], const char* src)
+{
+    size_t i = 0;
+    for (; src && src[i] && i < N - 1; i++) {
+        dst[i] = src[i];
+    }
+    for (; i < N; i++) {
+        dst[i] = 0;
+    }
+}
+
+// ---- 事件定义 ----
+
+// 把记录追加到当前CPU的缓冲区；只由跟踪函数在事件开启时调用
+void trace_write(const TraceEvent* ev, const void* rec, size_t size);
+
+#define TRACE_MEMBER_(type, name)   trace_member_t<type> name;
+#define TRACE_PARAM_(type, name)    , trace_arg_t<type> name
+#define TRACE_ASSIGN_(type, name)   trace_assign(rec.name, name);
+#define TRACE_FIELD_(type, name)                                                    \
+    { #name, (uint16_t)offsetof(Record, name), (uint8_t)sizeof(type), TraceType<type>::value },
+
+// 去掉参数列表开头多出的", "
+#define TRACE_REST_(first, ...)     __VA_ARGS__
+#define TRACE_PARAMS_(...)          TRACE_REST_(__VA_ARGS__)
+
+#define TRACE_EVENT(name, FIELDS)                                                   \
+    struct trace_##name##_rec {                                                     \
+        FIELDS(TRACE_MEMBER_)                                                       \
+    };                                                                              \
+    extern bool trace_on_##name;                                                    \
+    extern const TraceEvent trace_event_##name;                                     \
+    static inline void trace_##name(TRACE_PARAMS_(0 FIELDS(TRACE_PARAM_)))          \
+    {                                                                               \
+        if (__builtin_expect(trace_on_##name, 0)) {                                 \
+            trace_##name##_rec rec = {};                                            \
+            FIELDS(TRACE_ASSIGN_)                                                   \
+            trace_write(&trace_event_##name, &rec, sizeof(rec));                    \
+        }                                                                           \
+    }
+
+#define DEFINE_TRACE_EVENT(name, FIELDS)                                            \
+    bool trace_on_##name;                                                           \
+    namespace trace_##name##_desc {                                                 \
+        typedef trace_##name##_rec Record;                                          \
+        const TraceField fields[] = { FIELDS(TRACE_FIELD_) };                       \
+    }                                                                               \
+    const TraceEvent trace_event_##name                                             \
+        __attribute__((used, section("trace_events"), aligned(8))) = {              \
+            #name, &trace_on_##name, trace_##name##_desc::fields,                   \
+            sizeof(trace_##name##_desc::fields) / sizeof(TraceField),               \
+            sizeof(trace_##name##_rec) }
+
+// ---- 控制 ----
+
+// 为当前CPU分配缓冲区；第一次调用时还按构建时的TRACE_EVENTS开启事件。
+// 没有指定TRACE_EVENTS时什么都不做。每个要记录事件的CPU调用一次，需要页分配器
+void trace_init();
+
+// 开启或关闭名字与pat(支持*和?)匹配的事件，返回匹配的个数
+size_t trace_enable(const char* pat, bool on);
+
+// 关闭全部事件，在串口输出格式描述和各CPU缓冲区的内容
+void trace_dump();
+
+#endif // __LEAFOS_TRACE_H__
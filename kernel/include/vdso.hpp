@@ -0,0 +1,38 @@
+/**
+ * leafOS - vDSO
+ *
+ * 每个用户地址空间在固定位置映射两页: 只读的时间页(clock.hpp的ClockPage)和紧随其后的
+ * 代码页。代码页中的函数在用户态直接读取时间页和计数器(x86 TSC，aarch64 CNTVCT，
+ * 由syscall.cpp在CNTKCTL_EL1中允许EL0读取)，不进入内核，
+ * 调用约定与用户态的C函数相同:
+ *   int clock_gettime(int clockid, Timespec* ts)
+ *       CLOCK_REALTIME和CLOCK_MONOTONIC，其他时钟转为SYS_clock_gettime系统调用
+ *   int getcpu(unsigned* cpu, unsigned* node, void* unused)
+ *       x86以LSL读GDT中CPU段的界限，aarch64读TPIDRRO_EL0；node总是0
+ * 对应的系统调用结果相同，供比较和没有映射vDSO时使用。
+ * 两页都是内核映像中的页，所有地址空间共享，不占额外的内存
+ */
+
+#pragma once
+#ifndef __LEAFOS_VDSO_H__
+#define __LEAFOS_VDSO_H__
+
+#include <stdint.h>
+#include <vmm.hpp>
+
+// 放在用户映射窗口的最后两页
+constexpr uint64_t VDSO_DATA = mm::USER_END - 2 * mm::PAGE_SIZE;
+constexpr uint64_t VDSO_TEXT = mm::USER_END - mm::PAGE_SIZE;
+
+struct Timespec {
+    int64_t tv_sec;
+    int64_t tv_nsec;
+};
+
+// 把vDSO映射到as中，由AddressSpace::create调用
+int vdso_map(mm::AddressSpace* as);
+
+// vDSO中名为name的函数的用户态地址，没有时返回0
+uintptr_t vdso_lookup(const char* name);
+
+#endif // __LEAFOS_VDSO_H__
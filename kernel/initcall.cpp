@@ -0,0 +1,356 @@
+/**
+ * leafOS - 分级初始化调用实现
+ *
+ * 启动时把登记项建成依赖图(后继以CSR形式存放)，就绪的初始化由任意空闲CPU领取执行。
+ * 每项记录开始/结束时刻和所在CPU；完成顺序本身就是一个拓扑序，
+ * 沿它扫一遍即可求出关键路径，即CPU再多也省不掉的那部分启动时间
+ */
+
+#include <initcall.hpp>
+#include <console.hpp>
+#include <clock.hpp>
+#include <kheap.hpp>
+#include <kstring.hpp>
+#include <kerrno.hpp>
+#include <spinlock.hpp>
+#include <trace.hpp>
+#include <arch/cpu.hpp>
+
+// 每项初始化的执行，名字截断到31个字符
+#define TRACE_INITCALL_BEGIN(F) F(char[32], fn) F(uint32_t, level)
+#define TRACE_INITCALL_END(F)   F(char[32], fn) F(int32_t, ret)
+
+TRACE_EVENT(initcall_begin, TRACE_INITCALL_BEGIN)
+TRACE_EVENT(initcall_end, TRACE_INITCALL_END)
+
+DEFINE_TRACE_EVENT(initcall_begin, TRACE_INITCALL_BEGIN);
+DEFINE_TRACE_EVENT(initcall_end, TRACE_INITCALL_END);
+
+// 由链接器为initcalls段自动生成
+extern "C" const Initcall __start_initcalls[];
+extern "C" const Initcall __stop_initcalls[];
+
+namespace {
+
+enum class State : uint8_t {
+    Waiting,
+    Ready,
+    Running,
+    Done,
+};
+
+struct Node {
+    const Initcall* call;
+    State    state;
+    uint32_t pending;       // 尚未完成的前置项数
+    uint32_t succ_begin;    // 后继在edges中的区间
+    uint32_t succ_end;
+    uint32_t cpu;
+    int      ret;
+    uint64_t start_ns;
+    uint64_t end_ns;
+    uint64_t path_ns;       // 以本项结束的最长依赖链用时
+    int32_t  crit_pred;     // 该链上的前一项，没有时为-1
+};
+
+struct Graph {
+    Node*     nodes;
+    uint32_t* edges;
+    uint32_t* order;        // 完成顺序
+    uint32_t  count;
+    uint32_t  finished;
+    uint32_t  ready;
+    uint32_t  running;
+    Spinlock  lock;
+};
+
+enum : uint32_t {
+    IDLE,
+    ACTIVE,
+    FINISHED,
+};
+
+Graph             g_graph;
+volatile uint32_t g_phase = IDLE;
+
+// name是否出现在以空格分隔的列表中
+bool __init listed(const char* list, const char* name)
+{
+    size_t len = strlen(name);
+    while (*list) {
+        while (*list == ' ') {
+            list++;
+        }
+        const char* end = list;
+        while (*end && *end != ' ') {
+            end++;
+        }
+        if ((size_t)(end - list) == len && strncmp(list, name, len) == 0) {
+            return true;
+        }
+        list = end;
+    }
+    return false;
+}
+
+// b是否必须在a之前完成
+bool __init depends(const Initcall& a, const Initcall& b)
+{
+    if (&a == &b) {
+        return false;
+    }
+    if (!a.deps) {
+        return b.level < a.level;
+    }
+    return listed(a.deps, b.name);
+}
+
+// 声明了却找不到的依赖多半是拼写错误，只提示，不阻塞
+void __init check_deps(const Initcall* calls, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        const char* p = calls[i].deps;
+        while (p && *p) {
+            while (*p == ' ') {
+                p++;
+            }
+            const char* end = p;
+            while (*end && *end != ' ') {
+                end++;
+            }
+            bool found = end == p;
+            for (uint32_t j = 0; j < count && !found; j++) {
+                size_t len = strlen(calls[j].name);
+                found = (size_t)(end - p) == len && strncmp(p, calls[j].name, len) == 0;
+            }
+            if (!found) {
+                char name[64];
+                size_t len = (size_t)(end - p) < sizeof(name) ? (size_t)(end - p) : sizeof(name) - 1;
+                memcpy(name, p, len);
+                name[len] = 0;
+                console::Line().str("initcall ").str(calls[i].name)
+                    .str(": unknown dependency ").str(name).print();
+            }
+            p = end;
+        }
+    }
+}
+
+bool __init build(Graph& g, const Initcall* calls, uint32_t count)
+{
+    g.count = count;
+    g.nodes = static_cast<Node*>(kmalloc(count * sizeof(Node)));
+    g.order = static_cast<uint32_t*>(kmalloc(count * sizeof(uint32_t)));
+    if (!g.nodes || !g.order) {
+        return false;
+    }
+
+    uint32_t edges = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        Node& n = g.nodes[i];
+        memset(&n, 0, sizeof(n));
+        n.call = &calls[i];
+        n.crit_pred = -1;
+        for (uint32_t j = 0; j < count; j++) {
+            if (depends(calls[i], calls[j])) {
+                n.pending++;
+                edges++;
+            }
+        }
+        n.state = n.pending ? State::Waiting : State::Ready;
+        g.ready += !n.pending;
+    }
+
+    g.edges = static_cast<uint32_t*>(kmalloc((edges ? edges : 1) * sizeof(uint32_t)));
+    if (!g.edges) {
+        return false;
+    }
+    uint32_t pos = 0;
+    for (uint32_t j = 0; j < count; j++) {
+        g.nodes[j].succ_begin = pos;
+        for (uint32_t i = 0; i < count; i++) {
+            if (depends(calls[i], calls[j])) {
+                g.edges[pos++] = i;
+            }
+        }
+        g.nodes[j].succ_end = pos;
+    }
+    return true;
+}
+
+// 领取就绪项执行，直到全部完成。调用时不持有锁
+void work(Graph& g)
+{
+    uint32_t cpu = arch::cpu_id();
+    for (;;) {
+        g.lock.lock();
+        if (g.finished == g.count) {
+            g.lock.unlock();
+            return;
+        }
+
+        int32_t pick = -1;
+        for (uint32_t i = 0; i < g.count; i++) {
+            if (g.nodes[i].state == State::Ready &&
+                (pick < 0 || g.nodes[i].call->level < g.nodes[pick].call->level)) {
+                pick = (int32_t)i;
+            }
+        }
+        if (pick < 0) {
+            if (g.running) {
+                // 其他CPU上还有初始化在执行，不持锁等它们放出新的就绪项
+                g.lock.unlock();
+                while (!__atomic_load_n(&g.ready, __ATOMIC_RELAXED) &&
+                       __atomic_load_n(&g.running, __ATOMIC_RELAXED)) {
+                    cpu_relax();
+                }
+                continue;
+            }
+            // 没有在执行的，剩下的都在依赖环上
+            uint64_t now = clock_ns();
+            for (uint32_t i = 0; i < g.count; i++) {
+                Node& n = g.nodes[i];
+                if (n.state == State::Waiting) {
+                    n.state = State::Done;
+                    n.ret = -EDEADLK;
+                    n.start_ns = n.end_ns = now;
+                    g.order[g.finished++] = i;
+                }
+            }
+            g.lock.unlock();
+            return;
+        }
+
+        Node& n = g.nodes[pick];
+        n.state = State::Running;
+        g.ready--;
+        g.running++;
+        g.lock.unlock();
+
+        n.cpu = cpu;
+        n.start_ns = clock_ns();
+        trace_initcall_begin(n.call->name, n.call->level);
+        n.ret = n.call->fn();
+        trace_initcall_end(n.call->name, n.ret);
+        n.end_ns = clock_ns();
+
+        g.lock.lock();
+        n.state = State::Done;
+        g.running--;
+        g.order[g.finished++] = (uint32_t)pick;
+        for (uint32_t e = n.succ_begin; e < n.succ_end; e++) {
+            Node& s = g.nodes[g.edges[e]];
+            if (--s.pending == 0 && s.state == State::Waiting) {
+                s.state = State::Ready;
+                g.ready++;
+            }
+        }
+        g.lock.unlock();
+    }
+}
+
+void __init report(Graph& g, uint64_t wall_ns)
+{
+    uint64_t sum_ns = 0;
+    uint64_t cpus = 0;
+    int32_t last = -1;
+    for (uint32_t k = 0; k < g.count; k++) {
+        Node& n = g.nodes[g.order[k]];
+        uint64_t dur = n.end_ns - n.start_ns;
+        sum_ns += dur;
+        cpus |= 1ull << (n.cpu & 63);
+
+        n.path_ns += dur;
+        for (uint32_t e = n.succ_begin; e < n.succ_end; e++) {
+            Node& s = g.nodes[g.edges[e]];
+            if (n.path_ns > s.path_ns) {
+                s.path_ns = n.path_ns;
+                s.crit_pred = (int32_t)g.order[k];
+            }
+        }
+        if (last < 0 || n.path_ns > g.nodes[last].path_ns) {
+            last = (int32_t)g.order[k];
+        }
+    }
+
+    uint32_t ncpus = 0;
+    for (; cpus; cpus &= cpus - 1) {
+        ncpus++;
+    }
+    console::Line().str("initcalls: ").num(g.count).str(" calls on ").num(ncpus)
+        .str(" cpu(s), wall ").num(wall_ns / 1000).str(" us, sum ").num(sum_ns / 1000)
+        .str(" us, critical path ").num(last < 0 ? 0 : g.nodes[last].path_ns / 1000).str(" us").print();
+
+    for (uint32_t k = 0; k < g.count; k++) {
+        const Node& n = g.nodes[g.order[k]];
+        console::Line line;
+        line.str("  +").num(n.start_ns / 1000, 8).str(" us ").num((n.end_ns - n.start_ns) / 1000, 8)
+            .str(" us  cpu").num(n.cpu).str("  ").str(n.call->name);
+        if (n.ret < 0) {
+            line.str("  error ").num(n.ret);
+        }
+        line.print();
+    }
+
+    // 沿前驱回溯得到的是逆序，先反转
+    uint32_t len = 0;
+    for (int32_t i = last; i >= 0; i = g.nodes[i].crit_pred) {
+        g.order[len++] = (uint32_t)i;
+    }
+    console::Line().str("  critical path:").print();
+    while (len) {
+        const Node& n = g.nodes[g.order[--len]];
+        console::Line().str("    ").num((n.end_ns - n.start_ns) / 1000, 8).str(" us  ")
+            .str(n.call->name).print();
+    }
+}
+
+} // namespace
+
+int __init run_initcalls()
+{
+    // 跟踪要用到时钟和控制台，它们先于所有登记项就绪
+    clock_init();
+    console::init();
+
+    const Initcall* calls = __start_initcalls;
+    uint32_t count = (uint32_t)(__stop_initcalls - __start_initcalls);
+    Graph& g = g_graph;
+    if (!build(g, calls, count)) {
+        kfree(g.nodes);
+        kfree(g.order);
+        return (int)count;
+    }
+    check_deps(calls, count);
+
+    uint64_t t0 = clock_ns();
+    __atomic_store_n(&g_phase, ACTIVE, __ATOMIC_RELEASE);
+    work(g);
+    __atomic_store_n(&g_phase, FINISHED, __ATOMIC_RELEASE);
+    uint64_t wall_ns = clock_ns() - t0;
+
+    int failed = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (g.nodes[i].ret < 0) {
+            failed++;
+        }
+    }
+    report(g, wall_ns);
+
+    kfree(g.edges);
+    kfree(g.order);
+    kfree(g.nodes);
+    g.nodes = nullptr;
+    return failed;
+}
+
+void initcall_worker()
+{
+    uint32_t phase;
+    while ((phase = __atomic_load_n(&g_phase, __ATOMIC_ACQUIRE)) == IDLE) {
+        cpu_relax();
+    }
+    if (phase == ACTIVE) {
+        work(g_graph);
+    }
+}
@@ -0,0 +1,496 @@
+/**
+ * leafOS - 异步I/O提交/完成环实现
+ *
+ * 现有的块设备和文件系统驱动都是同步的，请求在处理SQE时当场完成；
+ * 只有超时(以及挂在超时之后的链)需要挂起，之后由enter或轮询检查到期。
+ */
+
+#include <io_ring.hpp>
+#include <vfs.hpp>
+#include <block.hpp>
+#include <vmm.hpp>
+#include <clock.hpp>
+#include <page_alloc.hpp>
+#include <kheap.hpp>
+#include <kstring.hpp>
+#include <trace.hpp>
+
+// 一项请求的执行过程，以及每个完成项(包括取消和超时)
+#define TRACE_IO_OP_BEGIN(F) \
+    F(uint8_t, opcode) F(int32_t, fd) F(uint64_t, off) F(uint32_t, len) F(uint64_t, user_data)
+#define TRACE_IO_OP_END(F)      F(uint64_t, user_data) F(int32_t, res)
+#define TRACE_IO_COMPLETE(F)    F(uint64_t, user_data) F(int32_t, res)
+
+TRACE_EVENT(io_op_begin, TRACE_IO_OP_BEGIN)
+TRACE_EVENT(io_op_end, TRACE_IO_OP_END)
+TRACE_EVENT(io_complete, TRACE_IO_COMPLETE)
+
+DEFINE_TRACE_EVENT(io_op_begin, TRACE_IO_OP_BEGIN);
+DEFINE_TRACE_EVENT(io_op_end, TRACE_IO_OP_END);
+DEFINE_TRACE_EVENT(io_complete, TRACE_IO_COMPLETE);
+
+namespace {
+
+constexpr uint32_t MAX_ENTRIES = 4096;
+constexpr uint64_t SQPOLL_IDLE_NS = 10 * 1000 * 1000;  // 轮询空闲10ms后停止
+
+Spinlock g_poll_lock;
+IoRing*  g_poll_list;
+
+uint32_t round_pow2(uint32_t n)
+{
+    uint32_t v = 1;
+    while (v < n) {
+        v <<= 1;
+    }
+    return v;
+}
+
+inline uint64_t align_up(uint64_t v, uint64_t a)
+{
+    return (v + a - 1) & ~(a - 1);
+}
+
+} // namespace
+
+// ============================================
+// 创建与注册
+// ============================================
+
+IoRing* IoRing::create(uint32_t sq_entries, uint32_t cq_entries, uint32_t setup_flags)
+{
+    if (!sq_entries || sq_entries > MAX_ENTRIES || cq_entries > 2 * MAX_ENTRIES) {
+        return nullptr;
+    }
+    sq_entries = round_pow2(sq_entries);
+    cq_entries = round_pow2(cq_entries ? cq_entries : sq_entries * 2);
+    if (cq_entries < sq_entries) {
+        cq_entries = sq_entries;
+    }
+
+    uint64_t sqes_off = align_up(sizeof(IoRingShared), 64);
+    uint64_t cqes_off = sqes_off + (uint64_t)sq_entries * sizeof(IoSqe);
+    uint64_t bytes = cqes_off + (uint64_t)cq_entries * sizeof(IoCqe);
+
+    IoRing* ring = knew<IoRing>();
+    if (!ring) {
+        return nullptr;
+    }
+    ring->order_ = mm::size_to_order(bytes);
+    ring->shared_ = static_cast<IoRingShared*>(mm::alloc_pages_zeroed(ring->order_));
+    if (!ring->shared_ || !ring->scratch_.reserve(sq_entries)) {
+        ring->destroy();
+        return nullptr;
+    }
+
+    IoRingShared* s = ring->shared_;
+    s->sq_entries = sq_entries;
+    s->cq_entries = cq_entries;
+    s->sqes_off = (uint32_t)sqes_off;
+    s->cqes_off = (uint32_t)cqes_off;
+    ring->sqes_ = io_sqes(s);
+    ring->cqes_ = io_cqes(s);
+    ring->sq_entries_ = sq_entries;
+    ring->cq_entries_ = cq_entries;
+
+    ring->setup_flags_ = setup_flags;
+    if (setup_flags & IO_SETUP_SQPOLL) {
+        ring->idle_since_ = clock_ns();
+        SpinGuard guard(g_poll_lock);
+        ring->poll_next_ = g_poll_list;
+        g_poll_list = ring;
+    }
+    return ring;
+}
+
+void IoRing::destroy()
+{
+    if (setup_flags_ & IO_SETUP_SQPOLL) {
+        SpinGuard guard(g_poll_lock);
+        for (IoRing** p = &g_poll_list; *p; p = &(*p)->poll_next_) {
+            if (*p == this) {
+                *p = poll_next_;
+                break;
+            }
+        }
+    }
+
+    lock_.lock();
+    for (size_t i = 0; i < timers_.size(); i++) {
+        kfree(timers_[i].rest);
+    }
+    if (user_as_) {
+        // 先收回用户的映射，否则用户还能访问释放后的页
+        for (uint64_t i = 0; i < (1ULL << order_); i++) {
+            user_as_->unmap(user_va_ + (i << mm::PAGE_SHIFT));
+        }
+    }
+    if (shared_) {
+        mm::free_pages(shared_, order_);
+    }
+    lock_.unlock();
+    kdelete(this);
+}
+
+int IoRing::register_files(fs::Inode* const* files, uint32_t count)
+{
+    SpinGuard guard(lock_);
+    files_.clear();
+    for (uint32_t i = 0; i < count; i++) {
+        if (!files_.push_back(files[i])) {
+            files_.clear();
+            return -ENOMEM;
+        }
+    }
+    return 0;
+}
+
+int IoRing::register_blockdevs(BlockDevice* const* devs, uint32_t count)
+{
+    SpinGuard guard(lock_);
+    blockdevs_.clear();
+    for (uint32_t i = 0; i < count; i++) {
+        if (!blockdevs_.push_back(devs[i])) {
+            blockdevs_.clear();
+            return -ENOMEM;
+        }
+    }
+    return 0;
+}
+
+int IoRing::map_user(mm::AddressSpace* as, uint64_t va)
+{
+    // 之后SQE中的地址都按这个地址空间解释；destroy只记得一处映射
+    if (user_as_) {
+        return -EBUSY;
+    }
+    uint64_t pages = 1ULL << order_;
+    uint64_t pa = reinterpret_cast<uintptr_t>(shared_);
+
+    for (uint64_t i = 0; i < pages; i++) {
+        int err = as->map(va + (i << mm::PAGE_SHIFT), pa + (i << mm::PAGE_SHIFT),
+                          mm::VM_USER | mm::VM_WRITE);
+        if (err) {
+            while (i--) {
+                as->unmap(va + (i << mm::PAGE_SHIFT));
+            }
+            return err;
+        }
+    }
+    user_as_ = as;
+    user_va_ = va;
+    return 0;
+}
+
+// ============================================
+// 完成队列
+// ============================================
+
+uint32_t IoRing::cq_ready() const
+{
+    return __atomic_load_n(&shared_->cq_tail, __ATOMIC_RELAXED) -
+           __atomic_load_n(&shared_->cq_head, __ATOMIC_ACQUIRE);
+}
+
+uint32_t IoRing::cq_space() const
+{
+    uint32_t ready = cq_ready();
+    return ready < cq_entries_ ? cq_entries_ - ready : 0;
+}
+
+void IoRing::post(uint64_t user_data, int32_t res)
+{
+    if (!cq_space()) {
+        // 提交前已预留空间，只有消费者把cq_head改乱时才会走到这里
+        __atomic_add_fetch(&shared_->cq_overflow, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    trace_io_complete(user_data, res);
+    uint32_t tail = shared_->cq_tail;
+    IoCqe& cqe = cqes_[tail & (cq_entries_ - 1)];
+    cqe.user_data = user_data;
+    cqe.res = res;
+    cqe.flags = 0;
+    __atomic_store_n(&shared_->cq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+// ============================================
+// 执行请求
+// ============================================
+
+int32_t IoRing::execute(const IoSqe& sqe)
+{
+    switch (sqe.opcode) {
+    case IO_OP_NOP:
+        return 0;
+
+    case IO_OP_READ:
+    case IO_OP_WRITE: {
+        if (sqe.fd < 0 || (size_t)sqe.fd >= files_.size() || !files_[sqe.fd]) {
+            return -EBADF;
+        }
+        fs::Inode* node = files_[sqe.fd];
+        bool rd = sqe.opcode == IO_OP_READ;
+        // 结果要放进int32_t，更长的请求按短读写处理
+        uint32_t len = sqe.len > INT32_MAX ? (uint32_t)INT32_MAX : sqe.len;
+        if (!user_as_) {
+            void* buf = reinterpret_cast<void*>(sqe.addr);
+            int64_t n = rd ? node->read(sqe.off, buf, len) : node->write(sqe.off, buf, len);
+            return (int32_t)n;
+        }
+
+        // 用户环: 缓冲区在用户地址空间中，逐页翻译；已传输部分数据时返回其长度
+        uint32_t done = 0;
+        while (done < len) {
+            uint64_t va = sqe.addr + done;
+            uint64_t room = mm::PAGE_SIZE - (va & (mm::PAGE_SIZE - 1));
+            uint32_t chunk = len - done < room ? len - done : (uint32_t)room;
+            uint64_t pa = user_as_->translate_user(va, rd);
+            if (!pa) {
+                return done ? (int32_t)done : -EFAULT;
+            }
+            void* buf = reinterpret_cast<void*>(pa);
+            int64_t n = rd ? node->read(sqe.off + done, buf, chunk)
+                           : node->write(sqe.off + done, buf, chunk);
+            if (n < 0) {
+                return done ? (int32_t)done : (int32_t)n;
+            }
+            done += (uint32_t)n;
+            if ((uint32_t)n < chunk) {
+                break;
+            }
+        }
+        return (int32_t)done;
+    }
+
+    case IO_OP_BLOCK_READ:
+    case IO_OP_BLOCK_WRITE: {
+        if (sqe.fd < 0 || (size_t)sqe.fd >= blockdevs_.size() || !blockdevs_[sqe.fd]) {
+            return -EBADF;
+        }
+        if (sqe.len > INT32_MAX) {
+            return -EINVAL;
+        }
+        BlockDevice* dev = blockdevs_[sqe.fd];
+        bool rd = sqe.opcode == IO_OP_BLOCK_READ;
+        if (!user_as_) {
+            void* buf = reinterpret_cast<void*>(sqe.addr);
+            int err = rd ? dev->read(sqe.off, sqe.len, buf) : dev->write(sqe.off, sqe.len, buf);
+            return err ? err : (int32_t)sqe.len;
+        }
+
+        // 用户环: 缓冲区按扇区对齐，扇区就不会跨页，每次传输一页中的扇区
+        uint32_t ss = dev->sector_size();
+        if (ss > mm::PAGE_SIZE || sqe.addr % ss) {
+            return -EINVAL;
+        }
+        uint32_t done = 0;
+        while (done < sqe.len) {
+            uint64_t va = sqe.addr + (uint64_t)done * ss;
+            uint32_t count = (uint32_t)((mm::PAGE_SIZE - (va & (mm::PAGE_SIZE - 1))) / ss);
+            if (count > sqe.len - done) {
+                count = sqe.len - done;
+            }
+            uint64_t pa = user_as_->translate_user(va, rd);
+            if (!pa) {
+                return -EFAULT;
+            }
+            void* buf = reinterpret_cast<void*>(pa);
+            int err = rd ? dev->read(sqe.off + done, count, buf)
+                         : dev->write(sqe.off + done, count, buf);
+            if (err) {
+                return err;
+            }
+            done += count;
+        }
+        return (int32_t)done;
+    }
+
+    default:
+        return -EINVAL;
+    }
+}
+
+void IoRing::cancel_chain(const IoSqe* chain, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        post(chain[i].user_data, -ECANCELED);
+    }
+}
+
+void IoRing::run_chain(const IoSqe* chain, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        const IoSqe& sqe = chain[i];
+
+        if (sqe.opcode == IO_OP_TIMEOUT) {
+            uint64_t deadline = (sqe.op_flags & IO_TIMEOUT_ABS) ? sqe.off : clock_ns() + sqe.off;
+            Timer t = { deadline, sqe.user_data, sqe.op_flags, count - i - 1, nullptr };
+            if (t.rest_count) {
+                t.rest = static_cast<IoSqe*>(kmalloc(t.rest_count * sizeof(IoSqe)));
+                if (!t.rest) {
+                    post(sqe.user_data, -ENOMEM);
+                    cancel_chain(chain + i + 1, count - i - 1);
+                    return;
+                }
+                memcpy(t.rest, chain + i + 1, t.rest_count * sizeof(IoSqe));
+            }
+            if (!timers_.push_back(t)) {
+                kfree(t.rest);
+                post(sqe.user_data, -ENOMEM);
+                cancel_chain(chain + i + 1, count - i - 1);
+            }
+            return;     // 链的剩余部分在超时到期后继续
+        }
+
+        trace_io_op_begin(sqe.opcode, sqe.fd, sqe.off, sqe.len, sqe.user_data);
+        int32_t res = execute(sqe);
+        trace_io_op_end(sqe.user_data, res);
+        post(sqe.user_data, res);
+
+        // 出错或读写不足都打断链接
+        bool ok = res >= 0 &&
+                  !((sqe.opcode == IO_OP_READ || sqe.opcode == IO_OP_WRITE) && (uint32_t)res != sqe.len);
+        if (!ok) {
+            cancel_chain(chain + i + 1, count - i - 1);
+            return;
+        }
+    }
+}
+
+bool IoRing::run_timers()
+{
+    if (timers_.empty()) {
+        return false;
+    }
+
+    uint64_t now = clock_ns();
+    bool fired = false;
+    for (size_t i = 0; i < timers_.size();) {
+        Timer t = timers_[i];
+        // 完成超时本身以及后续整条链都需要CQ空间
+        if (t.deadline > now || cq_space() < 1 + t.rest_count) {
+            i++;
+            continue;
+        }
+        timers_[i] = timers_.back();
+        timers_.pop_back();
+        fired = true;
+
+        post(t.user_data, -ETIME);
+        if (t.rest) {
+            if (t.op_flags & IO_TIMEOUT_ETIME_SUCCESS) {
+                run_chain(t.rest, t.rest_count);
+            } else {
+                cancel_chain(t.rest, t.rest_count);
+            }
+            kfree(t.rest);
+        }
+    }
+    return fired;
+}
+
+// ============================================
+// 提交
+// ============================================
+
+uint32_t IoRing::submit(uint32_t max)
+{
+    IoRingShared* s = shared_;
+    uint32_t mask = sq_entries_ - 1;
+    uint32_t head = s->sq_head;
+    uint32_t avail = __atomic_load_n(&s->sq_tail, __ATOMIC_ACQUIRE) - head;
+    if (avail > sq_entries_) {
+        avail = sq_entries_;        // tail被写坏时最多处理一圈
+    }
+    if (avail > max) {
+        avail = max;
+    }
+
+    uint32_t done = 0;
+    while (done < avail) {
+        // 收集一条链: 链在本次可提交范围的末尾自然结束
+        scratch_.clear();
+        do {
+            if (!scratch_.push_back(sqes_[(head + scratch_.size()) & mask])) {
+                return done;    // create已预留sq_entries项，不会失败
+            }
+        } while ((scratch_.back().flags & IOSQE_LINK) && done + scratch_.size() < avail);
+
+        uint32_t n = (uint32_t)scratch_.size();
+        if (cq_space() < n) {
+            break;          // 等消费者腾出CQ再继续，SQE留在队列中
+        }
+
+        head += n;
+        done += n;
+        __atomic_store_n(&s->sq_head, head, __ATOMIC_RELEASE);
+        run_chain(scratch_.data(), n);
+    }
+    return done;
+}
+
+int IoRing::enter(uint32_t to_submit, uint32_t min_complete, uint32_t flags)
+{
+    SpinGuard guard(lock_);
+
+    if (flags & IO_ENTER_SQ_WAKEUP) {
+        __atomic_and_fetch(&shared_->sq_flags, ~IO_SQ_NEED_WAKEUP, __ATOMIC_RELEASE);
+        idle_since_ = clock_ns();
+    }
+
+    uint32_t submitted = submit(to_submit);
+    run_timers();
+
+    if (flags & IO_ENTER_GETEVENTS) {
+        // 没有调度器可以让出CPU，只能忙等挂起的超时到期
+        while (cq_ready() < min_complete) {
+            if (timers_.empty()) {
+                return submitted ? (int)submitted : -EAGAIN;
+            }
+            cpu_relax();
+            run_timers();
+        }
+    }
+    return (int)submitted;
+}
+
+// ============================================
+// SQPOLL
+// ============================================
+
+bool IoRing::poll()
+{
+    if (!lock_.try_lock()) {
+        return false;
+    }
+
+    bool busy = run_timers();
+    if (!(__atomic_load_n(&shared_->sq_flags, __ATOMIC_RELAXED) & IO_SQ_NEED_WAKEUP)) {
+        busy |= submit(~0u) != 0;
+
+        uint64_t now = clock_ns();
+        if (busy) {
+            idle_since_ = now;
+        } else if (now - idle_since_ > SQPOLL_IDLE_NS) {
+            __atomic_or_fetch(&shared_->sq_flags, IO_SQ_NEED_WAKEUP, __ATOMIC_RELEASE);
+            // 置位后再看一次，避免提交者在置位前刚好提交、随后又看到需要唤醒的竞争
+            if (__atomic_load_n(&shared_->sq_tail, __ATOMIC_ACQUIRE) != shared_->sq_head) {
+                __atomic_and_fetch(&shared_->sq_flags, ~IO_SQ_NEED_WAKEUP, __ATOMIC_RELEASE);
+            }
+        }
+    }
+
+    lock_.unlock();
+    return busy;
+}
+
+bool io_ring_poll()
+{
+    SpinGuard guard(g_poll_lock);
+    for (IoRing* r = g_poll_list; r; r = r->poll_next_) {
+        r->poll();
+    }
+    return g_poll_list != nullptr;
+}
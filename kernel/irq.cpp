@@ -0,0 +1,364 @@
+/**
+ * leafOS - 中断入口与分发实现
+ *
+ * 处理函数表只在登记时写入；中断入口只读它，不加锁
+ */
+
+#include <irq.hpp>
+#include <stdint.h>
+#include <stddef.h>
+#include <spinlock.hpp>
+
+#if defined(__x86_64__)
+#include <arch/io.hpp>
+#include <kstring.hpp>
+#include <page_alloc.hpp>
+#include <percpu.hpp>
+#elif defined(__aarch64__)
+#include <arch/gic.hpp>
+#include <console.hpp>
+#include <kernel.hpp>
+#endif
+
+namespace {
+
+Spinlock g_lock;
+
+#if defined(__x86_64__)
+
+struct IdtGate {
+    uint16_t off_lo;
+    uint16_t selector;
+    uint8_t  ist;
+    uint8_t  type;
+    uint16_t off_mid;
+    uint32_t off_hi;
+    uint32_t reserved;
+};
+
+struct __attribute__((packed)) IdtPtr {
+    uint16_t limit;
+    uint64_t base;
+};
+
+constexpr uint32_t NMI_VECTOR = 2;
+constexpr uint8_t  NMI_IST    = 1;             // TSS中的NMI栈(syscall.cpp)
+constexpr uint32_t MAX_IRQS   = 256;
+constexpr uint8_t  GATE_INTR  = 0x8E;          // 存在、DPL 0、64位中断门
+constexpr size_t   STUB_SIZE  = 16;
+
+IdtGate*    g_idt;
+irq_handler g_handlers[MAX_IRQS];
+
+#elif defined(__aarch64__)
+
+constexpr uint32_t MAX_IRQS = 32;               // SGI和PPI
+
+irq_handler g_handlers[MAX_IRQS];
+
+#endif
+
+} // namespace
+
+#if defined(__x86_64__)
+
+// 每个向量一个16字节的入口，压入向量号后转到irq_common。
+// irq_common保存调用者保存的通用寄存器和全部XMM寄存器(内核代码可能使用SSE)，
+// 以(向量号, (RIP, CS, RFLAGS, RSP, SS)帧, 被打断时的RBP)调用irq_dispatch。
+// CPU在压入中断帧前把RSP按16字节对齐，此后压入的向量号和10个寄存器使call时再次对齐。
+// 被打断的是用户态时进出各执行一次SWAPGS。系统调用的入口和出口(syscall.cpp)在内核态
+// 还有几条指令使用用户的栈，入口的第一条和出口的sysretq、iretq使用用户的GS；
+// 关中断时只有NMI会落在那里。所以NMI经IST换到TSS中本CPU的NMI栈，不碰被打断的RSP，
+// 落在这三条指令上时同样要换GS
+extern "C" char irq_stubs[];
+
+__asm__(R"(
+    .pushsection .text
+    // off(%rsp)是中断帧中的RIP
+    .macro user_gs off
+    testb $3, \off+8(%rsp)
+    jnz 1f
+    push %rax
+    lea syscall_entry(%rip), %rax
+    cmp %rax, \off+8(%rsp)
+    je 2f
+    lea user_sysret(%rip), %rax
+    cmp %rax, \off+8(%rsp)
+    je 2f
+    lea user_iret(%rip), %rax
+    cmp %rax, \off+8(%rsp)
+2:
+    pop %rax
+    jne 3f
+1:
+    swapgs
+3:
+    .endm
+
+    .balign 16
+irq_common:
+    user_gs 8
+    push %rax
+    push %rcx
+    push %rdx
+    push %rsi
+    push %rdi
+    push %r8
+    push %r9
+    push %r10
+    push %r11
+    push %rbp
+    sub $256, %rsp
+    movdqu %xmm0, 0(%rsp)
+    movdqu %xmm1, 16(%rsp)
+    movdqu %xmm2, 32(%rsp)
+    movdqu %xmm3, 48(%rsp)
+    movdqu %xmm4, 64(%rsp)
+    movdqu %xmm5, 80(%rsp)
+    movdqu %xmm6, 96(%rsp)
+    movdqu %xmm7, 112(%rsp)
+    movdqu %xmm8, 128(%rsp)
+    movdqu %xmm9, 144(%rsp)
+    movdqu %xmm10, 160(%rsp)
+    movdqu %xmm11, 176(%rsp)
+    movdqu %xmm12, 192(%rsp)
+    movdqu %xmm13, 208(%rsp)
+    movdqu %xmm14, 224(%rsp)
+    movdqu %xmm15, 240(%rsp)
+    cld
+    mov 336(%rsp), %rdi
+    lea 344(%rsp), %rsi
+    mov %rbp, %rdx
+    call irq_dispatch
+    movdqu 0(%rsp), %xmm0
+    movdqu 16(%rsp), %xmm1
+    movdqu 32(%rsp), %xmm2
+    movdqu 48(%rsp), %xmm3
+    movdqu 64(%rsp), %xmm4
+    movdqu 80(%rsp), %xmm5
+    movdqu 96(%rsp), %xmm6
+    movdqu 112(%rsp), %xmm7
+    movdqu 128(%rsp), %xmm8
+    movdqu 144(%rsp), %xmm9
+    movdqu 160(%rsp), %xmm10
+    movdqu 176(%rsp), %xmm11
+    movdqu 192(%rsp), %xmm12
+    movdqu 208(%rsp), %xmm13
+    movdqu 224(%rsp), %xmm14
+    movdqu 240(%rsp), %xmm15
+    add $256, %rsp
+    pop %rbp
+    pop %r11
+    pop %r10
+    pop %r9
+    pop %r8
+    pop %rdi
+    pop %rsi
+    pop %rdx
+    pop %rcx
+    pop %rax
+    add $8, %rsp
+    user_gs 0
+    iretq
+    .purgem user_gs
+
+    .balign 16
+    .globl irq_stubs
+    .hidden irq_stubs
+irq_stubs:
+    .set vector, 0
+    .rept 256
+    .balign 16
+    push $vector
+    jmp irq_common
+    .set vector, vector + 1
+    .endr
+    .popsection
+)");
+
+extern "C" __attribute__((used)) void irq_dispatch(uint64_t vector, const uint64_t* frame, uintptr_t fp)
+{
+    irq_handler fn = g_handlers[vector % MAX_IRQS];
+    if (fn) {
+        fn(frame[0], fp, frame[3]);
+    }
+}
+
+bool irq_register(uint32_t id, irq_handler fn)
+{
+    if (id >= MAX_IRQS || (id < 32 && id != NMI_VECTOR) || !fn) {
+        return false;
+    }
+    SpinGuard guard(g_lock);
+
+    if (!g_idt) {
+        IdtPtr cur;
+        __asm__ __volatile__("sidt %0" : "=m"(cur));
+        IdtGate* idt = static_cast<IdtGate*>(mm::alloc_pages_zeroed(0));
+        if (!idt) {
+            return false;
+        }
+        size_t len = (size_t)cur.limit + 1;
+        memcpy(idt, reinterpret_cast<const void*>(cur.base), len < mm::PAGE_SIZE ? len : mm::PAGE_SIZE);
+        g_idt = idt;
+
+        // 固件可能还留着8259的中断源，它们的向量不归内核处理，全部屏蔽
+        outb(0x21, 0xFF);
+        outb(0xA1, 0xFF);
+    }
+
+    // 没有本内核TSS的CPU没有NMI栈，IST会从固件的TSS(或空的TR)取栈
+    if (id == NMI_VECTOR && !this_cpu()->tss) {
+        return false;
+    }
+
+    g_handlers[id] = fn;
+    uint16_t cs;
+    __asm__ __volatile__("mov %%cs, %0" : "=r"(cs));
+    uintptr_t entry = reinterpret_cast<uintptr_t>(irq_stubs) + id * STUB_SIZE;
+    IdtGate& g = g_idt[id];
+    g.off_lo = (uint16_t)entry;
+    g.selector = cs;
+    g.ist = id == NMI_VECTOR ? NMI_IST : 0;
+    g.type = GATE_INTR;
+    g.off_mid = (uint16_t)(entry >> 16);
+    g.off_hi = (uint32_t)(entry >> 32);
+    g.reserved = 0;
+
+    IdtPtr p = { (uint16_t)(mm::PAGE_SIZE - 1), reinterpret_cast<uint64_t>(g_idt) };
+    __asm__ __volatile__("lidt %0" :: "m"(p) : "memory");
+    return true;
+}
+
+#elif defined(__aarch64__)
+
+// 异常向量表: 16项，每项128字节。只有当前EL的IRQ(使用SP_EL0或SP_ELx)进入分发，
+// 来自EL0的同步异常交给系统调用入口svc_el0(syscall.cpp)，
+// 其余异常在固件的向量表被替换后已无人处理，输出现场和调用栈后停机。
+// IRQ入口保存调用者保存的寄存器、帧指针和ELR/SPSR，
+// 以被打断时的PC、帧指针和栈指针调用irq_el1
+extern "C" char irq_vectors[];
+
+__asm__(R"(
+    .pushsection .text
+    .macro irq_entry sp_reg
+    sub sp, sp, #192
+    stp x0, x1, [sp, #0]
+    stp x2, x3, [sp, #16]
+    stp x4, x5, [sp, #32]
+    stp x6, x7, [sp, #48]
+    stp x8, x9, [sp, #64]
+    stp x10, x11, [sp, #80]
+    stp x12, x13, [sp, #96]
+    stp x14, x15, [sp, #112]
+    stp x16, x17, [sp, #128]
+    stp x18, x29, [sp, #144]
+    mrs x0, elr_el1
+    mrs x1, spsr_el1
+    stp x30, x0, [sp, #160]
+    str x1, [sp, #176]
+    mov x1, x29
+    .ifc \sp_reg, sp_el0
+    mrs x2, sp_el0
+    .else
+    add x2, sp, #192
+    .endif
+    bl irq_el1
+    ldr x1, [sp, #176]
+    ldp x30, x0, [sp, #160]
+    msr spsr_el1, x1
+    msr elr_el1, x0
+    ldp x18, x29, [sp, #144]
+    ldp x16, x17, [sp, #128]
+    ldp x14, x15, [sp, #112]
+    ldp x12, x13, [sp, #96]
+    ldp x10, x11, [sp, #80]
+    ldp x8, x9, [sp, #64]
+    ldp x6, x7, [sp, #48]
+    ldp x4, x5, [sp, #32]
+    ldp x2, x3, [sp, #16]
+    ldp x0, x1, [sp, #0]
+    add sp, sp, #192
+    eret
+    .endm
+
+    .macro irq_vector target, index
+    .balign 128
+    .ifnb \index
+    mov x0, #\index
+    mov x1, x29
+    mov x2, sp
+    .endif
+    b \target
+    .endm
+
+    .balign 2048
+    .globl irq_vectors
+    .hidden irq_vectors
+irq_vectors:
+    irq_vector irq_trap, 0
+    irq_vector irq_el1_sp0
+    irq_vector irq_trap, 2
+    irq_vector irq_trap, 3
+    irq_vector irq_trap, 4
+    irq_vector irq_el1_spx
+    irq_vector irq_trap, 6
+    irq_vector irq_trap, 7
+    irq_vector svc_el0
+    irq_vector irq_trap, 9
+    irq_vector irq_trap, 10
+    irq_vector irq_trap, 11
+    irq_vector irq_trap, 12
+    irq_vector irq_trap, 13
+    irq_vector irq_trap, 14
+    irq_vector irq_trap, 15
+
+    // 向量表每项只有128字节，入口代码放在表外
+irq_el1_sp0:
+    irq_entry sp_el0
+irq_el1_spx:
+    irq_entry sp
+    .purgem irq_entry
+    .purgem irq_vector
+    .popsection
+)");
+
+// 没有登记的中断源(如固件留下的)关掉，免得反复进入
+extern "C" __attribute__((used)) void irq_el1(uintptr_t pc, uintptr_t fp, uintptr_t sp)
+{
+    uint32_t intid = arch::gic_ack();
+    irq_handler fn = intid < MAX_IRQS ? g_handlers[intid] : nullptr;
+    if (fn) {
+        fn(pc, fp, sp);
+    } else if (intid < arch::GIC_SPURIOUS) {
+        arch::gic_disable(intid);
+    }
+    arch::gic_eoi(intid);
+}
+
+extern "C" __attribute__((used, noreturn)) void irq_trap(uint64_t index, uintptr_t fp, uintptr_t sp)
+{
+    uint64_t esr, elr, far;
+    __asm__ __volatile__("mrs %0, esr_el1\n"
+                         "mrs %1, elr_el1\n"
+                         "mrs %2, far_el1"
+                         : "=r"(esr), "=r"(elr), "=r"(far));
+    console::Line().str("unexpected exception ").num((int64_t)index)
+        .str(" esr ").hex(esr).str(" elr ").hex(elr).str(" far ").hex(far).print();
+    print_backtrace(elr, fp, sp);
+    halt_forever();
+}
+
+bool irq_register(uint32_t id, irq_handler fn)
+{
+    if (id < 16 || id >= MAX_IRQS || !fn) {
+        return false;
+    }
+    SpinGuard guard(g_lock);
+
+    g_handlers[id] = fn;
+    __asm__ __volatile__("msr vbar_el1, %0; isb" :: "r"(irq_vectors) : "memory");
+    return arch::gic_enable_ppi(id, 0xA0);
+}
+
+#endif
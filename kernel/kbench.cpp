@@ -0,0 +1,110 @@
+/**
+ * leafOS - 内核微基准运行器
+ *
+ * 中断是关闭的，也没有调度器，测量期间CPU完全归被测代码使用；
+ * 剩下的抖动来自缓存和(在QEMU中)宿主机，p99能看出它们的影响
+ */
+
+#include <kbench.hpp>
+
+#if defined(LEAFOS_KBENCH)
+
+#include <arch/clock.hpp>
+#include <clock.hpp>
+#include <console.hpp>
+#include <kheap.hpp>
+
+// 由链接器为kbench段自动生成
+extern "C" const KBench __start_kbench[] __attribute__((weak));
+extern "C" const KBench __stop_kbench[] __attribute__((weak));
+
+namespace {
+
+constexpr uint32_t WARMUP  = 100;
+constexpr uint32_t SAMPLES = 1000;
+
+void __attribute__((noinline)) empty(uint32_t)
+{
+    __asm__ __volatile__("" ::: "memory");
+}
+
+uint64_t sample(kbench_fn fn, uint32_t batch)
+{
+    uint64_t t0 = arch::read_counter_serialized();
+    fn(batch);
+    return arch::read_counter_serialized() - t0;
+}
+
+// 样本不多，插入排序足够
+void sort(uint64_t* v, uint32_t n)
+{
+    for (uint32_t i = 1; i < n; i++) {
+        uint64_t x = v[i];
+        uint32_t j = i;
+        for (; j && v[j - 1] > x; j--) {
+            v[j] = v[j - 1];
+        }
+        v[j] = x;
+    }
+}
+
+// 以两位小数输出x/div
+console::Line& fixed2(console::Line& line, uint64_t x, uint64_t div)
+{
+    uint64_t v = x * 100 / div;
+    uint64_t frac = v % 100;
+    return line.num((int64_t)(v / 100)).str(frac < 10 ? ".0" : ".").num((int64_t)frac);
+}
+
+void run(const KBench& b, uint64_t* samples, uint64_t overhead)
+{
+    uint32_t batch = b.batch ? b.batch : 1;
+    for (uint32_t i = 0; i < WARMUP; i++) {
+        sample(b.fn, batch);
+    }
+    for (uint32_t i = 0; i < SAMPLES; i++) {
+        uint64_t t = sample(b.fn, batch);
+        samples[i] = t > overhead ? t - overhead : 0;
+    }
+    sort(samples, SAMPLES);
+
+    uint64_t median = samples[SAMPLES / 2];
+    console::Line line;
+    line.str("kbench: ").str(b.name).str(",").num(batch).str(",");
+    fixed2(line, samples[0], batch).str(",");
+    fixed2(line, median, batch).str(",");
+    fixed2(line, samples[SAMPLES * 99 / 100], batch).str(",");
+    fixed2(line, clock_cycles_to_ns(median), batch).print();
+}
+
+} // namespace
+
+void run_kbenches()
+{
+    const KBench* begin = __start_kbench;
+    const KBench* end = __stop_kbench;
+    uint64_t* samples = static_cast<uint64_t*>(kmalloc(SAMPLES * sizeof(uint64_t)));
+    if (!samples) {
+        console::Line().str("kbench done (out of memory)").print();
+        return;
+    }
+
+    // 起止读数本身的开销取空调用的最小值，从每个样本中扣除
+    uint64_t overhead = ~0ull;
+    for (uint32_t i = 0; i < WARMUP + SAMPLES; i++) {
+        uint64_t t = sample(empty, 1);
+        overhead = t < overhead ? t : overhead;
+    }
+
+    console::Line().str("kbench ").num(end - begin).str(" benchmarks, counter ")
+        .num((int64_t)clock_hz()).str(" Hz, overhead ").num((int64_t)overhead)
+        .str(" cycles").print();
+    console::Line().str("kbench: name,batch,min_cycles,median_cycles,p99_cycles,median_ns").print();
+    for (const KBench* b = begin; b < end; b++) {
+        run(*b, samples, overhead);
+    }
+    console::Line().str("kbench done").print();
+    kfree(samples);
+}
+
+#endif // LEAFOS_KBENCH
@@ -0,0 +1,178 @@
+/**
+ * leafOS - 内核主流程 (ExitBootServices之后)
+ */
+
+#include <kernel.hpp>
+#include <vfs.hpp>
+#include <fat32.hpp>
+#include <initramfs.hpp>
+#include <ext4.hpp>
+#include <tmpfs.hpp>
+#include <vmm.hpp>
+#include <arch/paging.hpp>
+#include <io_ring.hpp>
+#include <initcall.hpp>
+#include <console.hpp>
+#include <func_profile.hpp>
+#include <kprof.hpp>
+#include <ftrace.hpp>
+#include <percpu.hpp>
+#include <cpuhp.hpp>
+#include <trace.hpp>
+#include <gcov.hpp>
+#include <kbench.hpp>
+#include <latency.hpp>
+
+#if defined(__x86_64__)
+#include <ata.hpp>
+#endif
+
+namespace {
+
+BootInfo g_boot;
+bool     g_initrd_root __initdata;
+
+// 有initrd时以它为根文件系统，启动盘(ESP)挂在/boot；否则ESP就是根
+int __init mount_root()
+{
+    fs::InitramFileSystem* initrd = fs::InitramFileSystem::mount(g_boot.initrd, g_boot.initrd_size);
+    if (!initrd) {
+        return 0;
+    }
+    int err = fs::mount("/", initrd);
+    g_initrd_root = !err;
+    return err;
+}
+DEFINE_INITCALL_AFTER(INIT_LEVEL_FS, mount_root, "");
+
+#if defined(__x86_64__)
+// 探测的主要耗时在等待驱动器应答。两个通道的寄存器互不相干，分开登记以便同时探测；
+// 同一通道的主从盘共用寄存器，只能先后进行
+struct AtaSlot {
+    uint16_t io;
+    uint16_t ctrl;
+    bool     slave;
+};
+
+const AtaSlot g_ata_slots[] __initconst = {
+    { ATA_PRIMARY_IO,   ATA_PRIMARY_CTRL,   false },
+    { ATA_PRIMARY_IO,   ATA_PRIMARY_CTRL,   true  },
+    { ATA_SECONDARY_IO, ATA_SECONDARY_CTRL, false },
+    { ATA_SECONDARY_IO, ATA_SECONDARY_CTRL, true  },
+};
+AtaDisk* g_ata_disks[4] __initdata;
+
+int __init probe_channel(size_t first)
+{
+    for (size_t i = first; i < first + 2; i++) {
+        const AtaSlot& s = g_ata_slots[i];
+        g_ata_disks[i] = AtaDisk::probe(s.io, s.ctrl, s.slave);
+    }
+    return 0;
+}
+
+int __init probe_ata_primary()
+{
+    return probe_channel(0);
+}
+DEFINE_INITCALL_AFTER(INIT_LEVEL_DEVICE, probe_ata_primary, "");
+
+int __init probe_ata_secondary()
+{
+    return probe_channel(2);
+}
+DEFINE_INITCALL_AFTER(INIT_LEVEL_DEVICE, probe_ata_secondary, "");
+
+// 按通道顺序，第一个FAT32分区是ESP，第一个ext分区挂在/mnt
+int __init mount_disks()
+{
+    const char* esp_path = g_initrd_root ? "/boot" : "/";
+    bool esp_found = false;
+    bool ext_found = false;
+    for (AtaDisk* disk : g_ata_disks) {
+        if (!disk) {
+            continue;
+        }
+        if (!esp_found) {
+            fs::Fat32FileSystem* esp = fs::Fat32FileSystem::probe(disk);
+            if (esp) {
+                esp_found = fs::mount(esp_path, esp) == 0;
+            }
+        }
+        if (!ext_found) {
+            fs::Ext4FileSystem* ext = fs::Ext4FileSystem::probe(disk);
+            if (ext) {
+                ext_found = fs::mount("/mnt", ext) == 0;
+            }
+        }
+    }
+    return 0;
+}
+DEFINE_INITCALL_AFTER(INIT_LEVEL_DEVICE, mount_disks, "mount_root probe_ata_primary probe_ata_secondary");
+#endif
+
+} // namespace
+
+// 链接脚本划分的init区，gnu-efi构建中不存在
+extern "C" char __init_begin[] __attribute__((weak));
+extern "C" char __init_end[] __attribute__((weak));
+
+void free_initmem()
+{
+    uintptr_t begin = reinterpret_cast<uintptr_t>(__init_begin);
+    uintptr_t end = reinterpret_cast<uintptr_t>(__init_end);
+    if (!begin || end <= begin) {
+        return;
+    }
+    // 映像所在的页不在页分配器的初始范围内时会被free_range截掉，按实际增加的空闲页报告
+    uint64_t before = mm::free_page_count();
+    mm::free_range(begin, (end - begin) >> mm::PAGE_SHIFT);
+    uint64_t freed = mm::free_page_count() - before;
+    console::Line().str("freed ").num(freed * mm::PAGE_SIZE / 1024).str(" KiB of init memory").print();
+}
+
+void halt_forever()
+{
+    for (;;) {
+#if defined(__x86_64__)
+        __asm__ __volatile__("cli; hlt");
+#elif defined(__aarch64__)
+        __asm__ __volatile__("msr daifset, #0xf; wfi");
+#endif
+    }
+}
+
+const BootInfo& boot_info()
+{
+    return g_boot;
+}
+
+void kernel_main(const BootInfo& boot)
+{
+    g_boot = boot;
+    percpu_init();
+    if (!arch::paging_init()) {
+        panic("CPU does not support no-execute pages");
+    }
+    cpuhp_init();
+    mm::page_alloc_init(boot.free_ranges, boot.free_count);
+    trace_init();
+
+    // 其余初始化由各子系统登记，按依赖关系执行。
+    // 目前只有引导CPU参与；启动其他CPU后，它们通过initcall_worker加入
+    run_initcalls();
+    free_initmem();
+    run_kbenches();
+    run_latency();
+
+    // 没有调度器: 空闲的引导CPU充当SQPOLL环的内核轮询线程，同时处理跟踪命令(FTRACE构建)，
+    // 两者都没有事可做时停机。两边每轮都要轮询，不能短路
+    while (io_ring_poll() | ftrace_poll()) {
+        cpu_relax();
+    }
+    trace_dump();
+    kprof_dump();
+    func_profile_dump();
+    gcov_dump();
+    halt_forever();
+}
@@ -0,0 +1,294 @@
+/**
+ * leafOS - 采样剖析实现
+ *
+ * 采样处理可能打断任何代码(x86上包括持有自旋锁、关中断的代码)，因此只写当前CPU的
+ * 缓冲区: 每个样本是一个字的深度，其后是从被打断的位置开始、逐层向外的地址。
+ * 缓冲区满后不再记录，只计数。合并与输出都在kprof_dump中进行
+ */
+
+#include <kprof.hpp>
+
+#if defined(LEAFOS_KPROF)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <arch/cpu.hpp>
+#include <arch/pmu.hpp>
+#include <console.hpp>
+#include <cpuhp.hpp>
+#include <initcall.hpp>
+#include <kerrno.hpp>
+#include <kheap.hpp>
+#include <irq.hpp>
+#include <ksyms.hpp>
+#include <kstring.hpp>
+#include <page_alloc.hpp>
+#include <stacktrace.hpp>
+
+// 映像基址(链接脚本定义)，输出偏移以便和链接地址对应；gnu-efi构建中不存在
+extern "C" char __image_base[] __attribute__((weak));
+
+namespace {
+
+constexpr uint64_t PERIOD    = 1000000;    // 采样间隔(核心周期)，1 GHz时每毫秒一次
+constexpr uint32_t MAX_DEPTH = 32;
+constexpr unsigned BUF_ORDER = 8;          // 每个CPU 1 MiB，约可存放一万个样本
+constexpr uint32_t MAX_CPUS  = 256;        // arch::cpu_id()是8位的
+
+#if defined(__x86_64__)
+constexpr uint32_t NMI_VECTOR = 2;
+#endif
+
+struct CpuBuf {
+    uint64_t* words;
+    uint32_t  cap;
+    uint32_t  used;
+    uint32_t  samples;
+    uint32_t  dropped;
+};
+
+CpuBuf g_cpu[MAX_CPUS];
+bool   g_started;       // 引导CPU上的采样已经开始，其他CPU上线时跟着开始
+bool   g_stopped;
+
+void record(uintptr_t pc, uintptr_t fp, uintptr_t sp)
+{
+    CpuBuf& b = g_cpu[arch::cpu_id() % MAX_CPUS];
+    if (!b.words || __atomic_load_n(&g_stopped, __ATOMIC_RELAXED)) {
+        return;
+    }
+    if (b.cap - b.used < MAX_DEPTH + 1) {
+        b.dropped++;
+        return;
+    }
+    uint64_t* rec = b.words + b.used;
+    rec[1] = pc;
+    uint32_t depth = 1 + stack_walk(fp, sp, reinterpret_cast<uintptr_t*>(rec + 2), MAX_DEPTH - 1);
+    rec[0] = depth;
+    b.used += 1 + depth;
+    b.samples++;
+}
+
+// x86经本地APIC以NMI送达；aarch64是经GIC送达的PMU中断。其他来源的NMI(目前没有)直接忽略
+void sample(uintptr_t pc, uintptr_t fp, uintptr_t sp)
+{
+    if (arch::pmu_ack(PERIOD)) {
+        record(pc, fp, sp);
+    }
+}
+
+bool route_interrupt()
+{
+#if defined(__x86_64__)
+    return irq_register(NMI_VECTOR, sample);
+#elif defined(__aarch64__)
+    if (!irq_register(arch::PMU_IRQ, sample)) {
+        return false;
+    }
+    arch::irq_enable();
+    return true;
+#endif
+}
+
+// 在当前CPU上分配缓冲区(重新上线的CPU沿用原来的)，接好中断并开始计数
+int start_cpu()
+{
+    CpuBuf& b = g_cpu[arch::cpu_id() % MAX_CPUS];
+    uint64_t* words = b.words;
+    if (!words) {
+        words = static_cast<uint64_t*>(mm::alloc_pages(BUF_ORDER));
+        if (!words) {
+            return -ENOMEM;
+        }
+    }
+    if (!route_interrupt()) {
+        if (!b.words) {
+            mm::free_pages(words, BUF_ORDER);
+        }
+        return -ENODEV;
+    }
+    b.cap = (uint32_t)((mm::PAGE_SIZE << BUF_ORDER) / sizeof(uint64_t));
+    b.words = words;
+    arch::pmu_start(PERIOD);
+    return 0;
+}
+
+// 多CPU参与启动时只在执行这项初始化的CPU上采样，其他CPU上线时各自开始。
+// x86的NMI用syscall_init在TSS中设置的栈，要在它之后
+int __init kprof_init()
+{
+    if (!arch::pmu_probe()) {
+        console::Line().str("kprof: no usable PMU, sampling disabled").print();
+        return -ENODEV;
+    }
+    int err = start_cpu();
+    if (err) {
+        return err;
+    }
+    g_started = true;
+    console::Line().str("kprof: sampling every ").num((int64_t)PERIOD).str(" cycles").print();
+    return 0;
+}
+DEFINE_INITCALL_AFTER(INIT_LEVEL_ARCH, kprof_init, "syscall_init");
+
+// 下线的CPU停止计数，已记录的样本留给kprof_dump输出。
+// 排在跟踪级别: 同一级别内先后不定，本CPU的TSS要先由CPUHP_LEVEL_ARCH的syscall步骤设置好
+int kprof_cpu_online(uint32_t)
+{
+    return g_started && !__atomic_load_n(&g_stopped, __ATOMIC_RELAXED) ? start_cpu() : 0;
+}
+
+void kprof_cpu_offline(uint32_t)
+{
+    if (g_started) {
+        arch::pmu_stop();
+    }
+}
+DEFINE_CPUHP_STEP(CPUHP_LEVEL_TRACE, kprof, kprof_cpu_online, kprof_cpu_offline);
+
+struct Stack {
+    const uint64_t* rec;        // 指向样本记录，首字是深度
+    uint32_t        count;
+};
+
+uint64_t hash_of(const uint64_t* rec)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (uint64_t i = 0; i <= rec[0]; i++) {
+        h = (h ^ rec[i]) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+// 调用栈可能远长于console::Line的容量，在这里自行拼行
+char g_line[32 + MAX_DEPTH * KSYM_NAME_LEN];
+
+char* put_str(char* p, const char* s)
+{
+    while (*s) {
+        *p++ = *s++;
+    }
+    return p;
+}
+
+char* put_dec(char* p, uint32_t v)
+{
+    char tmp[12];
+    uint32_t n = 0;
+    do {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (n) {
+        *p++ = tmp[--n];
+    }
+    return p;
+}
+
+char* put_hex(char* p, uint64_t v)
+{
+    static const char digits[] = "0123456789abcdef";
+    int shift = 60;
+    while (shift > 0 && !((v >> shift) & 0xF)) {
+        shift -= 4;
+    }
+    *p++ = '0';
+    *p++ = 'x';
+    for (; shift >= 0; shift -= 4) {
+        *p++ = digits[(v >> shift) & 0xF];
+    }
+    return p;
+}
+
+// 有符号表时直接输出flamegraph.pl的折叠栈"kprof: 外层;...;内层 次数"，
+// 否则输出"kprof 次数 偏移;...;偏移"，由tools/kprof.py借助nm转换
+void print_stack(const Stack& s, uintptr_t base, bool symbolize)
+{
+    char* p = g_line;
+    if (symbolize) {
+        p = put_str(p, "kprof: ");
+    } else {
+        p = put_str(p, "kprof ");
+        p = put_dec(p, s.count);
+        *p++ = ' ';
+    }
+    for (uint64_t i = s.rec[0]; i >= 1; i--) {
+        // 除最内层外记录的都是返回地址，指向call之后，减1才落在调用者内
+        uintptr_t pc = s.rec[i];
+        Ksym sym;
+        if (symbolize && ksym_lookup(i > 1 ? pc - 1 : pc, &sym)) {
+            p = put_str(p, sym.name);
+        } else {
+            p = put_hex(p, pc - base);
+        }
+        if (i > 1) {
+            *p++ = ';';
+        }
+    }
+    if (symbolize) {
+        *p++ = ' ';
+        p = put_dec(p, s.count);
+    }
+    *p++ = '\n';
+    console::write(g_line, (size_t)(p - g_line));
+}
+
+} // namespace
+
+void kprof_dump()
+{
+    // 先停止记录，输出过程本身不被采样
+    if (__atomic_exchange_n(&g_stopped, true, __ATOMIC_ACQ_REL)) {
+        return;
+    }
+    arch::pmu_stop();
+
+    uint32_t samples = 0;
+    uint32_t dropped = 0;
+    for (const CpuBuf& b : g_cpu) {
+        samples += b.samples;
+        dropped += b.dropped;
+    }
+
+    // 开放寻址合并相同的调用栈，表的大小至少是样本数的两倍
+    uint32_t size = 16;
+    while (size < samples * 2) {
+        size <<= 1;
+    }
+    Stack* table = static_cast<Stack*>(kzalloc(size * sizeof(Stack)));
+    if (!table) {
+        console::Line().str("kprof: out of memory, ").num(samples).str(" samples discarded").print();
+        return;
+    }
+    uint32_t unique = 0;
+    for (const CpuBuf& b : g_cpu) {
+        for (uint32_t pos = 0; pos < b.used; pos += 1 + (uint32_t)b.words[pos]) {
+            const uint64_t* rec = b.words + pos;
+            uint32_t h = (uint32_t)hash_of(rec) & (size - 1);
+            while (table[h].rec &&
+                   (table[h].rec[0] != rec[0] ||
+                    memcmp(table[h].rec, rec, (rec[0] + 1) * sizeof(uint64_t)) != 0)) {
+                h = (h + 1) & (size - 1);
+            }
+            if (!table[h].rec) {
+                table[h].rec = rec;
+                unique++;
+            }
+            table[h].count++;
+        }
+    }
+
+    uintptr_t base = reinterpret_cast<uintptr_t>(__image_base);
+    bool symbolize = ksym_available();
+    console::Line().str("kprof begin ").num(unique).str(" stacks, ").num(samples)
+        .str(" samples, ").num(dropped).str(" dropped").print();
+    for (uint32_t i = 0; i < size; i++) {
+        if (table[i].rec) {
+            print_stack(table[i], base, symbolize);
+        }
+    }
+    console::Line().str("kprof end").print();
+    kfree(table);
+}
+
+#endif // LEAFOS_KPROF
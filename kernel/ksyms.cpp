@@ -0,0 +1,174 @@
+/**
+ * leafOS - 内核符号表查找
+ */
+
+#include <ksyms.hpp>
+#include <kstring.hpp>
+
+// 由tools/mksyms.py生成；第一遍链接和gnu-efi构建中不存在
+extern "C" const uint8_t ksym_table[] __attribute__((weak));
+extern "C" char __image_base[] __attribute__((weak));
+
+namespace {
+
+constexpr uint32_t KSYM_MAGIC = 0x4D59534B;    // "KSYM"
+
+struct Header {
+    uint32_t magic;
+    uint32_t count;
+    uint32_t block_size;
+    uint32_t block_count;
+};
+
+// 块首函数相对映像基址的偏移，块数据相对表头的位置
+struct Block {
+    uint32_t addr;
+    uint32_t data;
+};
+
+const Header* table()
+{
+    const Header* h = reinterpret_cast<const Header*>(ksym_table);
+    return h && h->magic == KSYM_MAGIC && h->count ? h : nullptr;
+}
+
+uint64_t uleb(const uint8_t*& p)
+{
+    uint64_t v = 0;
+    for (unsigned shift = 0;; shift += 7) {
+        uint8_t b = *p++;
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            return v;
+        }
+    }
+}
+
+// 顺序解码一个块: 每次取出下一个函数，名字按前缀共享直接在sym->name中还原
+class BlockReader {
+public:
+    BlockReader(const Header* h, uint32_t b)
+    {
+        const Block* blocks = reinterpret_cast<const Block*>(h + 1);
+        p_ = ksym_table + blocks[b].data;
+        start_ = blocks[b].addr;
+        left_ = h->count - b * h->block_size;
+        left_ = left_ < h->block_size ? left_ : h->block_size;
+        first_ = true;
+    }
+
+    // 返回false表示块已读完；start是相对映像基址的偏移
+    bool next(uint64_t* start, Ksym* sym)
+    {
+        if (!left_) {
+            return false;
+        }
+        left_--;
+        if (!first_) {
+            start_ += uleb(p_);
+        }
+        first_ = false;
+        sym->size = (uint32_t)uleb(p_);
+        uint8_t keep = p_[0];
+        uint8_t add = p_[1];
+        memcpy(sym->name + keep, p_ + 2, add);
+        sym->name[keep + add] = '\0';
+        p_ += 2 + add;
+        *start = start_;
+        return true;
+    }
+
+private:
+    const uint8_t* p_;
+    uint64_t       start_;
+    uint32_t       left_;
+    bool           first_;
+};
+
+} // namespace
+
+bool ksym_available()
+{
+    return table() != nullptr;
+}
+
+uint32_t ksym_count()
+{
+    const Header* h = table();
+    return h ? h->count : 0;
+}
+
+bool ksym_at(uint32_t index, Ksym* sym)
+{
+    const Header* h = table();
+    if (!h || index >= h->count) {
+        return false;
+    }
+    BlockReader reader(h, index / h->block_size);
+    uint64_t start = 0;
+    for (uint32_t i = 0; i <= index % h->block_size; i++) {
+        reader.next(&start, sym);
+    }
+    sym->addr = reinterpret_cast<uintptr_t>(__image_base) + start;
+    return true;
+}
+
+uint32_t ksym_find(const char* name, Ksym* sym)
+{
+    const Header* h = table();
+    if (!h) {
+        return 0;
+    }
+    uint32_t found = 0;
+    Ksym cur;
+    for (uint32_t b = 0; b < h->block_count; b++) {
+        BlockReader reader(h, b);
+        uint64_t start;
+        while (reader.next(&start, &cur)) {
+            if (!strcmp(cur.name, name) && !found++) {
+                *sym = cur;
+                sym->addr = reinterpret_cast<uintptr_t>(__image_base) + start;
+            }
+        }
+    }
+    return found;
+}
+
+bool ksym_lookup(uintptr_t addr, Ksym* sym)
+{
+    const Header* h = table();
+    uintptr_t base = reinterpret_cast<uintptr_t>(__image_base);
+    if (!h || addr < base) {
+        return false;
+    }
+    uint64_t off = addr - base;
+
+    // 最后一个块首不超过off的块
+    const Block* blocks = reinterpret_cast<const Block*>(h + 1);
+    uint32_t lo = 0;
+    uint32_t hi = h->block_count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (blocks[mid].addr <= off) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (!lo) {
+        return false;
+    }
+
+    BlockReader reader(h, lo - 1);
+    uint64_t start;
+    while (reader.next(&start, sym)) {
+        if (off < start) {
+            return false;
+        }
+        if (off < start + sym->size) {
+            sym->addr = base + start;
+            return true;
+        }
+    }
+    return false;
+}
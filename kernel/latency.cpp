@@ -0,0 +1,172 @@
+/**
+ * leafOS - 中断与唤醒延迟测量实现
+ *
+ * 迟到时间以计数器读数计算: 到期时刻本身就是计数器读数，中断处理函数的第一件事是读计数器。
+ * 到期时刻按固定间隔递增而不是从醒来时重新计算，一次迟到不会推迟后面所有周期；
+ * 迟到超过一个间隔时跳过错过的周期并计数
+ */
+
+#include <latency.hpp>
+
+#if defined(LEAFOS_LATENCY)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <arch/clock.hpp>
+#include <arch/cpu.hpp>
+#include <arch/timer.hpp>
+#include <clock.hpp>
+#include <console.hpp>
+#include <irq.hpp>
+#include <kstring.hpp>
+#include <page_alloc.hpp>
+#include <percpu.hpp>
+
+namespace {
+
+constexpr uint64_t INTERVAL_US = 1000;
+constexpr uint32_t BUCKETS     = 32;        // 最后一桶收纳2^31 ns(约2秒)以上的全部样本
+constexpr unsigned LOAD_ORDER  = 10;        // 负载在4 MiB的缓冲区上来回拷贝，超出常见的L2
+constexpr size_t   LOAD_CHUNK  = 4096;
+
+struct Histogram {
+    uint64_t buckets[BUCKETS];
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t min_ns;
+    uint64_t max_ns;
+
+    void add(uint64_t ns)
+    {
+        uint32_t b = ns ? 63 - (uint32_t)__builtin_clzll(ns) : 0;
+        buckets[b < BUCKETS ? b : BUCKETS - 1]++;
+        min_ns = count && min_ns < ns ? min_ns : ns;
+        max_ns = max_ns > ns ? max_ns : ns;
+        sum_ns += ns;
+        count++;
+    }
+};
+
+struct CpuState {
+    Histogram irq;
+    Histogram wakeup;
+    uint64_t  overruns;
+    uint64_t  entry;        // 最近一次中断处理开始时的计数器读数
+    bool      fired;
+};
+
+CpuState    g_cpus[MAX_CPUS];
+arch::Timer g_timer;
+
+void on_timer(uintptr_t, uintptr_t, uintptr_t)
+{
+    CpuState& c = g_cpus[this_cpu()->cpu % MAX_CPUS];
+    c.entry = arch::read_counter();
+    arch::timer_ack();
+    __atomic_store_n(&c.fired, true, __ATOMIC_RELEASE);
+}
+
+uint64_t late_ns(uint64_t t, uint64_t deadline)
+{
+    // 一次性模式按校准的频率换算，可能比到期时刻略早
+    return t > deadline ? clock_cycles_to_ns(t - deadline) : 0;
+}
+
+// 开着中断来回拷贝load缓冲区，直到定时器到期
+void run_load(CpuState& c, uint8_t* load, size_t* pos)
+{
+    constexpr size_t HALF = (mm::PAGE_SIZE << LOAD_ORDER) / 2;
+    arch::irq_enable();
+    while (!__atomic_load_n(&c.fired, __ATOMIC_ACQUIRE)) {
+        memcpy(load + HALF + *pos, load + *pos, LOAD_CHUNK);
+        *pos = (*pos + LOAD_CHUNK) % HALF;
+    }
+    arch::irq_disable();
+}
+
+void measure(CpuState& c, uint64_t cycles, uint8_t* load)
+{
+    uint64_t interval = clock_hz() * INTERVAL_US / 1000000;
+    size_t pos = 0;
+    uint64_t next = arch::read_counter() + interval;
+    for (uint64_t i = 0; i < cycles; i++) {
+        __atomic_store_n(&c.fired, false, __ATOMIC_RELAXED);
+        arch::timer_arm(g_timer, next);
+        if (load) {
+            run_load(c, load, &pos);
+        } else {
+            while (!__atomic_load_n(&c.fired, __ATOMIC_ACQUIRE)) {
+                arch::wait_for_interrupt();
+            }
+        }
+        uint64_t woke = arch::read_counter();
+        c.irq.add(late_ns(c.entry, next));
+        c.wakeup.add(late_ns(woke, next));
+
+        next += interval;
+        if (next <= woke) {
+            uint64_t missed = (woke - next) / interval + 1;
+            c.overruns += missed;
+            next += missed * interval;
+        }
+    }
+}
+
+void print(const char* name, const Histogram& h)
+{
+    console::Line().str("latency: ").str(name).str(" samples ").num((int64_t)h.count)
+        .str(" min ").num((int64_t)h.min_ns).str(" avg ").num((int64_t)(h.count ? h.sum_ns / h.count : 0))
+        .str(" max ").num((int64_t)h.max_ns).str(" ns").print();
+    for (uint32_t b = 0; b < BUCKETS; b++) {
+        if (h.buckets[b]) {
+            console::Line line;
+            line.str("latency: ").str(name).str(" ").num(b ? (int64_t)1 << b : 0);
+            if (b + 1 < BUCKETS) {
+                line.str("..").num(((int64_t)1 << (b + 1)) - 1);
+            } else {
+                line.str("..");
+            }
+            line.str(" ns ").num((int64_t)h.buckets[b]).print();
+        }
+    }
+}
+
+} // namespace
+
+void run_latency()
+{
+    uint32_t cpu = this_cpu()->cpu;
+    CpuState& c = g_cpus[cpu % MAX_CPUS];
+    if (!arch::timer_init(&g_timer, clock_hz()) || !irq_register(arch::TIMER_IRQ, on_timer)) {
+        console::Line().str("latency: no usable timer interrupt").print();
+        console::Line().str("latency done").print();
+        return;
+    }
+
+    uint8_t* load = nullptr;
+#if defined(LEAFOS_LATENCY_LOAD)
+    load = static_cast<uint8_t*>(mm::alloc_pages(LOAD_ORDER));
+    if (!load) {
+        console::Line().str("latency: out of memory for the load buffer").print();
+    }
+#endif
+
+    uint64_t cycles = (uint64_t)LEAFOS_LATENCY * 1000000 / INTERVAL_US;
+    console::Line().str("latency: cpu ").num((int64_t)cpu).str(", ").num((int64_t)cycles)
+        .str(" cycles of ").num((int64_t)INTERVAL_US).str(" us, load ").str(load ? "on" : "off").print();
+
+    unsigned long flags = arch::irq_save();
+    measure(c, cycles, load);
+    arch::timer_stop(g_timer);
+    arch::irq_restore(flags);
+
+    if (load) {
+        mm::free_pages(load, LOAD_ORDER);
+    }
+    print("irq", c.irq);
+    print("wakeup", c.wakeup);
+    console::Line().str("latency: overruns ").num((int64_t)c.overruns).print();
+    console::Line().str("latency done").print();
+}
+
+#endif // LEAFOS_LATENCY
@@ -0,0 +1,35 @@
+/**
+ * leafOS - 最小C++运行时支持
+ * 编译选项为 -fno-exceptions -fno-rtti，这里只需补齐编译器会引用的几个符号
+ */
+
+#include <kheap.hpp>
+#include <kernel.hpp>
+
+extern "C" {
+
+// 全局构造函数表，链接脚本已按init_priority从小到大排好序(不带优先级的排在最后)。
+// 声明为弱符号: gnu-efi的链接脚本不定义它们，那条构建路径由其crt0负责构造
+typedef void (*ctor_fn)();
+extern ctor_fn __init_array_start[] __attribute__((weak));
+extern ctor_fn __init_array_end[] __attribute__((weak));
+
+// 由boot.S在处理完重定位、切换到内核栈之后调用，此前不能依赖任何全局对象
+void _init()
+{
+    for (ctor_fn* p = __init_array_start; p < __init_array_end; p++) {
+        (*p)();
+    }
+}
+
+// 纯虚函数被调用说明对象已损坏
+void __cxa_pure_virtual()
+{
+    panic("pure virtual function called");
+}
+
+} // extern "C"
+
+// 虚析构函数会引用operator delete
+void operator delete(void* p) noexcept { kfree(p); }
+void operator delete(void* p, size_t) noexcept { kfree(p); }
@@ -0,0 +1,92 @@
+/**
+ * leafOS - 函数调用顺序剖析实现
+ *
+ * 插桩钩子可能在任何CPU、任何上下文(包括持有自旋锁时)被调用，因此只用原子操作:
+ * 函数地址放在开放寻址的散列表里，首次插入时领取一个顺序号。
+ * 钩子本身和它用到的一切都不能被插桩
+ */
+
+#include <func_profile.hpp>
+
+#if defined(LEAFOS_FUNC_PROFILE)
+
+#include <stdint.h>
+#include <console.hpp>
+
+#define NO_PROFILE __attribute__((no_instrument_function))
+
+// 映像基址(链接脚本定义)，输出偏移以便和链接地址对应；gnu-efi构建中不存在
+extern "C" char __image_base[] __attribute__((weak));
+
+namespace {
+
+constexpr uint32_t SLOT_BITS = 13;
+constexpr uint32_t SLOTS     = 1u << SLOT_BITS;    // 远多于内核的函数个数
+
+uintptr_t g_fn[SLOTS];
+uint32_t  g_count[SLOTS];
+uint16_t  g_order[SLOTS];       // 按首次调用排列的槽号
+uint32_t  g_next;
+bool      g_stopped;
+
+NO_PROFILE inline uint32_t slot_of(uintptr_t fn)
+{
+    return (uint32_t)(((uint64_t)fn * 0x9E3779B97F4A7C15ULL) >> (64 - SLOT_BITS));
+}
+
+NO_PROFILE void record(uintptr_t fn)
+{
+    if (__atomic_load_n(&g_stopped, __ATOMIC_RELAXED)) {
+        return;
+    }
+    uint32_t h = slot_of(fn);
+    for (uint32_t probe = 0; probe < SLOTS; probe++, h = (h + 1) & (SLOTS - 1)) {
+        uintptr_t cur = __atomic_load_n(&g_fn[h], __ATOMIC_RELAXED);
+        if (!cur) {
+            uintptr_t expected = 0;
+            if (__atomic_compare_exchange_n(&g_fn[h], &expected, fn, false,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                uint32_t idx = __atomic_fetch_add(&g_next, 1, __ATOMIC_RELAXED);
+                g_order[idx] = (uint16_t)h;
+                __atomic_fetch_add(&g_count[h], 1, __ATOMIC_RELAXED);
+                return;
+            }
+            cur = expected;
+        }
+        if (cur == fn) {
+            __atomic_fetch_add(&g_count[h], 1, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+    // 表满，放弃这一项
+}
+
+} // namespace
+
+extern "C" NO_PROFILE void __cyg_profile_func_enter(void* fn, void*)
+{
+    record(reinterpret_cast<uintptr_t>(fn));
+}
+
+extern "C" NO_PROFILE void __cyg_profile_func_exit(void*, void*)
+{
+}
+
+void func_profile_dump()
+{
+    // 先停止记录，输出过程本身的调用不计入
+    if (__atomic_exchange_n(&g_stopped, true, __ATOMIC_ACQ_REL)) {
+        return;
+    }
+    uint32_t n = __atomic_load_n(&g_next, __ATOMIC_ACQUIRE);
+    uintptr_t base = reinterpret_cast<uintptr_t>(__image_base);
+
+    console::Line().str("fprof begin ").num(n).print();
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t h = g_order[i];
+        console::Line().str("fprof ").hex(g_fn[h] - base).str(" ").num(g_count[h]).print();
+    }
+    console::Line().str("fprof end").print();
+}
+
+#endif // LEAFOS_FUNC_PROFILE
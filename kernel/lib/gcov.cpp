@@ -0,0 +1,249 @@
+/**
+ * leafOS - PGO计数收集实现
+ *
+ * 代替libgcov: 编译器为每个编译单元生成一个构造函数，调用__gcov_init登记该单元的
+ * gcov_info；输出时沿登记链表把计数按.gcda格式写进缓冲区再转成十六进制。
+ * gcov_info的布局随GCC版本变化，这里只支持GCC 7以后的格式。
+ * 计数由-fprofile-update=atomic保证多CPU下不丢失；本文件自身不插桩(见Makefile)
+ */
+
+#include <gcov.hpp>
+
+#if defined(LEAFOS_PGO_GEN)
+
+#include <stdint.h>
+#include <console.hpp>
+#include <kheap.hpp>
+#include <kstring.hpp>
+
+#if __GNUC__ >= 14
+#define GCOV_COUNTERS 9
+#elif __GNUC__ >= 10
+#define GCOV_COUNTERS 8
+#elif __GNUC__ >= 7
+#define GCOV_COUNTERS 9
+#else
+#error "PGO构建需要GCC 7或更新的版本"
+#endif
+
+// GCC 12起记录长度以字节计，此前以4字节字计；单元也多了一个校验字段
+#if __GNUC__ >= 12
+#define GCOV_UNIT_SIZE 4
+#else
+#define GCOV_UNIT_SIZE 1
+#endif
+
+namespace {
+
+typedef int64_t gcov_type;
+
+constexpr uint32_t GCOV_DATA_MAGIC           = 0x67636461;     // "gcda"
+constexpr uint32_t GCOV_TAG_FUNCTION         = 0x01000000;
+constexpr uint32_t GCOV_TAG_FUNCTION_LENGTH  = 3 * GCOV_UNIT_SIZE;
+constexpr uint32_t GCOV_TAG_COUNTER_BASE     = 0x01a10000;
+constexpr uint32_t GCOV_TAG_OBJECT_SUMMARY   = 0xa1000000;
+constexpr uint32_t GCOV_TAG_SUMMARY_LENGTH   = 2 * GCOV_UNIT_SIZE;
+
+struct gcov_info;
+
+struct gcov_ctr_info {
+    uint32_t   num;
+    gcov_type* values;
+};
+
+struct gcov_fn_info {
+    const gcov_info* key;       // 所属单元；COMDAT函数可能属于别的单元
+    uint32_t         ident;
+    uint32_t         lineno_checksum;
+    uint32_t         cfg_checksum;
+    gcov_ctr_info    ctrs[1];   // 只有启用的计数种类，依次排列
+};
+
+struct gcov_info {
+    uint32_t              version;
+    gcov_info*            next;
+    uint32_t              stamp;
+#if __GNUC__ >= 12
+    uint32_t              checksum;
+#endif
+    const char*           filename;
+    void                  (*merge[GCOV_COUNTERS])(gcov_type*, uint32_t);
+    uint32_t              n_functions;
+    const gcov_fn_info* const* functions;
+};
+
+gcov_info* g_list;
+bool       g_dumped;
+
+// 先以buf为空跑一遍求出长度，再分配缓冲区真正写入
+class Writer {
+public:
+    explicit Writer(uint8_t* buf) : buf_(buf) {}
+
+    void u32(uint32_t v)
+    {
+        if (buf_) {
+            memcpy(buf_ + pos_, &v, sizeof(v));
+        }
+        pos_ += sizeof(v);
+    }
+
+    // 64位计数按低、高两个字存放
+    void u64(uint64_t v)
+    {
+        u32((uint32_t)v);
+        u32((uint32_t)(v >> 32));
+    }
+
+    size_t size() const { return pos_; }
+
+private:
+    uint8_t* buf_;
+    size_t   pos_ = 0;
+};
+
+void serialize(const gcov_info* info, uint64_t sum_max, Writer& w)
+{
+    w.u32(GCOV_DATA_MAGIC);
+    w.u32(info->version);
+    w.u32(info->stamp);
+#if __GNUC__ >= 12
+    w.u32(info->checksum);
+#endif
+    // 内核只"运行"一次，最大弧计数供编译器判断冷热
+    w.u32(GCOV_TAG_OBJECT_SUMMARY);
+    w.u32(GCOV_TAG_SUMMARY_LENGTH);
+    w.u32(1);
+    w.u32((uint32_t)(sum_max > 0xffffffffu ? 0xffffffffu : sum_max));
+
+    for (uint32_t f = 0; f < info->n_functions; f++) {
+        const gcov_fn_info* fn = info->functions[f];
+        bool own = fn && fn->key == info;
+        w.u32(GCOV_TAG_FUNCTION);
+        w.u32(own ? GCOV_TAG_FUNCTION_LENGTH : 0);
+        if (!own) {
+            continue;
+        }
+        w.u32(fn->ident);
+        w.u32(fn->lineno_checksum);
+        w.u32(fn->cfg_checksum);
+
+        const gcov_ctr_info* ctr = fn->ctrs;
+        for (uint32_t t = 0; t < GCOV_COUNTERS; t++) {
+            if (!info->merge[t]) {
+                continue;
+            }
+            w.u32(GCOV_TAG_COUNTER_BASE + (t << 17));
+            w.u32(ctr->num * 2 * GCOV_UNIT_SIZE);
+            for (uint32_t i = 0; i < ctr->num; i++) {
+                w.u64((uint64_t)__atomic_load_n(&ctr->values[i], __ATOMIC_RELAXED));
+            }
+            ctr++;
+        }
+    }
+}
+
+// 全部单元中最大的弧计数(第0种计数器)
+uint64_t arcs_max()
+{
+    uint64_t max = 0;
+    for (const gcov_info* info = g_list; info; info = info->next) {
+        if (!info->merge[0]) {
+            continue;
+        }
+        for (uint32_t f = 0; f < info->n_functions; f++) {
+            const gcov_fn_info* fn = info->functions[f];
+            if (!fn || fn->key != info) {
+                continue;
+            }
+            for (uint32_t i = 0; i < fn->ctrs[0].num; i++) {
+                uint64_t v = (uint64_t)fn->ctrs[0].values[i];
+                max = v > max ? v : max;
+            }
+        }
+    }
+    return max;
+}
+
+// 32位FNV-1a，供主机端发现串口传输中的错字
+uint32_t fnv1a(const uint8_t* p, size_t len)
+{
+    uint32_t h = 0x811c9dc5;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ p[i]) * 0x01000193;
+    }
+    return h;
+}
+
+void emit(const gcov_info* info, uint64_t sum_max)
+{
+    Writer sizer(nullptr);
+    serialize(info, sum_max, sizer);
+    size_t len = sizer.size();
+    uint8_t* buf = static_cast<uint8_t*>(kmalloc(len));
+    if (!buf) {
+        console::Line().str("gcda skip ").str(info->filename).str(": out of memory").print();
+        return;
+    }
+    Writer w(buf);
+    serialize(info, sum_max, w);
+
+    // 输出目录由主机端决定，这里只给出文件名
+    const char* name = info->filename;
+    for (const char* p = info->filename; *p; p++) {
+        if (*p == '/') {
+            name = p + 1;
+        }
+    }
+    console::Line().str("gcda begin ").num((int64_t)len).str(" ").str(name).print();
+
+    static const char digits[] = "0123456789abcdef";
+    constexpr size_t BYTES_PER_LINE = 48;
+    for (size_t off = 0; off < len; off += BYTES_PER_LINE) {
+        char text[5 + 2 * BYTES_PER_LINE + 1];
+        size_t n = len - off < BYTES_PER_LINE ? len - off : BYTES_PER_LINE;
+        memcpy(text, "gcda ", 5);
+        for (size_t i = 0; i < n; i++) {
+            text[5 + 2 * i]     = digits[buf[off + i] >> 4];
+            text[5 + 2 * i + 1] = digits[buf[off + i] & 15];
+        }
+        text[5 + 2 * n] = '\n';
+        console::write(text, 5 + 2 * n + 1);
+    }
+    console::Line().str("gcda end ").hex(fnv1a(buf, len)).print();
+    kfree(buf);
+}
+
+} // namespace
+
+// 由每个插桩单元的构造函数调用。构造函数在引导CPU上依次执行，无需加锁
+extern "C" void __gcov_init(gcov_info* info)
+{
+    info->next = g_list;
+    g_list = info;
+}
+
+// 内核不会退出，也不与已有的.gcda合并；这两个符号只是为了满足编译器生成的引用
+extern "C" void __gcov_exit()
+{
+}
+
+extern "C" void __gcov_merge_add(gcov_type*, uint32_t)
+{
+}
+
+void gcov_dump()
+{
+    if (__atomic_exchange_n(&g_dumped, true, __ATOMIC_ACQ_REL)) {
+        return;
+    }
+    uint64_t sum_max = arcs_max();
+    uint32_t units = 0;
+    for (const gcov_info* info = g_list; info; info = info->next) {
+        emit(info, sum_max);
+        units++;
+    }
+    console::Line().str("gcda done ").num(units).print();
+}
+
+#endif // LEAFOS_PGO_GEN
@@ -0,0 +1,223 @@
+/**
+ * leafOS - LZ4解码实现
+ *
+ * 内核以-mno-sse/-mgeneral-regs-only编译，不能用向量寄存器，
+ * 字面量和匹配都以8字节通用寄存器为单位复制，只在接近缓冲区末尾时退回逐字节复制
+ */
+
+#include <lz4.hpp>
+#include <kstring.hpp>
+#include <kerrno.hpp>
+
+namespace {
+
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t WILD = 8;          // 整块复制可能越过终点的字节数
+
+inline uint16_t load16(const uint8_t* p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+inline uint32_t load32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+inline void copy8(uint8_t* d, const uint8_t* s)
+{
+    uint64_t v;
+    __builtin_memcpy(&v, s, 8);
+    __builtin_memcpy(d, &v, 8);
+}
+
+// 以8字节为单位复制到至少e处，可能多写不到8字节，调用方保证目标和源都有这些余量
+inline void wild_copy(uint8_t* d, const uint8_t* s, uint8_t* e)
+{
+    do {
+        copy8(d, s);
+        d += 8;
+        s += 8;
+    } while (d < e);
+}
+
+// 读取长度的扩展字节(每个255表示还有后续)，输入不足时返回false
+inline bool read_length(const uint8_t*& ip, const uint8_t* iend, size_t* len)
+{
+    uint8_t b;
+    do {
+        if (ip >= iend) {
+            return false;
+        }
+        b = *ip++;
+        *len += b;
+    } while (b == 255);
+    return true;
+}
+
+} // namespace
+
+int lz4_frame_header(const void* src, size_t len, Lz4FrameInfo* info)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(src);
+    if (len < 7) {
+        return 0;
+    }
+    if (load32(p) != LZ4_FRAME_MAGIC) {
+        return -EINVAL;
+    }
+
+    uint8_t flg = p[4];
+    uint8_t bd = p[5];
+    if ((flg >> 6) != 1 || (flg & 0x02) || (bd & 0x8F)) {
+        return -EINVAL;
+    }
+    if (flg & 0x01) {
+        return -ENOSYS;         // 外部字典
+    }
+    if (!(flg & 0x08)) {
+        return -ENOSYS;         // 没有内容长度就无法预先分配输出
+    }
+
+    unsigned id = (bd >> 4) & 7;
+    if (id < 4) {
+        return -EINVAL;
+    }
+
+    if (len < LZ4_FRAME_HEADER_SIZE) {
+        return 0;
+    }
+
+    uint64_t content = 0;
+    for (int i = 7; i >= 0; i--) {
+        content = (content << 8) | p[6 + i];
+    }
+
+    info->content_size = content;
+    info->block_max = 1u << (8 + 2 * id);
+    info->block_checksum = flg & 0x10;
+    info->content_checksum = flg & 0x04;
+    return LZ4_FRAME_HEADER_SIZE;
+}
+
+int64_t lz4_decompress_block(const void* src, size_t len, uint8_t* dst, size_t cap, size_t history)
+{
+    const uint8_t* ip = static_cast<const uint8_t*>(src);
+    const uint8_t* const iend = ip + len;
+    uint8_t* op = dst;
+    uint8_t* const oend = dst + cap;
+    const uint8_t* const low = dst - history;
+
+    for (;;) {
+        if (ip >= iend) {
+            return -EINVAL;
+        }
+        uint8_t token = *ip++;
+
+        // 字面量
+        size_t lit = token >> 4;
+        if (lit == 15 && !read_length(ip, iend, &lit)) {
+            return -EINVAL;
+        }
+        if (lit > (size_t)(iend - ip) || lit > (size_t)(oend - op)) {
+            return -EINVAL;
+        }
+        if (lit + WILD <= (size_t)(iend - ip) && lit + WILD <= (size_t)(oend - op)) {
+            wild_copy(op, ip, op + lit);
+        } else {
+            memmove(op, ip, lit);
+        }
+        op += lit;
+        ip += lit;
+
+        // 最后一个序列只有字面量
+        if (ip == iend) {
+            break;
+        }
+
+        // 匹配
+        if (iend - ip < 2) {
+            return -EINVAL;
+        }
+        size_t offset = load16(ip);
+        ip += 2;
+        if (!offset || offset > (size_t)(op - low)) {
+            return -EINVAL;
+        }
+
+        size_t mlen = token & 15;
+        if (mlen == 15 && !read_length(ip, iend, &mlen)) {
+            return -EINVAL;
+        }
+        mlen += MIN_MATCH;
+        if (mlen > (size_t)(oend - op)) {
+            return -EINVAL;
+        }
+
+        const uint8_t* match = op - offset;
+        if (offset >= 8 && mlen + WILD <= (size_t)(oend - op)) {
+            // 源比目标至少落后8字节，每次读到的都是已经写好的数据
+            wild_copy(op, match, op + mlen);
+            op += mlen;
+        } else {
+            // 短距离重叠(如offset为1的游程)必须逐字节展开
+            for (size_t i = 0; i < mlen; i++) {
+                op[i] = match[i];
+            }
+            op += mlen;
+        }
+    }
+
+    return op - dst;
+}
+
+int64_t lz4_decompress_frame(const void* src, size_t len, void* dst, size_t cap)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(src);
+    const uint8_t* end = p + len;
+    uint8_t* out = static_cast<uint8_t*>(dst);
+
+    Lz4FrameInfo info;
+    int hdr = lz4_frame_header(p, len, &info);
+    if (hdr <= 0) {
+        return hdr ? hdr : -EINVAL;
+    }
+    if (info.content_size > cap) {
+        return -ENOSPC;
+    }
+    p += hdr;
+
+    size_t done = 0;
+    for (;;) {
+        if (end - p < 4) {
+            return -EINVAL;
+        }
+        uint32_t word = load32(p);
+        p += 4;
+        if (!word) {
+            break;
+        }
+
+        uint32_t size = word & ~LZ4_BLOCK_UNCOMPRESSED;
+        size_t skip = size + (info.block_checksum ? 4 : 0);
+        if (size > info.block_max || skip > (size_t)(end - p)) {
+            return -EINVAL;
+        }
+        if (word & LZ4_BLOCK_UNCOMPRESSED) {
+            if (size > info.content_size - done) {
+                return -EINVAL;
+            }
+            memcpy(out + done, p, size);
+            done += size;
+        } else {
+            int64_t n = lz4_decompress_block(p, size, out + done, info.content_size - done, done);
+            if (n < 0) {
+                return n;
+            }
+            done += n;
+        }
+        p += skip;
+    }
+
+    return done == info.content_size ? (int64_t)done : -EINVAL;
+}
@@ -0,0 +1,137 @@
+/**
+ * leafOS - 内核字符串/内存函数实现
+ */
+
+#include <kstring.hpp>
+
+// 防止GCC把下面的循环识别成memcpy/memset调用，造成自身递归
+#pragma GCC optimize("no-tree-loop-distribute-patterns")
+
+extern "C" {
+
+// gnu-efi的libefi也提供memcpy/memset，CMake构建时以它的为准，因此这两个声明为弱符号
+__attribute__((weak))
+void* memcpy(void* dst, const void* src, size_t n)
+{
+    uint8_t* d = static_cast<uint8_t*>(dst);
+    const uint8_t* s = static_cast<const uint8_t*>(src);
+
+    // 两端都8字节对齐时按字拷贝
+    if ((((uintptr_t)d | (uintptr_t)s) & 7) == 0) {
+        while (n >= 8) {
+            *reinterpret_cast<uint64_t*>(d) = *reinterpret_cast<const uint64_t*>(s);
+            d += 8;
+            s += 8;
+            n -= 8;
+        }
+    }
+    while (n--) {
+        *d++ = *s++;
+    }
+    return dst;
+}
+
+void* memmove(void* dst, const void* src, size_t n)
+{
+    uint8_t* d = static_cast<uint8_t*>(dst);
+    const uint8_t* s = static_cast<const uint8_t*>(src);
+
+    if (d == s || n == 0) {
+        return dst;
+    }
+    if (d < s || d >= s + n) {
+        return memcpy(dst, src, n);
+    }
+    // 目标区域与源区域重叠且在其后，从尾部向前拷贝
+    while (n--) {
+        d[n] = s[n];
+    }
+    return dst;
+}
+
+__attribute__((weak))
+void* memset(void* dst, int c, size_t n)
+{
+    uint8_t* d = static_cast<uint8_t*>(dst);
+    uint8_t v = static_cast<uint8_t>(c);
+
+    if (((uintptr_t)d & 7) == 0) {
+        uint64_t w = 0x0101010101010101ULL * v;
+        while (n >= 8) {
+            *reinterpret_cast<uint64_t*>(d) = w;
+            d += 8;
+            n -= 8;
+        }
+    }
+    while (n--) {
+        *d++ = v;
+    }
+    return dst;
+}
+
+int memcmp(const void* a, const void* b, size_t n)
+{
+    const uint8_t* x = static_cast<const uint8_t*>(a);
+    const uint8_t* y = static_cast<const uint8_t*>(b);
+
+    for (size_t i = 0; i < n; i++) {
+        if (x[i] != y[i]) {
+            return x[i] < y[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+size_t strlen(const char* s)
+{
+    size_t n = 0;
+    while (s[n]) {
+        n++;
+    }
+    return n;
+}
+
+int strcmp(const char* a, const char* b)
+{
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return (uint8_t)*a - (uint8_t)*b;
+}
+
+int strncmp(const char* a, const char* b, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        if (a[i] != b[i] || !a[i]) {
+            return (uint8_t)a[i] - (uint8_t)b[i];
+        }
+    }
+    return 0;
+}
+
+} // extern "C"
+
+bool glob_match(const char* pat, const char* s)
+{
+    const char* star = nullptr;
+    const char* resume = nullptr;
+    while (*s) {
+        if (*pat == '*') {
+            star = pat++;
+            resume = s;
+        } else if (*pat == '?' || *pat == *s) {
+            pat++;
+            s++;
+        } else if (star) {
+            pat = star + 1;
+            s = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (*pat == '*') {
+        pat++;
+    }
+    return !*pat;
+}
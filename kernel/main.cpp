@@ -1,16 +1,116 @@
 #include <efi/efi.h>
 #include <efi/efilib.h>
+#include <kernel.hpp>
+#include <init.hpp>
+#include <efi_loader.hpp>
+#include <clock.hpp>
 
 #define UCS2(str) reinterpret_cast<CHAR16*>(const_cast<char16_t*>(u##str))
 
+// 退出启动服务后交给页分配器的空闲内存
+static mm::MemRange g_free_ranges[256];
+
+// 把ESP上的 \EFI\leafos\initrd.cpio 整个读入EfiLoaderData页，
+// 内核直接在这片内存上建立索引，不再拷贝。有LZ4压缩的版本(make COMPRESS=lz4)时优先使用，
+// 边读边解压到最终的页中
+static void __init load_initrd(BootInfo* boot){
+    void* data;
+    uint64_t size;
+    efi::LoadStats stats;
+    const char16_t* name = u"initrd.cpio.lz4";
+    int err = efi::load_lz4_file(u"\\EFI\\leafos\\initrd.cpio.lz4", &data, &size, &stats);
+    if (err) {
+        name = u"initrd.cpio";
+        err = efi::load_file(u"\\EFI\\leafos\\initrd.cpio", &data, &size, &stats);
+    }
+    if (!err) {
+        boot->initrd = data;
+        boot->initrd_size = size;
+        efi::report(name, stats, size);
+    }
+}
+
+// 按固件的实时时钟设置挂钟。EFI_TIME是当地时间，UTC = 当地时间 + TimeZone分钟
+static void __init set_realtime(){
+    EFI_TIME t;
+    if (EFI_ERROR(uefi_call_wrapper(RT->GetTime, 2, &t, NULL)) || t.Month < 1 || t.Month > 12) {
+        return;
+    }
+    // 1970-01-01起的天数(按3月为一年的开始计算闰日)
+    int64_t y = (int64_t)t.Year - (t.Month <= 2);
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    int64_t yoe = y - era * 400;
+    int64_t mp = (t.Month + 9) % 12;
+    int64_t doy = (153 * mp + 2) / 5 + t.Day - 1;
+    int64_t days = era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
+
+    int64_t sec = days * 86400 + t.Hour * 3600 + t.Minute * 60 + t.Second;
+    if (t.TimeZone != EFI_UNSPECIFIED_TIMEZONE) {
+        sec += (int64_t)t.TimeZone * 60;
+    }
+    if (sec > 0) {
+        clock_set_realtime((uint64_t)sec * 1000000000 + t.Nanosecond);
+    }
+}
+
+// 取得内存映射并退出启动服务，返回空闲区间数
+static size_t __init exit_boot_services(EFI_HANDLE ImageHandle){
+    UINTN entries, map_key, desc_size;
+    UINT32 desc_version;
+    EFI_MEMORY_DESCRIPTOR* map = LibMemoryMap(&entries, &map_key, &desc_size, &desc_version);
+    if (!map) {
+        return 0;
+    }
+
+    // 固件可能在两次调用之间改变内存映射，此时需要重新获取
+    EFI_STATUS status = uefi_call_wrapper(BS->ExitBootServices, 2, ImageHandle, map_key);
+    if (EFI_ERROR(status)) {
+        UINTN map_size = entries * desc_size;
+        status = uefi_call_wrapper(BS->GetMemoryMap, 5, &map_size, map, &map_key,
+                                   &desc_size, &desc_version);
+        if (EFI_ERROR(status)) {
+            return 0;
+        }
+        entries = map_size / desc_size;
+        if (EFI_ERROR(uefi_call_wrapper(BS->ExitBootServices, 2, ImageHandle, map_key))) {
+            return 0;
+        }
+    }
+
+    // 只取常规内存: 启动服务的内存里还有当前使用的栈
+    size_t count = 0;
+    for (UINTN i = 0; i < entries && count < 256; i++) {
+        EFI_MEMORY_DESCRIPTOR* d = reinterpret_cast<EFI_MEMORY_DESCRIPTOR*>(
+            reinterpret_cast<UINT8*>(map) + i * desc_size);
+        if (d->Type == EfiConventionalMemory) {
+            g_free_ranges[count].base = d->PhysicalStart;
+            g_free_ranges[count].pages = d->NumberOfPages;
+            count++;
+        }
+    }
+    return count;
+}
+
 extern "C"
-EFI_STATUS EFIAPI efi_main(EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable){
+EFI_STATUS EFIAPI __init efi_main(EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable){
     InitializeLib(ImageHandle, SystemTable);
     
     CHAR16* str = UCS2("hello");
 
     Print(str);
     Print(UCS2("\n"));
-    
-    return EFI_SUCCESS;
-}
\ No newline at end of file
+
+    efi::init(ImageHandle, SystemTable);
+    clock_init();
+    set_realtime();
+
+    BootInfo boot = {};
+    load_initrd(&boot);
+
+    boot.free_count = exit_boot_services(ImageHandle);
+    if (!boot.free_count) {
+        return EFI_LOAD_ERROR;
+    }
+    boot.free_ranges = g_free_ranges;
+    kernel_main(boot);
+}
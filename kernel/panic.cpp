@@ -0,0 +1,56 @@
+/**
+ * leafOS - 致命错误处理
+ */
+
+#include <kernel.hpp>
+#include <console.hpp>
+#include <ksyms.hpp>
+#include <stacktrace.hpp>
+
+namespace {
+
+constexpr uint32_t MAX_FRAMES = 32;
+
+bool g_panicked;
+
+void print_frame(uintptr_t pc, bool ret)
+{
+    console::Line line;
+    line.str("  [").hex(pc).str("]");
+    // 返回地址指向call之后，减1才落在调用者内
+    Ksym sym;
+    if (ksym_lookup(ret ? pc - 1 : pc, &sym)) {
+        line.str(" ").str(sym.name).str("+").hex(pc - sym.addr).str("/").hex(sym.size);
+    }
+    line.print();
+}
+
+void print_callers(uintptr_t fp, uintptr_t sp)
+{
+    uintptr_t frames[MAX_FRAMES];
+    uint32_t n = stack_walk(fp, sp, frames, MAX_FRAMES);
+    for (uint32_t i = 0; i < n; i++) {
+        print_frame(frames[i], true);
+    }
+}
+
+} // namespace
+
+void print_backtrace(uintptr_t pc, uintptr_t fp, uintptr_t sp)
+{
+    console::Line().str("call trace:").print();
+    print_frame(pc, false);
+    print_callers(fp, sp);
+}
+
+void panic(const char* msg)
+{
+    // 输出过程中再次出错时不再回溯，直接停机
+    if (!__atomic_exchange_n(&g_panicked, true, __ATOMIC_ACQ_REL)) {
+        console::Line().str("panic: ").str(msg).print();
+        console::Line().str("call trace:").print();
+        uintptr_t fp = reinterpret_cast<uintptr_t>(__builtin_frame_address(0));
+        print_callers(fp, fp);
+    }
+    halt_forever();
+}
@@ -0,0 +1,22 @@
+/**
+ * leafOS - 每CPU数据实现
+ */
+
+#include <percpu.hpp>
+
+namespace {
+
+PerCpu g_percpu[MAX_CPUS];
+
+} // namespace
+
+void percpu_init()
+{
+    uint32_t cpu = arch::cpu_id();
+    PerCpu& p = g_percpu[cpu % MAX_CPUS];
+    if (!p.self) {
+        p.cpu = cpu;
+        p.self = &p;
+    }
+    arch::set_cpu_local(&p);
+}
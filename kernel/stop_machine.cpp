@@ -0,0 +1,28 @@
+/**
+ * leafOS - 停机执行实现
+ */
+
+#include <stop_machine.hpp>
+#include <arch/cpu.hpp>
+#include <clock.hpp>
+#include <spinlock.hpp>
+
+namespace {
+
+Spinlock g_lock;
+
+} // namespace
+
+int stop_machine(int (*fn)(void*), void* arg, uint64_t* paused_ns)
+{
+    SpinGuard guard(g_lock);
+    unsigned long flags = arch::irq_save();
+    uint64_t start = clock_cycles();
+    int ret = fn(arg);
+    uint64_t cycles = clock_cycles() - start;
+    arch::irq_restore(flags);
+    if (paused_ns) {
+        *paused_ns = clock_cycles_to_ns(cycles);
+    }
+    return ret;
+}
@@ -0,0 +1,514 @@
+/**
+ * leafOS - 系统调用实现
+ *
+ * user_enter保存被调用者保存的寄存器，把此时的栈指针记为本CPU的kernel_sp后进入用户态；
+ * 之后每次系统调用都从kernel_sp开始使用内核栈。SYS_exit经user_return回到kernel_sp处，
+ * 恢复寄存器后从user_enter返回
+ */
+
+#include <syscall.hpp>
+#include <stddef.h>
+#include <cpuhp.hpp>
+#include <initcall.hpp>
+#include <kerrno.hpp>
+#include <percpu.hpp>
+
+#if defined(__x86_64__)
+#include <kstring.hpp>
+#include <page_alloc.hpp>
+#endif
+
+// 调用号表，由LEAFOS_SYSCALLS在编译期生成，入口代码直接按调用号取用
+#define SYSCALL_ENTRY(name) sys_##name,
+extern "C" __attribute__((used)) constexpr syscall_fn syscall_table[] = { LEAFOS_SYSCALLS(SYSCALL_ENTRY) };
+#undef SYSCALL_ENTRY
+extern "C" __attribute__((used)) constexpr uint64_t syscall_count = sizeof(syscall_table) / sizeof(syscall_table[0]);
+
+static_assert(syscall_count == SYS_COUNT, "LEAFOS_SYSCALLS changed while generating the table");
+
+// 入口代码按固定偏移访问PerCpu
+static_assert(offsetof(PerCpu, kernel_sp) == 32 && offsetof(PerCpu, user_sp) == 40 &&
+              offsetof(PerCpu, tss) == 48, "syscall entry code uses fixed PerCpu offsets");
+
+extern "C" int64_t user_enter(uintptr_t pc, uintptr_t sp, uint64_t arg);
+extern "C" __attribute__((noreturn)) void user_return(int64_t code);
+
+namespace {
+
+uint8_t g_ready[MAX_CPUS];
+
+} // namespace
+
+#if defined(__x86_64__)
+
+extern "C" char syscall_entry[];
+
+// 进入系统调用前内核所用的段选择子，user_return以iretq恢复；
+// 用户态的段选择子，返回地址不是规范地址时以iretq代替sysretq返回
+extern "C" {
+__attribute__((used)) uint64_t syscall_kernel_cs;
+__attribute__((used)) uint64_t syscall_kernel_ss;
+__attribute__((used)) uint64_t syscall_user_cs;
+__attribute__((used)) uint64_t syscall_user_ss;
+}
+
+// 入口:  SYSCALL已把返回地址存入rcx、RFLAGS存入r11，并按MSR_FMASK关中断。
+//        换上内核GS和内核栈，压入用户栈指针、rcx、r11和C代码会改写的参数寄存器，
+//        r10移到rcx作为第4个参数后查表调用，连同占位的rax共10项，call时栈按16字节对齐。
+// 出口:  rcx不在用户的低半部时，Intel的CPU执行sysretq会在内核态、已换上用户栈之后产生#GP，
+//        这时在内核栈上构造中断帧改用iretq，出错也只在内核栈上。
+//        user_sysret和user_iret两处仍在内核态而GS已是用户的，
+//        irq_common据此判断被打断时是否要换GS(还有syscall_entry的第一条指令)
+__asm__(R"(
+    .pushsection .text
+    .balign 16
+    .globl syscall_entry
+    .hidden syscall_entry
+syscall_entry:
+    swapgs
+    mov %rsp, %gs:40
+    mov %gs:32, %rsp
+    pushq %gs:40
+    push %rcx
+    push %r11
+    push %rax
+    push %rdi
+    push %rsi
+    push %rdx
+    push %r10
+    push %r8
+    push %r9
+    cmp syscall_count(%rip), %rax
+    jae 2f
+    mov %r10, %rcx
+    lea syscall_table(%rip), %r11
+    call *(%r11,%rax,8)
+1:
+    pop %r9
+    pop %r8
+    pop %r10
+    pop %rdx
+    pop %rsi
+    pop %rdi
+    add $8, %rsp
+    mov 8(%rsp), %r11
+    shr $47, %r11
+    jnz 3f
+    pop %r11
+    pop %rcx
+    pop %rsp
+user_swapgs:
+    swapgs
+    .globl user_sysret
+    .hidden user_sysret
+user_sysret:
+    sysretq
+2:
+    mov $-38, %rax
+    jmp 1b
+3:
+    pop %r11
+    pop %rcx
+    pushq (%rsp)
+    push %r11
+    mov syscall_user_ss(%rip), %r11
+    mov %r11, 16(%rsp)
+    pushq syscall_user_cs(%rip)
+    push %rcx
+    mov 16(%rsp), %r11
+    swapgs
+    .globl user_iret
+    .hidden user_iret
+user_iret:
+    iretq
+
+    // rdi = pc, rsi = sp, rdx = arg。以IF=0进入用户态，用户态不能再开中断；
+    // 被调用者保存的寄存器清零，不把内核的值带到用户态
+    .balign 16
+    .globl user_enter
+    .hidden user_enter
+user_enter:
+    push %rbp
+    mov %rsp, %rbp
+    push %rbx
+    push %r12
+    push %r13
+    push %r14
+    push %r15
+    pushfq
+    cli
+    mov %rsp, %gs:32
+    mov %gs:48, %rax
+    mov %rsp, 4(%rax)
+    mov %rdi, %rcx
+    mov %rdx, %rdi
+    mov %rsi, %rsp
+    mov $2, %r11d
+    xor %eax, %eax
+    xor %ebx, %ebx
+    xor %edx, %edx
+    xor %esi, %esi
+    xor %ebp, %ebp
+    xor %r8d, %r8d
+    xor %r9d, %r9d
+    xor %r10d, %r10d
+    xor %r12d, %r12d
+    xor %r13d, %r13d
+    xor %r14d, %r14d
+    xor %r15d, %r15d
+    jmp user_swapgs
+
+    // rdi = 退出码。系统调用是以syscall_entry设置的段进入的，经iretq换回原来的段
+    .balign 16
+    .globl user_return
+    .hidden user_return
+user_return:
+    mov %gs:32, %rsp
+    mov %rdi, %rax
+    mov %rsp, %rdx
+    pushq syscall_kernel_ss(%rip)
+    push %rdx
+    pushfq
+    pushq syscall_kernel_cs(%rip)
+    lea 1f(%rip), %rdx
+    push %rdx
+    iretq
+1:
+    popfq
+    pop %r15
+    pop %r14
+    pop %r13
+    pop %r12
+    pop %rbx
+    pop %rbp
+    ret
+    .popsection
+)");
+
+namespace {
+
+struct __attribute__((packed)) DescPtr {
+    uint16_t limit;
+    uint64_t base;
+};
+
+struct __attribute__((packed)) Tss {
+    uint32_t reserved0;
+    uint64_t rsp[3];            // rsp[0]: 从用户态进入中断时的内核栈，由user_enter设置
+    uint64_t reserved1;
+    uint64_t ist[7];            // ist[0]: NMI的栈(IST1)
+    uint64_t reserved2;
+    uint16_t reserved3;
+    uint16_t iomap_base;
+};
+
+static_assert(sizeof(Tss) == 104, "TSS layout");
+
+constexpr uint32_t MSR_EFER           = 0xC0000080;
+constexpr uint32_t MSR_STAR           = 0xC0000081;
+constexpr uint32_t MSR_LSTAR          = 0xC0000082;
+constexpr uint32_t MSR_FMASK          = 0xC0000084;
+constexpr uint32_t MSR_KERNEL_GS_BASE = 0xC0000102;
+constexpr uint64_t EFER_SCE           = 1;
+constexpr uint64_t FMASK              = 0x47700;    // 进入时清除TF DF IF IOPL NT AC
+
+// 放在固件GDT之后、从第GDT_FIRST项开始的描述符，顺序由SYSCALL/SYSRET决定:
+// 内核代码、内核数据(STAR[47:32]起)，用户数据、用户代码(STAR[63:48] + 8起)，
+// 然后是TSS和getcpu用的段。位置固定，vDSO中可以直接写出选择子
+constexpr uint64_t DESC_KERNEL_CODE = 0x00AF9A000000FFFFULL;
+constexpr uint64_t DESC_KERNEL_DATA = 0x00CF92000000FFFFULL;
+constexpr uint64_t DESC_USER_DATA   = 0x00CFF2000000FFFFULL;
+constexpr uint64_t DESC_USER_CODE   = 0x00AFFA000000FFFFULL;
+constexpr uint64_t DESC_CPU         = 0x0040F20000000000ULL;    // 用户可读的数据段，界限另填
+constexpr size_t   GDT_FIRST        = 32;           // 固件的GDT不能超过这么多项
+constexpr size_t   GDT_ENTRIES      = GDT_FIRST + 7;
+constexpr size_t   TSS_OFFSET       = 2048;         // GDT和TSS共用一页
+constexpr unsigned NMI_STACK_ORDER  = 1;
+
+static_assert(GDT_CPU_SELECTOR == ((GDT_FIRST + 6) * 8 | 3), "GDT_CPU_SELECTOR must match the GDT layout");
+
+// 复制固件的GDT并追加本内核的段和TSS，原有的选择子照常有效；
+// 下线的CPU停在cpuhp_poll中，GDT、TSS和MSR都保持原样，重新上线时不再设置。
+// NMI可能落在RSP还是用户栈的指令上(系统调用的入口和出口)，经IST1换到自己的栈(irq.cpp)
+int setup_cpu()
+{
+    PerCpu* pc = this_cpu();
+    if (pc->tss) {
+        return 0;
+    }
+    DescPtr cur;
+    __asm__ __volatile__("sgdt %0" : "=m"(cur));
+    size_t len = (size_t)cur.limit + 1;
+    if (len > GDT_FIRST * 8) {
+        return -ENOSPC;
+    }
+    uint8_t* page = static_cast<uint8_t*>(mm::alloc_pages_zeroed(0));
+    if (!page) {
+        return -ENOMEM;
+    }
+    uint8_t* nmi_stack = static_cast<uint8_t*>(mm::alloc_pages(NMI_STACK_ORDER));
+    if (!nmi_stack) {
+        mm::free_pages(page, 0);
+        return -ENOMEM;
+    }
+    memcpy(page, reinterpret_cast<const void*>(cur.base), len);
+
+    uint64_t* gdt = reinterpret_cast<uint64_t*>(page);
+    Tss* tss = reinterpret_cast<Tss*>(page + TSS_OFFSET);
+    tss->ist[0] = reinterpret_cast<uintptr_t>(nmi_stack + (mm::PAGE_SIZE << NMI_STACK_ORDER));
+    tss->iomap_base = sizeof(Tss);
+    uint64_t base = reinterpret_cast<uintptr_t>(tss);
+    uint64_t cpu = pc->cpu;
+    gdt[GDT_FIRST] = DESC_KERNEL_CODE;
+    gdt[GDT_FIRST + 1] = DESC_KERNEL_DATA;
+    gdt[GDT_FIRST + 2] = DESC_USER_DATA;
+    gdt[GDT_FIRST + 3] = DESC_USER_CODE;
+    gdt[GDT_FIRST + 4] = (sizeof(Tss) - 1) | (base & 0xFFFFFF) << 16 | 0x89ULL << 40 | (base >> 24 & 0xFF) << 56;
+    gdt[GDT_FIRST + 5] = base >> 32;
+    gdt[GDT_FIRST + 6] = DESC_CPU | (cpu & 0xFFFF) | (cpu >> 16 & 0xF) << 48;
+
+    DescPtr p = { (uint16_t)(GDT_ENTRIES * 8 - 1), reinterpret_cast<uint64_t>(page) };
+    uint16_t tr = (uint16_t)((GDT_FIRST + 4) * 8);
+    __asm__ __volatile__("lgdt %0\n"
+                         "ltr %1"
+                         :: "m"(p), "r"(tr) : "memory");
+
+    uint16_t cs, ss;
+    __asm__ __volatile__("mov %%cs, %0\n"
+                         "mov %%ss, %1"
+                         : "=r"(cs), "=r"(ss));
+    syscall_kernel_cs = cs;
+    syscall_kernel_ss = ss;
+    syscall_user_cs = (GDT_FIRST + 3) * 8 | 3;
+    syscall_user_ss = (GDT_FIRST + 2) * 8 | 3;
+
+    uint64_t star = ((uint64_t)((GDT_FIRST + 1) * 8 | 3) << 48) | ((uint64_t)(GDT_FIRST * 8) << 32);
+    arch::wrmsr(MSR_STAR, star);
+    arch::wrmsr(MSR_LSTAR, reinterpret_cast<uintptr_t>(syscall_entry));
+    arch::wrmsr(MSR_FMASK, FMASK);
+    arch::wrmsr(MSR_KERNEL_GS_BASE, 0);         // 用户态的GS
+    arch::wrmsr(MSR_EFER, arch::rdmsr(MSR_EFER) | EFER_SCE);
+    pc->tss = tss;
+    return 0;
+}
+
+} // namespace
+
+#elif defined(__aarch64__)
+
+// 来自EL0的同步异常在irq_vectors的第8项跳到这里。用户态和系统调用都屏蔽全部异常运行，
+// ELR_EL1和SPSR_EL1在处理期间不会被改写，不必保存；只保存C代码会改写的x1-x18和x30。
+// 不是SVC的同步异常(用户态访存出错等)交给irq_trap
+__asm__(R"(
+    .pushsection .text
+    .balign 16
+    .globl svc_el0
+    .hidden svc_el0
+svc_el0:
+    sub sp, sp, #160
+    stp x1, x2, [sp, #0]
+    stp x3, x4, [sp, #16]
+    stp x5, x6, [sp, #32]
+    stp x7, x8, [sp, #48]
+    stp x9, x10, [sp, #64]
+    stp x11, x12, [sp, #80]
+    stp x13, x14, [sp, #96]
+    stp x15, x16, [sp, #112]
+    stp x17, x18, [sp, #128]
+    str x30, [sp, #144]
+    mrs x9, esr_el1
+    lsr x9, x9, #26
+    cmp x9, #0x15
+    b.ne 3f
+    adrp x9, syscall_count
+    ldr x9, [x9, :lo12:syscall_count]
+    cmp x8, x9
+    b.hs 2f
+    adrp x9, syscall_table
+    add x9, x9, :lo12:syscall_table
+    ldr x9, [x9, x8, lsl #3]
+    blr x9
+1:
+    ldr x30, [sp, #144]
+    ldp x17, x18, [sp, #128]
+    ldp x15, x16, [sp, #112]
+    ldp x13, x14, [sp, #96]
+    ldp x11, x12, [sp, #80]
+    ldp x9, x10, [sp, #64]
+    ldp x7, x8, [sp, #48]
+    ldp x5, x6, [sp, #32]
+    ldp x3, x4, [sp, #16]
+    ldp x1, x2, [sp, #0]
+    add sp, sp, #160
+    eret
+2:
+    mov x0, #-38
+    b 1b
+3:
+    add sp, sp, #160
+    mov x0, #8
+    mov x1, x29
+    mov x2, sp
+    b irq_trap
+
+    // x0 = pc, x1 = sp, x2 = arg。内核可能以SP_EL0或SP_EL1运行: 切到SP_EL1并让它指向当前的栈，
+    // 来自EL0的异常就落在这里之下；原来的SPSel、DAIF、SP_EL0和SP_EL1都记在帧中，
+    // user_return据此恢复。以EL0t、屏蔽全部异常进入用户态
+    .balign 16
+    .globl user_enter
+    .hidden user_enter
+user_enter:
+    sub sp, sp, #128
+    stp x29, x30, [sp, #0]
+    mov x29, sp
+    stp x19, x20, [sp, #16]
+    stp x21, x22, [sp, #32]
+    stp x23, x24, [sp, #48]
+    stp x25, x26, [sp, #64]
+    stp x27, x28, [sp, #80]
+    mrs x9, spsel
+    mrs x10, daif
+    stp x9, x10, [sp, #112]
+    msr daifset, #0xf
+    mov x11, sp
+    msr spsel, #1
+    mov x13, sp
+    mrs x14, sp_el0
+    mov sp, x11
+    stp x13, x14, [sp, #96]
+    mrs x12, tpidr_el1
+    str x11, [x12, #32]
+    msr sp_el0, x1
+    msr elr_el1, x0
+    mov x9, #0x3c0
+    msr spsr_el1, x9
+    mov x0, x2
+    mov x1, xzr
+    mov x2, xzr
+    mov x3, xzr
+    mov x4, xzr
+    mov x5, xzr
+    mov x6, xzr
+    mov x7, xzr
+    mov x8, xzr
+    mov x9, xzr
+    mov x10, xzr
+    mov x11, xzr
+    mov x12, xzr
+    mov x13, xzr
+    mov x14, xzr
+    mov x15, xzr
+    mov x16, xzr
+    mov x17, xzr
+    mov x18, xzr
+    mov x19, xzr
+    mov x20, xzr
+    mov x21, xzr
+    mov x22, xzr
+    mov x23, xzr
+    mov x24, xzr
+    mov x25, xzr
+    mov x26, xzr
+    mov x27, xzr
+    mov x28, xzr
+    mov x29, xzr
+    mov x30, xzr
+    eret
+
+    // x0 = 退出码，运行在SP_EL1上。恢复SP_EL0、SP_EL1和SPSel后，
+    // 当前的栈指针正是user_enter的帧
+    .balign 16
+    .globl user_return
+    .hidden user_return
+user_return:
+    mrs x12, tpidr_el1
+    ldr x11, [x12, #32]
+    ldp x13, x14, [x11, #96]
+    ldp x9, x10, [x11, #112]
+    msr sp_el0, x14
+    mov sp, x13
+    msr spsel, x9
+    msr daif, x10
+    ldp x27, x28, [sp, #80]
+    ldp x25, x26, [sp, #64]
+    ldp x23, x24, [sp, #48]
+    ldp x21, x22, [sp, #32]
+    ldp x19, x20, [sp, #16]
+    ldp x29, x30, [sp, #0]
+    add sp, sp, #128
+    ret
+    .popsection
+)");
+
+extern "C" char irq_vectors[];
+
+namespace {
+
+constexpr uint64_t CNTKCTL_EL0VCTEN = 1 << 1;   // EL0可读CNTVCT_EL0
+
+// 用户态可读的TPIDRRO_EL0中放CPU的编号(vDSO的getcpu)。vDSO的clock_gettime读CNTVCT_EL0，
+// CNTKCTL_EL1的复位值不确定，不打开EL0VCTEN时这条指令会陷入EL1
+int setup_cpu()
+{
+    uint64_t cntkctl;
+    __asm__ __volatile__("mrs %0, cntkctl_el1" : "=r"(cntkctl));
+    __asm__ __volatile__("msr tpidrro_el0, %0\n"
+                         "msr cntkctl_el1, %1\n"
+                         "msr vbar_el1, %2\n"
+                         "isb"
+                         :: "r"((uint64_t)this_cpu()->cpu), "r"(cntkctl | CNTKCTL_EL0VCTEN), "r"(irq_vectors)
+                         : "memory");
+    return 0;
+}
+
+} // namespace
+
+#endif
+
+namespace {
+
+int syscall_cpu_online(uint32_t cpu)
+{
+    int err = setup_cpu();
+    if (!err) {
+        g_ready[cpu % MAX_CPUS] = 1;
+    }
+    return err;
+}
+
+void syscall_cpu_offline(uint32_t cpu)
+{
+    g_ready[cpu % MAX_CPUS] = 0;
+}
+DEFINE_CPUHP_STEP(CPUHP_LEVEL_ARCH, syscall, syscall_cpu_online, syscall_cpu_offline);
+
+// 多CPU参与启动时只设置执行这项初始化的CPU，其他CPU上线时各自设置
+int __init syscall_init()
+{
+    return syscall_cpu_online(this_cpu()->cpu);
+}
+arch_initcall(syscall_init);
+
+} // namespace
+
+// 还没有进程，用户态程序都以1号运行
+int64_t sys_getpid(uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t)
+{
+    return 1;
+}
+
+int64_t sys_exit(uint64_t code, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t)
+{
+    user_return((int64_t)code);
+}
+
+int64_t user_call(uintptr_t pc, uintptr_t sp, uint64_t arg)
+{
+    if (!access_ok(pc, 1) || !access_ok(sp - 16, 16) || (sp & 15)) {
+        return -EFAULT;
+    }
+    if (!g_ready[this_cpu()->cpu % MAX_CPUS]) {
+        return -ENODEV;
+    }
+    return user_enter(pc, sp, arg);
+}
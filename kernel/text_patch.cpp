@@ -0,0 +1,52 @@
+/**
+ * leafOS - 内核代码改写实现
+ */
+
+#include <text_patch.hpp>
+#include <stdint.h>
+#include <arch/cpu.hpp>
+#include <kerrno.hpp>
+#include <kstring.hpp>
+#include <spinlock.hpp>
+#include <vmm.hpp>
+
+namespace {
+
+// 改写窗口: 用户窗口之后的一页，与恒等映射和用户窗口都不重叠。
+// 目标不跨8字节边界，也就不会跨页，别名上的地址与原地址页内偏移相同
+constexpr uint64_t POKE_VA = mm::USER_END;
+
+Spinlock g_lock;
+
+} // namespace
+
+int text_poke(void* addr, const void* src, size_t len)
+{
+    uintptr_t va = reinterpret_cast<uintptr_t>(addr);
+    if (!text_poke_atomic(va, len)) {
+        return -EINVAL;
+    }
+    uintptr_t page = va & ~(uintptr_t)(mm::PAGE_SIZE - 1);
+
+    SpinGuard guard(g_lock);
+    mm::AddressSpace* as = mm::AddressSpace::kernel();
+    uint64_t pa = as->translate(page);
+    if (!pa) {
+        return -EFAULT;
+    }
+    int err = as->map(POKE_VA, pa & ~(mm::PAGE_SIZE - 1), mm::VM_WRITE);
+    if (err) {
+        return err;
+    }
+
+    // 读出所在的对齐字，替换其中的len字节后一次写回
+    uintptr_t alias = POKE_VA + (va - page);
+    uint64_t* word = reinterpret_cast<uint64_t*>(alias & ~(uintptr_t)7);
+    uint64_t v = *word;
+    memcpy(reinterpret_cast<uint8_t*>(&v) + (va & 7), src, len);
+    __atomic_store_n(word, v, __ATOMIC_RELEASE);
+    arch::sync_code(alias, va, len);
+
+    as->unmap(POKE_VA);
+    return 0;
+}
@@ -0,0 +1,218 @@
+/**
+ * leafOS - 静态跟踪点实现
+ *
+ * 缓冲区只追加不覆盖: 记录是变长的，覆盖旧记录后读者无法找到第一条完整记录的边界。
+ * 输出格式(行首都是"trace "):
+ *   trace clock <计数器频率>
+ *   trace event <事件号> <名字> <记录体大小> <字段名>:<类型><字节数>@<偏移> ...
+ *   trace begin <cpu> <字节数> <丢弃的记录数>
+ *   trace <十六进制>
+ *   trace end <FNV-1a>
+ * 类型是u/i/p/s(无符号、有符号、指针、字符串)。记录的字节序是本机字节序，目前都是小端
+ */
+
+#include <trace.hpp>
+#include <stdint.h>
+#include <stddef.h>
+#include <arch/clock.hpp>
+#include <clock.hpp>
+#include <console.hpp>
+#include <cpuhp.hpp>
+#include <kstring.hpp>
+#include <page_alloc.hpp>
+#include <percpu.hpp>
+
+// 由链接器生成的登记表边界
+extern "C" const TraceEvent __start_trace_events[] __attribute__((weak));
+extern "C" const TraceEvent __stop_trace_events[] __attribute__((weak));
+
+struct TraceBuffer {
+    uint8_t* data;
+    uint32_t used;
+    uint32_t lost;      // 缓冲区满或嵌套而丢弃的记录数
+    uint32_t busy;      // 正在记录；NMI打断记录时，NMI中嵌套的那一条丢弃
+    uint32_t cpu;
+};
+
+namespace {
+
+constexpr unsigned BUFFER_ORDER = 8;        // 每个CPU 1 MiB
+constexpr uint32_t BUFFER_SIZE  = (uint32_t)(mm::PAGE_SIZE << BUFFER_ORDER);
+
+#if defined(LEAFOS_TRACE_EVENTS)
+const char g_boot_events[] = LEAFOS_TRACE_EVENTS;
+#else
+const char g_boot_events[] = "";
+#endif
+
+TraceBuffer g_buffers[MAX_CPUS];
+bool        g_started;
+
+size_t event_count()
+{
+    return (size_t)(__stop_trace_events - __start_trace_events);
+}
+
+const char type_chars[] = { 'u', 'i', 'p', 's' };
+
+// 32位FNV-1a，供主机端发现串口传输中的错字
+uint32_t fnv1a(const uint8_t* p, size_t len)
+{
+    uint32_t h = 0x811c9dc5;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ p[i]) * 0x01000193;
+    }
+    return h;
+}
+
+void dump_buffer(const TraceBuffer& b)
+{
+    console::Line().str("trace begin ").num((int64_t)b.cpu).str(" ").num((int64_t)b.used)
+        .str(" ").num((int64_t)b.lost).print();
+
+    static const char digits[] = "0123456789abcdef";
+    constexpr size_t BYTES_PER_LINE = 48;
+    for (size_t off = 0; off < b.used; off += BYTES_PER_LINE) {
+        char text[6 + 2 * BYTES_PER_LINE + 1];
+        size_t n = b.used - off < BYTES_PER_LINE ? b.used - off : BYTES_PER_LINE;
+        memcpy(text, "trace ", 6);
+        for (size_t i = 0; i < n; i++) {
+            text[6 + 2 * i]     = digits[b.data[off + i] >> 4];
+            text[6 + 2 * i + 1] = digits[b.data[off + i] & 15];
+        }
+        text[6 + 2 * n] = '\n';
+        console::write(text, 6 + 2 * n + 1);
+    }
+    console::Line().str("trace end ").hex(fnv1a(b.data, b.used)).print();
+}
+
+} // namespace
+
+void trace_write(const TraceEvent* ev, const void* rec, size_t size)
+{
+    TraceBuffer* b = this_cpu()->trace;
+    if (!b) {
+        return;
+    }
+    if (b->busy) {
+        b->lost++;
+        return;
+    }
+    b->busy = 1;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+
+    uint32_t total = (uint32_t)((sizeof(TraceHeader) + size + 7) & ~(size_t)7);
+    if (BUFFER_SIZE - b->used < total) {
+        b->lost++;
+    } else {
+        TraceHeader* h = reinterpret_cast<TraceHeader*>(b->data + b->used);
+        h->ts = arch::read_counter();
+        h->id = (uint16_t)(ev - __start_trace_events);
+        h->size = (uint16_t)size;
+        h->reserved = 0;
+        memcpy(h + 1, rec, size);
+        b->used += total;
+    }
+
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    b->busy = 0;
+}
+
+size_t trace_enable(const char* pat, bool on)
+{
+    size_t n = 0;
+    for (const TraceEvent* ev = __start_trace_events; ev < __stop_trace_events; ev++) {
+        if (glob_match(pat, ev->name)) {
+            __atomic_store_n(ev->enabled, on, __ATOMIC_RELAXED);
+            n++;
+        }
+    }
+    return n;
+}
+
+void trace_init()
+{
+    if (!g_boot_events[0]) {
+        return;
+    }
+
+    PerCpu* cpu = this_cpu();
+    TraceBuffer& b = g_buffers[cpu->cpu % MAX_CPUS];
+    if (!b.data) {
+        b.data = static_cast<uint8_t*>(mm::alloc_pages(BUFFER_ORDER));
+        if (!b.data) {
+            console::Line().str("trace: out of memory on cpu ").num((int64_t)cpu->cpu).print();
+            return;
+        }
+        b.cpu = cpu->cpu;
+    }
+    cpu->trace = &b;
+
+    if (g_started) {
+        return;
+    }
+    g_started = true;
+
+    // 逗号分隔的多个通配符
+    size_t enabled = 0;
+    char pat[64];
+    for (const char* p = g_boot_events; *p;) {
+        size_t len = 0;
+        while (p[len] && p[len] != ',') {
+            len++;
+        }
+        if (len < sizeof(pat)) {
+            memcpy(pat, p, len);
+            pat[len] = 0;
+            enabled += trace_enable(pat, true);
+        }
+        p += len + (p[len] == ',');
+    }
+    console::Line().str("trace: ").num((int64_t)enabled).str(" of ").num((int64_t)event_count())
+        .str(" events enabled").print();
+}
+
+namespace {
+
+// 上线的CPU分配或重新挂上自己的缓冲区；下线的CPU不再记录，缓冲区留给trace_dump输出
+int trace_cpu_online(uint32_t)
+{
+    trace_init();
+    return 0;
+}
+
+void trace_cpu_offline(uint32_t)
+{
+    this_cpu()->trace = nullptr;
+}
+DEFINE_CPUHP_STEP(CPUHP_LEVEL_TRACE, trace, trace_cpu_online, trace_cpu_offline);
+
+} // namespace
+
+void trace_dump()
+{
+    if (!g_started) {
+        return;
+    }
+    trace_enable("*", false);
+
+    console::Line().str("trace clock ").num((int64_t)clock_hz()).print();
+    for (const TraceEvent* ev = __start_trace_events; ev < __stop_trace_events; ev++) {
+        console::Line line;
+        line.str("trace event ").num((int64_t)(ev - __start_trace_events)).str(" ").str(ev->name)
+            .str(" ").num((int64_t)ev->size);
+        for (uint16_t i = 0; i < ev->field_count; i++) {
+            const TraceField& f = ev->fields[i];
+            char type[2] = { type_chars[f.type], 0 };
+            line.str(" ").str(f.name).str(":").str(type).num((int64_t)f.size)
+                .str("@").num((int64_t)f.offset);
+        }
+        line.print();
+    }
+
+    for (const TraceBuffer& b : g_buffers) {
+        if (b.data) {
+            dump_buffer(b);
+        }
+    }
+}
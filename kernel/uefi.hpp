@@ -51,19 +51,36 @@ typedef UINTN       EFI_TPL;    // 任务优先级级别
 // 指针类型
 typedef CHAR16*     EFI_STRING; // UTF-16字符串
 
-// 状态码定义
-#define EFI_SUCCESS               0      // 成功
-#define EFI_LOAD_ERROR            (1)    // 加载错误
-#define EFI_INVALID_PARAMETER     (2)    // 无效参数
-#define EFI_UNSUPPORTED           (3)    // 不支持
-#define EFI_BAD_BUFFER_SIZE       (4)    // 缓冲区大小错误
-#define EFI_BUFFER_TOO_SMALL      (5)    // 缓冲区太小
-#define EFI_NOT_READY             (6)    // 未就绪
-#define EFI_DEVICE_ERROR          (7)    // 设备错误
-#define EFI_WRITE_PROTECTED       (8)    // 写保护
-#define EFI_OUT_OF_RESOURCES      (9)    // 资源不足
-#define EFI_NOT_FOUND             (14)   // 未找到
-#define EFI_ABORTED               (21)   // 已中止
+// 固件接口的调用约定: x86_64上固件使用Microsoft x64 ABI，内核默认是System V ABI，
+// 所有经由函数指针调用固件的地方都必须带EFIAPI；aarch64两者一致
+#if defined(__x86_64__)
+#define EFIAPI __attribute__((ms_abi))
+#else
+#define EFIAPI
+#endif
+
+// 状态码定义: 错误码最高位为1，警告码最高位为0
+#define EFI_ERROR_BIT             ((EFI_STATUS)1 << (sizeof(EFI_STATUS) * 8 - 1))
+#define EFIERR(a)                 (EFI_ERROR_BIT | (a))
+
+#define EFI_SUCCESS               0               // 成功
+#define EFI_LOAD_ERROR            EFIERR(1)       // 加载错误
+#define EFI_INVALID_PARAMETER     EFIERR(2)       // 无效参数
+#define EFI_UNSUPPORTED           EFIERR(3)       // 不支持
+#define EFI_BAD_BUFFER_SIZE       EFIERR(4)       // 缓冲区大小错误
+#define EFI_BUFFER_TOO_SMALL      EFIERR(5)       // 缓冲区太小
+#define EFI_NOT_READY             EFIERR(6)       // 未就绪
+#define EFI_DEVICE_ERROR          EFIERR(7)       // 设备错误
+#define EFI_WRITE_PROTECTED       EFIERR(8)       // 写保护
+#define EFI_OUT_OF_RESOURCES      EFIERR(9)       // 资源不足
+#define EFI_VOLUME_CORRUPTED      EFIERR(10)      // 卷损坏
+#define EFI_VOLUME_FULL           EFIERR(11)      // 卷已满
+#define EFI_NO_MEDIA              EFIERR(12)      // 无介质
+#define EFI_MEDIA_CHANGED         EFIERR(13)      // 介质已更换
+#define EFI_NOT_FOUND             EFIERR(14)      // 未找到
+#define EFI_ACCESS_DENIED         EFIERR(15)      // 拒绝访问
+#define EFI_TIMEOUT               EFIERR(18)      // 超时
+#define EFI_ABORTED               EFIERR(21)      // 已中止
 
 // 简单的字符串处理宏
 #define EFI_ERROR(Status) ((INTN)(Status) < 0)
@@ -161,11 +178,11 @@ typedef struct {
 // 简单文本输入协议（用于键盘输入）
 typedef struct EFI_SIMPLE_TEXT_INPUT_PROTOCOL {
     // 重置设备
-    EFI_STATUS (*Reset)(struct EFI_SIMPLE_TEXT_INPUT_PROTOCOL* This,
+    EFI_STATUS (EFIAPI *Reset)(struct EFI_SIMPLE_TEXT_INPUT_PROTOCOL* This,
                        BOOLEAN ExtendedVerification);
     
     // 读取按键
-    EFI_STATUS (*ReadKeyStroke)(struct EFI_SIMPLE_TEXT_INPUT_PROTOCOL* This,
+    EFI_STATUS (EFIAPI *ReadKeyStroke)(struct EFI_SIMPLE_TEXT_INPUT_PROTOCOL* This,
                                EFI_INPUT_KEY* Key);
     
     // 等待按键事件
@@ -185,93 +202,245 @@ typedef struct {
 // 简单文本输出协议（用于控制台输出）
 typedef struct EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL {
     // 重置设备
-    EFI_STATUS (*Reset)(struct EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL* This,
+    EFI_STATUS (EFIAPI *Reset)(struct EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL* This,
                        BOOLEAN ExtendedVerification);
     
     // 输出字符串
-    EFI_STATUS (*OutputString)(struct EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL* This,
+    EFI_STATUS (EFIAPI *OutputString)(struct EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL* This,
                               CHAR16* String);
     
     // 测试字符串输出
-    EFI_STATUS (*TestString)(struct EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL* This,
+    EFI_STATUS (EFIAPI *TestString)(struct EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL* This,
                             CHAR16* String);
     
     // 查询模式信息
-    EFI_STATUS (*QueryMode)(struct EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL* This,
+    EFI_STATUS (EFIAPI *QueryMode)(struct EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL* This,
                            UINTN ModeNumber,
                            UINTN* Columns,
                            UINTN* Rows);
     
     // 设置模式
-    EFI_STATUS (*SetMode)(struct EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL* This,
+    EFI_STATUS (EFIAPI *SetMode)(struct EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL* This,
                          UINTN ModeNumber);
     
     // 设置属性
-    EFI_STATUS (*SetAttribute)(struct EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL* This,
+    EFI_STATUS (EFIAPI *SetAttribute)(struct EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL* This,
                               UINTN Attribute);
     
     // 清除屏幕
-    EFI_STATUS (*ClearScreen)(struct EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL* This);
+    EFI_STATUS (EFIAPI *ClearScreen)(struct EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL* This);
     
     // 设置光标位置
-    EFI_STATUS (*SetCursorPosition)(struct EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL* This,
+    EFI_STATUS (EFIAPI *SetCursorPosition)(struct EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL* This,
                                    UINTN Column,
                                    UINTN Row);
     
     // 启用/禁用光标
-    EFI_STATUS (*EnableCursor)(struct EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL* This,
+    EFI_STATUS (EFIAPI *EnableCursor)(struct EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL* This,
                               BOOLEAN Visible);
     
     // 当前模式
     SIMPLE_TEXT_OUTPUT_MODE* Mode;
 } EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL;
 
-// // 键盘输入键结构
-// typedef struct {
-//     UINT16  ScanCode;          // 扫描码
-//     CHAR16  UnicodeChar;       // Unicode字符
-// } EFI_INPUT_KEY;
+// 事件类型与任务优先级
+#define EVT_TIMER                   0x80000000
+#define EVT_RUNTIME                 0x40000000
+#define EVT_NOTIFY_WAIT             0x00000100
+#define EVT_NOTIFY_SIGNAL           0x00000200
+
+#define TPL_APPLICATION             4
+#define TPL_CALLBACK                8
+#define TPL_NOTIFY                  16
+#define TPL_HIGH_LEVEL              31
+
+typedef VOID (EFIAPI *EFI_EVENT_NOTIFY)(EFI_EVENT Event, VOID* Context);
+
+typedef enum {
+    TimerCancel,
+    TimerPeriodic,
+    TimerRelative
+} EFI_TIMER_DELAY;
 
+typedef enum {
+    AllHandles,
+    ByRegisterNotify,
+    ByProtocol
+} EFI_LOCATE_SEARCH_TYPE;
+
+// OpenProtocol的Attributes
+#define EFI_OPEN_PROTOCOL_BY_HANDLE_PROTOCOL    0x00000001
+#define EFI_OPEN_PROTOCOL_GET_PROTOCOL          0x00000002
+
+// 启动服务表: 字段顺序必须与规范完全一致，不用的项也要占位
 typedef struct {
     EFI_TABLE_HEADER  Hdr;    // 表头
-    
+
     // 任务优先级服务
-    EFI_TPL (*RaiseTPL)(EFI_TPL NewTpl);
-    VOID (*RestoreTPL)(EFI_TPL OldTpl);
-    
+    EFI_TPL (EFIAPI *RaiseTPL)(EFI_TPL NewTpl);
+    VOID (EFIAPI *RestoreTPL)(EFI_TPL OldTpl);
+
     // 内存分配服务
-    EFI_STATUS (*AllocatePages)(EFI_ALLOCATE_TYPE Type,
+    EFI_STATUS (EFIAPI *AllocatePages)(EFI_ALLOCATE_TYPE Type,
                                EFI_MEMORY_TYPE MemoryType,
                                UINTN Pages,
                                EFI_PHYSICAL_ADDRESS* Memory);
-    EFI_STATUS (*FreePages)(EFI_PHYSICAL_ADDRESS Memory,
+    EFI_STATUS (EFIAPI *FreePages)(EFI_PHYSICAL_ADDRESS Memory,
                            UINTN Pages);
-    EFI_STATUS (*GetMemoryMap)(UINTN* MemoryMapSize,
+    EFI_STATUS (EFIAPI *GetMemoryMap)(UINTN* MemoryMapSize,
                               EFI_MEMORY_DESCRIPTOR* MemoryMap,
                               UINTN* MapKey,
                               UINTN* DescriptorSize,
                               UINT32* DescriptorVersion);
-    
-    // 退出启动服务
-    EFI_STATUS (*ExitBootServices)(EFI_HANDLE ImageHandle,
+    EFI_STATUS (EFIAPI *AllocatePool)(EFI_MEMORY_TYPE PoolType,
+                              UINTN Size,
+                              VOID** Buffer);
+    EFI_STATUS (EFIAPI *FreePool)(VOID* Buffer);
+
+    // 事件与定时器服务
+    EFI_STATUS (EFIAPI *CreateEvent)(UINT32 Type,
+                             EFI_TPL NotifyTpl,
+                             EFI_EVENT_NOTIFY NotifyFunction,
+                             VOID* NotifyContext,
+                             EFI_EVENT* Event);
+    EFI_STATUS (EFIAPI *SetTimer)(EFI_EVENT Event,
+                          EFI_TIMER_DELAY Type,
+                          UINT64 TriggerTime);
+    EFI_STATUS (EFIAPI *WaitForEvent)(UINTN NumberOfEvents,
+                              EFI_EVENT* Event,
+                              UINTN* Index);
+    EFI_STATUS (EFIAPI *SignalEvent)(EFI_EVENT Event);
+    EFI_STATUS (EFIAPI *CloseEvent)(EFI_EVENT Event);
+    EFI_STATUS (EFIAPI *CheckEvent)(EFI_EVENT Event);
+
+    // 协议处理服务
+    VOID*      InstallProtocolInterface;
+    VOID*      ReinstallProtocolInterface;
+    VOID*      UninstallProtocolInterface;
+    EFI_STATUS (EFIAPI *HandleProtocol)(EFI_HANDLE Handle,
+                                EFI_GUID* Protocol,
+                                VOID** Interface);
+    VOID*      Reserved;
+    VOID*      RegisterProtocolNotify;
+    EFI_STATUS (EFIAPI *LocateHandle)(EFI_LOCATE_SEARCH_TYPE SearchType,
+                              EFI_GUID* Protocol,
+                              VOID* SearchKey,
+                              UINTN* BufferSize,
+                              EFI_HANDLE* Buffer);
+    VOID*      LocateDevicePath;
+    EFI_STATUS (EFIAPI *InstallConfigurationTable)(EFI_GUID* Guid,
+                                           VOID* Table);
+
+    // 映像服务
+    EFI_STATUS (EFIAPI *LoadImage)(BOOLEAN BootPolicy,
+                           EFI_HANDLE ParentImageHandle,
+                           VOID* DevicePath,
+                           VOID* SourceBuffer,
+                           UINTN SourceSize,
+                           EFI_HANDLE* ImageHandle);
+    EFI_STATUS (EFIAPI *StartImage)(EFI_HANDLE ImageHandle,
+                            UINTN* ExitDataSize,
+                            CHAR16** ExitData);
+    EFI_STATUS (EFIAPI *Exit)(EFI_HANDLE ImageHandle,
+                      EFI_STATUS ExitStatus,
+                      UINTN ExitDataSize,
+                      CHAR16* ExitData);
+    EFI_STATUS (EFIAPI *UnloadImage)(EFI_HANDLE ImageHandle);
+    EFI_STATUS (EFIAPI *ExitBootServices)(EFI_HANDLE ImageHandle,
                                   UINTN MapKey);
-    
-    // 还有很多其他函数...
-} EFI_BOOT_SERVICES;
 
+    // 杂项服务
+    EFI_STATUS (EFIAPI *GetNextMonotonicCount)(UINT64* Count);
+    EFI_STATUS (EFIAPI *Stall)(UINTN Microseconds);
+    EFI_STATUS (EFIAPI *SetWatchdogTimer)(UINTN Timeout,
+                                  UINT64 WatchdogCode,
+                                  UINTN DataSize,
+                                  CHAR16* WatchdogData);
+
+    // 驱动模型服务
+    VOID*      ConnectController;
+    VOID*      DisconnectController;
+
+    // 打开/关闭协议
+    EFI_STATUS (EFIAPI *OpenProtocol)(EFI_HANDLE Handle,
+                              EFI_GUID* Protocol,
+                              VOID** Interface,
+                              EFI_HANDLE AgentHandle,
+                              EFI_HANDLE ControllerHandle,
+                              UINT32 Attributes);
+    EFI_STATUS (EFIAPI *CloseProtocol)(EFI_HANDLE Handle,
+                               EFI_GUID* Protocol,
+                               EFI_HANDLE AgentHandle,
+                               EFI_HANDLE ControllerHandle);
+    VOID*      OpenProtocolInformation;
+
+    // 库服务
+    VOID*      ProtocolsPerHandle;
+    EFI_STATUS (EFIAPI *LocateHandleBuffer)(EFI_LOCATE_SEARCH_TYPE SearchType,
+                                    EFI_GUID* Protocol,
+                                    VOID* SearchKey,
+                                    UINTN* NoHandles,
+                                    EFI_HANDLE** Buffer);
+    EFI_STATUS (EFIAPI *LocateProtocol)(EFI_GUID* Protocol,
+                                VOID* Registration,
+                                VOID** Interface);
+    VOID*      InstallMultipleProtocolInterfaces;
+    VOID*      UninstallMultipleProtocolInterfaces;
+
+    // 32位CRC服务
+    EFI_STATUS (EFIAPI *CalculateCrc32)(VOID* Data,
+                                UINTN DataSize,
+                                UINT32* Crc32);
+
+    // 杂项服务
+    VOID (EFIAPI *CopyMem)(VOID* Destination,
+                   VOID* Source,
+                   UINTN Length);
+    VOID (EFIAPI *SetMem)(VOID* Buffer,
+                  UINTN Size,
+                  UINT8 Value);
+    VOID*      CreateEventEx;
+} EFI_BOOT_SERVICES;
 
+// 运行时服务表
 typedef struct {
     EFI_TABLE_HEADER  Hdr;    // 表头
-    
-    // 获取当前时间
-    EFI_STATUS (*GetTime)(EFI_TIME* Time,
+
+    // 时间服务
+    EFI_STATUS (EFIAPI *GetTime)(EFI_TIME* Time,
                          VOID* Capabilities);
-    
-    // 设置当前时间
-    EFI_STATUS (*SetTime)(EFI_TIME* Time);
-    
-    // 还有很多其他函数...
-}EFI_RUNTIME_SERVICES;
+    EFI_STATUS (EFIAPI *SetTime)(EFI_TIME* Time);
+    VOID*      GetWakeupTime;
+    VOID*      SetWakeupTime;
+
+    // 虚拟内存服务
+    EFI_STATUS (EFIAPI *SetVirtualAddressMap)(UINTN MemoryMapSize,
+                                      UINTN DescriptorSize,
+                                      UINT32 DescriptorVersion,
+                                      EFI_MEMORY_DESCRIPTOR* VirtualMap);
+    VOID*      ConvertPointer;
+
+    // 变量服务
+    EFI_STATUS (EFIAPI *GetVariable)(CHAR16* VariableName,
+                             EFI_GUID* VendorGuid,
+                             UINT32* Attributes,
+                             UINTN* DataSize,
+                             VOID* Data);
+    VOID*      GetNextVariableName;
+    VOID*      SetVariable;
+
+    // 杂项服务
+    VOID*      GetNextHighMonotonicCount;
+    VOID (EFIAPI *ResetSystem)(UINT32 ResetType,
+                       EFI_STATUS ResetStatus,
+                       UINTN DataSize,
+                       VOID* ResetData);
+
+    // 胶囊与变量查询服务
+    VOID*      UpdateCapsule;
+    VOID*      QueryCapsuleCapabilities;
+    VOID*      QueryVariableInfo;
+} EFI_RUNTIME_SERVICES;
 
 typedef struct {
     EFI_GUID    VendorGuid;     // 供应商GUID
@@ -313,12 +482,128 @@ typedef struct {
 } EFI_SYSTEM_TABLE;
 
 // ============================================
-// 启动服务表
+// 映像与文件系统协议
 // ============================================
 
+#define EFI_LOADED_IMAGE_PROTOCOL_GUID \
+    { 0x5b1b31a1, 0x9562, 0x11d2, { 0x8e, 0x3f, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } }
 
+#define EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_GUID \
+    { 0x964e5b22, 0x6459, 0x11d2, { 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } }
 
+#define EFI_FILE_INFO_ID \
+    { 0x09576e92, 0x6d3f, 0x11d2, { 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } }
 
+// 已加载映像协议 (由固件安装在内核自己的ImageHandle上)
+typedef struct {
+    UINT32              Revision;
+    EFI_HANDLE          ParentHandle;
+    EFI_SYSTEM_TABLE*   SystemTable;
+
+    EFI_HANDLE          DeviceHandle;       // 映像所在的设备，即ESP
+    VOID*               FilePath;
+    VOID*               Reserved;
+
+    UINT32              LoadOptionsSize;
+    VOID*               LoadOptions;
+
+    VOID*               ImageBase;
+    UINT64              ImageSize;
+    EFI_MEMORY_TYPE     ImageCodeType;
+    EFI_MEMORY_TYPE     ImageDataType;
+    EFI_STATUS (EFIAPI *Unload)(EFI_HANDLE ImageHandle);
+} EFI_LOADED_IMAGE_PROTOCOL;
+
+// Open的OpenMode
+#define EFI_FILE_MODE_READ          0x0000000000000001ULL
+#define EFI_FILE_MODE_WRITE         0x0000000000000002ULL
+#define EFI_FILE_MODE_CREATE        0x8000000000000000ULL
+
+// 文件属性
+#define EFI_FILE_READ_ONLY          0x0000000000000001ULL
+#define EFI_FILE_HIDDEN             0x0000000000000002ULL
+#define EFI_FILE_SYSTEM             0x0000000000000004ULL
+#define EFI_FILE_DIRECTORY          0x0000000000000010ULL
+#define EFI_FILE_ARCHIVE            0x0000000000000020ULL
+
+#define EFI_FILE_PROTOCOL_REVISION          0x00010000
+#define EFI_FILE_PROTOCOL_REVISION2         0x00020000
+
+// GetInfo(EFI_FILE_INFO_ID)返回的信息，FileName是变长的
+typedef struct {
+    UINT64      Size;               // 整个结构的字节数，含文件名
+    UINT64      FileSize;
+    UINT64      PhysicalSize;
+    EFI_TIME    CreateTime;
+    EFI_TIME    LastAccessTime;
+    EFI_TIME    ModificationTime;
+    UINT64      Attribute;
+    CHAR16      FileName[1];
+} EFI_FILE_INFO;
+
+// 异步读写(ReadEx/WriteEx)的请求令牌: Event为NULL时按同步执行，
+// 否则调用立即返回，完成时固件填写Status/BufferSize并触发Event
+typedef struct {
+    EFI_EVENT   Event;
+    EFI_STATUS  Status;
+    UINTN       BufferSize;
+    VOID*       Buffer;
+} EFI_FILE_IO_TOKEN;
+
+// 文件协议: 每个打开的文件/目录一个实例
+typedef struct EFI_FILE_PROTOCOL {
+    UINT64      Revision;
+
+    EFI_STATUS (EFIAPI *Open)(struct EFI_FILE_PROTOCOL* This,
+                      struct EFI_FILE_PROTOCOL** NewHandle,
+                      CHAR16* FileName,
+                      UINT64 OpenMode,
+                      UINT64 Attributes);
+    EFI_STATUS (EFIAPI *Close)(struct EFI_FILE_PROTOCOL* This);
+    EFI_STATUS (EFIAPI *Delete)(struct EFI_FILE_PROTOCOL* This);
+
+    // 从当前位置读*BufferSize字节，返回时*BufferSize为实际读到的字节数
+    EFI_STATUS (EFIAPI *Read)(struct EFI_FILE_PROTOCOL* This,
+                      UINTN* BufferSize,
+                      VOID* Buffer);
+    EFI_STATUS (EFIAPI *Write)(struct EFI_FILE_PROTOCOL* This,
+                       UINTN* BufferSize,
+                       VOID* Buffer);
+    EFI_STATUS (EFIAPI *GetPosition)(struct EFI_FILE_PROTOCOL* This,
+                             UINT64* Position);
+    EFI_STATUS (EFIAPI *SetPosition)(struct EFI_FILE_PROTOCOL* This,
+                             UINT64 Position);
+    EFI_STATUS (EFIAPI *GetInfo)(struct EFI_FILE_PROTOCOL* This,
+                         EFI_GUID* InformationType,
+                         UINTN* BufferSize,
+                         VOID* Buffer);
+    EFI_STATUS (EFIAPI *SetInfo)(struct EFI_FILE_PROTOCOL* This,
+                         EFI_GUID* InformationType,
+                         UINTN BufferSize,
+                         VOID* Buffer);
+    EFI_STATUS (EFIAPI *Flush)(struct EFI_FILE_PROTOCOL* This);
+
+    // 以下仅在Revision >= EFI_FILE_PROTOCOL_REVISION2时存在
+    EFI_STATUS (EFIAPI *OpenEx)(struct EFI_FILE_PROTOCOL* This,
+                        struct EFI_FILE_PROTOCOL** NewHandle,
+                        CHAR16* FileName,
+                        UINT64 OpenMode,
+                        UINT64 Attributes,
+                        EFI_FILE_IO_TOKEN* Token);
+    EFI_STATUS (EFIAPI *ReadEx)(struct EFI_FILE_PROTOCOL* This,
+                        EFI_FILE_IO_TOKEN* Token);
+    EFI_STATUS (EFIAPI *WriteEx)(struct EFI_FILE_PROTOCOL* This,
+                         EFI_FILE_IO_TOKEN* Token);
+    EFI_STATUS (EFIAPI *FlushEx)(struct EFI_FILE_PROTOCOL* This,
+                         EFI_FILE_IO_TOKEN* Token);
+} EFI_FILE_PROTOCOL;
+
+// 简单文件系统协议: 安装在每个可识别的卷(如ESP)的句柄上
+typedef struct EFI_SIMPLE_FILE_SYSTEM_PROTOCOL {
+    UINT64      Revision;
+    EFI_STATUS (EFIAPI *OpenVolume)(struct EFI_SIMPLE_FILE_SYSTEM_PROTOCOL* This,
+                            EFI_FILE_PROTOCOL** Root);
+} EFI_SIMPLE_FILE_SYSTEM_PROTOCOL;
 
 #ifdef __cplusplus
 } // extern "C"
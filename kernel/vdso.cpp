@@ -0,0 +1,241 @@
+/**
+ * leafOS - vDSO实现
+ *
+ * 代码页是内核映像中按页对齐、独占一页的只读数据，其中的代码只以PC相对的方式访问
+ * 前一页(时间页)，映射到任何地址都能运行。时间页的读法与clock.cpp的写法对应:
+ * seq为奇数时等待，读完换算参数后seq不变才采用
+ */
+
+#include <vdso.hpp>
+#include <stddef.h>
+#include <clock.hpp>
+#include <kerrno.hpp>
+#include <kstring.hpp>
+#include <percpu.hpp>
+#include <syscall.hpp>
+
+// 代码中直接使用的常量
+static_assert(offsetof(ClockPage, seq) == 0 && offsetof(ClockPage, cycle_base) == 8 &&
+              offsetof(ClockPage, mult) == 16 && offsetof(ClockPage, base_ns) == 24,
+              "vDSO code reads ClockPage at fixed offsets");
+static_assert(CLOCK_REALTIME == 0 && CLOCK_MONOTONIC == 1, "vDSO code indexes base_ns by clockid");
+static_assert(SYS_clock_gettime == 2, "update the fallback syscall number in the vDSO code");
+
+extern "C" const char vdso_start[];
+extern "C" const char vdso_clock_gettime[];
+extern "C" const char vdso_getcpu[];
+
+#if defined(__x86_64__)
+
+static_assert(GDT_CPU_SELECTOR == 0x133, "update the selector in vdso_getcpu");
+
+// clock_gettime: 纳秒数 = base_ns[clockid] + (TSC - cycle_base) * mult >> 32。
+// lfence使rdtsc不早于前面读时间页的指令执行
+__asm__(R"(
+    .pushsection .rodata.vdso, "a"
+    .balign 4096
+    .globl vdso_start
+    .hidden vdso_start
+vdso_start:
+
+    .globl vdso_clock_gettime
+    .hidden vdso_clock_gettime
+vdso_clock_gettime:
+    cmp $1, %edi
+    ja 3f
+    mov %edi, %edi
+    lea vdso_start-4096(%rip), %r8
+1:
+    mov (%r8), %ecx
+    test $1, %ecx
+    jnz 2f
+    mov 8(%r8), %r9
+    mov 16(%r8), %r10
+    mov 24(%r8,%rdi,8), %r11
+    lfence
+    rdtsc
+    shl $32, %rdx
+    or %rdx, %rax
+    sub %r9, %rax
+    mul %r10
+    shrd $32, %rdx, %rax
+    add %r11, %rax
+    cmp (%r8), %ecx
+    jne 1b
+    xor %edx, %edx
+    mov $1000000000, %ecx
+    div %rcx
+    mov %rax, (%rsi)
+    mov %rdx, 8(%rsi)
+    xor %eax, %eax
+    ret
+2:
+    pause
+    jmp 1b
+3:
+    mov $2, %eax
+    syscall
+    ret
+
+    .globl vdso_getcpu
+    .hidden vdso_getcpu
+vdso_getcpu:
+    mov $0x133, %eax
+    lsl %eax, %eax
+    test %rdi, %rdi
+    jz 1f
+    mov %eax, (%rdi)
+1:
+    test %rsi, %rsi
+    jz 2f
+    movl $0, (%rsi)
+2:
+    xor %eax, %eax
+    ret
+
+    .balign 4096
+    .popsection
+)");
+
+#elif defined(__aarch64__)
+
+// clock_gettime: 同x86，64x64位乘积的[95:32]位由umulh和extr取得。
+// 两次读seq之间的dmb ishld使换算参数的读取不越过它们
+__asm__(R"(
+    .pushsection .rodata.vdso, "a"
+    .balign 4096
+    .globl vdso_start
+    .hidden vdso_start
+vdso_start:
+
+    .globl vdso_clock_gettime
+    .hidden vdso_clock_gettime
+vdso_clock_gettime:
+    cmp w0, #1
+    b.hi 3f
+    adr x2, vdso_start - 4096
+1:
+    ldr w4, [x2]
+    tbnz w4, #0, 2f
+    dmb ishld
+    ldr x5, [x2, #8]
+    ldr x6, [x2, #16]
+    add x7, x2, #24
+    ldr x3, [x7, w0, uxtw #3]
+    isb
+    mrs x7, cntvct_el0
+    sub x7, x7, x5
+    mul x8, x7, x6
+    umulh x9, x7, x6
+    extr x8, x9, x8, #32
+    add x8, x8, x3
+    dmb ishld
+    ldr w5, [x2]
+    cmp w4, w5
+    b.ne 1b
+    mov x10, #0xca00
+    movk x10, #0x3b9a, lsl #16
+    udiv x11, x8, x10
+    msub x12, x11, x10, x8
+    stp x11, x12, [x1]
+    mov w0, #0
+    ret
+2:
+    yield
+    b 1b
+3:
+    mov x8, #2
+    svc #0
+    ret
+
+    .globl vdso_getcpu
+    .hidden vdso_getcpu
+vdso_getcpu:
+    mrs x2, tpidrro_el0
+    cbz x0, 1f
+    str w2, [x0]
+1:
+    cbz x1, 2f
+    str wzr, [x1]
+2:
+    mov w0, #0
+    ret
+
+    .balign 4096
+    .popsection
+)");
+
+#endif
+
+namespace {
+
+struct VdsoSym {
+    const char* name;
+    const char* addr;
+};
+
+const VdsoSym g_syms[] = {
+    { "clock_gettime", vdso_clock_gettime },
+    { "getcpu",        vdso_getcpu },
+};
+
+} // namespace
+
+int vdso_map(mm::AddressSpace* as)
+{
+    int err = as->map(VDSO_DATA, reinterpret_cast<uintptr_t>(clock_page()), mm::VM_USER);
+    if (err) {
+        return err;
+    }
+    err = as->map(VDSO_TEXT, reinterpret_cast<uintptr_t>(vdso_start), mm::VM_USER | mm::VM_EXEC);
+    if (err) {
+        as->unmap(VDSO_DATA);
+    }
+    return err;
+}
+
+uintptr_t vdso_lookup(const char* name)
+{
+    for (const VdsoSym& s : g_syms) {
+        if (!strcmp(s.name, name)) {
+            return VDSO_TEXT + (uintptr_t)(s.addr - vdso_start);
+        }
+    }
+    return 0;
+}
+
+int64_t sys_clock_gettime(uint64_t clockid, uint64_t ts, uint64_t, uint64_t, uint64_t, uint64_t)
+{
+    uint64_t ns;
+    switch ((int)clockid) {
+    case CLOCK_REALTIME:
+        ns = clock_realtime_ns();
+        break;
+    case CLOCK_MONOTONIC:
+        ns = clock_ns();
+        break;
+    default:
+        return -EINVAL;
+    }
+    if (!access_ok(ts, sizeof(Timespec))) {
+        return -EFAULT;
+    }
+    Timespec* p = reinterpret_cast<Timespec*>(ts);
+    p->tv_sec = (int64_t)(ns / 1000000000);
+    p->tv_nsec = (int64_t)(ns % 1000000000);
+    return 0;
+}
+
+int64_t sys_getcpu(uint64_t cpu, uint64_t node, uint64_t, uint64_t, uint64_t, uint64_t)
+{
+    if ((cpu && !access_ok(cpu, sizeof(uint32_t))) || (node && !access_ok(node, sizeof(uint32_t)))) {
+        return -EFAULT;
+    }
+    if (cpu) {
+        *reinterpret_cast<uint32_t*>(cpu) = this_cpu()->cpu;
+    }
+    if (node) {
+        *reinterpret_cast<uint32_t*>(node) = 0;
+    }
+    return 0;
+}
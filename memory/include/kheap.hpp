@@ -0,0 +1,43 @@
+/**
+ * leafOS - 内核堆
+ * 小对象按2的幂大小分级，从单页切分；大对象直接向页分配器申请
+ */
+
+#pragma once
+#ifndef __LEAFOS_KHEAP_H__
+#define __LEAFOS_KHEAP_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+void* kmalloc(size_t size);
+void* kzalloc(size_t size);
+void* krealloc(void* ptr, size_t size);
+void  kfree(void* ptr);
+
+// 放置new (独立环境下没有<new>)
+#if __STDC_HOSTED__
+#include <new>
+#else
+inline void* operator new(size_t, void* p) noexcept { return p; }
+inline void* operator new[](size_t, void* p) noexcept { return p; }
+#endif
+
+// 在内核堆上构造/析构对象，分配失败时返回nullptr
+template <typename T, typename... Args>
+T* knew(Args&&... args)
+{
+    void* p = kmalloc(sizeof(T));
+    return p ? new (p) T(static_cast<Args&&>(args)...) : nullptr;
+}
+
+template <typename T>
+void kdelete(T* obj)
+{
+    if (obj) {
+        obj->~T();
+        kfree(obj);
+    }
+}
+
+#endif // __LEAFOS_KHEAP_H__
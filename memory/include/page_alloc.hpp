@@ -0,0 +1,55 @@
+/**
+ * leafOS - 物理页分配器
+ * 伙伴系统(buddy)分配器，管理ExitBootServices之后可用的物理内存
+ *
+ * UEFI在x86_64和aarch64上都对物理内存做恒等映射，
+ * 因此这里返回的指针既是虚拟地址也是物理地址
+ */
+
+#pragma once
+#ifndef __LEAFOS_PAGE_ALLOC_H__
+#define __LEAFOS_PAGE_ALLOC_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace mm {
+
+constexpr unsigned PAGE_SHIFT      = 12;
+constexpr uint64_t PAGE_SIZE       = 1ULL << PAGE_SHIFT;
+constexpr unsigned MAX_ORDER       = 10;    // 最大块: 2^10页 = 4 MiB
+constexpr unsigned HUGE_PAGE_ORDER = 9;     // 2 MiB大页
+
+// 一段空闲物理内存 (地址和页数均按4K计)
+struct MemRange {
+    uint64_t base;
+    uint64_t pages;
+};
+
+// 用空闲内存区间初始化分配器，页描述符数组从其中一段区间切出
+void page_alloc_init(const MemRange* ranges, size_t count);
+
+// 分配/释放 2^order 个连续物理页，块按自身大小对齐
+void* alloc_pages(unsigned order);
+void* alloc_pages_zeroed(unsigned order);
+void  free_pages(void* addr, unsigned order);
+
+// 把任意一段页对齐的区间交给分配器 (例如启动完成后回收的内存)
+void free_range(uint64_t phys, uint64_t pages);
+
+uint64_t free_page_count();
+uint64_t total_page_count();
+
+// 把字节数换算成能容纳它的最小order
+static inline unsigned size_to_order(uint64_t bytes)
+{
+    unsigned order = 0;
+    while ((PAGE_SIZE << order) < bytes) {
+        order++;
+    }
+    return order;
+}
+
+} // namespace mm
+
+#endif // __LEAFOS_PAGE_ALLOC_H__
@@ -0,0 +1,72 @@
+/**
+ * leafOS - 虚拟地址空间
+ *
+ * 内核沿用UEFI的恒等映射。新建的地址空间共享当前页表中内核部分的顶层表项，
+ * 用户映射只放在 [USER_BASE, USER_END) 窗口里，该窗口的页表归地址空间自己所有。
+ */
+
+#pragma once
+#ifndef __LEAFOS_VMM_H__
+#define __LEAFOS_VMM_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <page_alloc.hpp>
+#include <spinlock.hpp>
+
+namespace mm {
+
+// 用户映射窗口: 512 GiB起的512 GiB，对应顶层页表的第1项，不与低端恒等映射重叠
+constexpr uint64_t USER_BASE = 0x0000008000000000ULL;
+constexpr uint64_t USER_END  = 0x0000010000000000ULL;
+
+constexpr uint64_t HUGE_PAGE_SIZE = PAGE_SIZE << HUGE_PAGE_ORDER;
+
+// 映射属性
+constexpr uint32_t VM_WRITE = 1u << 0;
+constexpr uint32_t VM_USER  = 1u << 1;
+constexpr uint32_t VM_EXEC  = 1u << 2;
+
+class AddressSpace {
+public:
+    // 新建地址空间，内核映射与当前活动页表共享
+    static AddressSpace* create();
+
+    // 当前活动页表(启动时即固件页表)对应的内核地址空间
+    static AddressSpace* kernel();
+
+    // 映射一个4K页或一个2 MiB大页，va/pa必须按对应大小对齐
+    int map(uint64_t va, uint64_t pa, uint32_t flags);
+    int map_huge(uint64_t va, uint64_t pa, uint32_t flags);
+
+    // 解除映射；大页中的地址会解除整个大页，返回解除的字节数
+    uint64_t unmap(uint64_t va);
+
+    // 查询va对应的物理地址，未映射时返回0
+    uint64_t translate(uint64_t va);
+
+    // 同translate，但要求va所在的页允许用户访问，write时还要可写，否则返回0。
+    // 内核代替用户访问其内存(如I/O环的缓冲区)前用它检查
+    uint64_t translate_user(uint64_t va, bool write);
+
+    // 设置va所在的4K页是否可执行。va在更大的页中时先把该页逐级拆成4K页，映射和其余属性不变。
+    // 未映射时返回-EFAULT，拆分时没有内存返回-ENOMEM
+    int set_exec(uint64_t va, bool exec);
+
+    // 切换到这个地址空间
+    void activate();
+
+    uint64_t root() const { return root_; }
+
+    explicit AddressSpace(uint64_t root) : root_(root) {}
+
+private:
+    uint64_t* walk(uint64_t va, unsigned leaf_level, bool create);
+
+    uint64_t root_;
+    Spinlock lock_;
+};
+
+} // namespace mm
+
+#endif // __LEAFOS_VMM_H__
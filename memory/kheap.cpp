@@ -0,0 +1,150 @@
+/**
+ * leafOS - 内核堆实现
+ *
+ * 每个对象前有16字节头部，记录它属于哪个大小级别或页块的order，
+ * 因此kfree不需要调用者提供大小。
+ */
+
+#include <kheap.hpp>
+#include <page_alloc.hpp>
+#include <kstring.hpp>
+#include <spinlock.hpp>
+
+namespace {
+
+constexpr uint32_t HEAP_MAGIC   = 0x4C454146;   // "LEAF"
+constexpr unsigned MIN_SHIFT    = 5;            // 最小块32字节(含头部)
+constexpr unsigned NUM_CLASSES  = 7;            // 32 .. 2048
+constexpr uint16_t CLASS_LARGE  = 0xFFFF;
+
+struct Header {
+    uint32_t magic;
+    uint16_t size_class;    // 大小级别，或CLASS_LARGE表示整页分配
+    uint16_t order;         // 整页分配时的order
+    uint64_t size;          // 请求的字节数
+};
+
+struct FreeObj {
+    FreeObj* next;
+};
+
+Spinlock g_heap_lock;
+FreeObj* g_free[NUM_CLASSES];
+
+unsigned class_of(size_t total)
+{
+    unsigned c = 0;
+    while ((1UL << (c + MIN_SHIFT)) < total) {
+        c++;
+    }
+    return c;
+}
+
+// 取一页切成同样大小的对象挂到空闲链表 (调用者持锁)
+bool refill(unsigned c)
+{
+    uint8_t* page = static_cast<uint8_t*>(mm::alloc_pages(0));
+    if (!page) {
+        return false;
+    }
+    size_t obj = 1UL << (c + MIN_SHIFT);
+    for (size_t off = 0; off + obj <= mm::PAGE_SIZE; off += obj) {
+        FreeObj* f = reinterpret_cast<FreeObj*>(page + off);
+        f->next = g_free[c];
+        g_free[c] = f;
+    }
+    return true;
+}
+
+Header* header_of(void* ptr)
+{
+    return reinterpret_cast<Header*>(ptr) - 1;
+}
+
+} // namespace
+
+void* kmalloc(size_t size)
+{
+    size_t total = size + sizeof(Header);
+    Header* h;
+
+    if (total <= (1UL << (MIN_SHIFT + NUM_CLASSES - 1))) {
+        unsigned c = class_of(total);
+        SpinGuard guard(g_heap_lock);
+        if (!g_free[c] && !refill(c)) {
+            return nullptr;
+        }
+        h = reinterpret_cast<Header*>(g_free[c]);
+        g_free[c] = g_free[c]->next;
+        h->size_class = static_cast<uint16_t>(c);
+        h->order = 0;
+    } else {
+        unsigned order = mm::size_to_order(total);
+        h = static_cast<Header*>(mm::alloc_pages(order));
+        if (!h) {
+            return nullptr;
+        }
+        h->size_class = CLASS_LARGE;
+        h->order = static_cast<uint16_t>(order);
+    }
+
+    h->magic = HEAP_MAGIC;
+    h->size = size;
+    return h + 1;
+}
+
+void* kzalloc(size_t size)
+{
+    void* p = kmalloc(size);
+    if (p) {
+        memset(p, 0, size);
+    }
+    return p;
+}
+
+void* krealloc(void* ptr, size_t size)
+{
+    if (!ptr) {
+        return kmalloc(size);
+    }
+
+    Header* h = header_of(ptr);
+    size_t capacity = h->size_class == CLASS_LARGE
+                    ? (mm::PAGE_SIZE << h->order) - sizeof(Header)
+                    : (1UL << (h->size_class + MIN_SHIFT)) - sizeof(Header);
+    if (size <= capacity) {
+        h->size = size;
+        return ptr;
+    }
+
+    void* n = kmalloc(size);
+    if (n) {
+        memcpy(n, ptr, h->size);
+        kfree(ptr);
+    }
+    return n;
+}
+
+void kfree(void* ptr)
+{
+    if (!ptr) {
+        return;
+    }
+
+    Header* h = header_of(ptr);
+    if (h->magic != HEAP_MAGIC) {
+        return;     // 非堆指针或重复释放，忽略
+    }
+    h->magic = 0;
+
+    if (h->size_class == CLASS_LARGE) {
+        mm::free_pages(h, h->order);
+        return;
+    }
+
+    unsigned c = h->size_class;
+    FreeObj* f = reinterpret_cast<FreeObj*>(h);
+    SpinGuard guard(g_heap_lock);
+    f->next = g_free[c];
+    g_free[c] = f;
+}
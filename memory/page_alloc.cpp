@@ -0,0 +1,244 @@
+/**
+ * leafOS - 物理页分配器实现 (伙伴系统)
+ *
+ * 每个物理页对应一个字节的描述符: 空闲块的首页记录 FREE|order，其余为0。
+ * 空闲链表直接存放在空闲块自身的内存里，不额外占用空间。
+ */
+
+#include <page_alloc.hpp>
+#include <kstring.hpp>
+#include <spinlock.hpp>
+#include <init.hpp>
+
+namespace mm {
+
+namespace {
+
+constexpr uint8_t DESC_FREE = 0x80;
+
+// 空闲块头部 (位于空闲块自身的第一页)
+struct FreeBlock {
+    FreeBlock* next;
+    FreeBlock* prev;
+};
+
+Spinlock   g_lock;
+FreeBlock* g_free_list[MAX_ORDER + 1];
+uint8_t*   g_desc;              // 页描述符数组，下标为 pfn - g_base_pfn
+uint64_t   g_base_pfn;
+uint64_t   g_end_pfn;
+uint64_t   g_free_pages;
+uint64_t   g_total_pages;
+
+inline FreeBlock* pfn_to_block(uint64_t pfn)
+{
+    return reinterpret_cast<FreeBlock*>(pfn << PAGE_SHIFT);
+}
+
+inline uint64_t block_to_pfn(const void* p)
+{
+    return reinterpret_cast<uintptr_t>(p) >> PAGE_SHIFT;
+}
+
+void list_push(unsigned order, uint64_t pfn)
+{
+    FreeBlock* b = pfn_to_block(pfn);
+    b->prev = nullptr;
+    b->next = g_free_list[order];
+    if (b->next) {
+        b->next->prev = b;
+    }
+    g_free_list[order] = b;
+    g_desc[pfn - g_base_pfn] = DESC_FREE | order;
+}
+
+void list_remove(unsigned order, uint64_t pfn)
+{
+    FreeBlock* b = pfn_to_block(pfn);
+    if (b->prev) {
+        b->prev->next = b->next;
+    } else {
+        g_free_list[order] = b->next;
+    }
+    if (b->next) {
+        b->next->prev = b->prev;
+    }
+    g_desc[pfn - g_base_pfn] = 0;
+}
+
+// 释放一个块并尽可能与伙伴合并 (调用者持锁)
+void free_block(uint64_t pfn, unsigned order)
+{
+    g_free_pages += 1ULL << order;
+
+    while (order < MAX_ORDER) {
+        uint64_t buddy = pfn ^ (1ULL << order);
+        if (buddy < g_base_pfn || buddy + (1ULL << order) > g_end_pfn) {
+            break;
+        }
+        if (g_desc[buddy - g_base_pfn] != (DESC_FREE | order)) {
+            break;
+        }
+        list_remove(order, buddy);
+        pfn &= ~(1ULL << order);
+        order++;
+    }
+    list_push(order, pfn);
+}
+
+// 把一段区间拆成尽可能大的对齐块放入空闲链表 (调用者持锁)
+void free_span(uint64_t pfn, uint64_t pages)
+{
+    while (pages) {
+        unsigned order = MAX_ORDER;
+        while (order && ((pfn & ((1ULL << order) - 1)) || (1ULL << order) > pages)) {
+            order--;
+        }
+        free_block(pfn, order);
+        pfn += 1ULL << order;
+        pages -= 1ULL << order;
+    }
+}
+
+} // namespace
+
+void __init page_alloc_init(const MemRange* ranges, size_t count)
+{
+    uint64_t lo = ~0ULL;
+    uint64_t hi = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        uint64_t pfn = ranges[i].base >> PAGE_SHIFT;
+        // 保留第0页，避免分配出值为nullptr的指针
+        if (pfn == 0 && ranges[i].pages) {
+            pfn = 1;
+        }
+        if (pfn < lo) {
+            lo = pfn;
+        }
+        if ((ranges[i].base >> PAGE_SHIFT) + ranges[i].pages > hi) {
+            hi = (ranges[i].base >> PAGE_SHIFT) + ranges[i].pages;
+        }
+    }
+    if (lo >= hi) {
+        return;
+    }
+
+    // 描述符数组放在第一段足够大的区间的开头
+    uint64_t desc_pages = (hi - lo + PAGE_SIZE - 1) >> PAGE_SHIFT;
+    size_t   desc_range = count;
+    for (size_t i = 0; i < count; i++) {
+        if (ranges[i].base >= PAGE_SIZE && ranges[i].pages >= desc_pages) {
+            desc_range = i;
+            break;
+        }
+    }
+    if (desc_range == count) {
+        return;
+    }
+
+    g_desc = reinterpret_cast<uint8_t*>(ranges[desc_range].base);
+    g_base_pfn = lo;
+    g_end_pfn = hi;
+    memset(g_desc, 0, hi - lo);
+
+    SpinGuard guard(g_lock);
+    for (size_t i = 0; i < count; i++) {
+        uint64_t pfn = ranges[i].base >> PAGE_SHIFT;
+        uint64_t pages = ranges[i].pages;
+        if (i == desc_range) {
+            pfn += desc_pages;
+            pages -= desc_pages;
+        }
+        if (pfn == 0 && pages) {
+            pfn++;
+            pages--;
+        }
+        free_span(pfn, pages);
+        g_total_pages += pages;
+    }
+}
+
+void* alloc_pages(unsigned order)
+{
+    if (order > MAX_ORDER) {
+        return nullptr;
+    }
+
+    SpinGuard guard(g_lock);
+
+    unsigned o = order;
+    while (o <= MAX_ORDER && !g_free_list[o]) {
+        o++;
+    }
+    if (o > MAX_ORDER) {
+        return nullptr;
+    }
+
+    uint64_t pfn = block_to_pfn(g_free_list[o]);
+    list_remove(o, pfn);
+
+    // 大块逐级对半拆分，后一半放回低一级的链表
+    while (o > order) {
+        o--;
+        list_push(o, pfn + (1ULL << o));
+    }
+
+    g_free_pages -= 1ULL << order;
+    return pfn_to_block(pfn);
+}
+
+void* alloc_pages_zeroed(unsigned order)
+{
+    void* p = alloc_pages(order);
+    if (p) {
+        memset(p, 0, PAGE_SIZE << order);
+    }
+    return p;
+}
+
+void free_pages(void* addr, unsigned order)
+{
+    if (!addr) {
+        return;
+    }
+    SpinGuard guard(g_lock);
+    free_block(block_to_pfn(addr), order);
+}
+
+void free_range(uint64_t phys, uint64_t pages)
+{
+    uint64_t pfn = phys >> PAGE_SHIFT;
+
+    // 只接受描述符数组覆盖范围内的页
+    if (pfn < g_base_pfn) {
+        uint64_t skip = g_base_pfn - pfn;
+        if (skip >= pages) {
+            return;
+        }
+        pfn += skip;
+        pages -= skip;
+    }
+    if (pfn >= g_end_pfn) {
+        return;
+    }
+    if (pfn + pages > g_end_pfn) {
+        pages = g_end_pfn - pfn;
+    }
+
+    SpinGuard guard(g_lock);
+    free_span(pfn, pages);
+    g_total_pages += pages;
+}
+
+uint64_t free_page_count()
+{
+    return __atomic_load_n(&g_free_pages, __ATOMIC_RELAXED);
+}
+
+uint64_t total_page_count()
+{
+    return __atomic_load_n(&g_total_pages, __ATOMIC_RELAXED);
+}
+
+} // namespace mm
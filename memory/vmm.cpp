@@ -0,0 +1,239 @@
+/**
+ * leafOS - 虚拟地址空间实现
+ * 页表格式由 arch/paging.hpp 提供，这里只做与体系结构无关的逐级遍历
+ */
+
+#include <vmm.hpp>
+#include <kheap.hpp>
+#include <kstring.hpp>
+#include <kerrno.hpp>
+#include <arch/paging.hpp>
+#include <vdso.hpp>
+
+namespace mm {
+
+namespace {
+
+inline unsigned level_index(uint64_t va, unsigned level)
+{
+    return (va >> (PAGE_SHIFT + 9 * level)) & (arch::PT_ENTRIES - 1);
+}
+
+inline uint64_t* table_ptr(uint64_t pa)
+{
+    return reinterpret_cast<uint64_t*>(pa);
+}
+
+bool in_user_window(uint64_t va, uint64_t len)
+{
+    return va >= USER_BASE && va < USER_END && len <= USER_END - va;
+}
+
+} // namespace
+
+AddressSpace* AddressSpace::kernel()
+{
+    static AddressSpace* space;
+    if (!space) {
+        space = knew<AddressSpace>(arch::current_root());
+    }
+    return space;
+}
+
+AddressSpace* AddressSpace::create()
+{
+    uint64_t* top = static_cast<uint64_t*>(alloc_pages_zeroed(0));
+    if (!top) {
+        return nullptr;
+    }
+
+    // 共享内核部分的顶层表项；用户窗口所在的项留空，由本地址空间自己分配
+    const uint64_t* cur = table_ptr(kernel()->root());
+    unsigned top_level = arch::paging_top_level();
+    unsigned ubegin = level_index(USER_BASE, top_level);
+    unsigned uend = level_index(USER_END - 1, top_level);
+    for (unsigned i = 0; i < arch::PT_ENTRIES; i++) {
+        if (i < ubegin || i > uend) {
+            top[i] = cur[i];
+        }
+    }
+
+    AddressSpace* as = knew<AddressSpace>(reinterpret_cast<uintptr_t>(top));
+    if (!as) {
+        free_pages(top, 0);
+        return nullptr;
+    }
+    // 每个地址空间都有vDSO。失败只可能是内存不足，已建立的中间页表随之丢弃
+    if (vdso_map(as)) {
+        kdelete(as);
+        free_pages(top, 0);
+        return nullptr;
+    }
+    return as;
+}
+
+uint64_t* AddressSpace::walk(uint64_t va, unsigned leaf_level, bool create)
+{
+    uint64_t* table = table_ptr(root_);
+
+    for (unsigned level = arch::paging_top_level(); level > leaf_level; level--) {
+        uint64_t& e = table[level_index(va, level)];
+        if (!arch::pte_present(e)) {
+            if (!create) {
+                return nullptr;
+            }
+            void* next = alloc_pages_zeroed(0);
+            if (!next) {
+                return nullptr;
+            }
+            e = arch::make_table(reinterpret_cast<uintptr_t>(next));
+        } else if (!arch::pte_is_table(e, level)) {
+            return nullptr;     // 已被更大的页映射占用
+        }
+        table = table_ptr(arch::pte_addr(e));
+    }
+    return &table[level_index(va, leaf_level)];
+}
+
+int AddressSpace::map(uint64_t va, uint64_t pa, uint32_t flags)
+{
+    if ((va | pa) & (PAGE_SIZE - 1)) {
+        return -EINVAL;
+    }
+    if ((flags & VM_USER) && !in_user_window(va, PAGE_SIZE)) {
+        return -EFAULT;
+    }
+
+    SpinGuard guard(lock_);
+    uint64_t* e = walk(va, 0, true);
+    if (!e) {
+        return -ENOMEM;
+    }
+    if (arch::pte_present(*e)) {
+        return -EEXIST;
+    }
+    *e = arch::make_leaf(pa, 0, flags & VM_WRITE, flags & VM_USER, flags & VM_EXEC);
+    return 0;
+}
+
+int AddressSpace::map_huge(uint64_t va, uint64_t pa, uint32_t flags)
+{
+    if ((va | pa) & (HUGE_PAGE_SIZE - 1)) {
+        return -EINVAL;
+    }
+    if ((flags & VM_USER) && !in_user_window(va, HUGE_PAGE_SIZE)) {
+        return -EFAULT;
+    }
+
+    SpinGuard guard(lock_);
+    uint64_t* e = walk(va, 1, true);
+    if (!e) {
+        return -ENOMEM;
+    }
+    if (arch::pte_present(*e)) {
+        return -EEXIST;
+    }
+    *e = arch::make_leaf(pa, 1, flags & VM_WRITE, flags & VM_USER, flags & VM_EXEC);
+    return 0;
+}
+
+uint64_t AddressSpace::unmap(uint64_t va)
+{
+    SpinGuard guard(lock_);
+    uint64_t* table = table_ptr(root_);
+
+    for (unsigned level = arch::paging_top_level(); ; level--) {
+        uint64_t& e = table[level_index(va, level)];
+        if (!arch::pte_present(e)) {
+            return 0;
+        }
+        if (level == 0 || !arch::pte_is_table(e, level)) {
+            e = 0;
+            uint64_t size = PAGE_SIZE << (9 * level);
+            arch::flush_tlb_page(va & ~(size - 1));
+            return size;
+        }
+        table = table_ptr(arch::pte_addr(e));
+    }
+}
+
+uint64_t AddressSpace::translate(uint64_t va)
+{
+    SpinGuard guard(lock_);
+    uint64_t* table = table_ptr(root_);
+
+    for (unsigned level = arch::paging_top_level(); ; level--) {
+        uint64_t e = table[level_index(va, level)];
+        if (!arch::pte_present(e)) {
+            return 0;
+        }
+        if (level == 0 || !arch::pte_is_table(e, level)) {
+            uint64_t size = PAGE_SIZE << (9 * level);
+            return arch::pte_addr(e) + (va & (size - 1));
+        }
+        table = table_ptr(arch::pte_addr(e));
+    }
+}
+
+uint64_t AddressSpace::translate_user(uint64_t va, bool write)
+{
+    if (va < USER_BASE || va >= USER_END) {
+        return 0;
+    }
+    SpinGuard guard(lock_);
+    uint64_t* table = table_ptr(root_);
+
+    for (unsigned level = arch::paging_top_level(); ; level--) {
+        uint64_t e = table[level_index(va, level)];
+        if (!arch::pte_present(e)) {
+            return 0;
+        }
+        if (level == 0 || !arch::pte_is_table(e, level)) {
+            if (!arch::pte_user(e) || (write && !arch::pte_writable(e))) {
+                return 0;
+            }
+            uint64_t size = PAGE_SIZE << (9 * level);
+            return arch::pte_addr(e) + (va & (size - 1));
+        }
+        table = table_ptr(arch::pte_addr(e));
+    }
+}
+
+int AddressSpace::set_exec(uint64_t va, bool exec)
+{
+    SpinGuard guard(lock_);
+    uint64_t* table = table_ptr(root_);
+
+    for (unsigned level = arch::paging_top_level(); ; level--) {
+        uint64_t& e = table[level_index(va, level)];
+        if (!arch::pte_present(e)) {
+            return -EFAULT;
+        }
+        if (level > 0 && !arch::pte_is_table(e, level)) {
+            // 大页: 换成逐项映射同一段内存、属性相同的下一级页表，翻译结果不变，
+            // 其他CPU在替换前后用哪一个表项都一样
+            uint64_t* next = static_cast<uint64_t*>(alloc_pages(0));
+            if (!next) {
+                return -ENOMEM;
+            }
+            uint64_t child = PAGE_SIZE << (9 * (level - 1));
+            for (unsigned i = 0; i < arch::PT_ENTRIES; i++) {
+                next[i] = arch::pte_split(e, level, i * child);
+            }
+            e = arch::make_table(reinterpret_cast<uintptr_t>(next));
+        }
+        if (level == 0) {
+            e = exec ? arch::pte_allow_exec(e) : arch::pte_deny_exec(e);
+            arch::flush_tlb_page(va & ~(PAGE_SIZE - 1));
+            return 0;
+        }
+        table = table_ptr(arch::pte_addr(e));
+    }
+}
+
+void AddressSpace::activate()
+{
+    arch::set_root(root_);
+}
+
+} // namespace mm
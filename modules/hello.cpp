@@ -0,0 +1,21 @@
+/**
+ * leafOS - 示例模块
+ * 加载时在串口输出一行，并导出一个函数供之后加载的模块调用。
+ * 构建: make MODULES=hello run-uefi
+ */
+
+#include <module.hpp>
+#include <console.hpp>
+
+extern "C" int hello_add(int a, int b)
+{
+    return a + b;
+}
+EXPORT_SYMBOL(hello_add)
+
+extern "C" int module_init()
+{
+    static const char msg[] = "hello: loaded\n";
+    console::write(msg, sizeof(msg) - 1);
+    return 0;
+}
@@ -0,0 +1,48 @@
+/**
+ * leafOS - 示例实时补丁
+ * 加载时用每次检查8字节的版本替换内核逐字节的strlen，不需要重启。
+ * 构建: make MODULES=strlen_patch run-uefi
+ */
+
+#include <livepatch.hpp>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace {
+
+constexpr uint64_t ONES  = 0x0101010101010101ULL;
+constexpr uint64_t HIGHS = 0x8080808080808080ULL;
+
+typedef uint64_t __attribute__((may_alias)) word_t;     // 按字读取字符数据
+
+// 先逐字节走到8字节对齐，之后按对齐的字读取: 对齐的读不跨页，读到字符串末尾之后也不会出错
+size_t strlen_word(const char* s)
+{
+    const char* p = s;
+    while (reinterpret_cast<uintptr_t>(p) & 7) {
+        if (!*p) {
+            return (size_t)(p - s);
+        }
+        p++;
+    }
+    const word_t* w = reinterpret_cast<const word_t*>(p);
+    while (!((*w - ONES) & ~*w & HIGHS)) {
+        w++;
+    }
+    p = reinterpret_cast<const char*>(w);
+    while (*p) {
+        p++;
+    }
+    return (size_t)(p - s);
+}
+
+const LivepatchFunc g_funcs[] = {
+    LIVEPATCH_FUNC("strlen", strlen_word),
+};
+
+} // namespace
+
+extern "C" int module_init()
+{
+    return livepatch_enable("strlen_patch", g_funcs, sizeof(g_funcs) / sizeof(g_funcs[0]));
+}
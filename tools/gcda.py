@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+"""
+leafOS - 从串口日志还原PGO计数文件
+
+读取 make PGO=gen 构建的内核在串口上输出的 "gcda begin/gcda <十六进制>/gcda end" 记录，
+校验长度和FNV-1a校验和后写成.gcda文件。文件名是编译器按-fprofile-dir规则拼出的名字，
+输出目录应与 make PGO=use 使用的PGO_DIR相同。
+
+同一个文件出现多次(多次运行的日志拼在一起)时，后出现的覆盖前面的。
+
+用法: gcda.py <串口日志> <输出目录>
+"""
+
+import argparse
+import os
+import re
+import sys
+
+BEGIN = re.compile(r"gcda begin (\d+) (\S+)")
+DATA = re.compile(r"gcda ([0-9a-f]+)\s*$")
+END = re.compile(r"gcda end 0x([0-9a-f]+)")
+
+
+def fnv1a(data):
+    h = 0x811C9DC5
+    for b in data:
+        h = ((h ^ b) * 0x01000193) & 0xFFFFFFFF
+    return h
+
+
+def parse(path):
+    """逐个返回(文件名, 内容)；残缺或校验失败的记录给出警告后跳过"""
+    name, size, data = None, 0, None
+    with open(path, errors="replace") as f:
+        for line in f:
+            m = BEGIN.search(line)
+            if m:
+                if name:
+                    print(f"警告: {name} 没有结束标记，已丢弃", file=sys.stderr)
+                size, name, data = int(m.group(1)), m.group(2), bytearray()
+                continue
+            if name is None:
+                continue
+            m = END.search(line)
+            if m:
+                if len(data) != size:
+                    print(f"警告: {name} 长度 {len(data)}，应为 {size}，已丢弃", file=sys.stderr)
+                elif fnv1a(data) != int(m.group(1), 16):
+                    print(f"警告: {name} 校验和不符，已丢弃", file=sys.stderr)
+                else:
+                    yield name, bytes(data)
+                name = None
+                continue
+            m = DATA.search(line)
+            if m:
+                data += bytes.fromhex(m.group(1))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="从串口日志还原.gcda文件")
+    parser.add_argument("log", help="串口日志")
+    parser.add_argument("outdir", help="输出目录(PGO_DIR)")
+    args = parser.parse_args()
+
+    os.makedirs(args.outdir, exist_ok=True)
+    files = {}
+    for name, data in parse(args.log):
+        if "/" in name or name.startswith("."):
+            print(f"警告: 忽略可疑的文件名 {name}", file=sys.stderr)
+            continue
+        files[name] = data
+
+    for name, data in files.items():
+        with open(os.path.join(args.outdir, name), "wb") as f:
+            f.write(data)
+    print(f"已写入 {len(files)} 个.gcda文件到 {args.outdir}")
+    return 0 if files else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+"""
+leafOS - 采样剖析结果转换工具
+
+内核不带符号表(例如gnu-efi构建)时，采样剖析输出的是偏移。本工具读取
+以 make KPROF=1 构建的内核在串口上输出的 "kprof <次数> <偏移>;<偏移>;..." 记录，
+借助nm把每一帧的偏移对应到函数名，合并后按flamegraph.pl的折叠栈格式输出:
+"外层函数;...;被打断的函数 次数"。
+
+除最内层外，各帧记录的是返回地址，指向call指令之后，查找前先减1，
+否则以调用结尾的函数会被算到紧随其后的函数上。
+
+用法: kprof.py <串口日志> <内核ELF> | flamegraph.pl > kprof.svg
+"""
+
+import argparse
+import bisect
+import collections
+import os
+import re
+import subprocess
+import sys
+
+
+def read_samples(path):
+    stacks = []
+    pattern = re.compile(r"kprof (\d+) ((?:0x[0-9a-f]+;)*0x[0-9a-f]+)")
+    with open(path, errors="replace") as f:
+        for line in f:
+            m = pattern.search(line)
+            if m:
+                frames = [int(x, 16) for x in m.group(2).split(";")]
+                stacks.append((int(m.group(1)), frames))
+    return stacks
+
+
+def read_symbols(elf):
+    nm = os.environ.get("NM", "nm")
+    out = subprocess.run([nm, "--defined-only", "-n", "-C", elf],
+                         check=True, capture_output=True, text=True).stdout
+    addrs, names = [], []
+    for line in out.splitlines():
+        parts = line.split(None, 2)
+        if len(parts) == 3 and parts[1] in "tTwW":
+            addrs.append(int(parts[0], 16))
+            names.append(parts[2])
+    return addrs, names
+
+
+def main():
+    ap = argparse.ArgumentParser(description="把kprof记录转换为折叠栈")
+    ap.add_argument("log")
+    ap.add_argument("elf")
+    args = ap.parse_args()
+
+    stacks = read_samples(args.log)
+    if not stacks:
+        sys.exit("%s: 没有找到kprof记录" % args.log)
+    addrs, names = read_symbols(args.elf)
+
+    def symbolize(off):
+        i = bisect.bisect_right(addrs, off) - 1
+        return names[i] if i >= 0 else "0x%x" % off
+
+    folded = collections.Counter()
+    total = 0
+    for count, frames in stacks:
+        # 记录从最外层开始，最后一帧是被打断的位置
+        syms = [symbolize(off if i == len(frames) - 1 else off - 1)
+                for i, off in enumerate(frames)]
+        folded[";".join(s.replace(";", ":") for s in syms)] += count
+        total += count
+
+    for stack, count in sorted(folded.items()):
+        print("%s %d" % (stack, count))
+    print("%d samples, %d stacks" % (total, len(folded)), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
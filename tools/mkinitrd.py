@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+"""
+leafOS - initrd打包工具
+
+把一个目录打包成cpio newc归档。与普通cpio不同，文件名后面用额外的0填充，
+使每个文件的内容都从4K页边界开始，内核可以把归档页直接映射给进程，不需要拷贝。
+
+用法: mkinitrd.py <源目录> <输出文件>
+"""
+
+import os
+import stat
+import sys
+
+PAGE_SIZE = 4096
+HEADER_SIZE = 110
+
+
+def header(ino, mode, nlink, mtime, size, namesize):
+    fields = [ino, mode, 0, 0, nlink, mtime, size, 0, 0, 0, 0, namesize, 0]
+    return b"070701" + b"".join(b"%08X" % f for f in fields)
+
+
+def align(v, a):
+    return (v + a - 1) & ~(a - 1)
+
+
+def add_entry(out, ino, path, name, st):
+    data = b""
+    if stat.S_ISREG(st.st_mode):
+        with open(path, "rb") as f:
+            data = f.read()
+    elif stat.S_ISLNK(st.st_mode):
+        data = os.readlink(path).encode()
+
+    name = name.encode() + b"\0"
+    namesize = len(name)
+    if data and stat.S_ISREG(st.st_mode):
+        # 在名字后补0，直到数据起点落在页边界
+        start = len(out) + HEADER_SIZE
+        namesize = align(start + namesize, PAGE_SIZE) - start
+
+    out += header(ino, st.st_mode, st.st_nlink, int(st.st_mtime), len(data), namesize)
+    out += name.ljust(namesize, b"\0")
+    out += b"\0" * (align(len(out), 4) - len(out))
+    out += data
+    out += b"\0" * (align(len(out), 4) - len(out))
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    root, output = sys.argv[1], sys.argv[2]
+
+    out = bytearray()
+    ino = 1
+    for dirpath, dirnames, filenames in os.walk(root):
+        dirnames.sort()
+        for name in sorted(dirnames) + sorted(filenames):
+            path = os.path.join(dirpath, name)
+            rel = os.path.relpath(path, root)
+            add_entry(out, ino, path, rel, os.lstat(path))
+            ino += 1
+
+    out += header(0, 0, 1, 0, 0, 11) + b"TRAILER!!!\0"
+    out += b"\0" * (align(len(out), 512) - len(out))
+
+    with open(output, "wb") as f:
+        f.write(out)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+"""
+leafOS - 函数排列顺序生成工具
+
+读取插桩内核(make FUNC_PROFILE=1)在串口上输出的 "fprof <偏移> <次数>" 记录，
+借助nm把偏移对应到函数，生成objcopy的参数文件: 把这些函数所在的节依次改名为
+.text.sorted.N，链接脚本按序号把它们连续排在.text的前部。
+
+只排列至少被调用min-calls次的函数(默认2): 只执行一次的启动代码留在原处，
+不占用热区。顺序沿用首次调用的先后，调用链上的函数因此彼此相邻。
+
+用法: mkorder.py [--min-calls N] <串口日志> <插桩内核ELF> > text.order
+"""
+
+import argparse
+import bisect
+import os
+import re
+import subprocess
+import sys
+
+# 同一个函数在-ffunction-sections下可能出现的节名前缀
+SECTION_PREFIXES = (".text.", ".text.hot.", ".text.unlikely.")
+
+
+def read_profile(path):
+    entries = []
+    pattern = re.compile(r"fprof (0x[0-9a-f]+) (\d+)")
+    with open(path, errors="replace") as f:
+        for line in f:
+            m = pattern.search(line)
+            if m:
+                entries.append((int(m.group(1), 16), int(m.group(2))))
+    return entries
+
+
+def read_symbols(elf):
+    nm = os.environ.get("NM", "nm")
+    out = subprocess.run([nm, "--defined-only", "-n", elf],
+                         check=True, capture_output=True, text=True).stdout
+    addrs, names = [], []
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) == 3 and parts[1] in "tTwW":
+            addrs.append(int(parts[0], 16))
+            names.append(parts[2])
+    return addrs, names
+
+
+def main():
+    ap = argparse.ArgumentParser(description="由函数剖析结果生成TEXT_ORDER文件")
+    ap.add_argument("--min-calls", type=int, default=2)
+    ap.add_argument("log")
+    ap.add_argument("elf")
+    args = ap.parse_args()
+
+    entries = read_profile(args.log)
+    if not entries:
+        sys.exit("%s: 没有找到fprof记录" % args.log)
+    addrs, names = read_symbols(args.elf)
+
+    seen = set()
+    order = []
+    for off, count in entries:
+        if count < args.min_calls:
+            continue
+        i = bisect.bisect_right(addrs, off) - 1
+        if i < 0 or addrs[i] != off:
+            continue        # 插桩记录的是函数入口，对不上说明日志与ELF不匹配
+        name = names[i]
+        if name not in seen:
+            seen.add(name)
+            order.append(name)
+
+    for n, name in enumerate(order):
+        for prefix in SECTION_PREFIXES:
+            print("--rename-section %s%s=.text.sorted.%05d" % (prefix, name, n))
+    print("%d functions ordered" % len(order), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""
+leafOS - 内核符号表生成工具
+
+由链接好的内核ELF(nm)生成ksyms.hpp描述的符号表，输出汇编源文件，
+放在ksyms节中的ksym_table处，与内核一起再链接一遍。
+链接脚本把ksyms节放在所有代码之后，加入它不会移动任何函数，两遍链接的函数地址相同。
+
+格式(小端):
+  头部   magic "KSYM", 符号数, 每块符号数, 块数
+  块索引 每块一项: 块首函数的偏移(相对映像基址), 块数据在表中的位置
+  块数据 每个函数: 与上一个函数的偏移差(块首省略), 长度, 与上一个名字相同的前缀长度,
+         其余部分的长度, 其余部分。整数用ULEB128，名字在块首重新开始
+
+名字是去掉参数表的C++函数名；同一地址有多个名字时取第一个全局符号。
+
+用法: mksyms.py <内核ELF> > ksym_table.S
+"""
+
+import os
+import re
+import struct
+import subprocess
+import sys
+
+MAGIC = 0x4D59534B      # "KSYM"
+BLOCK = 16
+NAME_MAX = 127          # KSYM_NAME_LEN - 1
+
+
+def strip_params(name):
+    # GCC克隆出的函数带" [clone .constprop.0]"等后缀，保留为".constprop.0"接在名字后面
+    clones = ""
+    m = re.search(r"( \[clone [^\]]+\])+$", name)
+    if m:
+        clones = "".join(re.findall(r"\[clone ([^\]]+)\]", m.group(0)))
+        name = name[:m.start()]
+    # 去掉最外层的参数表及其后的const等限定，模板参数里的括号不受影响
+    if name.endswith(")") or name.endswith(") const"):
+        depth = 0
+        for i in range(name.rfind(")"), 0, -1):
+            if name[i] == ")":
+                depth += 1
+            elif name[i] == "(":
+                depth -= 1
+                if depth == 0:
+                    name = name[:i]
+                    break
+    return name + clones
+
+
+def read_functions(elf):
+    nm = os.environ.get("NM", "nm")
+    out = subprocess.run([nm, "--defined-only", "-n", "-S", "-C", elf],
+                         check=True, capture_output=True, text=True).stdout
+    # 地址 [长度] 类型 名字；demangle后的名字可能含空格
+    pattern = re.compile(r"^([0-9a-f]+) (?:([0-9a-f]+) )?([tTwW]) (.+)$")
+    funcs = []      # [偏移, 长度, 名字, 是否全局]
+    for line in out.splitlines():
+        m = pattern.match(line)
+        if not m:
+            continue
+        addr, size, name = int(m.group(1), 16), int(m.group(2) or "0", 16), m.group(4)
+        glob = m.group(3) in "TW"
+        if funcs and funcs[-1][0] == addr:
+            prev = funcs[-1]
+            prev[1] = max(prev[1], size)
+            if glob and not prev[3]:
+                prev[2], prev[3] = name, glob
+            continue
+        funcs.append([addr, size, name, glob])
+
+    # 汇编标签等没有长度的符号延伸到下一个函数
+    for i, f in enumerate(funcs):
+        if not f[1] and i + 1 < len(funcs):
+            f[1] = funcs[i + 1][0] - f[0]
+    return [(a, s, strip_params(n)[:NAME_MAX].encode()) for a, s, n, _ in funcs if s]
+
+
+def uleb(v):
+    out = bytearray()
+    while True:
+        b = v & 0x7F
+        v >>= 7
+        if v:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return bytes(out)
+
+
+def build(funcs):
+    blocks = (len(funcs) + BLOCK - 1) // BLOCK
+    header = struct.pack("<4I", MAGIC, len(funcs), BLOCK, blocks)
+    index = bytearray()
+    data = bytearray()
+    data_base = len(header) + blocks * 8
+    for b in range(blocks):
+        chunk = funcs[b * BLOCK:(b + 1) * BLOCK]
+        index += struct.pack("<2I", chunk[0][0], data_base + len(data))
+        prev_addr, prev_name = chunk[0][0], b""
+        for addr, size, name in chunk:
+            if addr != chunk[0][0]:
+                data += uleb(addr - prev_addr)
+            keep = 0
+            while keep < min(len(name), len(prev_name)) and name[keep] == prev_name[keep]:
+                keep += 1
+            data += uleb(size) + bytes([keep, len(name) - keep]) + name[keep:]
+            prev_addr, prev_name = addr, name
+    return header + index + data
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit("用法: mksyms.py <内核ELF> > ksym_table.S")
+    funcs = read_functions(sys.argv[1])
+    if not funcs:
+        sys.exit("%s: 没有找到函数符号" % sys.argv[1])
+    table = build(funcs)
+
+    print("/* 由tools/mksyms.py生成: %d个函数, %d字节 */" % (len(funcs), len(table)))
+    print('.section ksyms, "a"')
+    print(".balign 8")
+    print(".globl ksym_table")
+    print(".hidden ksym_table")
+    print("ksym_table:")
+    for i in range(0, len(table), 16):
+        print("    .byte " + ", ".join(str(b) for b in table[i:i + 16]))
+    print('.section .note.GNU-stack, "", %progbits')
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+"""
+leafOS - 把静态跟踪点的记录转换为Chrome跟踪格式
+
+读取以 make TRACE_EVENTS=... 构建的内核在串口上输出的 "trace ..." 行(格式见kernel/trace.cpp)，
+按事件的格式描述解码各CPU缓冲区中的二进制记录，输出chrome://tracing和Perfetto都能打开的JSON:
+每个CPU是一个线程，时间以启动后最早的一条记录为0。
+
+名字以_begin结尾的事件与同一CPU上随后对应的_end事件组成一段持续时间，片段名取begin事件的
+第一个字符串字段(没有时取去掉_begin的事件名)；其他事件是瞬时事件。字段都放在args中。
+
+用法: trace2json.py <串口日志> [-o 输出文件]
+"""
+
+import argparse
+import json
+import re
+import struct
+import sys
+
+CLOCK = re.compile(r"trace clock (\d+)")
+EVENT = re.compile(r"trace event (\d+) (\S+) (\d+)((?: \S+:[uips]\d+@\d+)*)\s*$")
+FIELD = re.compile(r"(\S+):([uips])(\d+)@(\d+)")
+BEGIN = re.compile(r"trace begin (\d+) (\d+) (\d+)")
+DATA = re.compile(r"trace ([0-9a-f]+)\s*$")
+END = re.compile(r"trace end 0x([0-9a-f]+)")
+
+HEADER = struct.Struct("<QHHI")     # TraceHeader
+
+
+def fnv1a(data):
+    h = 0x811C9DC5
+    for b in data:
+        h = ((h ^ b) * 0x01000193) & 0xFFFFFFFF
+    return h
+
+
+def parse(path):
+    """返回(计数器频率, {事件号: (名字, 字段列表)}, [(cpu, 缓冲区内容, 丢弃数)])"""
+    hz, events, buffers = None, {}, []
+    cpu, size, lost, data = None, 0, 0, None
+    with open(path, errors="replace") as f:
+        for line in f:
+            if cpu is not None:
+                m = END.search(line)
+                if m:
+                    if len(data) != size:
+                        print(f"警告: cpu {cpu} 的记录长度 {len(data)}，应为 {size}，已丢弃",
+                              file=sys.stderr)
+                    elif fnv1a(data) != int(m.group(1), 16):
+                        print(f"警告: cpu {cpu} 的记录校验和不符，已丢弃", file=sys.stderr)
+                    else:
+                        buffers.append((cpu, bytes(data), lost))
+                    cpu = None
+                    continue
+                m = DATA.search(line)
+                if m:
+                    data += bytes.fromhex(m.group(1))
+                    continue
+            m = BEGIN.search(line)
+            if m:
+                if cpu is not None:
+                    print(f"警告: cpu {cpu} 的记录没有结束标记，已丢弃", file=sys.stderr)
+                cpu, size, lost, data = int(m.group(1)), int(m.group(2)), int(m.group(3)), bytearray()
+                continue
+            m = CLOCK.search(line)
+            if m:
+                hz = int(m.group(1))
+                continue
+            m = EVENT.search(line)
+            if m:
+                fields = [(name, kind, int(n), int(off))
+                          for name, kind, n, off in FIELD.findall(m.group(4))]
+                events[int(m.group(1))] = (m.group(2), fields)
+    return hz, events, buffers
+
+
+def decode_field(body, kind, size, off):
+    raw = body[off:off + size]
+    if kind == "s":
+        return raw.split(b"\0", 1)[0].decode("utf-8", "replace")
+    value = int.from_bytes(raw, "little", signed=(kind == "i"))
+    return f"{value:#x}" if kind == "p" else value
+
+
+def records(data, events):
+    """逐条返回(时间戳, 事件名, 字段字典, 第一个字符串字段)"""
+    pos = 0
+    while pos + HEADER.size <= len(data):
+        ts, eid, size, _ = HEADER.unpack_from(data, pos)
+        body = data[pos + HEADER.size:pos + HEADER.size + size]
+        pos += (HEADER.size + size + 7) & ~7
+        if eid not in events:
+            print(f"警告: 未知的事件号 {eid}", file=sys.stderr)
+            continue
+        name, fields = events[eid]
+        args, label = {}, None
+        for fname, kind, fsize, off in fields:
+            args[fname] = decode_field(body, kind, fsize, off)
+            if kind == "s" and label is None:
+                label = args[fname]
+        yield ts, name, args, label
+
+
+def convert(hz, events, buffers):
+    decoded = [(cpu, list(records(data, events))) for cpu, data, _ in buffers]
+    stamps = [r[0] for _, recs in decoded for r in recs]
+    base = min(stamps) if stamps else 0
+
+    out = []
+    for cpu, recs in decoded:
+        out.append({"name": "thread_name", "ph": "M", "pid": 0, "tid": cpu,
+                    "args": {"name": f"cpu {cpu}"}})
+        for ts, name, args, label in recs:
+            ev = {"ts": (ts - base) * 1e6 / hz, "pid": 0, "tid": cpu, "args": args}
+            if name.endswith("_begin"):
+                base_name = name[:-len("_begin")]
+                ev.update(name=label or base_name, cat=base_name, ph="B")
+            elif name.endswith("_end"):
+                base_name = name[:-len("_end")]
+                ev.update(name=label or base_name, cat=base_name, ph="E")
+            else:
+                ev.update(name=name, ph="i", s="t")
+            out.append(ev)
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description="把静态跟踪点的记录转换为Chrome跟踪格式")
+    parser.add_argument("log", help="串口日志")
+    parser.add_argument("-o", "--output", help="输出文件(默认标准输出)")
+    args = parser.parse_args()
+
+    hz, events, buffers = parse(args.log)
+    if not hz or not buffers:
+        print("错误: 日志中没有跟踪记录", file=sys.stderr)
+        return 1
+    for cpu, _, lost in buffers:
+        if lost:
+            print(f"警告: cpu {cpu} 丢弃了 {lost} 条记录", file=sys.stderr)
+
+    trace = {
+        "traceEvents": convert(hz, events, buffers),
+        "displayTimeUnit": "ns",
+        "otherData": {"clock_hz": hz},
+    }
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+        print()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())